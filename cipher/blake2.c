@@ -29,6 +29,7 @@
 #include "bufhelp.h"
 #include "cipher.h"
 #include "hash-common.h"
+#include "kdf-internal.h"
 
 /* USE_AVX indicates whether to compile with Intel AVX code. */
 #undef USE_AVX
@@ -474,6 +475,60 @@ static gcry_err_code_t blake2b_init_ctx(void *ctx, unsigned int flags,
   return blake2b_init(c, key, keylen);
 }
 
+/* Variable-length hash function H' of Argon2 (RFC 9106, section 3.3).
+ * Hash INLEN bytes at IN into OUTPUTLEN bytes at OUTPUT. */
+gcry_err_code_t
+_gcry_blake2b_vl_hash (const void *in, size_t inlen, size_t outputlen,
+                       void *output)
+{
+  gcry_err_code_t ec;
+  BLAKE2B_CONTEXT ctx;
+  byte *out = output;
+  byte buf[4];
+  byte v[BLAKE2B_OUTBYTES];
+
+  ec = blake2b_init_ctx (&ctx, 0, NULL, 0,
+                         (outputlen < BLAKE2B_OUTBYTES
+                          ? outputlen : BLAKE2B_OUTBYTES) * 8);
+  if (ec)
+    return ec;
+
+  buf_put_le32 (buf, outputlen);
+  blake2b_write (&ctx, buf, 4);
+  blake2b_write (&ctx, in, inlen);
+  blake2b_final (&ctx);
+
+  if (outputlen <= BLAKE2B_OUTBYTES)
+    {
+      memcpy (out, ctx.buf, outputlen);
+      goto leave;
+    }
+
+  /* Output first half of each V_i until at most 64 bytes remain.  */
+  memcpy (v, ctx.buf, BLAKE2B_OUTBYTES);
+  while (outputlen > BLAKE2B_OUTBYTES)
+    {
+      memcpy (out, v, BLAKE2B_OUTBYTES / 2);
+      out += BLAKE2B_OUTBYTES / 2;
+      outputlen -= BLAKE2B_OUTBYTES / 2;
+
+      ec = blake2b_init_ctx (&ctx, 0, NULL, 0,
+                             (outputlen < BLAKE2B_OUTBYTES
+                              ? outputlen : BLAKE2B_OUTBYTES) * 8);
+      if (ec)
+        goto leave;
+      blake2b_write (&ctx, v, BLAKE2B_OUTBYTES);
+      blake2b_final (&ctx);
+      memcpy (v, ctx.buf, BLAKE2B_OUTBYTES);
+    }
+  memcpy (out, v, outputlen);
+
+ leave:
+  wipememory (v, sizeof (v));
+  wipememory (&ctx, sizeof (ctx));
+  return ec;
+}
+
 static inline void blake2s_set_lastblock(BLAKE2S_STATE *S)
 {
   S->f[0] = 0xFFFFFFFFUL;
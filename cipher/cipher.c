@@ -678,6 +678,53 @@ _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
 }
 
 
+/* Create a new cipher handle at HANDLE as an exact copy of SRC,
+   including the key schedule and the mode state.  */
+gcry_err_code_t
+_gcry_cipher_copy_internal (gcry_cipher_hd_t *handle, gcry_cipher_hd_t src)
+{
+  int secure = (src->magic == CTX_MAGIC_SECURE);
+  gcry_cipher_hd_t h;
+  size_t size, off = 0;
+
+  size = src->actual_handle_size;
+#ifdef NEED_16BYTE_ALIGNED_CONTEXT
+  size += 15;  /* Space for leading alignment gap.  */
+#endif /*NEED_16BYTE_ALIGNED_CONTEXT*/
+
+  if (secure)
+    h = xtrymalloc_secure (size);
+  else
+    h = xtrymalloc (size);
+  if (!h)
+    {
+      *handle = NULL;
+      return gpg_err_code_from_syserror ();
+    }
+
+#ifdef NEED_16BYTE_ALIGNED_CONTEXT
+  if ( ((uintptr_t)h & 0x0f) )
+    {
+      off = 16 - ((uintptr_t)h & 0x0f);
+      h = (void*)((char*)h + off);
+    }
+#endif /*NEED_16BYTE_ALIGNED_CONTEXT*/
+
+  memcpy (h, src, src->actual_handle_size);
+  h->actual_handle_size = size - off;
+  h->handle_offset = off;
+
+  /* Relocate pointers into the handle itself.  */
+  if (src->mode == GCRY_CIPHER_MODE_XTS)
+    h->u_mode.xts.tweak_context = ((char *)h
+                                   + (src->u_mode.xts.tweak_context
+                                      - (char *)src));
+
+  *handle = h;
+  return 0;
+}
+
+
 /* Release all resources associated with the cipher handle H. H may be
    NULL in which case this is a no-operation. */
 void
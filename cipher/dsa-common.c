@@ -416,3 +416,154 @@ _gcry_dsa_normalize_hash (gcry_mpi_t input,
 
   return rc;
 }
+
+
+/* Cache of comb tables for the exponentiations G^K mod P with the
+   generator G of the domains of DSA and Elgamal.  A table is created
+   on the second exponentiation for a domain, so that domains which
+   are used only once, for example during key generation, do not pay
+   for it.  The list is kept in most recently used order; items with
+   exponentiations in progress are not removed.  */
+struct dl_comb_item
+{
+  struct dl_comb_item *next;
+  gcry_mpi_t p;         /* The modulus and ...  */
+  gcry_mpi_t g;         /* ... the generator of the domain.  */
+  unsigned int nbits;   /* Size of the exponents.  */
+  unsigned int uses;    /* Number of uses up to DL_COMB_MIN_USES.  */
+  unsigned int refs;    /* Number of users of COMB.  */
+  mpi_powm_comb_t comb;
+};
+static struct dl_comb_item *dl_comb_cache;
+GPGRT_LOCK_DEFINE (dl_comb_cache_lock);
+
+/* The number of domains in the cache.  */
+#define DL_COMB_CACHE_SIZE 4
+
+/* The number of uses of a domain after which its table is created.  */
+#define DL_COMB_MIN_USES 2
+
+
+static void
+dl_comb_cache_lock_lock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_lock (&dl_comb_cache_lock);
+  if (err)
+    log_fatal ("failed to acquire the comb cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+static void
+dl_comb_cache_lock_unlock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_unlock (&dl_comb_cache_lock);
+  if (err)
+    log_fatal ("failed to release the comb cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+static void
+dl_comb_item_free (struct dl_comb_item *item)
+{
+  _gcry_mpi_release (item->p);
+  _gcry_mpi_release (item->g);
+  _gcry_mpi_powm_comb_free (item->comb);
+  xfree (item);
+}
+
+
+/* Return the comb table for G and P with exponents of NBITS bits or
+   NULL if there is none yet.  A returned table must be released with
+   dl_comb_put.  */
+static struct dl_comb_item *
+dl_comb_get (gcry_mpi_t g, gcry_mpi_t p, unsigned int nbits)
+{
+  struct dl_comb_item **pp, *item, *tmp;
+  unsigned int n;
+
+  dl_comb_cache_lock_lock ();
+  for (pp = &dl_comb_cache; (item = *pp); pp = &item->next)
+    if (item->nbits == nbits && !mpi_cmp (item->p, p) && !mpi_cmp (item->g, g))
+      {
+        *pp = item->next;
+        break;
+      }
+
+  if (!item)
+    {
+      item = xtrycalloc (1, sizeof *item);
+      if (!item)
+        {
+          dl_comb_cache_lock_unlock ();
+          return NULL;
+        }
+      item->p = mpi_copy (p);
+      item->g = mpi_copy (g);
+      item->nbits = nbits;
+    }
+  item->next = dl_comb_cache;
+  dl_comb_cache = item;
+  for (n = 1, pp = &item->next; (tmp = *pp); )
+    if (n >= DL_COMB_CACHE_SIZE && !tmp->refs)
+      {
+        *pp = tmp->next;
+        dl_comb_item_free (tmp);
+      }
+    else
+      {
+        pp = &tmp->next;
+        n++;
+      }
+
+  if (item->uses < DL_COMB_MIN_USES
+      && ++item->uses == DL_COMB_MIN_USES)
+    item->comb = _gcry_mpi_powm_comb_new (g, p, nbits);
+  if (item->comb)
+    item->refs++;
+  else
+    item = NULL;
+  dl_comb_cache_lock_unlock ();
+
+  return item;
+}
+
+
+/* Release the comb table ITEM returned by dl_comb_get.  */
+static void
+dl_comb_put (struct dl_comb_item *item)
+{
+  dl_comb_cache_lock_lock ();
+  item->refs--;
+  dl_comb_cache_lock_unlock ();
+}
+
+
+/*
+ * RES = G^K mod P for a secret K of at most NBITS bits, where G is the
+ * generator of a domain which is likely to be used again.  A cached
+ * table for the fixed base G is used if available; it turns most of
+ * the squarings of the exponentiation into a single scan of the table
+ * per column of K and keeps the sequence of operations and the memory
+ * access pattern independent of K.
+ */
+void
+_gcry_dl_powm_base (gcry_mpi_t res, gcry_mpi_t g, gcry_mpi_t k,
+                    gcry_mpi_t p, unsigned int nbits)
+{
+  struct dl_comb_item *item;
+
+  item = dl_comb_get (g, p, nbits);
+  if (!item)
+    {
+      mpi_powm (res, g, k, p);
+      return;
+    }
+  _gcry_mpi_powm_comb (res, k, item->comb);
+  dl_comb_put (item);
+}
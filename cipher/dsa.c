@@ -333,7 +333,10 @@ generate (DSA_secret_key *sk, unsigned int nbits, unsigned int qbits,
 
   /* y = g^x mod p */
   y = mpi_alloc( mpi_get_nlimbs(p) );
-  mpi_powm (y, g, x, p);
+  if (domain->p && domain->q && domain->g)
+    _gcry_dl_powm_base (y, g, x, p, qbits);
+  else
+    mpi_powm (y, g, x, p);
 
   if( DBG_CIPHER )
     {
@@ -506,7 +509,10 @@ generate_fips186 (DSA_secret_key *sk, unsigned int nbits, unsigned int qbits,
 
   /* y = g^x mod p */
   value_y = mpi_alloc_like (prime_p);
-  mpi_powm (value_y, value_g, value_x, prime_p);
+  if (domain->p && domain->q && domain->g)
+    _gcry_dl_powm_base (value_y, value_g, value_x, prime_p, qbits);
+  else
+    mpi_powm (value_y, value_g, value_x, prime_p);
 
   if (DBG_CIPHER)
     {
@@ -643,8 +649,8 @@ sign (gcry_mpi_t r, gcry_mpi_t s, gcry_mpi_t input, DSA_secret_key *skey,
 
   _gcry_dsa_modify_k (k, skey->q, qbits);
 
-  /* r = (a^k mod p) mod q */
-  mpi_powm( r, skey->g, k, skey->p );
+  /* r = (a^k mod p) mod q.  K has at most QBITS + 1 bits now.  */
+  _gcry_dl_powm_base (r, skey->g, k, skey->p, qbits + 1);
   mpi_fdiv_r( r, r, skey->q );
 
   /* s = (kinv * ( hash + x * r)) mod q */
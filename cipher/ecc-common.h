@@ -117,6 +117,12 @@ gpg_err_code_t _gcry_ecc_eddsa_verify (gcry_mpi_t input,
                                        mpi_ec_t ec,
                                        gcry_mpi_t r, gcry_mpi_t s,
                                        struct pk_encoding_ctx *ctx);
+gpg_err_code_t _gcry_ecc_eddsa_verify_batch (unsigned int count,
+                                             gcry_mpi_t *input,
+                                             mpi_ec_t *ec,
+                                             gcry_mpi_t *r, gcry_mpi_t *s,
+                                             struct pk_encoding_ctx **ctx,
+                                             gpg_err_code_t *results);
 void reverse_buffer (unsigned char *buffer, unsigned int length);
 
 
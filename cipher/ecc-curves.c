@@ -1375,6 +1375,167 @@ _gcry_mpi_ec_new (gcry_ctx_t *r_ctx,
 }
 
 
+/* Comb tables for the base points of the curves in DOMAIN_PARMS.
+   They are created on first use and then shared by all contexts for
+   the same curve until the process terminates.  EC is a context with
+   the standard parameters of the curve.  */
+static struct
+{
+  int tried;            /* Creation of the table has been tried.  */
+  mpi_ec_t ec;
+  mpi_ec_comb_t comb;
+} base_combs[DIM (domain_parms) - 1];
+GPGRT_LOCK_DEFINE (base_combs_lock);
+
+
+/* Return true if A and B have the same value.  Other than mpi_cmp
+   this does not normalize A or B which would break the fixed size
+   field functions.  */
+static int
+param_equal_p (gcry_mpi_t a, gcry_mpi_t b)
+{
+  mpi_size_t asize, bsize;
+
+  if (!a || !b || mpi_is_opaque (a) || mpi_is_opaque (b))
+    return 0;
+  asize = a->nlimbs;
+  bsize = b->nlimbs;
+  MPN_NORMALIZE (a->d, asize);
+  MPN_NORMALIZE (b->d, bsize);
+  return (asize == bsize && a->sign == b->sign
+          && (!asize || !_gcry_mpih_cmp (a->d, b->d, asize)));
+}
+
+
+/* Create the comb table for the curve with index IDX.  */
+static void
+base_comb_create (int idx)
+{
+  elliptic_curve_t E;
+  mpi_ec_t ec;
+  unsigned int nbits;
+
+  memset (&E, 0, sizeof E);
+  if (domain_parms[idx].model == MPI_EC_MONTGOMERY
+      || _gcry_ecc_fill_in_curve (0, domain_parms[idx].desc, &E, NULL))
+    goto leave;
+
+  ec = _gcry_mpi_ec_p_internal_new (E.model, E.dialect, 0, E.p, E.a, E.b);
+  if (mpi_ec_setup_elliptic_curve (ec, 0, &E, NULL))
+    {
+      _gcry_mpi_ec_free (ec);
+      goto leave;
+    }
+
+  nbits = mpi_get_nbits (ec->p);
+  if (mpi_get_nbits (ec->n) > nbits)
+    nbits = mpi_get_nbits (ec->n);
+  base_combs[idx].comb = _gcry_mpi_ec_comb_new (ec->G, nbits, ec);
+  if (base_combs[idx].comb)
+    base_combs[idx].ec = ec;
+  else
+    _gcry_mpi_ec_free (ec);
+
+ leave:
+  _gcry_ecc_curve_free (&E);
+}
+
+
+/* Return the context with the standard parameters of the curve used
+   by EC if the field and the curve equation of EC are those of the
+   named curve or NULL otherwise.  The shared comb table for the
+   standard base point is stored at R_COMB; it may be NULL.  */
+static mpi_ec_t
+get_std_ec (mpi_ec_t ec, mpi_ec_comb_t *r_comb)
+{
+  mpi_ec_t std;
+  gpg_err_code_t err;
+  int idx;
+
+  *r_comb = NULL;
+  if (!ec->name || ec->model == MPI_EC_MONTGOMERY)
+    return NULL;
+  idx = find_domain_parms_idx (ec->name);
+  if (idx < 0)
+    return NULL;
+
+  err = gpgrt_lock_lock (&base_combs_lock);
+  if (err)
+    log_fatal ("failed to acquire the base point table lock: %s\n",
+               gpg_strerror (err));
+  if (!base_combs[idx].tried)
+    {
+      base_combs[idx].tried = 1;
+      base_comb_create (idx);
+    }
+  std = base_combs[idx].ec;
+  if (std
+      && std->model == ec->model
+      && std->dialect == ec->dialect
+      && param_equal_p (std->p, ec->p)
+      && param_equal_p (std->a, ec->a)
+      && param_equal_p (std->b, ec->b))
+    *r_comb = base_combs[idx].comb;
+  else
+    std = NULL;
+  err = gpgrt_lock_unlock (&base_combs_lock);
+  if (err)
+    log_fatal ("failed to release the base point table lock: %s\n",
+               gpg_strerror (err));
+
+  return std;
+}
+
+
+/* Return the shared comb table for the standard base point of the
+   curve used by EC or NULL if there is none.  The table is only
+   returned if the domain parameters of EC are those of the named
+   curve; the caller still needs to check that a point is the base
+   point of the table.  */
+mpi_ec_comb_t
+_gcry_ecc_get_base_comb (mpi_ec_t ec)
+{
+  mpi_ec_comb_t comb;
+
+  get_std_ec (ec, &comb);
+  return comb;
+}
+
+
+/* Return true if all domain parameters of EC including the base point
+   and its order are those of the named curve EC->NAME.  */
+int
+_gcry_ecc_std_domain_p (mpi_ec_t ec)
+{
+  mpi_ec_comb_t comb;
+  mpi_ec_t std;
+
+  std = get_std_ec (ec, &comb);
+  return (std && ec->G && std->h == ec->h
+          && param_equal_p (std->n, ec->n)
+          && param_equal_p (std->G->x, ec->G->x)
+          && param_equal_p (std->G->y, ec->G->y)
+          && param_equal_p (std->G->z, ec->G->z));
+}
+
+
+/* Return true if the contexts A and B are for the same curve with
+   the same base point.  */
+int
+_gcry_ecc_same_curve_p (mpi_ec_t a, mpi_ec_t b)
+{
+  return (a->model == b->model && a->dialect == b->dialect
+          && a->nbits == b->nbits && a->h == b->h && a->G && b->G
+          && param_equal_p (a->p, b->p)
+          && param_equal_p (a->a, b->a)
+          && param_equal_p (a->b, b->b)
+          && param_equal_p (a->n, b->n)
+          && param_equal_p (a->G->x, b->G->x)
+          && param_equal_p (a->G->y, b->G->y)
+          && param_equal_p (a->G->z, b->G->z));
+}
+
+
 /* Return the parameters of the curve NAME as an S-expression.  */
 gcry_sexp_t
 _gcry_ecc_get_param_sexp (const char *name)
@@ -1520,6 +1681,7 @@ _gcry_ecc_set_mpi (const char *name, gcry_mpi_t newvalue, mpi_ec_t ec)
     {
       mpi_free (ec->b);
       ec->b = mpi_copy (newvalue);
+      _gcry_mpi_ec_get_reset (ec);
     }
   else if (!strcmp (name, "n"))
     {
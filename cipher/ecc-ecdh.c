@@ -74,7 +74,29 @@ _gcry_ecc_mul_point (int curveid, unsigned char *result,
   unsigned char *buf;
 
   if (curveid == GCRY_ECC_CURVE25519)
-    curve = "Curve25519";
+    {
+#ifdef USE_FE25519_51
+      /* Use the fixed-size code without setting up a context.  The
+         clamping is the same as in _gcry_mpi_ec_mul_point.  */
+      static const unsigned char basepoint[ECC_CURVE25519_BYTES] = { 9 };
+      unsigned char k[ECC_CURVE25519_BYTES];
+
+      /* Curve25519 is not allowed in FIPS mode; this check is
+         otherwise done when the context is created.  */
+      if (fips_mode ())
+        return gpg_error (GPG_ERR_NOT_SUPPORTED);
+
+      memcpy (k, scalar, ECC_CURVE25519_BYTES);
+      k[0] &= 0xf8;
+      k[ECC_CURVE25519_BYTES - 1] &= 0x7f;
+      k[ECC_CURVE25519_BYTES - 1] |= 0x40;
+      _gcry_mpi_ec_x25519 (result, k, point? point : basepoint);
+      wipememory (k, sizeof k);
+      return 0;
+#else
+      curve = "Curve25519";
+#endif
+    }
   else if (curveid == GCRY_ECC_CURVE448)
     curve = "X448";
   else
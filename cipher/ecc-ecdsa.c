@@ -169,7 +169,7 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, mpi_ec_t ec,
 {
   gpg_err_code_t err = 0;
   gcry_mpi_t hash, h, h1, h2, x;
-  mpi_point_struct Q, Q1, Q2;
+  mpi_point_struct Q;
   unsigned int nbits;
 
   if (!_gcry_mpi_ec_curve_point (ec->Q, ec))
@@ -190,21 +190,15 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, mpi_ec_t ec,
   h2 = mpi_alloc (0);
   x = mpi_alloc (0);
   point_init (&Q);
-  point_init (&Q1);
-  point_init (&Q2);
 
   /* h  = s^(-1) (mod n) */
   mpi_invm (h, s, ec->n);
   /* h1 = hash * s^(-1) (mod n) */
   mpi_mulm (h1, hash, h, ec->n);
-  /* Q1 = [ hash * s^(-1) ]G  */
-  _gcry_mpi_ec_mul_point (&Q1, h1, ec->G, ec);
   /* h2 = r * s^(-1) (mod n) */
   mpi_mulm (h2, r, h, ec->n);
-  /* Q2 = [ r * s^(-1) ]Q */
-  _gcry_mpi_ec_mul_point (&Q2, h2, ec->Q, ec);
   /* Q  = ([hash * s^(-1)]G) + ([r * s^(-1)]Q) */
-  _gcry_mpi_ec_add_points (&Q, &Q1, &Q2, ec);
+  _gcry_mpi_ec_mul_point2 (&Q, h1, ec->G, h2, ec->Q, ec);
 
   if (!mpi_cmp_ui (Q.z, 0))
     {
@@ -234,8 +228,6 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, mpi_ec_t ec,
     }
 
  leave:
-  point_free (&Q2);
-  point_free (&Q1);
   point_free (&Q);
   mpi_free (x);
   mpi_free (h2);
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 
 #include "g10lib.h"
 #include "mpi.h"
@@ -800,14 +801,38 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, mpi_ec_t ec,
     log_printhex ("     r", digest, digestlen);
   _gcry_mpi_set_buffer (r, digest, digestlen, 0);
   mpi_mod (r, r, ec->n);
-  _gcry_mpi_ec_mul_point (&I, r, ec->G, ec);
-  if (DBG_CIPHER)
-    log_printpnt ("   r", &I, ec);
-
-  /* Convert R into affine coordinates and apply encoding.  */
-  rc = _gcry_ecc_eddsa_encodepoint (&I, ec, x, y, 0, &rawmpi, &rawmpilen);
-  if (rc)
-    goto leave;
+#ifdef USE_FE25519_51
+  if (ec->nbits == 255 && ec->dialect == ECC_DIALECT_ED25519
+      && _gcry_ecc_std_domain_p (ec))
+    {
+      /* Use the fixed-size implementation with its precomputed table
+         of the base point.  */
+      rawmpi = xtrymalloc (32);
+      if (!rawmpi)
+        {
+          rc = gpg_err_code_from_syserror ();
+          goto leave;
+        }
+      rawmpilen = 32;
+      if (!_gcry_mpi_ec_ed25519_mul_base (rawmpi, r))
+        {
+          xfree (rawmpi);
+          rawmpi = NULL;
+        }
+    }
+#endif /*USE_FE25519_51*/
+  if (!rawmpi)
+    {
+      _gcry_mpi_ec_mul_point (&I, r, ec->G, ec);
+      if (DBG_CIPHER)
+        log_printpnt ("   r", &I, ec);
+
+      /* Convert R into affine coordinates and apply encoding.  */
+      rc = _gcry_ecc_eddsa_encodepoint (&I, ec, x, y, 0,
+                                        &rawmpi, &rawmpilen);
+      if (rc)
+        goto leave;
+    }
   if (DBG_CIPHER)
     log_printhex ("   e_r", rawmpi, rawmpilen);
 
@@ -889,13 +914,17 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, mpi_ec_t ec,
 }
 
 
-/* Verify an EdDSA signature.  See sign_eddsa for the reference.
- * Check if R_IN and S_IN verifies INPUT.
+/* Prepare the verification of the EdDSA signature R_IN, S_IN on
+ * INPUT: Check the public key and the lengths and compute H and S of
+ * the verification equation  encodepoint(sG - h·Q) = encodepoint(r).
+ * On success *R_RBUF and *R_RLEN are set to the encoded R.
  */
-gpg_err_code_t
-_gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
-                        gcry_mpi_t r_in, gcry_mpi_t s_in,
-                        struct pk_encoding_ctx *ctx)
+static gpg_err_code_t
+eddsa_verify_prepare (gcry_mpi_t input, mpi_ec_t ec,
+                      gcry_mpi_t r_in, gcry_mpi_t s_in,
+                      struct pk_encoding_ctx *ctx,
+                      gcry_mpi_t h, gcry_mpi_t s,
+                      const void **r_rbuf, size_t *r_rlen)
 {
   int rc;
   int b;
@@ -903,12 +932,8 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
   unsigned char *encpk = NULL; /* Encoded public key.  */
   unsigned int encpklen;
   const void *mbuf, *rbuf;
-  unsigned char *tbuf = NULL;
   size_t mlen, rlen;
-  unsigned int tlen;
   unsigned char digest[114];
-  gcry_mpi_t h, s;
-  mpi_point_struct Ia, Ib;
   const char *dom;
   int domlen, digestlen;
   int i;
@@ -938,11 +963,6 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
   else
     return GPG_ERR_NOT_IMPLEMENTED;
 
-  point_init (&Ia);
-  point_init (&Ib);
-  h = mpi_new (0);
-  s = mpi_new (0);
-
   /* Encode and check the public key.  */
   rc = _gcry_ecc_eddsa_encodepoint (ec->Q, ec, NULL, NULL, 0,
                                     &encpk, &encpklen);
@@ -1031,6 +1051,17 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
   if (DBG_CIPHER)
     log_printhex (" H(R+)", digest, digestlen);
   _gcry_mpi_set_buffer (h, digest, digestlen, 0);
+  if (ec->h)
+    {
+      /* Q is on the curve and thus its order divides cofactor·n.
+         Reducing h modulo this does not change h·Q but halves the
+         number of point doublings.  */
+      gcry_mpi_t order = mpi_new (0);
+
+      mpi_mul_ui (order, ec->n, ec->h);
+      mpi_mod (h, h, order);
+      mpi_free (order);
+    }
 
   /* According to the paper the best way for verification is:
          encodepoint(sG - h·Q) = encodepoint(r)
@@ -1053,27 +1084,388 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
       }
   }
 
-  _gcry_mpi_ec_mul_point (&Ia, s, ec->G, ec);
-  _gcry_mpi_ec_mul_point (&Ib, h, ec->Q, ec);
-  _gcry_mpi_sub (Ib.x, ec->p, Ib.x);
-  _gcry_mpi_ec_add_points (&Ia, &Ia, &Ib, ec);
+  *r_rbuf = rbuf;
+  *r_rlen = rlen;
+  rc = 0;
+
+ leave:
+  xfree (encpk);
+  return rc;
+}
+
+
+/* Compute RESULT = sG - h·Q for the values computed by
+ * eddsa_verify_prepare.  H is used as scratch space.
+ */
+static void
+eddsa_verify_point (mpi_point_t result, mpi_ec_t ec,
+                    gcry_mpi_t h, gcry_mpi_t s)
+{
+  mpi_point_struct Ib;
+  gcry_mpi_t order;
+
+  if (ec->h)
+    {
+      /* H has been reduced modulo cofactor·n which is a multiple of
+         the order of Q.  Thus -h·Q = (cofactor·n - h)·Q; using Q
+         itself allows for a precomputed table of Q.  */
+      order = mpi_new (0);
+      mpi_mul_ui (order, ec->n, ec->h);
+      if (mpi_cmp_ui (h, 0))
+        mpi_sub (h, order, h);
+      mpi_free (order);
+      _gcry_mpi_ec_mul_point2 (result, s, ec->G, h, ec->Q, ec);
+    }
+  else
+    {
+      /* Ib = -Q, so that RESULT = sG + h·Ib.  */
+      point_init (&Ib);
+      point_set (&Ib, ec->Q);
+      mpi_subm (Ib.x, ec->p, Ib.x, ec->p);
+      _gcry_mpi_ec_mul_point2 (result, s, ec->G, h, &Ib, ec);
+      point_free (&Ib);
+    }
+}
+
+
+/* Check the verification equation  encodepoint(sG - h·Q) = RBUF  for
+ * the values computed by eddsa_verify_prepare.  S and H are used as
+ * scratch space.
+ */
+static gpg_err_code_t
+eddsa_verify_check (mpi_ec_t ec, gcry_mpi_t h, gcry_mpi_t s,
+                    const void *rbuf, size_t rlen)
+{
+  gpg_err_code_t rc;
+  unsigned char *tbuf = NULL;
+  unsigned int tlen;
+  mpi_point_struct Ia;
+
+#ifdef USE_FE25519_51
+  if (ec->nbits == 255 && ec->dialect == ECC_DIALECT_ED25519
+      && rlen == 32 && _gcry_ecc_std_domain_p (ec))
+    {
+      unsigned char buf[32];
+
+      /* Use the fixed-size implementation which falls back to the
+         generic code for out of range values.  */
+      if (_gcry_mpi_ec_ed25519_mul_double (buf, s, h, ec->Q))
+        return memcmp (buf, rbuf, 32)? GPG_ERR_BAD_SIGNATURE : 0;
+    }
+#endif /*USE_FE25519_51*/
+
+  point_init (&Ia);
+  eddsa_verify_point (&Ia, ec, h, s);
   rc = _gcry_ecc_eddsa_encodepoint (&Ia, ec, s, h, 0, &tbuf, &tlen);
   if (rc)
     goto leave;
   if (tlen != rlen || memcmp (tbuf, rbuf, tlen))
+    rc = GPG_ERR_BAD_SIGNATURE;
+
+ leave:
+  xfree (tbuf);
+  point_free (&Ia);
+  return rc;
+}
+
+
+/* Decode the point R_IN of an EdDSA signature into RESULT.  Returns
+ * false if R_IN is not the canonical encoding of a curve point.
+ */
+static int
+eddsa_decode_r (gcry_mpi_t r_in, mpi_ec_t ec, mpi_point_t result)
+{
+#ifdef USE_FE25519_51
+  if (ec->nbits == 255 && ec->dialect == ECC_DIALECT_ED25519
+      && mpi_is_opaque (r_in) && _gcry_ecc_std_domain_p (ec))
     {
-      rc = GPG_ERR_BAD_SIGNATURE;
-      goto leave;
+      unsigned int nbits;
+      const unsigned char *buf = mpi_get_opaque (r_in, &nbits);
+
+      if (nbits == 256)
+        return _gcry_mpi_ec_ed25519_decodepoint (result, buf);
     }
+#endif /*USE_FE25519_51*/
 
-  rc = 0;
+  return (!_gcry_ecc_eddsa_decodepoint (r_in, ec, result, NULL, NULL)
+          && mpi_cmp (result->x, ec->p) < 0
+          && mpi_cmp (result->y, ec->p) < 0);
+}
 
- leave:
-  xfree (encpk);
-  xfree (tbuf);
+
+/* Return true if the cofactor of EC times the point P is the neutral
+ * element.
+ */
+static int
+eddsa_cofactor_neutral_p (mpi_point_t p, mpi_ec_t ec)
+{
+  mpi_point_struct t;
+  gcry_mpi_t c, x, y;
+  int ok;
+
+  c = mpi_alloc_set_ui (ec->h? ec->h : 1);
+  x = mpi_new (0);
+  y = mpi_new (0);
+  point_init (&t);
+  _gcry_mpi_ec_mul_point (&t, c, p, ec);
+  ok = (!_gcry_mpi_ec_get_affine (x, y, &t, ec)
+        && !mpi_cmp_ui (x, 0) && !mpi_cmp_ui (y, 1));
+  point_free (&t);
+  mpi_free (y);
+  mpi_free (x);
+  mpi_free (c);
+  return ok;
+}
+
+
+/* Check the cofactored verification equation  c·(sG - h·Q - R) = 0
+ * for the values computed by eddsa_verify_prepare and the point R_IN
+ * of the signature, whose encoding is RBUF.  S and H are used as
+ * scratch space.
+ */
+static gpg_err_code_t
+eddsa_verify_check_cofactored (mpi_ec_t ec, gcry_mpi_t h, gcry_mpi_t s,
+                               gcry_mpi_t r_in, const void *rbuf, size_t rlen)
+{
+  gpg_err_code_t rc;
+  mpi_point_struct Ia, R;
+
+#ifdef USE_FE25519_51
+  if (ec->nbits == 255 && ec->dialect == ECC_DIALECT_ED25519
+      && rlen == 32 && _gcry_ecc_std_domain_p (ec))
+    {
+      unsigned char buf[32];
+
+      /* A signature which passes the default check passes the
+         cofactored check as well.  */
+      if (_gcry_mpi_ec_ed25519_mul_double (buf, s, h, ec->Q)
+          && !memcmp (buf, rbuf, 32))
+        return 0;
+    }
+#endif /*USE_FE25519_51*/
+
+  point_init (&Ia);
+  point_init (&R);
+  if (!eddsa_decode_r (r_in, ec, &R))
+    rc = GPG_ERR_BAD_SIGNATURE;
+  else
+    {
+      eddsa_verify_point (&Ia, ec, h, s);
+      mpi_subm (R.x, ec->p, R.x, ec->p);
+      mpi_point_resize (&R, ec);
+      _gcry_mpi_ec_add_points (&Ia, &Ia, &R, ec);
+      rc = eddsa_cofactor_neutral_p (&Ia, ec)? 0 : GPG_ERR_BAD_SIGNATURE;
+    }
+  point_free (&R);
+  point_free (&Ia);
+  return rc;
+}
+
+
+/* Verify an EdDSA signature.  See sign_eddsa for the reference.
+ * Check if R_IN and S_IN verifies INPUT.
+ */
+gpg_err_code_t
+_gcry_ecc_eddsa_verify (gcry_mpi_t input, mpi_ec_t ec,
+                        gcry_mpi_t r_in, gcry_mpi_t s_in,
+                        struct pk_encoding_ctx *ctx)
+{
+  gpg_err_code_t rc;
+  const void *rbuf;
+  size_t rlen;
+  gcry_mpi_t h, s;
+
+  h = mpi_new (0);
+  s = mpi_new (0);
+  rc = eddsa_verify_prepare (input, ec, r_in, s_in, ctx, h, s, &rbuf, &rlen);
+  if (rc)
+    ;
+  else if ((ctx->flags & PUBKEY_FLAG_COFACTORED))
+    rc = eddsa_verify_check_cofactored (ec, h, s, r_in, rbuf, rlen);
+  else
+    rc = eddsa_verify_check (ec, h, s, rbuf, rlen);
   _gcry_mpi_release (s);
   _gcry_mpi_release (h);
-  point_free (&Ia);
-  point_free (&Ib);
+  return rc;
+}
+
+
+/* Verify the COUNT EdDSA signatures R_IN[I], S_IN[I] on INPUT[I]
+ * using the keys EC[I], which must all be on the same curve, and
+ * store the result of each check at RESULTS[I].
+ *
+ * Instead of checking each signature on its own, a random linear
+ * combination of the verification equations
+ *
+ *   sum z_i·(s_i·G - h_i·Q_i - R_i) = 0
+ *
+ * with 128 bit coefficients z_i, multiplied by the cofactor, is
+ * checked using one multi-scalar multiplication.  Only if that fails
+ * the signatures are checked one by one to find the bad ones.  This
+ * requires the cofactored verification of all signatures, which is
+ * requested with the flag "cofactored".  The default check, which
+ * does not multiply by the cofactor, can't be batched: a component of
+ * small order in R or Q would vanish in the combination for some
+ * values of z_i.  Signatures without the flag are thus checked one by
+ * one like those whose R is not the canonical encoding of a point.
+ * Returns an error code only if memory is short.
+ */
+gpg_err_code_t
+_gcry_ecc_eddsa_verify_batch (unsigned int count, gcry_mpi_t *input,
+                              mpi_ec_t *ec, gcry_mpi_t *r_in,
+                              gcry_mpi_t *s_in, struct pk_encoding_ctx **ctx,
+                              gpg_err_code_t *results)
+{
+  mpi_ec_t ec0 = ec[0];
+  gcry_mpi_t *h, *s, *scalars;
+  mpi_point_struct *points, result;
+  mpi_point_t *pointptrs;
+  const void **rbuf;
+  size_t *rlen;
+  unsigned int *batch;
+  unsigned char zbuf[16];
+  gcry_mpi_t z, order, x;
+  unsigned int i, j, n;
+  gpg_err_code_t rc = 0;
+
+  if (count > (UINT_MAX - 1) / 2)
+    return GPG_ERR_TOO_LARGE;
+
+  h = xtrycalloc (count, sizeof *h);
+  s = xtrycalloc (count, sizeof *s);
+  rbuf = xtrycalloc (count, sizeof *rbuf);
+  rlen = xtrycalloc (count, sizeof *rlen);
+  batch = xtrycalloc (count, sizeof *batch);
+  scalars = xtrycalloc (2 * count + 1, sizeof *scalars);
+  points = xtrycalloc (2 * count + 1, sizeof *points);
+  pointptrs = xtrycalloc (2 * count + 1, sizeof *pointptrs);
+  if (!h || !s || !rbuf || !rlen || !batch || !scalars || !points
+      || !pointptrs)
+    {
+      rc = gpg_err_code_from_syserror ();
+      goto leave;
+    }
+
+  z = mpi_new (0);
+  order = mpi_new (0);
+  x = mpi_new (0);
+  point_init (&result);
+  for (i = 0; i < 2 * count + 1; i++)
+    {
+      point_init (&points[i]);
+      pointptrs[i] = &points[i];
+      scalars[i] = mpi_new (0);
+    }
+
+  /* Q has been checked to be on the curve, so that h·Q may be computed
+     modulo the order of the curve; see eddsa_verify_prepare.  */
+  mpi_mul_ui (order, ec0->n, ec0->h);
+
+  /* Entry 0 is for G, entries 2J+1 and 2J+2 are for -Q and -R of the
+     Jth signature in the batch.  */
+  point_set (&points[0], ec0->G);
+  mpi_point_resize (&points[0], ec0);
+  for (n = i = 0; i < count; i++)
+    {
+      h[i] = mpi_new (0);
+      s[i] = mpi_new (0);
+      results[i] = eddsa_verify_prepare (input[i], ec[i], r_in[i], s_in[i],
+                                         ctx[i], h[i], s[i],
+                                         &rbuf[i], &rlen[i]);
+      if (results[i])
+        continue;
+
+      if (!(ctx[i]->flags & PUBKEY_FLAG_COFACTORED))
+        {
+          results[i] = eddsa_verify_check (ec[i], h[i], s[i],
+                                           rbuf[i], rlen[i]);
+          continue;
+        }
+      if (!eddsa_decode_r (r_in[i], ec0, &points[2*n+2]))
+        {
+          results[i] = GPG_ERR_BAD_SIGNATURE;
+          continue;
+        }
+
+      _gcry_create_nonce (zbuf, sizeof zbuf);
+      _gcry_mpi_set_buffer (z, zbuf, sizeof zbuf, 0);
+      if (!mpi_cmp_ui (z, 0))
+        mpi_set_ui (z, 1);
+
+      mpi_mulm (x, z, s[i], ec0->n);
+      mpi_addm (scalars[0], scalars[0], x, ec0->n);
+      mpi_mulm (scalars[2*n+1], z, h[i], order);
+      mpi_set (scalars[2*n+2], z);
+
+      point_set (&points[2*n+1], ec[i]->Q);
+      mpi_subm (points[2*n+1].x, ec0->p, points[2*n+1].x, ec0->p);
+      mpi_subm (points[2*n+2].x, ec0->p, points[2*n+2].x, ec0->p);
+      mpi_point_resize (&points[2*n+1], ec0);
+      mpi_point_resize (&points[2*n+2], ec0);
+
+      batch[n++] = i;
+    }
+
+  if (n)
+    {
+      int neutral = -1;
+
+#ifdef USE_FE25519_51
+      if (ec0->nbits == 255 && ec0->dialect == ECC_DIALECT_ED25519
+          && _gcry_ecc_std_domain_p (ec0))
+        {
+          /* The encoding of the neutral element.  */
+          static const unsigned char encneutral[32] = { 1 };
+          unsigned char buf[32];
+
+          if (_gcry_mpi_ec_ed25519_mul_points (buf, scalars[0], 2 * n,
+                                               scalars + 1, pointptrs + 1))
+            neutral = !memcmp (buf, encneutral, 32);
+        }
+#endif /*USE_FE25519_51*/
+      if (neutral == -1)
+        {
+          _gcry_mpi_ec_mul_points (&result, 2 * n + 1, scalars, pointptrs,
+                                   ec0);
+          neutral = eddsa_cofactor_neutral_p (&result, ec0);
+        }
+      if (!neutral)
+        {
+          /* At least one signature is bad.  */
+          for (j = 0; j < n; j++)
+            {
+              i = batch[j];
+              results[i] = eddsa_verify_check_cofactored (ec[i], h[i], s[i],
+                                                          r_in[i], rbuf[i],
+                                                          rlen[i]);
+            }
+        }
+    }
+
+  wipememory (zbuf, sizeof zbuf);
+  point_free (&result);
+  for (i = 0; i < 2 * count + 1; i++)
+    {
+      point_free (&points[i]);
+      mpi_free (scalars[i]);
+    }
+  for (i = 0; i < count; i++)
+    {
+      mpi_free (h[i]);
+      mpi_free (s[i]);
+    }
+  mpi_free (x);
+  mpi_free (order);
+  mpi_free (z);
+
+ leave:
+  xfree (pointptrs);
+  xfree (points);
+  xfree (scalars);
+  xfree (batch);
+  xfree (rlen);
+  xfree (rbuf);
+  xfree (s);
+  xfree (h);
   return rc;
 }
@@ -130,7 +130,7 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, mpi_ec_t ec,
 {
   gpg_err_code_t err = 0;
   gcry_mpi_t e, x, z1, z2, v, rv, zero;
-  mpi_point_struct Q, Q1, Q2;
+  mpi_point_struct Q;
 
   if (!_gcry_mpi_ec_curve_point (ec->Q, ec))
     return GPG_ERR_BROKEN_PUBKEY;
@@ -149,8 +149,6 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, mpi_ec_t ec,
   zero = mpi_alloc (0);
 
   point_init (&Q);
-  point_init (&Q1);
-  point_init (&Q2);
 
   mpi_mod (e, input, ec->n); /* e = hash mod n */
   if (!mpi_cmp_ui (e, 0))
@@ -160,15 +158,7 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, mpi_ec_t ec,
   mpi_mulm (rv, r, v, ec->n); /* rv = r*v (mod n) */
   mpi_subm (z2, zero, rv, ec->n); /* z2 = -r*v (mod n) */
 
-  _gcry_mpi_ec_mul_point (&Q1, z1, ec->G, ec);
-/*   log_mpidump ("Q1.x", Q1.x); */
-/*   log_mpidump ("Q1.y", Q1.y); */
-/*   log_mpidump ("Q1.z", Q1.z); */
-  _gcry_mpi_ec_mul_point (&Q2, z2, ec->Q, ec);
-/*   log_mpidump ("Q2.x", Q2.x); */
-/*   log_mpidump ("Q2.y", Q2.y); */
-/*   log_mpidump ("Q2.z", Q2.z); */
-  _gcry_mpi_ec_add_points (&Q, &Q1, &Q2, ec);
+  _gcry_mpi_ec_mul_point2 (&Q, z1, ec->G, z2, ec->Q, ec);
 /*   log_mpidump (" Q.x", Q.x); */
 /*   log_mpidump (" Q.y", Q.y); */
 /*   log_mpidump (" Q.z", Q.z); */
@@ -204,8 +194,6 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, mpi_ec_t ec,
     log_debug ("ecc verify: Accepted\n");
 
  leave:
-  point_free (&Q2);
-  point_free (&Q1);
   point_free (&Q);
   mpi_free (zero);
   mpi_free (rv);
@@ -496,7 +496,7 @@ _gcry_ecc_sm2_verify (gcry_mpi_t input, mpi_ec_t ec,
   gpg_err_code_t err = 0;
   gcry_mpi_t hash = NULL;
   gcry_mpi_t t = NULL;
-  mpi_point_struct sG, tP;
+  mpi_point_struct sG;
   gcry_mpi_t x1, y1;
   unsigned int nbits;
 
@@ -515,7 +515,6 @@ _gcry_ecc_sm2_verify (gcry_mpi_t input, mpi_ec_t ec,
     return err;
 
   point_init (&sG);
-  point_init (&tP);
   x1 = mpi_new (0);
   y1 = mpi_new (0);
   t = mpi_new (0);
@@ -529,9 +528,7 @@ _gcry_ecc_sm2_verify (gcry_mpi_t input, mpi_ec_t ec,
     }
 
   /* sG + tP = (x1, y1) */
-  _gcry_mpi_ec_mul_point (&sG, s, ec->G, ec);
-  _gcry_mpi_ec_mul_point (&tP, t, ec->Q, ec);
-  _gcry_mpi_ec_add_points (&sG, &sG, &tP, ec);
+  _gcry_mpi_ec_mul_point2 (&sG, s, ec->G, t, ec->Q, ec);
   if (_gcry_mpi_ec_get_affine (x1, y1, &sG, ec))
     {
       err = GPG_ERR_INV_DATA;
@@ -558,7 +555,6 @@ _gcry_ecc_sm2_verify (gcry_mpi_t input, mpi_ec_t ec,
 
  leave:
   point_free (&sG);
-  point_free (&tP);
   mpi_free (x1);
   mpi_free (y1);
   mpi_free (t);
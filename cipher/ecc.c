@@ -103,6 +103,7 @@ static void *progress_cb_data;
 static void test_keys (mpi_ec_t ec, unsigned int nbits);
 static void test_ecdh_only_keys (mpi_ec_t ec, unsigned int nbits, int flags);
 static unsigned int ecc_get_nbits (gcry_sexp_t parms);
+static gpg_err_code_t compute_keygrip (gcry_md_hd_t md, gcry_sexp_t keyparms);
 
 
 
@@ -677,25 +678,19 @@ ecc_check_secret_key (gcry_sexp_t keyparms)
 }
 
 
+/* Sign S_DATA with the secret key described by the context EC.
+   FLAGS are the flags of the key.  */
 static gcry_err_code_t
-ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+ecc_sign_ec (gcry_sexp_t *r_sig, gcry_sexp_t s_data, mpi_ec_t ec, int flags)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
   gcry_mpi_t sig_r = NULL;
   gcry_mpi_t sig_s = NULL;
-  mpi_ec_t ec = NULL;
-  int flags = 0;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_SIGN, 0);
 
-  /*
-   * Extract the key.
-   */
-  rc = _gcry_mpi_ec_internal_new (&ec, &flags, "ecc_sign", keyparms, NULL);
-  if (rc)
-    goto leave;
   if (!ec->p || !ec->a || !ec->b || !ec->G || !ec->n || !ec->d)
     {
       rc = GPG_ERR_NO_OBJ;
@@ -763,7 +758,6 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (sig_r);
   _gcry_mpi_release (sig_s);
   _gcry_mpi_release (data);
-  _gcry_mpi_ec_free (ec);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
     log_debug ("ecc_sign      => %s\n", gpg_strerror (rc));
@@ -772,28 +766,226 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
 
 static gcry_err_code_t
-ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 {
   gcry_err_code_t rc;
-  struct pk_encoding_ctx ctx;
-  gcry_sexp_t l1 = NULL;
-  gcry_mpi_t sig_r = NULL;
-  gcry_mpi_t sig_s = NULL;
-  gcry_mpi_t data = NULL;
-  int sigflags;
   mpi_ec_t ec = NULL;
   int flags = 0;
 
-  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
-                                   ecc_get_nbits (s_keyparms));
+  rc = _gcry_mpi_ec_internal_new (&ec, &flags, "ecc_sign", keyparms, NULL);
+  if (!rc)
+    rc = ecc_sign_ec (r_sig, s_data, ec, flags);
+  _gcry_mpi_ec_free (ec);
+  return rc;
+}
+
+
+/* Cache of the contexts of recently used public keys for
+   verification.  It is disabled by default and enabled with
+   GCRYCTL_SET_ECC_VERIFY_CACHE.  A cached context holds the decoded
+   public key and, after its second use, a comb table for it.  A
+   context is taken out of the cache while it is in use; concurrent
+   verifications with the same key thus simply create another
+   context.  The list is kept in most recently used order.  */
+struct verify_cache_item
+{
+  struct verify_cache_item *next;
+  unsigned char grip[20];
+  int flags;
+  mpi_ec_t ec;
+};
+static struct verify_cache_item *verify_cache;
+static unsigned int verify_cache_max;
+GPGRT_LOCK_DEFINE (verify_cache_lock);
+
+/* Identification of a public key for the cache.  */
+struct verify_cache_key
+{
+  int valid;            /* The key may be cached.  */
+  int hit;              /* The context was taken from the cache.  */
+  int flags;            /* The flags of the key.  */
+  unsigned char grip[20];
+};
+
+
+static void
+verify_cache_lock_lock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_lock (&verify_cache_lock);
+  if (err)
+    log_fatal ("failed to acquire the verify cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+static void
+verify_cache_lock_unlock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_unlock (&verify_cache_lock);
+  if (err)
+    log_fatal ("failed to release the verify cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+/* Drop the least recently used items until at most MAX are left.
+   Must be called with the lock held.  */
+static void
+verify_cache_shrink (unsigned int max)
+{
+  struct verify_cache_item **pp, *item;
+  unsigned int n;
+
+  for (n = 0, pp = &verify_cache; *pp && n < max; pp = &(*pp)->next, n++)
+    ;
+  while ((item = *pp))
+    {
+      *pp = item->next;
+      _gcry_mpi_ec_free (item->ec);
+      xfree (item);
+    }
+}
+
+
+/* Set the maximum number of keys in the verify cache to MAX.  A value
+   of 0 disables the cache and releases all cached keys.  */
+void
+_gcry_ecc_set_verify_cache (unsigned int max)
+{
+  verify_cache_lock_lock ();
+  verify_cache_max = max;
+  verify_cache_shrink (max);
+  verify_cache_lock_unlock ();
+}
+
+
+/* Create the context for the public key KEYPARMS and store it at
+   R_EC.  The flags of the key are ORed to R_FLAGS.  If the cache is
+   enabled, the context is taken from the cache if possible.  KEY
+   receives the information required for verify_cache_put.  */
+static gpg_err_code_t
+verify_cache_get (mpi_ec_t *r_ec, int *r_flags, gcry_sexp_t keyparms,
+                  struct verify_cache_key *key)
+{
+  gpg_err_code_t rc;
+  struct verify_cache_item **pp, *item = NULL;
+  gcry_sexp_t l1;
+  gcry_md_hd_t md;
+
+  memset (key, 0, sizeof *key);
+
+  /* Only keys using a named curve are cached; explicit parameters
+     might describe a different curve with the same keygrip.  The
+     unlocked read is only a hint.  */
+  if (verify_cache_max && (l1 = sexp_find_token (keyparms, "curve", 5)))
+    {
+      sexp_release (l1);
+      l1 = sexp_find_token (keyparms, "flags", 0);
+      rc = l1? _gcry_pk_util_parse_flaglist (l1, &key->flags, NULL) : 0;
+      sexp_release (l1);
+      if (!rc && !(key->flags & PUBKEY_FLAG_PARAM)
+          && !_gcry_md_open (&md, GCRY_MD_SHA1, 0))
+        {
+          if (!compute_keygrip (md, keyparms))
+            {
+              memcpy (key->grip, _gcry_md_read (md, GCRY_MD_SHA1), 20);
+              key->valid = 1;
+            }
+          _gcry_md_close (md);
+        }
+    }
+
+  if (key->valid)
+    {
+      verify_cache_lock_lock ();
+      for (pp = &verify_cache; (item = *pp); pp = &item->next)
+        if (item->flags == key->flags && !memcmp (item->grip, key->grip, 20))
+          {
+            *pp = item->next;
+            break;
+          }
+      verify_cache_lock_unlock ();
+    }
+
+  if (item)
+    {
+      *r_ec = item->ec;
+      *r_flags |= item->flags;
+      xfree (item);
+      key->hit = 1;
+      return 0;
+    }
+
+  rc = _gcry_mpi_ec_internal_new (r_ec, r_flags, "ecc_verify", keyparms, NULL);
+  if (!rc && key->valid
+      && (!(*r_ec)->name || (*r_ec)->d || (*r_ec)->model == MPI_EC_MONTGOMERY))
+    key->valid = 0;
+  return rc;
+}
+
+
+/* Return the context EC obtained by verify_cache_get for KEY to the
+   cache or release it.  */
+static void
+verify_cache_put (mpi_ec_t ec, struct verify_cache_key *key)
+{
+  struct verify_cache_item **pp, *item;
+
+  if (!ec)
+    return;
+  if (!key->valid || !verify_cache_max
+      || !(item = xtrymalloc (sizeof *item)))
+    {
+      _gcry_mpi_ec_free (ec);
+      return;
+    }
+
+  /* Creating the table takes about as long as a verification; thus
+     this is only done for keys used more than once.  */
+  if (key->hit)
+    _gcry_mpi_ec_precompute_key (ec);
+
+  memcpy (item->grip, key->grip, 20);
+  item->flags = key->flags;
+  item->ec = ec;
+
+  verify_cache_lock_lock ();
+  /* Another thread might have returned a context for the same key in
+     the meantime; keep only the newer one.  */
+  for (pp = &verify_cache; *pp; pp = &(*pp)->next)
+    if ((*pp)->flags == key->flags && !memcmp ((*pp)->grip, key->grip, 20))
+      {
+        struct verify_cache_item *old = *pp;
+
+        *pp = old->next;
+        _gcry_mpi_ec_free (old->ec);
+        xfree (old);
+        break;
+      }
+  item->next = verify_cache;
+  verify_cache = item;
+  verify_cache_shrink (verify_cache_max);
+  verify_cache_lock_unlock ();
+}
+
+
+/* Parse the signature S_SIG and the data S_DATA for a verification
+   with the public key described by the context EC and the key flags
+   FLAGS.  CTX must have been initialized by the caller.  The returned
+   objects must be released by the caller even on error.  */
+static gcry_err_code_t
+ecc_verify_parse_data (gcry_sexp_t s_sig, gcry_sexp_t s_data,
+                       mpi_ec_t ec, int flags, struct pk_encoding_ctx *ctx,
+                       gcry_mpi_t *r_data, gcry_mpi_t *r_sig_r,
+                       gcry_mpi_t *r_sig_s, int *r_sigflags)
+{
+  gcry_err_code_t rc;
+  gcry_sexp_t l1 = NULL;
 
-  /*
-   * Extract the key.
-   */
-  rc = _gcry_mpi_ec_internal_new (&ec, &flags, "ecc_verify",
-                                  s_keyparms, NULL);
-  if (rc)
-    goto leave;
   if (!ec->p || !ec->a || !ec->b || !ec->G || !ec->n || !ec->Q)
     {
       rc = GPG_ERR_NO_OBJ;
@@ -808,76 +1000,324 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
       goto leave;
     }
 
-  ctx.flags |= flags;
+  ctx->flags |= flags;
   if (ec->model == MPI_EC_EDWARDS && ec->dialect == ECC_DIALECT_SAFECURVE)
-    ctx.flags |= PUBKEY_FLAG_EDDSA;
+    ctx->flags |= PUBKEY_FLAG_EDDSA;
   /* Clear hash algo for EdDSA.  */
-  if ((ctx.flags & PUBKEY_FLAG_EDDSA))
-    ctx.hash_algo = GCRY_MD_NONE;
+  if ((ctx->flags & PUBKEY_FLAG_EDDSA))
+    ctx->hash_algo = GCRY_MD_NONE;
 
   /* Extract the data.  */
-  rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
+  rc = _gcry_pk_util_data_to_mpi (s_data, r_data, ctx);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
-    log_mpidump ("ecc_verify data", data);
+    log_mpidump ("ecc_verify data", *r_data);
 
   /* Hash algo is determined by curve in EdDSA.  Fill it if not specified.  */
-  if ((ctx.flags & PUBKEY_FLAG_EDDSA) && !ctx.hash_algo)
+  if ((ctx->flags & PUBKEY_FLAG_EDDSA) && !ctx->hash_algo)
     {
       if (ec->dialect == ECC_DIALECT_ED25519)
-        ctx.hash_algo = GCRY_MD_SHA512;
+        ctx->hash_algo = GCRY_MD_SHA512;
       else if (ec->dialect == ECC_DIALECT_SAFECURVE)
-        ctx.hash_algo = GCRY_MD_SHAKE256;
+        ctx->hash_algo = GCRY_MD_SHAKE256;
     }
 
   /*
    * Extract the signature value.
    */
-  rc = _gcry_pk_util_preparse_sigval (s_sig, ecc_names, &l1, &sigflags);
+  rc = _gcry_pk_util_preparse_sigval (s_sig, ecc_names, &l1, r_sigflags);
   if (rc)
     goto leave;
-  rc = sexp_extract_param (l1, NULL, (sigflags & PUBKEY_FLAG_EDDSA)? "/rs":"rs",
-                           &sig_r, &sig_s, NULL);
+  rc = sexp_extract_param (l1, NULL,
+                           (*r_sigflags & PUBKEY_FLAG_EDDSA)? "/rs":"rs",
+                           r_sig_r, r_sig_s, NULL);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("ecc_verify  s_r", sig_r);
-      log_mpidump ("ecc_verify  s_s", sig_s);
+      log_mpidump ("ecc_verify  s_r", *r_sig_r);
+      log_mpidump ("ecc_verify  s_s", *r_sig_s);
     }
-  if ((ctx.flags & PUBKEY_FLAG_EDDSA) ^ (sigflags & PUBKEY_FLAG_EDDSA))
+  if ((ctx->flags & PUBKEY_FLAG_EDDSA) ^ (*r_sigflags & PUBKEY_FLAG_EDDSA))
     {
       rc = GPG_ERR_CONFLICT; /* Inconsistent use of flag/algoname.  */
       goto leave;
     }
 
-  /*
-   * Verify the signature.
-   */
+ leave:
+  sexp_release (l1);
+  return rc;
+}
+
+
+/* Parse the signature S_SIG, the data S_DATA and the public key
+   S_KEYPARMS for a verification.  CTX must have been initialized by
+   the caller.  The returned objects must be released by the caller
+   even on error; release the context R_EC with verify_cache_put using
+   R_KEY.  */
+static gcry_err_code_t
+ecc_verify_parse (gcry_sexp_t s_sig, gcry_sexp_t s_data,
+                  gcry_sexp_t s_keyparms, struct pk_encoding_ctx *ctx,
+                  mpi_ec_t *r_ec, struct verify_cache_key *r_key,
+                  gcry_mpi_t *r_data,
+                  gcry_mpi_t *r_sig_r, gcry_mpi_t *r_sig_s, int *r_sigflags)
+{
+  gcry_err_code_t rc;
+  int flags = 0;
+
+  rc = verify_cache_get (r_ec, &flags, s_keyparms, r_key);
+  if (rc)
+    return rc;
+  return ecc_verify_parse_data (s_sig, s_data, *r_ec, flags, ctx,
+                                r_data, r_sig_r, r_sig_s, r_sigflags);
+}
+
+
+/* Verify the signature SIG_R, SIG_S on DATA as returned by
+   ecc_verify_parse.  */
+static gcry_err_code_t
+ecc_verify_mpi (gcry_mpi_t data, mpi_ec_t ec,
+                gcry_mpi_t sig_r, gcry_mpi_t sig_s, int sigflags,
+                struct pk_encoding_ctx *ctx)
+{
   if ((sigflags & PUBKEY_FLAG_EDDSA))
+    return _gcry_ecc_eddsa_verify (data, ec, sig_r, sig_s, ctx);
+  else if ((sigflags & PUBKEY_FLAG_GOST))
+    return _gcry_ecc_gost_verify (data, ec, sig_r, sig_s);
+  else if ((sigflags & PUBKEY_FLAG_SM2))
+    return _gcry_ecc_sm2_verify (data, ec, sig_r, sig_s);
+  else
+    return _gcry_ecc_ecdsa_verify (data, ec, sig_r, sig_s);
+}
+
+
+static gcry_err_code_t
+ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+{
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx ctx;
+  gcry_mpi_t sig_r = NULL;
+  gcry_mpi_t sig_s = NULL;
+  gcry_mpi_t data = NULL;
+  int sigflags = 0;
+  mpi_ec_t ec = NULL;
+  struct verify_cache_key key;
+
+  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
+                                   ecc_get_nbits (s_keyparms));
+
+  rc = ecc_verify_parse (s_sig, s_data, s_keyparms, &ctx,
+                         &ec, &key, &data, &sig_r, &sig_s, &sigflags);
+  if (!rc)
+    rc = ecc_verify_mpi (data, ec, sig_r, sig_s, sigflags, &ctx);
+
+  _gcry_mpi_release (data);
+  _gcry_mpi_release (sig_r);
+  _gcry_mpi_release (sig_s);
+  verify_cache_put (ec, &key);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  if (DBG_CIPHER)
+    log_debug ("ecc_verify    => %s\n", rc?gpg_strerror (rc):"Good");
+  return rc;
+}
+
+
+/* Verify the COUNT signatures S_SIGS[I] on S_DATA[I] using the public
+   keys S_KEYPARMS[I] and store the result of each check at
+   RESULTS[I].  The EdDSA signatures with the flag "cofactored" are
+   checked together per curve using _gcry_ecc_eddsa_verify_batch; all
+   others one by one.  Returns an error code only if memory is
+   short.  */
+static gcry_err_code_t
+ecc_verify_batch (unsigned int count, const gcry_sexp_t *s_sigs,
+                  const gcry_sexp_t *s_data, const gcry_sexp_t *s_keyparms,
+                  gcry_err_code_t *results)
+{
+  struct pk_encoding_ctx *ctx, **bctx;
+  struct verify_cache_key *key;
+  mpi_ec_t *ec, *bec;
+  gcry_mpi_t *data, *sig_r, *sig_s;
+  gcry_mpi_t *bdata, *bsig_r, *bsig_s;
+  gcry_err_code_t *bresults;
+  unsigned int *idx;
+  int *sigflags;
+  char *pending;
+  unsigned int i, j, n;
+  gcry_err_code_t rc = 0, err;
+
+  ctx = xtrycalloc (count, sizeof *ctx);
+  ec = xtrycalloc (count, sizeof *ec);
+  key = xtrycalloc (count, sizeof *key);
+  data = xtrycalloc (count, sizeof *data);
+  sig_r = xtrycalloc (count, sizeof *sig_r);
+  sig_s = xtrycalloc (count, sizeof *sig_s);
+  sigflags = xtrycalloc (count, sizeof *sigflags);
+  pending = xtrycalloc (count, sizeof *pending);
+  bctx = xtrycalloc (count, sizeof *bctx);
+  bec = xtrycalloc (count, sizeof *bec);
+  bdata = xtrycalloc (count, sizeof *bdata);
+  bsig_r = xtrycalloc (count, sizeof *bsig_r);
+  bsig_s = xtrycalloc (count, sizeof *bsig_s);
+  bresults = xtrycalloc (count, sizeof *bresults);
+  idx = xtrycalloc (count, sizeof *idx);
+  if (!ctx || !ec || !key || !data || !sig_r || !sig_s || !sigflags
+      || !pending || !bctx || !bec || !bdata || !bsig_r || !bsig_s
+      || !bresults || !idx)
     {
-      rc = _gcry_ecc_eddsa_verify (data, ec, sig_r, sig_s, &ctx);
+      rc = gpg_err_code_from_syserror ();
+      goto leave;
     }
-  else if ((sigflags & PUBKEY_FLAG_GOST))
+
+  for (i = 0; i < count; i++)
     {
-      rc = _gcry_ecc_gost_verify (data, ec, sig_r, sig_s);
+      _gcry_pk_util_init_encoding_ctx (&ctx[i], PUBKEY_OP_VERIFY,
+                                       ecc_get_nbits (s_keyparms[i]));
+      results[i] = ecc_verify_parse (s_sigs[i], s_data[i], s_keyparms[i],
+                                     &ctx[i], &ec[i], &key[i], &data[i],
+                                     &sig_r[i], &sig_s[i], &sigflags[i]);
+      if (results[i])
+        continue;
+      if ((sigflags[i] & PUBKEY_FLAG_EDDSA)
+          && (ctx[i].flags & PUBKEY_FLAG_COFACTORED))
+        pending[i] = 1;
+      else
+        results[i] = ecc_verify_mpi (data[i], ec[i], sig_r[i], sig_s[i],
+                                     sigflags[i], &ctx[i]);
     }
-  else if ((sigflags & PUBKEY_FLAG_SM2))
+
+  for (i = 0; i < count; i++)
     {
-      rc = _gcry_ecc_sm2_verify (data, ec, sig_r, sig_s);
+      if (!pending[i])
+        continue;
+
+      for (n = 0, j = i; j < count; j++)
+        if (pending[j] && _gcry_ecc_same_curve_p (ec[j], ec[i]))
+          {
+            pending[j] = 0;
+            bctx[n] = &ctx[j];
+            bec[n] = ec[j];
+            bdata[n] = data[j];
+            bsig_r[n] = sig_r[j];
+            bsig_s[n] = sig_s[j];
+            idx[n++] = j;
+          }
+      err = _gcry_ecc_eddsa_verify_batch (n, bdata, bec, bsig_r, bsig_s,
+                                          bctx, bresults);
+      for (j = 0; j < n; j++)
+        results[idx[j]] = err? err : bresults[j];
     }
-  else
+
+  for (i = 0; i < count; i++)
     {
-      rc = _gcry_ecc_ecdsa_verify (data, ec, sig_r, sig_s);
+      _gcry_mpi_release (data[i]);
+      _gcry_mpi_release (sig_r[i]);
+      _gcry_mpi_release (sig_s[i]);
+      verify_cache_put (ec[i], &key[i]);
+      _gcry_pk_util_free_encoding_ctx (&ctx[i]);
     }
 
  leave:
+  xfree (idx);
+  xfree (bresults);
+  xfree (bsig_s);
+  xfree (bsig_r);
+  xfree (bdata);
+  xfree (bec);
+  xfree (bctx);
+  xfree (pending);
+  xfree (sigflags);
+  xfree (sig_s);
+  xfree (sig_r);
+  xfree (data);
+  xfree (key);
+  xfree (ec);
+  xfree (ctx);
+  return rc;
+}
+
+
+/* A key parsed by ecc_prepare.  */
+struct ecc_prepared_key
+{
+  mpi_ec_t ec;
+  int flags;
+  unsigned int nbits;   /* As returned by ecc_get_nbits.  */
+};
+
+
+/* Parse the key KEYPARMS for use with the *_prepared functions.  */
+static gcry_err_code_t
+ecc_prepare (void **r_key, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  struct ecc_prepared_key *pk;
+
+  *r_key = NULL;
+  pk = xtrycalloc (1, sizeof *pk);
+  if (!pk)
+    return gpg_err_code_from_syserror ();
+
+  rc = _gcry_mpi_ec_internal_new (&pk->ec, &pk->flags, "ecc_prepare",
+                                  keyparms, NULL);
+  if (rc)
+    {
+      xfree (pk);
+      return rc;
+    }
+  pk->nbits = ecc_get_nbits (keyparms);
+
+  *r_key = pk;
+  return 0;
+}
+
+
+static void
+ecc_release_prepared (void *key)
+{
+  struct ecc_prepared_key *pk = key;
+
+  if (!pk)
+    return;
+  _gcry_mpi_ec_free (pk->ec);
+  xfree (pk);
+}
+
+
+static gcry_err_code_t
+ecc_sign_prepared (gcry_sexp_t *r_sig, gcry_sexp_t s_data, void *key)
+{
+  struct ecc_prepared_key *pk = key;
+
+  return ecc_sign_ec (r_sig, s_data, pk->ec, pk->flags);
+}
+
+
+static gcry_err_code_t
+ecc_verify_prepared (gcry_sexp_t s_sig, gcry_sexp_t s_data, void *key)
+{
+  struct ecc_prepared_key *pk = key;
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx ctx;
+  gcry_mpi_t sig_r = NULL;
+  gcry_mpi_t sig_s = NULL;
+  gcry_mpi_t data = NULL;
+  int sigflags = 0;
+
+  /* A prepared key is meant to be used many times; thus the table
+     for the public key is created with the first verification.  */
+  _gcry_mpi_ec_precompute_key (pk->ec);
+
+  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY, pk->nbits);
+
+  rc = ecc_verify_parse_data (s_sig, s_data, pk->ec, pk->flags, &ctx,
+                              &data, &sig_r, &sig_s, &sigflags);
+  if (!rc)
+    rc = ecc_verify_mpi (data, pk->ec, sig_r, sig_s, sigflags, &ctx);
+
   _gcry_mpi_release (data);
   _gcry_mpi_release (sig_r);
   _gcry_mpi_release (sig_s);
-  _gcry_mpi_ec_free (ec);
-  sexp_release (l1);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
     log_debug ("ecc_verify    => %s\n", rc?gpg_strerror (rc):"Good");
@@ -1867,5 +2307,12 @@ gcry_pk_spec_t _gcry_pubkey_spec_ecc =
     run_selftests,
     compute_keygrip,
     _gcry_ecc_get_curve,
-    _gcry_ecc_get_param_sexp
+    _gcry_ecc_get_param_sexp,
+    ecc_verify_batch,
+    ecc_prepare,
+    ecc_release_prepared,
+    NULL,
+    NULL,
+    ecc_sign_prepared,
+    ecc_verify_prepared
   };
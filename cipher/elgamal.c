@@ -481,7 +481,7 @@ do_encrypt(gcry_mpi_t a, gcry_mpi_t b, gcry_mpi_t input, ELG_public_key *pkey )
    */
 
   k = gen_k( pkey->p );
-  mpi_powm (a, pkey->g, k, pkey->p);
+  _gcry_dl_powm_base (a, pkey->g, k, pkey->p, mpi_get_nbits (pkey->p));
 
   /* b = (y^k * input) mod p
    *	 = ((y^k mod p) * (input mod p)) mod p
@@ -597,7 +597,7 @@ sign(gcry_mpi_t a, gcry_mpi_t b, gcry_mpi_t input, ELG_secret_key *skey )
     */
     mpi_sub_ui(p_1, p_1, 1);
     k = gen_k( skey->p );
-    mpi_powm( a, skey->g, k, skey->p );
+    _gcry_dl_powm_base (a, skey->g, k, skey->p, mpi_get_nbits (skey->p));
     mpi_mul(t, skey->x, a );
     mpi_subm(t, input, t, p_1 );
     mpi_invm(inv, k, p_1 );
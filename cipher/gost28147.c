@@ -327,6 +327,15 @@ gost_imit_close (gcry_mac_hd_t h)
   (void) h;
 }
 
+static gcry_err_code_t
+gost_imit_copy (gcry_mac_hd_t dst, gcry_mac_hd_t src)
+{
+  /* All state is kept inline in the handle.  */
+  (void) dst;
+  (void) src;
+  return 0;
+}
+
 static gcry_err_code_t
 gost_imit_setkey (gcry_mac_hd_t h, const unsigned char *key, size_t keylen)
 {
@@ -534,6 +543,7 @@ gost_imit_set_extra_info (gcry_mac_hd_t hd, int what, const void *buffer, size_t
 static gcry_mac_spec_ops_t gost_imit_ops = {
   gost_imit_open,
   gost_imit_close,
+  gost_imit_copy,
   gost_imit_setkey,
   gost_imit_setiv,
   gost_imit_reset,
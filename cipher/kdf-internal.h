@@ -28,6 +28,26 @@ _gcry_kdf_pkdf2 (const void *passphrase, size_t passphraselen,
                  unsigned long iterations,
                  size_t keysize, void *keybuffer);
 
+/*-- sha1.c --*/
+unsigned int
+_gcry_sha1_compress (void *context, const void *in, void *out,
+                     const void *data, size_t nblks);
+
+/*-- sha256.c --*/
+unsigned int
+_gcry_sha256_compress (void *context, const void *in, void *out,
+                       const void *data, size_t nblks);
+
+/*-- sha512.c --*/
+unsigned int
+_gcry_sha512_compress (void *context, const void *in, void *out,
+                       const void *data, size_t nblks);
+
+/*-- blake2.c --*/
+gcry_err_code_t
+_gcry_blake2b_vl_hash (const void *in, size_t inlen, size_t outputlen,
+                       void *output);
+
 /*-- scrypt.c --*/
 gcry_err_code_t
 _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
@@ -35,6 +55,18 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
                   const unsigned char *salt, size_t saltlen,
                   unsigned long iterations,
                   size_t dklen, unsigned char *dk);
+gpg_err_code_t
+_gcry_kdf_scrypt_open (gcry_kdf_hd_t *hd, int subalgo,
+                       const unsigned long *param, unsigned int paramlen,
+                       const void *passwd, size_t passwdlen,
+                       const void *salt, size_t saltlen);
+gpg_err_code_t
+_gcry_kdf_scrypt_compute (gcry_kdf_hd_t hd,
+                          const struct gcry_kdf_thread_ops *ops);
+gpg_err_code_t
+_gcry_kdf_scrypt_final (gcry_kdf_hd_t hd, size_t resultlen, void *result);
+void
+_gcry_kdf_scrypt_close (gcry_kdf_hd_t hd);
 
 
 #endif /*GCRY_KDF_INTERNAL_H*/
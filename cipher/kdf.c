@@ -23,11 +23,42 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#if defined(HAVE_MMAP)
+# include <sys/mman.h>
+#endif
 
 #include "g10lib.h"
 #include "cipher.h"
+#include "bithelp.h"
+#include "bufhelp.h"
 #include "kdf-internal.h"
 
+#if defined (MAP_ANON) && ! defined (MAP_ANONYMOUS)
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* USE_AVX2 indicates whether to compile with Intel AVX2 code.  The
+   implementations live in pbkdf2-avx2-amd64.S and
+   blake2b-amd64-avx2.S.  */
+#undef USE_AVX2
+#if defined(__x86_64__) && defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+     defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_AVX2 1
+#endif
+
+/* AMD64 assembly implementations use SystemV ABI, ABI conversion and additional
+ * stack to store XMM6-XMM15 needed on Win64. */
+#undef ASM_FUNC_ABI
+#undef ASM_EXTRA_STACK
+#if defined(USE_AVX2) && defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS)
+# define ASM_FUNC_ABI __attribute__((sysv_abi))
+# define ASM_EXTRA_STACK (10 * 16)
+#else
+# define ASM_FUNC_ABI
+# define ASM_EXTRA_STACK 0
+#endif
+
 
 /* Transform a passphrase into a suitable key of length KEYSIZE and
    store this key in the caller provided buffer KEYBUFFER.  The caller
@@ -109,6 +140,511 @@ openpgp_s2k (const void *passphrase, size_t passphraselen,
 }
 
 
+/*
+ * PBKDF2 on raw compression states.
+ *
+ * For the SHA-1 and SHA-2 digests the HMAC of each iteration is
+ * computed directly on the chaining values: the inner and outer key
+ * blocks are compressed once per passphrase and every iteration then
+ * takes two compressions of a single pre-padded block.  With AVX2 the
+ * iterations of several output blocks, or of several passphrases of a
+ * batch, run in the lanes of the multi-buffer code in
+ * pbkdf2-avx2-amd64.S.  The lane buffers hold the state and message
+ * words transposed so that row I holds word I of all lanes.
+ */
+
+/* Size of one row of the lane buffers.  */
+#define PBKDF2_ROW_SIZE 32
+
+typedef unsigned int (*pbkdf2_compress_t) (void *context, const void *in,
+                                           void *out, const void *data,
+                                           size_t nblks);
+typedef void (*pbkdf2_multi_t) (void *state, const void *msg);
+
+#ifdef USE_AVX2
+unsigned int _gcry_sha1_transform_8way_amd64_avx2 (void *state,
+                                                   const void *msg)
+                                                   ASM_FUNC_ABI;
+unsigned int _gcry_sha256_transform_8way_amd64_avx2 (void *state,
+                                                     const void *msg)
+                                                     ASM_FUNC_ABI;
+unsigned int _gcry_sha512_transform_4way_amd64_avx2 (void *state,
+                                                     const void *msg)
+                                                     ASM_FUNC_ABI;
+
+static void
+pbkdf2_sha1_8way (void *state, const void *msg)
+{
+  _gcry_sha1_transform_8way_amd64_avx2 (state, msg);
+}
+
+static void
+pbkdf2_sha256_8way (void *state, const void *msg)
+{
+  _gcry_sha256_transform_8way_amd64_avx2 (state, msg);
+}
+
+static void
+pbkdf2_sha512_4way (void *state, const void *msg)
+{
+  _gcry_sha512_transform_4way_amd64_avx2 (state, msg);
+}
+
+# define PBKDF2_MULTI(fn) fn
+#else
+# define PBKDF2_MULTI(fn) NULL
+#endif
+
+/* Description of a digest usable by the PBKDF2 engine.  */
+typedef struct
+{
+  int algo;
+  gcry_md_spec_t *spec;
+  pbkdf2_compress_t compress;
+  pbkdf2_multi_t multi;       /* Multi-buffer compression or NULL.  */
+  unsigned short blocksize;   /* Block size in bytes.  */
+  unsigned short wordsize;    /* Size of a chaining value word.  */
+  unsigned short nwords;      /* Number of chaining value words.  */
+  unsigned short dlen;        /* Length of the digest in bytes.  */
+} pbkdf2_digest_t;
+
+static const pbkdf2_digest_t pbkdf2_digests[] =
+  {
+#if USE_SHA1
+    { GCRY_MD_SHA1, &_gcry_digest_spec_sha1, _gcry_sha1_compress,
+      PBKDF2_MULTI (pbkdf2_sha1_8way), 64, 4, 5, 20 },
+#endif
+#if USE_SHA256
+    { GCRY_MD_SHA224, &_gcry_digest_spec_sha224, _gcry_sha256_compress,
+      PBKDF2_MULTI (pbkdf2_sha256_8way), 64, 4, 8, 28 },
+    { GCRY_MD_SHA256, &_gcry_digest_spec_sha256, _gcry_sha256_compress,
+      PBKDF2_MULTI (pbkdf2_sha256_8way), 64, 4, 8, 32 },
+#endif
+#if USE_SHA512
+    { GCRY_MD_SHA384, &_gcry_digest_spec_sha384, _gcry_sha512_compress,
+      PBKDF2_MULTI (pbkdf2_sha512_4way), 128, 8, 8, 48 },
+    { GCRY_MD_SHA512, &_gcry_digest_spec_sha512, _gcry_sha512_compress,
+      PBKDF2_MULTI (pbkdf2_sha512_4way), 128, 8, 8, 64 },
+    { GCRY_MD_SHA512_256, &_gcry_digest_spec_sha512_256,
+      _gcry_sha512_compress,
+      PBKDF2_MULTI (pbkdf2_sha512_4way), 128, 8, 8, 32 },
+    /* The digest ends within a word; the lanes can't be used.  */
+    { GCRY_MD_SHA512_224, &_gcry_digest_spec_sha512_224,
+      _gcry_sha512_compress, NULL, 128, 8, 8, 28 },
+#endif
+    { 0 }
+  };
+
+typedef struct
+{
+  const pbkdf2_digest_t *d;
+  unsigned int statesize;     /* Size of a chaining value in bytes.  */
+  unsigned long iterations;
+  unsigned int nburn;         /* Stack depth to burn.  */
+  unsigned char *mem;         /* The allocated memory and its size.  */
+  size_t memsize;
+  void *hashctx;              /* Context selecting the implementation.  */
+  unsigned char *keystate;    /* Inner and outer chaining value for each
+                                 passphrase.  */
+  unsigned char *sbuf;        /* SALT || INT (i) and its padding.  */
+  unsigned char *ublock;      /* Padded block holding U.  */
+  unsigned char *tbuf;        /* T of all lanes.  */
+  unsigned char *lanebuf;     /* Transposed lane buffers.  */
+} pbkdf2_engine_t;
+
+
+static const pbkdf2_digest_t *
+pbkdf2_find_digest (int algo)
+{
+  const pbkdf2_digest_t *d;
+
+  if (_gcry_md_test_algo (algo))
+    return NULL;
+
+  for (d = pbkdf2_digests; d->algo; d++)
+    if (d->algo == algo)
+      return d;
+
+  return NULL;
+}
+
+
+/* Add the padding of a message of LEN bytes at BUF which follows
+   the HMAC key block.  Returns the number of blocks.  */
+static size_t
+pbkdf2_pad (const pbkdf2_digest_t *d, unsigned char *buf, size_t len)
+{
+  size_t nblks = (len + 1 + 2 * d->wordsize + d->blocksize - 1) / d->blocksize;
+
+  memset (buf + len, 0, nblks * d->blocksize - len);
+  buf[len] = 0x80;
+  buf_put_be64 (buf + nblks * d->blocksize - 8,
+                ((u64)len + d->blocksize) * 8);
+  return nblks;
+}
+
+
+static inline u64
+pbkdf2_word (unsigned int wordsize, const void *state, unsigned int i)
+{
+  if (wordsize == 4)
+    return ((const u32 *)state)[i];
+  else
+    return ((const u64 *)state)[i];
+}
+
+
+static inline u64
+pbkdf2_lane_get (unsigned int wordsize, const void *rows,
+                 unsigned int row, unsigned int lane)
+{
+  return pbkdf2_word (wordsize, rows,
+                      row * (PBKDF2_ROW_SIZE / wordsize) + lane);
+}
+
+
+static inline void
+pbkdf2_lane_set (unsigned int wordsize, void *rows,
+                 unsigned int row, unsigned int lane, u64 val)
+{
+  unsigned int i = row * (PBKDF2_ROW_SIZE / wordsize) + lane;
+
+  if (wordsize == 4)
+    ((u32 *)rows)[i] = val;
+  else
+    ((u64 *)rows)[i] = val;
+}
+
+
+/* Store the digest from the chaining value STATE into E->UBLOCK
+   without touching its padding.  */
+static void
+pbkdf2_put_u (pbkdf2_engine_t *e, const void *state)
+{
+  const pbkdf2_digest_t *d = e->d;
+  unsigned char *u = e->ublock;
+  unsigned int i;
+
+  if (d->wordsize == 4)
+    for (i = 0; i < d->nwords; i++)
+      buf_put_be32 (u + i * 4, ((const u32 *)state)[i]);
+  else
+    for (i = 0; i < d->nwords; i++)
+      buf_put_be64 (u + i * 8, ((const u64 *)state)[i]);
+
+  if (e->statesize > d->dlen)
+    {
+      memset (u + d->dlen, 0, e->statesize - d->dlen);
+      u[d->dlen] = 0x80;
+    }
+}
+
+
+static inline void
+pbkdf2_burn (pbkdf2_engine_t *e, unsigned int nburn)
+{
+  if (nburn > e->nburn)
+    e->nburn = nburn;
+}
+
+
+static void
+pbkdf2_engine_close (pbkdf2_engine_t *e)
+{
+  if (e->mem)
+    {
+      wipememory (e->mem, e->memsize);
+      xfree (e->mem);
+    }
+  if (e->nburn)
+    _gcry_burn_stack (e->nburn);
+}
+
+
+/* Prepare the engine E for digest D and compute the inner and outer
+   chaining values for the COUNT passphrases.  */
+static gpg_err_code_t
+pbkdf2_engine_open (pbkdf2_engine_t *e, const pbkdf2_digest_t *d,
+                    unsigned int count,
+                    const void * const *passphrase,
+                    const size_t *passphraselen,
+                    size_t maxsaltlen, unsigned long iterations,
+                    int secmode)
+{
+  size_t ctxsize, sbufsize;
+  unsigned char kblk[128];
+  u64 iv[8];
+  unsigned int p, i;
+
+  memset (e, 0, sizeof *e);
+  e->d = d;
+  e->statesize = d->nwords * d->wordsize;
+  e->iterations = iterations;
+
+  ctxsize = ((d->spec->contextsize + PBKDF2_ROW_SIZE - 1)
+             & ~(size_t)(PBKDF2_ROW_SIZE - 1));
+  if (maxsaltlen > (size_t)-1 / 4
+      || count > ((size_t)-1 / 4) / (2 * e->statesize))
+    return GPG_ERR_INV_VALUE;
+  sbufsize = ((maxsaltlen + 4 + 2 * d->blocksize + PBKDF2_ROW_SIZE - 1)
+              & ~(size_t)(PBKDF2_ROW_SIZE - 1));
+
+  e->memsize = (ctxsize + (size_t)count * 2 * e->statesize + sbufsize
+                + d->blocksize
+                + 8 * 64                      /* T of all lanes.  */
+                + PBKDF2_ROW_SIZE * 48);      /* 4 states and a block.  */
+  e->mem = (secmode
+            ? xtrymalloc_secure (e->memsize)
+            : xtrymalloc (e->memsize));
+  if (!e->mem)
+    return gpg_err_code_from_syserror ();
+
+  e->hashctx = e->mem;
+  e->sbuf = e->mem + ctxsize;
+  e->lanebuf = e->sbuf + sbufsize;
+  e->tbuf = e->lanebuf + PBKDF2_ROW_SIZE * 48;
+  e->ublock = e->tbuf + 8 * 64;
+  e->keystate = e->ublock + d->blocksize;
+
+  d->spec->init (e->hashctx, 0);
+  d->compress (e->hashctx, NULL, iv, NULL, 0);
+  pbkdf2_pad (d, e->ublock, d->dlen);
+
+  for (p = 0; p < count; p++)
+    {
+      unsigned char *ist = e->keystate + (size_t)p * 2 * e->statesize;
+      size_t klen = passphraselen[p];
+
+      if (klen > d->blocksize)
+        {
+          _gcry_md_hash_buffer (d->algo, kblk, passphrase[p], klen);
+          klen = d->dlen;
+        }
+      else
+        memcpy (kblk, passphrase[p], klen);
+      memset (kblk + klen, 0, d->blocksize - klen);
+
+      for (i = 0; i < d->blocksize; i++)
+        kblk[i] ^= 0x36;
+      pbkdf2_burn (e, d->compress (e->hashctx, iv, ist, kblk, 1));
+      for (i = 0; i < d->blocksize; i++)
+        kblk[i] ^= 0x36 ^ 0x5c;
+      d->compress (e->hashctx, iv, ist + e->statesize, kblk, 1);
+    }
+
+  wipememory (kblk, sizeof kblk);
+  return 0;
+}
+
+
+/* Compute U_1 = PRF (P, S || INT (LIDX)) for the passphrase with
+   index P into E->UBLOCK.  */
+static void
+pbkdf2_first_u (pbkdf2_engine_t *e, unsigned int p,
+                const void *salt, size_t saltlen, u32 lidx)
+{
+  const pbkdf2_digest_t *d = e->d;
+  const unsigned char *ist = e->keystate + (size_t)p * 2 * e->statesize;
+  u64 st[8];
+  size_t nblks;
+
+  memcpy (e->sbuf, salt, saltlen);
+  buf_put_be32 (e->sbuf + saltlen, lidx);
+  nblks = pbkdf2_pad (d, e->sbuf, saltlen + 4);
+
+  pbkdf2_burn (e, d->compress (e->hashctx, ist, st, e->sbuf, nblks));
+  pbkdf2_put_u (e, st);
+  d->compress (e->hashctx, ist + e->statesize, st, e->ublock, 1);
+  pbkdf2_put_u (e, st);
+
+  wipememory (st, sizeof st);
+}
+
+
+/* Compute the block T_LIDX of the passphrase with index P into T.  */
+static void
+pbkdf2_block (pbkdf2_engine_t *e, unsigned int p,
+              const void *salt, size_t saltlen, u32 lidx,
+              unsigned char *t)
+{
+  const pbkdf2_digest_t *d = e->d;
+  const unsigned char *ist = e->keystate + (size_t)p * 2 * e->statesize;
+  const unsigned char *ost = ist + e->statesize;
+  u64 st[8];
+  unsigned long iter;
+
+  pbkdf2_first_u (e, p, salt, saltlen, lidx);
+  memcpy (t, e->ublock, d->dlen);
+
+  for (iter = 1; iter < e->iterations; iter++)
+    {
+      d->compress (e->hashctx, ist, st, e->ublock, 1);
+      pbkdf2_put_u (e, st);
+      d->compress (e->hashctx, ost, st, e->ublock, 1);
+      pbkdf2_put_u (e, st);
+      buf_xor (t, t, e->ublock, d->dlen);
+    }
+
+  wipememory (st, sizeof st);
+}
+
+
+/* Compute the blocks T_LIDX[J] of the passphrases with index P[J]
+   for the N jobs in the lanes.  T of job J is stored at E->TBUF + J
+   * DLEN.  */
+static void
+pbkdf2_lanes (pbkdf2_engine_t *e, unsigned int n,
+              const unsigned int *p, const u32 *lidx,
+              const void * const *salt, const size_t *saltlen)
+{
+  const pbkdf2_digest_t *d = e->d;
+  unsigned int ws = d->wordsize;
+  unsigned int nlanes = PBKDF2_ROW_SIZE / ws;
+  unsigned int dw = d->dlen / ws;
+  unsigned int rows = d->nwords * PBKDF2_ROW_SIZE;
+  unsigned char *ist = e->lanebuf;
+  unsigned char *ost = ist + 8 * PBKDF2_ROW_SIZE;
+  unsigned char *st = ost + 8 * PBKDF2_ROW_SIZE;
+  unsigned char *acc = st + 8 * PBKDF2_ROW_SIZE;
+  unsigned char *msg = acc + 8 * PBKDF2_ROW_SIZE;
+  unsigned long iter;
+  unsigned int j, w;
+
+  memset (e->lanebuf, 0, 48 * PBKDF2_ROW_SIZE);
+
+  for (j = 0; j < n; j++)
+    {
+      const unsigned char *ks = e->keystate + (size_t)p[j] * 2 * e->statesize;
+
+      pbkdf2_first_u (e, p[j], salt[p[j]], saltlen[p[j]], lidx[j]);
+      for (w = 0; w < d->nwords; w++)
+        {
+          pbkdf2_lane_set (ws, ist, w, j, pbkdf2_word (ws, ks, w));
+          pbkdf2_lane_set (ws, ost, w, j,
+                           pbkdf2_word (ws, ks + e->statesize, w));
+        }
+      for (w = 0; w < dw; w++)
+        pbkdf2_lane_set (ws, msg, w, j,
+                         ws == 4 ? buf_get_be32 (e->ublock + w * 4)
+                                 : buf_get_be64 (e->ublock + w * 8));
+    }
+
+  /* The padding of U is the same for all lanes.  */
+  for (j = 0; j < nlanes; j++)
+    {
+      pbkdf2_lane_set (ws, msg, dw, j, (u64)0x80 << (ws * 8 - 8));
+      pbkdf2_lane_set (ws, msg, 15, j, (u64)(d->blocksize + d->dlen) * 8);
+    }
+
+  memcpy (acc, msg, dw * PBKDF2_ROW_SIZE);
+  for (iter = 1; iter < e->iterations; iter++)
+    {
+      memcpy (st, ist, rows);
+      d->multi (st, msg);
+      memcpy (msg, st, dw * PBKDF2_ROW_SIZE);
+      memcpy (st, ost, rows);
+      d->multi (st, msg);
+      memcpy (msg, st, dw * PBKDF2_ROW_SIZE);
+      buf_xor (acc, acc, msg, dw * PBKDF2_ROW_SIZE);
+    }
+
+  for (j = 0; j < n; j++)
+    for (w = 0; w < dw; w++)
+      {
+        unsigned char *t = e->tbuf + j * d->dlen + w * ws;
+
+        if (ws == 4)
+          buf_put_be32 (t, pbkdf2_lane_get (ws, acc, w, j));
+        else
+          buf_put_be64 (t, pbkdf2_lane_get (ws, acc, w, j));
+      }
+}
+
+
+/* Run PBKDF2 with digest D for COUNT passphrases.  The arguments are
+   those of _gcry_kdf_pkdf2 with arrays for the passphrases, salts
+   and key buffers; they have been checked by the caller.  */
+static gpg_err_code_t
+pbkdf2_derive (const pbkdf2_digest_t *d, unsigned int count,
+               const void * const *passphrase, const size_t *passphraselen,
+               const void * const *salt, const size_t *saltlen,
+               unsigned long iterations,
+               size_t keysize, void * const *keybuffer)
+{
+  gpg_err_code_t ec;
+  pbkdf2_engine_t e;
+  unsigned int l = ((keysize - 1) / d->dlen) + 1;
+  unsigned int r = keysize - (l - 1) * d->dlen;
+  unsigned int p[PBKDF2_ROW_SIZE / 4];
+  u32 lidx[PBKDF2_ROW_SIZE / 4];
+  unsigned int nlanes = 0;
+  size_t maxsaltlen = 0;
+  u64 job, njobs;
+  int secmode = 0;
+  unsigned int i, j;
+
+  for (i = 0; i < count; i++)
+    {
+      if (saltlen[i] > maxsaltlen)
+        maxsaltlen = saltlen[i];
+      if (_gcry_is_secure (passphrase[i]) || _gcry_is_secure (keybuffer[i]))
+        secmode = 1;
+    }
+
+  ec = pbkdf2_engine_open (&e, d, count, passphrase, passphraselen,
+                           maxsaltlen, iterations, secmode);
+  if (ec)
+    {
+      pbkdf2_engine_close (&e);
+      return ec;
+    }
+
+#ifdef USE_AVX2
+  {
+    unsigned int hwf = _gcry_get_hw_features ();
+
+    /* With the SHA extensions a single SHA-256 block is about as fast
+       as eight blocks in the lanes.  */
+    if (d->multi && (hwf & HWF_INTEL_AVX2) && iterations > 1
+        && !((hwf & HWF_INTEL_SHAEXT)
+             && (d->algo == GCRY_MD_SHA224 || d->algo == GCRY_MD_SHA256)))
+      nlanes = PBKDF2_ROW_SIZE / d->wordsize;
+  }
+#endif
+
+  njobs = (u64)count * l;
+  for (job = 0; job < njobs; job += j)
+    {
+      /* The lanes pay off only if at least half of them are used.  */
+      j = njobs - job < nlanes ? njobs - job : nlanes;
+      if (j < 2 || j < nlanes / 2)
+        {
+          j = 1;
+          p[0] = job / l;
+          lidx[0] = job % l + 1;
+          pbkdf2_block (&e, p[0], salt[p[0]], saltlen[p[0]], lidx[0],
+                        e.tbuf);
+        }
+      else
+        {
+          for (i = 0; i < j; i++)
+            {
+              p[i] = (job + i) / l;
+              lidx[i] = (job + i) % l + 1;
+            }
+          pbkdf2_lanes (&e, j, p, lidx, salt, saltlen);
+        }
+
+      for (i = 0; i < j; i++)
+        memcpy ((char *)keybuffer[p[i]] + (size_t)(lidx[i] - 1) * d->dlen,
+                e.tbuf + i * d->dlen, lidx[i] == l ? r : d->dlen);
+    }
+
+  pbkdf2_engine_close (&e);
+  return 0;
+}
+
+
 /* Transform a passphrase into a suitable key of length KEYSIZE and
    store this key in the caller provided buffer KEYBUFFER.  The caller
    must provide PRFALGO which indicates the pseudorandom function to
@@ -127,6 +663,7 @@ _gcry_kdf_pkdf2 (const void *passphrase, size_t passphraselen,
   int secmode;
   unsigned long dklen = keysize;
   char *dk = keybuffer;
+  const pbkdf2_digest_t *d;
   unsigned int hlen;   /* Output length of the digest function.  */
   unsigned int l;      /* Rounded up number of blocks.  */
   unsigned int r;      /* Number of octets in the last block.  */
@@ -160,6 +697,11 @@ _gcry_kdf_pkdf2 (const void *passphrase, size_t passphraselen,
     return GPG_ERR_INV_VALUE;
 #endif
 
+  /* Use the engine working on the compression function if available.  */
+  d = pbkdf2_find_digest (hashalgo);
+  if (d)
+    return pbkdf2_derive (d, 1, &passphrase, &passphraselen, &salt, &saltlen,
+                          iterations, keysize, &keybuffer);
 
   /* Step 2 */
   l = ((dklen - 1)/ hlen) + 1;
@@ -307,6 +849,841 @@ _gcry_kdf_derive (const void *passphrase, size_t passphraselen,
 }
 
 
+
+/* Derive keys for COUNT passphrases.  The arguments are those of
+   _gcry_kdf_derive with arrays of COUNT elements for the passphrases,
+   salts and key buffers; SALT and SALTLEN may be NULL for algorithms
+   not using a salt.  PBKDF2 with a SHA-1 or SHA-2 digest computes the
+   keys in the parallel lanes of the PBKDF2 engine; all other
+   algorithms derive them one after the other.  The arguments are
+   checked as by _gcry_kdf_derive; in particular an empty salt is
+   rejected for PBKDF2 but allowed for scrypt.  */
+gpg_err_code_t
+_gcry_kdf_derive_batch (unsigned int count,
+                        const void * const *passphrase,
+                        const size_t *passphraselen,
+                        int algo, int subalgo,
+                        const void * const *salt, const size_t *saltlen,
+                        unsigned long iterations,
+                        size_t keysize, void * const *keybuffer)
+{
+  gpg_err_code_t ec;
+  const pbkdf2_digest_t *d;
+  unsigned long dklen = keysize;
+  unsigned int i;
+
+  if (!count || !passphrase || !passphraselen || !keybuffer)
+    return GPG_ERR_INV_VALUE;
+
+  if (algo == GCRY_KDF_PBKDF2 && (d = pbkdf2_find_digest (subalgo)))
+    {
+      /* Same order as in _gcry_kdf_derive and _gcry_kdf_pkdf2.  */
+      for (i = 0; i < count; i++)
+        {
+          if (!passphrase[i])
+            return GPG_ERR_INV_DATA;
+          if (!keybuffer[i] || !dklen)
+            return GPG_ERR_INV_VALUE;
+          if (!saltlen || !saltlen[i])
+            return GPG_ERR_INV_VALUE;
+          if (!salt || !salt[i] || !iterations)
+            return GPG_ERR_INV_VALUE;
+        }
+#if SIZEOF_UNSIGNED_LONG > 4
+      if (dklen > 0xffffffffU)
+        return GPG_ERR_INV_VALUE;
+#endif
+
+      return pbkdf2_derive (d, count, passphrase, passphraselen,
+                            salt, saltlen, iterations, keysize, keybuffer);
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      ec = _gcry_kdf_derive (passphrase[i], passphraselen[i], algo, subalgo,
+                             salt? salt[i] : NULL, saltlen? saltlen[i] : 0,
+                             iterations, keysize, keybuffer[i]);
+      if (ec)
+        return ec;
+    }
+
+  return 0;
+}
+
+/* The generic part of the KDF handle; the algorithm specific context
+   starts with the same field.  */
+struct gcry_kdf_handle
+{
+  int algo;
+};
+
+
+#ifdef USE_BLAKE2
+/*
+ * Argon2 as specified in RFC 9106.
+ *
+ * The memory is a single region of MEMORY_BLOCKS blocks of 1 KiB,
+ * divided into LANES lanes of LANE_LENGTH blocks; each lane is split
+ * into 4 segments by the synchronization points.  The segments of one
+ * slice are independent of each other, thus the lanes of a slice may
+ * be computed in parallel by the jobs of the caller provided
+ * gcry_kdf_thread_ops.
+ */
+
+#define ARGON2_VERSION 0x13
+#define ARGON2_WORDS_IN_BLOCK (1024 / 8)
+#define ARGON2_SYNC_POINTS 4
+
+/* Memory regions of at least this size are requested from the kernel
+   with a hint to back them with huge pages.  */
+#define ARGON2_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+#ifdef USE_AVX2
+unsigned int _gcry_blake2b_argon2_fill_block_amd64_avx2 (u64 *cur,
+                                                         const u64 *prev,
+                                                         const u64 *ref,
+                                                         int with_xor)
+                                                         ASM_FUNC_ABI;
+#endif
+
+typedef struct argon2_context *argon2_ctx_t;
+
+/* Per lane job data of one slice.  */
+struct argon2_thread_data
+{
+  argon2_ctx_t a;
+  unsigned int pass;
+  unsigned int slice;
+  unsigned int lane;
+};
+
+struct argon2_context
+{
+  int algo;
+  int hash_type;
+
+  unsigned int outlen;
+  unsigned int passes;
+  unsigned int m_cost;
+  unsigned int memory_blocks;
+  unsigned int segment_length;
+  unsigned int lane_length;
+  unsigned int lanes;
+
+  u64 *block;
+  size_t block_size;
+  unsigned int block_mmapped:1;
+  unsigned int computed:1;
+#ifdef USE_AVX2
+  unsigned int use_avx2:1;
+#endif
+
+  struct argon2_thread_data *thread_data;
+
+  /* H0 followed by room for the block and lane indices.  */
+  unsigned char h0_01_i[64 + 4 + 4];
+};
+
+static const u64 argon2_zero_block[ARGON2_WORDS_IN_BLOCK];
+
+
+/* Convert the block at B from little endian byte order to host
+   order or the other way around.  */
+static inline void
+argon2_swap_block (u64 *b)
+{
+#ifdef WORDS_BIGENDIAN
+  int i;
+
+  for (i = 0; i < ARGON2_WORDS_IN_BLOCK; i++)
+    b[i] = le_bswap64 (b[i]);
+#else
+  (void)b;
+#endif
+}
+
+
+#define ARGON2_ROR64(x, n) rol64 ((x), 64 - (n))
+
+/* The BLAKE2b G function with the additions replaced by the BlaMka
+   multiply-add.  */
+#define ARGON2_BLAMKA(x, y) ((x) + (y) + 2 * (u64)(u32)(x) * (u32)(y))
+
+#define ARGON2_G(a, b, c, d) do {                \
+    a = ARGON2_BLAMKA (a, b);                    \
+    d = ARGON2_ROR64 (d ^ a, 32);                \
+    c = ARGON2_BLAMKA (c, d);                    \
+    b = ARGON2_ROR64 (b ^ c, 24);                \
+    a = ARGON2_BLAMKA (a, b);                    \
+    d = ARGON2_ROR64 (d ^ a, 16);                \
+    c = ARGON2_BLAMKA (c, d);                    \
+    b = ARGON2_ROR64 (b ^ c, 63);                \
+  } while (0)
+
+#define ARGON2_P(v, i0, i1, i2, i3, i4, i5, i6, i7,             \
+                 i8, i9, i10, i11, i12, i13, i14, i15) do {     \
+    ARGON2_G (v[i0], v[i4], v[i8], v[i12]);                     \
+    ARGON2_G (v[i1], v[i5], v[i9], v[i13]);                     \
+    ARGON2_G (v[i2], v[i6], v[i10], v[i14]);                    \
+    ARGON2_G (v[i3], v[i7], v[i11], v[i15]);                    \
+    ARGON2_G (v[i0], v[i5], v[i10], v[i15]);                    \
+    ARGON2_G (v[i1], v[i6], v[i11], v[i12]);                    \
+    ARGON2_G (v[i2], v[i7], v[i8], v[i13]);                     \
+    ARGON2_G (v[i3], v[i4], v[i9], v[i14]);                     \
+  } while (0)
+
+/* Compute CUR = G(PREV, REF), or CUR ^= G(PREV, REF) if WITH_XOR is
+   set.  REF may alias CUR.  Returns the stack burn depth.  */
+static unsigned int
+argon2_fill_block_generic (u64 *cur, const u64 *prev, const u64 *ref,
+                           int with_xor)
+{
+  u64 r[ARGON2_WORDS_IN_BLOCK];
+  u64 t[ARGON2_WORDS_IN_BLOCK];
+  int i;
+
+  for (i = 0; i < ARGON2_WORDS_IN_BLOCK; i++)
+    {
+      r[i] = prev[i] ^ ref[i];
+      t[i] = with_xor ? r[i] ^ cur[i] : r[i];
+    }
+
+  for (i = 0; i < 8; i++)
+    ARGON2_P (r, 16*i + 0,  16*i + 1,  16*i + 2,  16*i + 3,
+                 16*i + 4,  16*i + 5,  16*i + 6,  16*i + 7,
+                 16*i + 8,  16*i + 9,  16*i + 10, 16*i + 11,
+                 16*i + 12, 16*i + 13, 16*i + 14, 16*i + 15);
+
+  for (i = 0; i < 8; i++)
+    ARGON2_P (r, 2*i + 0,   2*i + 1,   2*i + 16,  2*i + 17,
+                 2*i + 32,  2*i + 33,  2*i + 48,  2*i + 49,
+                 2*i + 64,  2*i + 65,  2*i + 80,  2*i + 81,
+                 2*i + 96,  2*i + 97,  2*i + 112, 2*i + 113);
+
+  for (i = 0; i < ARGON2_WORDS_IN_BLOCK; i++)
+    cur[i] = t[i] ^ r[i];
+
+  return sizeof (r) + sizeof (t) + 4 * sizeof (void *);
+}
+
+
+static inline unsigned int
+argon2_fill_block (argon2_ctx_t a, u64 *cur, const u64 *prev, const u64 *ref,
+                   int with_xor)
+{
+  unsigned int nburn;
+
+  if (0)
+    {}
+#ifdef USE_AVX2
+  else if (a->use_avx2)
+    nburn = _gcry_blake2b_argon2_fill_block_amd64_avx2 (cur, prev, ref,
+                                                        with_xor);
+#endif
+  else
+    nburn = argon2_fill_block_generic (cur, prev, ref, with_xor);
+
+  if (nburn)
+    nburn += ASM_EXTRA_STACK;
+
+  (void)a;
+  return nburn;
+}
+
+
+/* Allocate the memory for the blocks.  Large regions are mapped
+   directly and marked for transparent huge pages, which avoids most
+   of the TLB misses of the random reference accesses.  */
+static gpg_err_code_t
+argon2_alloc_blocks (argon2_ctx_t a)
+{
+  size_t n;
+
+  if ((u64)a->memory_blocks * 1024 > (size_t)-1)
+    return GPG_ERR_ENOMEM;
+  n = (size_t)a->memory_blocks * 1024;
+
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+  if (n >= ARGON2_HUGEPAGE_SIZE)
+    {
+      size_t len = (n + ARGON2_HUGEPAGE_SIZE - 1)
+                   & ~(size_t)(ARGON2_HUGEPAGE_SIZE - 1);
+      void *p;
+
+      p = mmap (NULL, len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED)
+        {
+          /* This is only a hint; ignore errors.  */
+          madvise (p, len, MADV_HUGEPAGE);
+          a->block = p;
+          a->block_size = len;
+          a->block_mmapped = 1;
+          return 0;
+        }
+    }
+#endif /*HAVE_MMAP && MADV_HUGEPAGE*/
+
+  a->block = xtrymalloc (n);
+  if (!a->block)
+    return gpg_err_code_from_syserror ();
+  a->block_size = n;
+  a->block_mmapped = 0;
+  return 0;
+}
+
+
+static void
+argon2_free_blocks (argon2_ctx_t a)
+{
+  if (!a->block)
+    return;
+
+  wipememory (a->block, a->block_size);
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+  if (a->block_mmapped)
+    munmap (a->block, a->block_size);
+  else
+#endif
+    xfree (a->block);
+  a->block = NULL;
+}
+
+
+static gpg_err_code_t
+argon2_fill_first_blocks (argon2_ctx_t a)
+{
+  gpg_err_code_t ec;
+  u64 *b;
+  unsigned int l;
+
+  for (l = 0; l < a->lanes; l++)
+    {
+      b = &a->block[(size_t)l * a->lane_length * ARGON2_WORDS_IN_BLOCK];
+
+      buf_put_le32 (a->h0_01_i + 64, 0);
+      buf_put_le32 (a->h0_01_i + 64 + 4, l);
+      ec = _gcry_blake2b_vl_hash (a->h0_01_i, sizeof (a->h0_01_i), 1024, b);
+      if (ec)
+        return ec;
+      argon2_swap_block (b);
+
+      b += ARGON2_WORDS_IN_BLOCK;
+      buf_put_le32 (a->h0_01_i + 64, 1);
+      ec = _gcry_blake2b_vl_hash (a->h0_01_i, sizeof (a->h0_01_i), 1024, b);
+      if (ec)
+        return ec;
+      argon2_swap_block (b);
+    }
+
+  return 0;
+}
+
+
+/* Map the 32-bit random value J1 to the index of the reference block
+   within its lane (RFC 9106, section 3.4.1.2).  */
+static u32
+argon2_index_alpha (argon2_ctx_t a, const struct argon2_thread_data *t,
+                    u32 index, u32 j1, int same_lane)
+{
+  u32 reference_area_size;
+  u64 relative_position;
+  u32 start_position;
+
+  if (t->pass == 0)
+    {
+      if (t->slice == 0)
+        reference_area_size = index - 1;
+      else if (same_lane)
+        reference_area_size = t->slice * a->segment_length + index - 1;
+      else
+        reference_area_size = t->slice * a->segment_length
+                              - (index == 0 ? 1 : 0);
+    }
+  else
+    {
+      if (same_lane)
+        reference_area_size = a->lane_length - a->segment_length + index - 1;
+      else
+        reference_area_size = a->lane_length - a->segment_length
+                              - (index == 0 ? 1 : 0);
+    }
+
+  relative_position = ((u64)j1 * j1) >> 32;
+  relative_position = reference_area_size - 1
+                      - ((reference_area_size * relative_position) >> 32);
+
+  if (t->pass == 0 || t->slice == ARGON2_SYNC_POINTS - 1)
+    start_position = 0;
+  else
+    start_position = (t->slice + 1) * a->segment_length;
+
+  return (start_position + relative_position) % a->lane_length;
+}
+
+
+/* Compute one segment; this is the job function dispatched for each
+   lane of a slice.  */
+static void
+argon2_compute_segment (void *priv)
+{
+  const struct argon2_thread_data *t = priv;
+  const argon2_ctx_t a = t->a;
+  u64 input_block[ARGON2_WORDS_IN_BLOCK];
+  u64 address_block[ARGON2_WORDS_IN_BLOCK];
+  int data_independent;
+  unsigned int burn = 0;
+  unsigned int nburn;
+  u32 i;
+  size_t curr_offset, prev_offset;
+
+  data_independent = (a->hash_type == GCRY_KDF_ARGON2I
+                      || (a->hash_type == GCRY_KDF_ARGON2ID
+                          && t->pass == 0
+                          && t->slice < ARGON2_SYNC_POINTS / 2));
+
+  if (data_independent)
+    {
+      memset (input_block, 0, sizeof (input_block));
+      input_block[0] = t->pass;
+      input_block[1] = t->lane;
+      input_block[2] = t->slice;
+      input_block[3] = a->memory_blocks;
+      input_block[4] = a->passes;
+      input_block[5] = a->hash_type;
+    }
+
+  if (t->pass == 0 && t->slice == 0)
+    i = 2;
+  else
+    i = 0;
+
+  curr_offset = (size_t)t->lane * a->lane_length
+                + t->slice * a->segment_length + i;
+  if ((curr_offset % a->lane_length))
+    prev_offset = curr_offset - 1;
+  else
+    prev_offset = curr_offset + a->lane_length - 1;
+
+  for (; i < a->segment_length; i++, curr_offset++, prev_offset++)
+    {
+      const u64 *ref_block;
+      u64 *curr_block, *prev_block;
+      u64 rand64;
+      u32 ref_lane, ref_index;
+
+      if ((curr_offset % a->lane_length) == 1)
+        prev_offset = curr_offset - 1;
+
+      prev_block = &a->block[prev_offset * ARGON2_WORDS_IN_BLOCK];
+      curr_block = &a->block[curr_offset * ARGON2_WORDS_IN_BLOCK];
+
+      if (data_independent)
+        {
+          if ((i % ARGON2_WORDS_IN_BLOCK) == 0
+              || (t->pass == 0 && t->slice == 0 && i == 2))
+            {
+              /* Next address block: G(0, G(0, input)).  */
+              input_block[6]++;
+              nburn = argon2_fill_block (a, address_block, argon2_zero_block,
+                                         input_block, 0);
+              burn = nburn > burn ? nburn : burn;
+              nburn = argon2_fill_block (a, address_block, argon2_zero_block,
+                                         address_block, 0);
+              burn = nburn > burn ? nburn : burn;
+            }
+          rand64 = address_block[i % ARGON2_WORDS_IN_BLOCK];
+        }
+      else
+        rand64 = prev_block[0];
+
+      if (t->pass == 0 && t->slice == 0)
+        ref_lane = t->lane;
+      else
+        ref_lane = (rand64 >> 32) % a->lanes;
+
+      ref_index = argon2_index_alpha (a, t, i, rand64 & 0xffffffff,
+                                      ref_lane == t->lane);
+      ref_block = &a->block[((size_t)ref_lane * a->lane_length + ref_index)
+                            * ARGON2_WORDS_IN_BLOCK];
+
+      nburn = argon2_fill_block (a, curr_block, prev_block, ref_block,
+                                 t->pass != 0);
+      burn = nburn > burn ? nburn : burn;
+    }
+
+  wipememory (input_block, sizeof (input_block));
+  wipememory (address_block, sizeof (address_block));
+  if (burn)
+    _gcry_burn_stack (burn);
+}
+
+
+static gpg_err_code_t
+argon2_compute (argon2_ctx_t a, const struct gcry_kdf_thread_ops *ops)
+{
+  gpg_err_code_t ec;
+  unsigned int r, s, l;
+
+  ec = argon2_fill_first_blocks (a);
+  if (ec)
+    return ec;
+
+  for (r = 0; r < a->passes; r++)
+    for (s = 0; s < ARGON2_SYNC_POINTS; s++)
+      {
+        for (l = 0; l < a->lanes; l++)
+          {
+            struct argon2_thread_data *t = &a->thread_data[l];
+
+            t->a = a;
+            t->pass = r;
+            t->slice = s;
+            t->lane = l;
+
+            if (!ops)
+              argon2_compute_segment (t);
+            else if (ops->dispatch_job (ops->jobs_context,
+                                        argon2_compute_segment, t) < 0)
+              {
+                /* Let the already dispatched jobs finish before
+                   returning; they still use the thread data.  */
+                ops->wait_all_jobs (ops->jobs_context);
+                return GPG_ERR_CANCELED;
+              }
+          }
+
+        /* Synchronization point.  */
+        if (ops && ops->wait_all_jobs (ops->jobs_context) < 0)
+          return GPG_ERR_CANCELED;
+      }
+
+  a->computed = 1;
+  return 0;
+}
+
+
+static gpg_err_code_t
+argon2_final (argon2_ctx_t a, size_t resultlen, void *result)
+{
+  gpg_err_code_t ec;
+  u64 last_block[ARGON2_WORDS_IN_BLOCK];
+  const u64 *b;
+  unsigned int l;
+  int i;
+
+  if (!a->computed)
+    return GPG_ERR_INV_STATE;
+  if (resultlen != a->outlen)
+    return GPG_ERR_INV_VALUE;
+
+  b = &a->block[((size_t)a->lane_length - 1) * ARGON2_WORDS_IN_BLOCK];
+  memcpy (last_block, b, sizeof (last_block));
+  for (l = 1; l < a->lanes; l++)
+    {
+      b += (size_t)a->lane_length * ARGON2_WORDS_IN_BLOCK;
+      for (i = 0; i < ARGON2_WORDS_IN_BLOCK; i++)
+        last_block[i] ^= b[i];
+    }
+  argon2_swap_block (last_block);
+
+  ec = _gcry_blake2b_vl_hash (last_block, sizeof (last_block),
+                              a->outlen, result);
+  wipememory (last_block, sizeof (last_block));
+  return ec;
+}
+
+
+static void
+argon2_close (argon2_ctx_t a)
+{
+  argon2_free_blocks (a);
+  xfree (a->thread_data);
+  wipememory (a, sizeof (*a));
+  xfree (a);
+}
+
+
+static gpg_err_code_t
+argon2_open (gcry_kdf_hd_t *hd, int subalgo,
+             const unsigned long *param, unsigned int paramlen,
+             const void *password, size_t passwordlen,
+             const void *salt, size_t saltlen,
+             const void *key, size_t keylen,
+             const void *ad, size_t adlen)
+{
+  gpg_err_code_t ec;
+  unsigned int taglen, t_cost, m_cost, parallelism = 1;
+  unsigned int memory_blocks, segment_length;
+  argon2_ctx_t a;
+  gcry_buffer_t iov[8];
+  byte buf[10][4];
+
+  switch (subalgo)
+    {
+    case GCRY_KDF_ARGON2D:
+    case GCRY_KDF_ARGON2I:
+    case GCRY_KDF_ARGON2ID:
+      break;
+    default:
+      return GPG_ERR_INV_VALUE;
+    }
+
+  if (paramlen != 3 && paramlen != 4)
+    return GPG_ERR_INV_VALUE;
+  if (param[0] < 4 || param[0] > 0xffffffff
+      || !param[1] || param[1] > 0xffffffff
+      || param[2] > 0xffffffff)
+    return GPG_ERR_INV_VALUE;
+  taglen = param[0];
+  t_cost = param[1];
+  m_cost = param[2];
+  if (paramlen == 4)
+    {
+      if (!param[3] || param[3] > 0xffffff)
+        return GPG_ERR_INV_VALUE;
+      parallelism = param[3];
+    }
+  if (m_cost < 8 * parallelism)
+    return GPG_ERR_INV_VALUE;
+  if (passwordlen > 0xffffffff || saltlen > 0xffffffff
+      || keylen > 0xffffffff || adlen > 0xffffffff)
+    return GPG_ERR_INV_VALUE;
+
+  /* m' = 4 * p * floor (m / (4 * p)) */
+  segment_length = m_cost / (parallelism * ARGON2_SYNC_POINTS);
+  memory_blocks = segment_length * parallelism * ARGON2_SYNC_POINTS;
+
+  a = xtrycalloc (1, sizeof (*a));
+  if (!a)
+    return gpg_err_code_from_syserror ();
+
+  a->algo = GCRY_KDF_ARGON2;
+  a->hash_type = subalgo;
+  a->outlen = taglen;
+  a->passes = t_cost;
+  a->m_cost = m_cost;
+  a->memory_blocks = memory_blocks;
+  a->segment_length = segment_length;
+  a->lane_length = segment_length * ARGON2_SYNC_POINTS;
+  a->lanes = parallelism;
+#ifdef USE_AVX2
+  a->use_avx2 = !!(_gcry_get_hw_features () & HWF_INTEL_AVX2);
+#endif
+
+  a->thread_data = xtrycalloc (a->lanes, sizeof (*a->thread_data));
+  if (!a->thread_data)
+    {
+      ec = gpg_err_code_from_syserror ();
+      goto leave;
+    }
+
+  ec = argon2_alloc_blocks (a);
+  if (ec)
+    goto leave;
+
+  /* H0; the caller's buffers are not needed after this.  */
+  buf_put_le32 (buf[0], a->lanes);
+  buf_put_le32 (buf[1], a->outlen);
+  buf_put_le32 (buf[2], a->m_cost);
+  buf_put_le32 (buf[3], a->passes);
+  buf_put_le32 (buf[4], ARGON2_VERSION);
+  buf_put_le32 (buf[5], a->hash_type);
+  buf_put_le32 (buf[6], passwordlen);
+  buf_put_le32 (buf[7], saltlen);
+  buf_put_le32 (buf[8], keylen);
+  buf_put_le32 (buf[9], adlen);
+
+  memset (iov, 0, sizeof (iov));
+  iov[0].data = buf[0];
+  iov[0].len = 4 * 7;
+  iov[1].data = (void *)password;
+  iov[1].len = passwordlen;
+  iov[2].data = buf[7];
+  iov[2].len = 4;
+  iov[3].data = (void *)salt;
+  iov[3].len = saltlen;
+  iov[4].data = buf[8];
+  iov[4].len = 4;
+  iov[5].data = (void *)key;
+  iov[5].len = keylen;
+  iov[6].data = buf[9];
+  iov[6].len = 4;
+  iov[7].data = (void *)ad;
+  iov[7].len = adlen;
+
+  ec = _gcry_md_hash_buffers (GCRY_MD_BLAKE2B_512, 0, a->h0_01_i, iov, 8);
+  wipememory (buf, sizeof (buf));
+  if (ec)
+    goto leave;
+
+  *hd = (gcry_kdf_hd_t)a;
+  return 0;
+
+ leave:
+  argon2_close (a);
+  return ec;
+}
+#endif /*USE_BLAKE2*/
+
+
+/* Create a handle HD for the KDF ALGO with variant SUBALGO.  The
+   (PARAM,PARAMLEN) array gives the algorithm parameters; for
+   GCRY_KDF_ARGON2 these are the tag length, the number of passes,
+   the memory cost in KiB and optionally the parallelism; for
+   GCRY_KDF_SCRYPT these are N, r and p.  PASSPHRASE,
+   SALT, KEY and AD are the inputs of the KDF; KEY and AD may be
+   NULL.  The input buffers are not referenced after return.  */
+gpg_err_code_t
+_gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+                const unsigned long *param, unsigned int paramlen,
+                const void *passphrase, size_t passphraselen,
+                const void *salt, size_t saltlen,
+                const void *key, size_t keylen,
+                const void *ad, size_t adlen)
+{
+  gpg_err_code_t ec;
+
+  if (!hd)
+    return GPG_ERR_INV_ARG;
+  *hd = NULL;
+
+  if ((!passphrase && passphraselen) || (!salt && saltlen)
+      || (!key && keylen) || (!ad && adlen) || (!param && paramlen))
+    return GPG_ERR_INV_VALUE;
+
+  switch (algo)
+    {
+    case GCRY_KDF_ARGON2:
+#ifdef USE_BLAKE2
+      if (!saltlen)
+        ec = GPG_ERR_INV_VALUE;
+      else
+        ec = argon2_open (hd, subalgo, param, paramlen,
+                          passphrase, passphraselen, salt, saltlen,
+                          key, keylen, ad, adlen);
+#else
+      ec = GPG_ERR_UNSUPPORTED_ALGORITHM;
+#endif /*USE_BLAKE2*/
+      break;
+
+    case GCRY_KDF_SCRYPT:
+#if USE_SCRYPT
+      if (keylen || adlen)
+        ec = GPG_ERR_INV_VALUE;
+      else
+        ec = _gcry_kdf_scrypt_open (hd, subalgo, param, paramlen,
+                                    passphrase, passphraselen,
+                                    salt, saltlen);
+#else
+      ec = GPG_ERR_UNSUPPORTED_ALGORITHM;
+#endif /*USE_SCRYPT*/
+      break;
+
+    default:
+      ec = GPG_ERR_UNKNOWN_ALGORITHM;
+      break;
+    }
+
+  return ec;
+}
+
+
+/* Run the KDF of HD.  If OPS is not NULL its functions are used to
+   run independent parts of the computation as parallel jobs.  */
+gpg_err_code_t
+_gcry_kdf_compute (gcry_kdf_hd_t h, const struct gcry_kdf_thread_ops *ops)
+{
+  gpg_err_code_t ec;
+
+  if (!h)
+    return GPG_ERR_INV_ARG;
+  if (ops && (!ops->dispatch_job || !ops->wait_all_jobs))
+    return GPG_ERR_INV_ARG;
+
+  switch (h->algo)
+    {
+#ifdef USE_BLAKE2
+    case GCRY_KDF_ARGON2:
+      ec = argon2_compute ((argon2_ctx_t)(void *)h, ops);
+      break;
+#endif /*USE_BLAKE2*/
+
+#if USE_SCRYPT
+    case GCRY_KDF_SCRYPT:
+      ec = _gcry_kdf_scrypt_compute (h, ops);
+      break;
+#endif /*USE_SCRYPT*/
+
+    default:
+      ec = GPG_ERR_UNKNOWN_ALGORITHM;
+      break;
+    }
+
+  return ec;
+}
+
+
+/* Store the RESULTLEN bytes of output of the computed KDF HD at
+   RESULT.  */
+gpg_err_code_t
+_gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen, void *result)
+{
+  gpg_err_code_t ec;
+
+  if (!h || !result)
+    return GPG_ERR_INV_ARG;
+
+  switch (h->algo)
+    {
+#ifdef USE_BLAKE2
+    case GCRY_KDF_ARGON2:
+      ec = argon2_final ((argon2_ctx_t)(void *)h, resultlen, result);
+      break;
+#endif /*USE_BLAKE2*/
+
+#if USE_SCRYPT
+    case GCRY_KDF_SCRYPT:
+      ec = _gcry_kdf_scrypt_final (h, resultlen, result);
+      break;
+#endif /*USE_SCRYPT*/
+
+    default:
+      ec = GPG_ERR_UNKNOWN_ALGORITHM;
+      break;
+    }
+
+  return ec;
+}
+
+
+/* Release the handle H and wipe all its memory.  */
+void
+_gcry_kdf_close (gcry_kdf_hd_t h)
+{
+  if (!h)
+    return;
+
+  switch (h->algo)
+    {
+#ifdef USE_BLAKE2
+    case GCRY_KDF_ARGON2:
+      argon2_close ((argon2_ctx_t)(void *)h);
+      break;
+#endif /*USE_BLAKE2*/
+
+#if USE_SCRYPT
+    case GCRY_KDF_SCRYPT:
+      _gcry_kdf_scrypt_close (h);
+      break;
+#endif /*USE_SCRYPT*/
+
+    default:
+      break;
+    }
+}
+
+
 /* Check one KDF call with ALGO and HASH_ALGO using the regular KDF
  * API. (passphrase,passphraselen) is the password to be derived,
  * (salt,saltlen) the salt for the key derivation,
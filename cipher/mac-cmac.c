@@ -96,6 +96,14 @@ cmac_close (gcry_mac_hd_t h)
 }
 
 
+static gcry_err_code_t
+cmac_copy (gcry_mac_hd_t dst, gcry_mac_hd_t src)
+{
+  /* The copied cipher handle includes the CMAC subkeys.  */
+  return _gcry_cipher_copy_internal (&dst->u.cmac.ctx, src->u.cmac.ctx);
+}
+
+
 static gcry_err_code_t
 cmac_setkey (gcry_mac_hd_t h, const unsigned char *key, size_t keylen)
 {
@@ -437,6 +445,7 @@ cmac_selftest (int algo, int extended, selftest_report_func_t report)
 static gcry_mac_spec_ops_t cmac_ops = {
   cmac_open,
   cmac_close,
+  cmac_copy,
   cmac_setkey,
   NULL,
   cmac_reset,
@@ -80,6 +80,14 @@ gmac_close (gcry_mac_hd_t h)
 }
 
 
+static gcry_err_code_t
+gmac_copy (gcry_mac_hd_t dst, gcry_mac_hd_t src)
+{
+  /* The copied cipher handle includes the GHASH key and tables.  */
+  return _gcry_cipher_copy_internal (&dst->u.gmac.ctx, src->u.gmac.ctx);
+}
+
+
 static gcry_err_code_t
 gmac_setkey (gcry_mac_hd_t h, const unsigned char *key, size_t keylen)
 {
@@ -142,6 +150,7 @@ gmac_get_keylen (int algo)
 static gcry_mac_spec_ops_t gmac_ops = {
   gmac_open,
   gmac_close,
+  gmac_copy,
   gmac_setkey,
   gmac_setiv,
   gmac_reset,
@@ -134,6 +134,15 @@ hmac_close (gcry_mac_hd_t h)
 }
 
 
+static gcry_err_code_t
+hmac_copy (gcry_mac_hd_t dst, gcry_mac_hd_t src)
+{
+  /* The copied digest context also carries the precomputed inner and
+     outer pad states.  */
+  return _gcry_md_copy (&dst->u.hmac.md_ctx, src->u.hmac.md_ctx);
+}
+
+
 static gcry_err_code_t
 hmac_setkey (gcry_mac_hd_t h, const unsigned char *key, size_t keylen)
 {
@@ -1323,6 +1332,7 @@ hmac_selftest (int algo, int extended, selftest_report_func_t report)
 static const gcry_mac_spec_ops_t hmac_ops = {
   hmac_open,
   hmac_close,
+  hmac_copy,
   hmac_setkey,
   NULL,
   hmac_reset,
@@ -46,6 +46,8 @@ struct poly1305mac_context_s;
 /* MAC module functions. */
 typedef gcry_err_code_t (*gcry_mac_open_func_t)(gcry_mac_hd_t h);
 typedef void (*gcry_mac_close_func_t)(gcry_mac_hd_t h);
+typedef gcry_err_code_t (*gcry_mac_copy_func_t)(gcry_mac_hd_t dst,
+						gcry_mac_hd_t src);
 typedef gcry_err_code_t (*gcry_mac_setkey_func_t)(gcry_mac_hd_t h,
 						  const unsigned char *key,
 						  size_t keylen);
@@ -73,6 +75,7 @@ typedef struct gcry_mac_spec_ops
 {
   gcry_mac_open_func_t open;
   gcry_mac_close_func_t close;
+  gcry_mac_copy_func_t copy;
   gcry_mac_setkey_func_t setkey;
   gcry_mac_setiv_func_t setiv;
   gcry_mac_reset_func_t reset;
@@ -110,6 +110,40 @@ poly1305mac_close (gcry_mac_hd_t h)
 }
 
 
+static gcry_err_code_t
+poly1305mac_copy (gcry_mac_hd_t dst, gcry_mac_hd_t src)
+{
+  struct poly1305mac_context_s *src_ctx = src->u.poly1305mac.ctx;
+  struct poly1305mac_context_s *mac_ctx;
+  int secure = (src->magic == CTX_MAC_MAGIC_SECURE);
+  gcry_err_code_t err;
+
+  if (secure)
+    mac_ctx = xtrymalloc_secure (sizeof(*mac_ctx));
+  else
+    mac_ctx = xtrymalloc (sizeof(*mac_ctx));
+
+  if (!mac_ctx)
+    return gpg_err_code_from_syserror ();
+
+  memcpy (mac_ctx, src_ctx, sizeof(*mac_ctx));
+
+  if (src->spec->algo != GCRY_MAC_POLY1305)
+    {
+      err = _gcry_cipher_copy_internal (&mac_ctx->hd, src_ctx->hd);
+      if (err)
+        {
+          wipememory (mac_ctx, sizeof(*mac_ctx));
+          xfree (mac_ctx);
+          return err;
+        }
+    }
+
+  dst->u.poly1305mac.ctx = mac_ctx;
+  return 0;
+}
+
+
 static gcry_err_code_t
 poly1305mac_prepare_key (gcry_mac_hd_t h, const unsigned char *key, size_t keylen)
 {
@@ -315,6 +349,7 @@ poly1305mac_get_keylen (int algo)
 static gcry_mac_spec_ops_t poly1305mac_ops = {
   poly1305mac_open,
   poly1305mac_close,
+  poly1305mac_copy,
   poly1305mac_setkey,
   poly1305mac_setiv,
   poly1305mac_reset,
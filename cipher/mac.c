@@ -554,6 +554,40 @@ mac_close (gcry_mac_hd_t hd)
 }
 
 
+static gcry_err_code_t
+mac_copy (gcry_mac_hd_t *dst, gcry_mac_hd_t src)
+{
+  gcry_err_code_t err;
+  gcry_mac_hd_t h;
+
+  if (!src->spec->ops->copy)
+    return GPG_ERR_NOT_SUPPORTED;
+
+  if (src->magic == CTX_MAC_MAGIC_SECURE)
+    h = xtrymalloc_secure (sizeof (*h));
+  else
+    h = xtrymalloc (sizeof (*h));
+
+  if (!h)
+    return gpg_err_code_from_syserror ();
+
+  /* Copy the generic part and any state kept inline; the module then
+     replaces the references to its sub-objects with fresh copies.  */
+  memcpy (h, src, sizeof (*h));
+
+  err = src->spec->ops->copy (h, src);
+  if (err)
+    {
+      wipememory (h, sizeof (*h));
+      xfree (h);
+    }
+  else
+    *dst = h;
+
+  return err;
+}
+
+
 static gcry_err_code_t
 mac_setkey (gcry_mac_hd_t hd, const void *key, size_t keylen)
 {
@@ -638,6 +672,22 @@ _gcry_mac_close (gcry_mac_hd_t hd)
 }
 
 
+/* Create a new MAC object at HANDLE_DST which is an exact copy of
+   HANDLE_SRC, including the key and all precomputed key material.
+   HANDLE_DST is guaranteed to be a valid handle or NULL on error.  */
+gcry_err_code_t
+_gcry_mac_copy (gcry_mac_hd_t *handle_dst, gcry_mac_hd_t handle_src)
+{
+  gcry_err_code_t rc;
+  gcry_mac_hd_t hd = NULL;
+
+  rc = mac_copy (&hd, handle_src);
+
+  *handle_dst = rc ? NULL : hd;
+  return rc;
+}
+
+
 gcry_err_code_t
 _gcry_mac_setkey (gcry_mac_hd_t hd, const void *key, size_t keylen)
 {
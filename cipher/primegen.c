@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include "g10lib.h"
 #include "mpi.h"
@@ -41,6 +42,17 @@ static void m_out_of_n( char *array, int m, int n );
 static void (*progress_cb) (void *,const char*,int,int, int );
 static void *progress_cb_data;
 
+/* The maximum number of threads used to search for a prime.  */
+#define MAX_PRIMEGEN_THREADS 8
+
+/* The number of threads used to search for a prime, including the
+   calling thread.  Values below 2 disable the concurrent search.  */
+static unsigned int primegen_threads;
+
+/* The number of candidates gen_prime tries after each random start
+   value.  */
+#define PRIME_SEARCH_RANGE 20000
+
 /* Note: 2 is not included because it can be tested more easily by
    looking at bit 0. The last entry in this list is marked by a zero */
 static ushort small_prime_numbers[] = {
@@ -221,6 +233,260 @@ get_pool_prime (unsigned int nbits, gcry_random_level_t randomlevel)
 }
 
 
+/* A second pool keeps secret primes of the sizes requested with
+   GCRYCTL_SET_PRIME_POOL ready for key generation.  It is filled by a
+   background thread which terminates once all sizes have their
+   requested number of primes and is restarted when a prime is taken.
+   All primes are generated with PRIMEPOOL_RANDOM_LEVEL so that they
+   can be used for any random level.  The pool is protected by
+   primepool_lock.  */
+#define PRIMEPOOL_MAX_SIZES 4
+#define PRIMEPOOL_MAX_COUNT 16
+#define PRIMEPOOL_RANDOM_LEVEL GCRY_VERY_STRONG_RANDOM
+struct primepool_size_s
+{
+  unsigned int nbits;    /* If this is 0 the entry is not used.  */
+  unsigned int count;    /* The requested number of primes.  */
+  unsigned int ready;    /* The number of primes in PRIMES.  */
+  unsigned int hits;     /* Requests served from the pool.  */
+  unsigned int misses;   /* Requests which found no suitable prime.  */
+  gcry_mpi_t primes[PRIMEPOOL_MAX_COUNT];
+};
+static struct primepool_size_s primepool_sizes[PRIMEPOOL_MAX_SIZES];
+/* True while the background thread is running.  */
+static int primepool_filling;
+/* The process owning the primes of PRIMEPOOL_SIZES.  */
+static pid_t primepool_pid;
+
+
+/* Release all primes of SIZE in excess of COUNT.  */
+static void
+release_pool_size (struct primepool_size_s *size, unsigned int count)
+{
+  while (size->ready > count)
+    {
+      size->ready--;
+      _gcry_mpi_release (size->primes[size->ready]);
+      size->primes[size->ready] = NULL;
+    }
+}
+
+
+/* Return the entry of the secret prime pool for NBITS or NULL.  Needs
+   to be called while primepool_lock is being hold.  */
+static struct primepool_size_s *
+find_pool_size (unsigned int nbits)
+{
+  int i;
+
+  if (primepool_pid != getpid ())
+    {
+      /* This is a child process.  Its primes are also known to the
+         parent process and the background thread was not
+         inherited.  */
+      for (i=0; i < PRIMEPOOL_MAX_SIZES; i++)
+        release_pool_size (primepool_sizes + i, 0);
+      primepool_filling = 0;
+      primepool_pid = getpid ();
+    }
+
+  for (i=0; i < PRIMEPOOL_MAX_SIZES; i++)
+    if (primepool_sizes[i].nbits && primepool_sizes[i].nbits == nbits)
+      return primepool_sizes + i;
+  return NULL;
+}
+
+
+/* The background thread filling the secret prime pool.  The size
+   with the fewest primes is served first.  The thread lets a fork
+   proceed before each prime and, in prime_search_part, before each
+   candidate which passed the sieve.  */
+static void
+primepool_fill (void *arg)
+{
+  struct primepool_size_s *size;
+  gcry_mpi_t prime;
+  unsigned int nbits, ready;
+  int i;
+
+  (void)arg;
+
+  for (;;)
+    {
+      _gcry_worker_checkpoint ();
+      gpgrt_lock_lock (&primepool_lock);
+      nbits = ready = 0;
+      for (i=0; i < PRIMEPOOL_MAX_SIZES; i++)
+        {
+          size = primepool_sizes + i;
+          if (size->nbits && size->ready < size->count
+              && (!nbits || size->ready < ready))
+            {
+              nbits = size->nbits;
+              ready = size->ready;
+            }
+        }
+      if (!nbits)
+        {
+          primepool_filling = 0;
+          gpgrt_lock_unlock (&primepool_lock);
+          return;
+        }
+      gpgrt_lock_unlock (&primepool_lock);
+
+      prime = gen_prime (nbits, 1, PRIMEPOOL_RANDOM_LEVEL, NULL, NULL);
+
+      gpgrt_lock_lock (&primepool_lock);
+      size = find_pool_size (nbits);
+      if (size && size->ready < size->count)
+        {
+          size->primes[size->ready++] = prime;
+          prime = NULL;
+        }
+      gpgrt_lock_unlock (&primepool_lock);
+      _gcry_mpi_release (prime);
+    }
+}
+
+
+/* Start the background thread unless it is running or the secret
+   prime pool is full.  Needs to be called while primepool_lock is
+   being hold.  */
+static gpg_err_code_t
+primepool_kick (void)
+{
+  gpg_err_code_t rc;
+  int i;
+
+  if (primepool_filling)
+    return 0;
+  for (i=0; i < PRIMEPOOL_MAX_SIZES; i++)
+    if (primepool_sizes[i].ready < primepool_sizes[i].count)
+      break;
+  if (i == PRIMEPOOL_MAX_SIZES)
+    return 0;
+
+  rc = _gcry_worker_start_background (primepool_fill, NULL);
+  if (!rc)
+    primepool_filling = 1;
+  return rc;
+}
+
+
+/* Return a secret prime of NBITS from the pool which is good for
+   RANDOMLEVEL and passes EXTRA_CHECK or NULL if there is none.  */
+static gcry_mpi_t
+take_pool_prime (unsigned int nbits, gcry_random_level_t randomlevel,
+                 int (*extra_check)(void *, gcry_mpi_t),
+                 void *extra_check_arg)
+{
+  struct primepool_size_s *size;
+  gcry_mpi_t prime = NULL;
+  unsigned int i;
+
+  if (gpgrt_lock_lock (&primepool_lock))
+    return NULL;
+  size = find_pool_size (nbits);
+  if (size)
+    {
+      if (randomlevel <= PRIMEPOOL_RANDOM_LEVEL)
+        for (i = size->ready; !prime && i--; )
+          if (!extra_check
+              || !extra_check (extra_check_arg, size->primes[i]))
+            {
+              prime = size->primes[i];
+              size->primes[i] = size->primes[--size->ready];
+              size->primes[size->ready] = NULL;
+            }
+      if (prime)
+        size->hits++;
+      else
+        size->misses++;
+      primepool_kick ();
+    }
+  gpgrt_lock_unlock (&primepool_lock);
+  return prime;
+}
+
+
+/* Keep COUNT secret primes of NBITS ready, with COUNT limited to
+   PRIMEPOOL_MAX_COUNT.  A COUNT of 0 releases the primes of NBITS.  */
+gpg_err_code_t
+_gcry_primegen_set_pool (unsigned int nbits, unsigned int count)
+{
+  struct primepool_size_s *size;
+  gpg_err_code_t rc;
+  int i;
+
+  if (nbits < 64 || nbits > 8192)
+    return GPG_ERR_INV_ARG;
+  if (count > PRIMEPOOL_MAX_COUNT)
+    count = PRIMEPOOL_MAX_COUNT;
+
+  rc = gpgrt_lock_lock (&primepool_lock);
+  if (rc)
+    return rc;
+  size = find_pool_size (nbits);
+  if (!size && count)
+    {
+      for (i=0; i < PRIMEPOOL_MAX_SIZES; i++)
+        if (!primepool_sizes[i].nbits)
+          {
+            size = primepool_sizes + i;
+            memset (size, 0, sizeof *size);
+            size->nbits = nbits;
+            break;
+          }
+      if (!size)
+        rc = GPG_ERR_LIMIT_REACHED;
+    }
+  if (size)
+    {
+      size->count = count;
+      release_pool_size (size, count);
+      rc = primepool_kick ();
+      if (rc || !count)
+        {
+          release_pool_size (size, 0);
+          size->nbits = 0;
+          size->count = 0;
+        }
+    }
+  gpgrt_lock_unlock (&primepool_lock);
+  return rc;
+}
+
+
+/* Store the number of secret primes of NBITS which are ready and the
+   number of requests which could or could not be served from the pool
+   at the given addresses, which may be NULL.  */
+gpg_err_code_t
+_gcry_primegen_get_pool_stats (unsigned int nbits, unsigned int *r_ready,
+                               unsigned int *r_hits, unsigned int *r_misses)
+{
+  struct primepool_size_s *size;
+  gpg_err_code_t rc;
+
+  rc = gpgrt_lock_lock (&primepool_lock);
+  if (rc)
+    return rc;
+  size = find_pool_size (nbits);
+  if (!size)
+    rc = GPG_ERR_NOT_FOUND;
+  else
+    {
+      if (r_ready)
+        *r_ready = size->ready;
+      if (r_hits)
+        *r_hits = size->hits;
+      if (r_misses)
+        *r_misses = size->misses;
+    }
+  gpgrt_lock_unlock (&primepool_lock);
+  return rc;
+}
+
+
 
 
 
@@ -234,16 +500,91 @@ _gcry_register_primegen_progress ( void (*cb)(void *,const char*,int,int,int),
 }
 
 
+/* Progress is only reported by the thread which called the prime
+   generation; the helper threads of a concurrent search are silent.  */
 static void
 progress( int c )
 {
-  if ( progress_cb )
+  if ( progress_cb && !_gcry_worker_self_p () )
     progress_cb ( progress_cb_data, "primegen", c, 0, 0 );
 }
 
 
+/* Use up to NTHREADS threads, including the calling one, to search
+   for a prime.  */
+void
+_gcry_primegen_set_threads (unsigned int nthreads)
+{
+  if (nthreads > MAX_PRIMEGEN_THREADS)
+    nthreads = MAX_PRIMEGEN_THREADS;
+  primegen_threads = nthreads;
+}
+
+
+/* Return the number of threads to be used for a prime search.  */
+unsigned int
+_gcry_primegen_get_threads (void)
+{
+  return primegen_threads > 1? primegen_threads : 1;
+}
+
+
+/* Argument of run_part_job.  */
+struct primegen_part
+{
+  void (*fn) (void *arg, unsigned int part);
+  void *arg;
+  unsigned int part;
+  void *job;
+};
+
+static void
+run_part_job (void *arg)
+{
+  struct primegen_part *part = arg;
+
+  part->fn (part->arg, part->part);
+}
+
+
+/* Call FN (ARG, PART) for PART = 0 to NPARTS - 1 and return when all
+   calls have returned.  Part 0 is run by the calling thread, the
+   others on the threads of the worker pool.  If no thread is
+   available, the calling thread runs the part after part 0.  Thus FN
+   needs to cope with any order of execution.  */
+void
+_gcry_primegen_run_parts (unsigned int nparts,
+                          void (*fn) (void *arg, unsigned int part),
+                          void *arg)
+{
+  struct primegen_part parts[MAX_PRIMEGEN_THREADS];
+  unsigned int i;
+
+  gcry_assert (nparts && nparts <= MAX_PRIMEGEN_THREADS);
+
+  for (i=0; i < nparts; i++)
+    {
+      parts[i].fn = fn;
+      parts[i].arg = arg;
+      parts[i].part = i;
+      parts[i].job = NULL;
+      if (i && _gcry_worker_start (&parts[i].job, run_part_job, parts + i))
+        parts[i].fn = NULL;
+    }
+
+  fn (arg, 0);
+  for (i=1; i < nparts; i++)
+    if (!parts[i].fn)
+      fn (arg, i);
+
+  for (i=1; i < nparts; i++)
+    _gcry_worker_wait (parts[i].job);
+}
+
+
 /****************
- * Generate a prime number (stored in secure memory)
+ * Generate a prime number (stored in secure memory).  A prime from
+ * the pool configured with GCRYCTL_SET_PRIME_POOL is used if possible.
  */
 gcry_mpi_t
 _gcry_generate_secret_prime (unsigned int nbits,
@@ -253,7 +594,9 @@ _gcry_generate_secret_prime (unsigned int nbits,
 {
   gcry_mpi_t prime;
 
-  prime = gen_prime (nbits, 1, random_level, extra_check, extra_check_arg);
+  prime = take_pool_prime (nbits, random_level, extra_check, extra_check_arg);
+  if (!prime)
+    prime = gen_prime (nbits, 1, random_level, extra_check, extra_check_arg);
   progress('\n');
   return prime;
 }
@@ -374,12 +717,19 @@ prime_generate_internal (int need_q_factor,
   /* Allocate an integer to old the new prime. */
   prime = mpi_new (pbits);
 
-  /* Generate first prime factor.  */
-  q = gen_prime (qbits, is_secret, randomlevel, NULL, NULL);
+  /* Generate first prime factor.  It may be taken from the pool of
+     secret primes. */
+  q = take_pool_prime (qbits, randomlevel, NULL, NULL);
+  if (!q)
+    q = gen_prime (qbits, is_secret, randomlevel, NULL, NULL);
 
   /* Generate a specific Q-Factor if requested. */
   if (need_q_factor)
-    q_factor = gen_prime (req_qbits, is_secret, randomlevel, NULL, NULL);
+    {
+      q_factor = take_pool_prime (req_qbits, randomlevel, NULL, NULL);
+      if (!q_factor)
+        q_factor = gen_prime (req_qbits, is_secret, randomlevel, NULL, NULL);
+    }
 
   /* Allocate an array to hold all factors + 2 for later usage.  */
   factors = xtrycalloc (n + 2, sizeof (*factors));
@@ -742,14 +1092,170 @@ _gcry_generate_elg_prime (int mode, unsigned pbits, unsigned qbits,
 }
 
 
+/* The state of a search for a prime starting at START, which is
+   shared by the parts of a concurrent search.  Part I of N tests the
+   candidates START + STEP for STEP = 2I, 2I + 2N, ... below
+   PRIME_SEARCH_RANGE.  The result is the smallest STEP at which a
+   prime has been accepted or the search had to be stopped; this is
+   the same as for a search by a single thread.  */
+struct prime_search
+{
+  gcry_mpi_t start;
+  int *mods;                /* START modulo the small primes.  This is
+                               only changed by a single part.  */
+  unsigned int nbits;
+  int secret;
+  int (*extra_check)(void *, gcry_mpi_t);
+  void *extra_check_arg;
+  unsigned int nparts;
+  gpgrt_lock_t lock;        /* Protects the following fields.  */
+  unsigned int found;       /* The result or PRIME_SEARCH_RANGE.  */
+  gcry_mpi_t prime;         /* The prime at FOUND or NULL.  */
+};
+
+
+/* Record the result PRIME, which may be NULL, at STEP of the search
+   PS unless a smaller step has already been recorded.  PRIME is
+   considered released after calling this function.  */
+static void
+prime_search_record (struct prime_search *ps, unsigned int step,
+                     gcry_mpi_t prime)
+{
+  gpgrt_lock_lock (&ps->lock);
+  if (step < ps->found)
+    {
+      ps->found = step;
+      _gcry_mpi_release (ps->prime);
+      ps->prime = prime;
+      prime = NULL;
+    }
+  gpgrt_lock_unlock (&ps->lock);
+  _gcry_mpi_release (prime);
+}
+
+
+/* Search part PART of the search ARG.  */
+static void
+prime_search_part (void *arg, unsigned int part)
+{
+  struct prime_search *ps = arg;
+  gcry_mpi_t ptest, pminus1, val_2, result;
+  int *mods = ps->mods;
+  int i;
+  unsigned int x, step, stride;
+  unsigned int count2 = 0;
+  int dotcount = 0;
+
+  val_2  = mpi_alloc_set_ui( 2 );
+  result = mpi_alloc_like( ps->start );
+  pminus1= mpi_alloc_like( ps->start );
+  ptest  = mpi_alloc_like( ps->start );
+
+  /* Now try some primes starting with START. */
+  stride = 2 * ps->nparts;
+  for (step = 2 * part; step < PRIME_SEARCH_RANGE; step += stride)
+    {
+      if (ps->nparts > 1)
+        {
+          int done;
+
+          /* Stop if another part has found a smaller result.  */
+          gpgrt_lock_lock (&ps->lock);
+          done = step > ps->found;
+          gpgrt_lock_unlock (&ps->lock);
+          if (done)
+            break;
+        }
+
+      /* Check against all the small primes we have in mods.  The
+         parts of a concurrent search share MODS and thus can't
+         update it.  */
+      if (ps->nparts > 1)
+        {
+          for (i=0; (x = small_prime_numbers[i]); i++ )
+            if ( !((mods[i] + step) % x) )
+              break;
+        }
+      else
+        {
+          for (i=0; (x = small_prime_numbers[i]); i++ )
+            {
+              while ( mods[i] + step >= x )
+                mods[i] -= x;
+              if ( !(mods[i] + step) )
+                break;
+            }
+        }
+      if ( x )
+        continue;   /* Found a multiple of an already known prime. */
+
+      /* No lock is held here; see primepool_fill.  */
+      _gcry_worker_checkpoint ();
+
+      mpi_add_ui( ptest, ps->start, step );
+
+      /* Do a fast Fermat test now. */
+      count2++;
+      mpi_sub_ui( pminus1, ptest, 1);
+      mpi_powm( result, val_2, pminus1, ptest );
+      if ( !mpi_cmp_ui( result, 1 ) )
+        {
+          /* Not composite, perform stronger tests */
+          if (is_prime(ptest, 5, &count2 ))
+            {
+              if (!mpi_test_bit( ptest, ps->nbits-1-ps->secret ))
+                {
+                  progress('\n');
+                  log_debug ("overflow in prime generation\n");
+                  /* Stop loop, continue with a new prime. */
+                  prime_search_record (ps, step, NULL);
+                  break;
+                }
+
+              if (ps->extra_check
+                  && ps->extra_check (ps->extra_check_arg, ptest))
+                {
+                  /* The extra check told us that this prime is
+                     not of the caller's taste. */
+                  progress ('/');
+                }
+              else
+                {
+                  /* Got it. */
+                  prime_search_record (ps, step, ptest);
+                  ptest = NULL;
+                  break;
+                }
+            }
+        }
+      if (++dotcount == 10 )
+        {
+          progress('.');
+          dotcount = 0;
+        }
+    }
+
+  mpi_free(val_2);
+  mpi_free(result);
+  mpi_free(pminus1);
+  mpi_free(ptest);
+}
+
+
+/* Generate a prime of NBITS.  If more than one thread has been
+   configured with _gcry_primegen_set_threads, the candidates following
+   each random start value are tested concurrently.  The returned prime
+   is the same as with a single thread; only the random values used by
+   the Rabin-Miller tests may differ.  EXTRA_CHECK may then be called
+   from several threads at the same time.  */
 static gcry_mpi_t
 gen_prime (unsigned int nbits, int secret, int randomlevel,
            int (*extra_check)(void *, gcry_mpi_t), void *extra_check_arg)
 {
-  gcry_mpi_t prime, ptest, pminus1, val_2, val_3, result;
+  struct prime_search ps;
+  gcry_mpi_t prime;
   int i;
-  unsigned int x, step;
-  unsigned int count1, count2;
+  unsigned int x;
   int *mods;
 
 /*   if (  DBG_CIPHER ) */
@@ -761,17 +1267,22 @@ gen_prime (unsigned int nbits, int secret, int randomlevel,
   mods = (secret? xmalloc_secure (no_of_small_prime_numbers * sizeof *mods)
           /* */ : xmalloc (no_of_small_prime_numbers * sizeof *mods));
   /* Make nbits fit into gcry_mpi_t implementation. */
-  val_2  = mpi_alloc_set_ui( 2 );
-  val_3 = mpi_alloc_set_ui( 3);
   prime  = secret? mpi_snew (nbits): mpi_new (nbits);
-  result = mpi_alloc_like( prime );
-  pminus1= mpi_alloc_like( prime );
-  ptest  = mpi_alloc_like( prime );
-  count1 = count2 = 0;
+
+  memset (&ps, 0, sizeof ps);
+  ps.start = prime;
+  ps.nbits = nbits;
+  ps.secret = secret;
+  ps.extra_check = extra_check;
+  ps.extra_check_arg = extra_check_arg;
+  ps.mods = mods;
+  /* The threads of the worker pool, which includes the one filling
+     the prime pool, don't start further threads.  */
+  ps.nparts = _gcry_worker_self_p ()? 1 : _gcry_primegen_get_threads ();
+  gpgrt_lock_init (&ps.lock);
+
   for (;;)
     {  /* try forvever */
-      int dotcount=0;
-
       /* generate a random number */
       _gcry_mpi_randomize( prime, nbits, randomlevel );
 
@@ -788,64 +1299,21 @@ gen_prime (unsigned int nbits, int secret, int randomlevel,
       for (i=0; (x = small_prime_numbers[i]); i++ )
         mods[i] = mpi_fdiv_r_ui(NULL, prime, x);
 
-      /* Now try some primes starting with prime. */
-      for(step=0; step < 20000; step += 2 )
-        {
-          /* Check against all the small primes we have in mods. */
-          count1++;
-          for (i=0; (x = small_prime_numbers[i]); i++ )
-            {
-              while ( mods[i] + step >= x )
-                mods[i] -= x;
-              if ( !(mods[i] + step) )
-                break;
-	    }
-          if ( x )
-            continue;   /* Found a multiple of an already known prime. */
-
-          mpi_add_ui( ptest, prime, step );
-
-          /* Do a fast Fermat test now. */
-          count2++;
-          mpi_sub_ui( pminus1, ptest, 1);
-          mpi_powm( result, val_2, pminus1, ptest );
-          if ( !mpi_cmp_ui( result, 1 ) )
-            {
-              /* Not composite, perform stronger tests */
-              if (is_prime(ptest, 5, &count2 ))
-                {
-                  if (!mpi_test_bit( ptest, nbits-1-secret ))
-                    {
-                      progress('\n');
-                      log_debug ("overflow in prime generation\n");
-                      break; /* Stop loop, continue with a new prime. */
-                    }
+      ps.found = PRIME_SEARCH_RANGE;
+      ps.prime = NULL;
+      if (ps.nparts > 1)
+        _gcry_primegen_run_parts (ps.nparts, prime_search_part, &ps);
+      else
+        prime_search_part (&ps, 0);
 
-                  if (extra_check && extra_check (extra_check_arg, ptest))
-                    {
-                      /* The extra check told us that this prime is
-                         not of the caller's taste. */
-                      progress ('/');
-                    }
-                  else
-                    {
-                      /* Got it. */
-                      mpi_free(val_2);
-                      mpi_free(val_3);
-                      mpi_free(result);
-                      mpi_free(pminus1);
-                      mpi_free(prime);
-                      xfree(mods);
-                      return ptest;
-                    }
-                }
-	    }
-          if (++dotcount == 10 )
-            {
-              progress('.');
-              dotcount = 0;
-	    }
-	}
+      if (ps.prime)
+        {
+          /* Got it. */
+          gpgrt_lock_destroy (&ps.lock);
+          mpi_free(prime);
+          xfree(mods);
+          return ps.prime;
+        }
       progress(':'); /* restart with a new random value */
     }
 }
@@ -96,6 +96,8 @@ gpg_err_code_t _gcry_dsa_gen_rfc6979_k (gcry_mpi_t *r_k,
 gpg_err_code_t _gcry_dsa_normalize_hash (gcry_mpi_t input,
                                          gcry_mpi_t *out,
                                          unsigned int qbits);
+void _gcry_dl_powm_base (gcry_mpi_t res, gcry_mpi_t g, gcry_mpi_t k,
+                        gcry_mpi_t p, unsigned int nbits);
 
 /*-- ecc.c --*/
 gpg_err_code_t _gcry_pk_ecc_get_sexp (gcry_sexp_t *r_sexp, int mode,
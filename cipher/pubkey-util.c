@@ -170,6 +170,8 @@ _gcry_pk_util_parse_flaglist (gcry_sexp_t list,
             igninvflag = 1;
           else if (!memcmp (s, "no-keytest", 10))
             flags |= PUBKEY_FLAG_NO_KEYTEST;
+          else if (!memcmp (s, "cofactored", 10))
+            flags |= PUBKEY_FLAG_COFACTORED;
           else if (!igninvflag)
             rc = GPG_ERR_INV_FLAG;
           break;
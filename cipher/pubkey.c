@@ -467,6 +467,228 @@ _gcry_pk_verify (gcry_sexp_t s_sig, gcry_sexp_t s_hash, gcry_sexp_t s_pkey)
 }
 
 
+/*
+   Verify a batch of signatures.
+
+   Check the COUNT signatures SIGVALS[I] on DATA[I] using the public
+   keys PKEYS[I] and store the result of each check at RESULTS[I].
+   Algorithms which support it check all their signatures together;
+   all others are checked one by one.  Returns 0 if all signatures are
+   good and GPG_ERR_BAD_SIGNATURE if at least one check failed.  */
+gcry_err_code_t
+_gcry_pk_verify_batch (unsigned int count, const gcry_sexp_t *sigvals,
+                       const gcry_sexp_t *data, const gcry_sexp_t *pkeys,
+                       gpg_error_t *results)
+{
+  gcry_err_code_t rc;
+  gcry_pk_spec_t *spec, **specs;
+  gcry_sexp_t *keyparms, *bsigvals, *bdata, *bkeyparms;
+  gcry_err_code_t *codes, *bcodes;
+  unsigned int *idx;
+  unsigned int i, j, n;
+
+  if (!count)
+    return 0;
+
+  specs = xtrycalloc (count, sizeof *specs);
+  keyparms = xtrycalloc (count, sizeof *keyparms);
+  codes = xtrycalloc (count, sizeof *codes);
+  bsigvals = xtrycalloc (count, sizeof *bsigvals);
+  bdata = xtrycalloc (count, sizeof *bdata);
+  bkeyparms = xtrycalloc (count, sizeof *bkeyparms);
+  bcodes = xtrycalloc (count, sizeof *bcodes);
+  idx = xtrycalloc (count, sizeof *idx);
+  if (!specs || !keyparms || !codes || !bsigvals || !bdata || !bkeyparms
+      || !bcodes || !idx)
+    {
+      rc = gpg_err_code_from_syserror ();
+      for (i = 0; i < count; i++)
+        results[i] = gpg_error (rc);
+      goto leave;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      codes[i] = spec_from_sexp (pkeys[i], 0, &specs[i], &keyparms[i]);
+      if (codes[i])
+        specs[i] = NULL;
+      else if (!specs[i]->verify_batch)
+        {
+          if (specs[i]->verify)
+            codes[i] = specs[i]->verify (sigvals[i], data[i], keyparms[i]);
+          else
+            codes[i] = GPG_ERR_NOT_IMPLEMENTED;
+          specs[i] = NULL;
+        }
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      if (!specs[i])
+        continue;
+
+      spec = specs[i];
+      for (n = 0, j = i; j < count; j++)
+        if (specs[j] == spec)
+          {
+            specs[j] = NULL;
+            bsigvals[n] = sigvals[j];
+            bdata[n] = data[j];
+            bkeyparms[n] = keyparms[j];
+            idx[n++] = j;
+          }
+      rc = spec->verify_batch (n, bsigvals, bdata, bkeyparms, bcodes);
+      for (j = 0; j < n; j++)
+        codes[idx[j]] = rc? rc : bcodes[j];
+    }
+
+  rc = 0;
+  for (i = 0; i < count; i++)
+    {
+      results[i] = gpg_error (codes[i]);
+      if (codes[i])
+        rc = GPG_ERR_BAD_SIGNATURE;
+    }
+
+ leave:
+  if (keyparms)
+    for (i = 0; i < count; i++)
+      sexp_release (keyparms[i]);
+  xfree (idx);
+  xfree (bcodes);
+  xfree (bkeyparms);
+  xfree (bdata);
+  xfree (bsigvals);
+  xfree (codes);
+  xfree (keyparms);
+  xfree (specs);
+  return rc;
+}
+
+
+/* A key parsed by _gcry_pk_key_new.  */
+struct gcry_pk_key
+{
+  gcry_pk_spec_t *spec;
+  gcry_sexp_t keyparms;  /* The parameters of the key.  */
+  int secret;            /* The key is a private key.  */
+  void *prepared;        /* The key as returned by SPEC->prepare.  */
+};
+
+
+/*
+   Create a handle for the public or private key S_KEY and store it at
+   R_KEY.  The key is parsed only once so that the handle can be used
+   for many operations with the *_key functions.  */
+gcry_err_code_t
+_gcry_pk_key_new (gcry_pk_key_t *r_key, gcry_sexp_t s_key)
+{
+  gcry_err_code_t rc;
+  gcry_pk_key_t key;
+  gcry_sexp_t l1;
+
+  *r_key = NULL;
+
+  key = xtrycalloc (1, sizeof *key);
+  if (!key)
+    return gpg_err_code_from_syserror ();
+
+  l1 = sexp_find_token (s_key, "private-key", 0);
+  key->secret = !!l1;
+  sexp_release (l1);
+
+  rc = spec_from_sexp (s_key, key->secret, &key->spec, &key->keyparms);
+  if (!rc && key->spec->prepare)
+    rc = key->spec->prepare (&key->prepared, key->keyparms);
+  if (rc)
+    {
+      sexp_release (key->keyparms);
+      xfree (key);
+      return rc;
+    }
+
+  *r_key = key;
+  return 0;
+}
+
+
+/* Release the key handle KEY.  */
+void
+_gcry_pk_key_release (gcry_pk_key_t key)
+{
+  if (!key)
+    return;
+  if (key->prepared)
+    key->spec->release_prepared (key->prepared);
+  sexp_release (key->keyparms);
+  xfree (key);
+}
+
+
+/* Same as _gcry_pk_encrypt but using the key handle KEY.  */
+gcry_err_code_t
+_gcry_pk_encrypt_key (gcry_sexp_t *r_ciph, gcry_sexp_t s_data,
+                      gcry_pk_key_t key)
+{
+  *r_ciph = NULL;
+
+  if (key->prepared && key->spec->encrypt_prepared)
+    return key->spec->encrypt_prepared (r_ciph, s_data, key->prepared);
+  else if (key->spec->encrypt)
+    return key->spec->encrypt (r_ciph, s_data, key->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_decrypt but using the key handle KEY.  */
+gcry_err_code_t
+_gcry_pk_decrypt_key (gcry_sexp_t *r_plain, gcry_sexp_t s_data,
+                      gcry_pk_key_t key)
+{
+  *r_plain = NULL;
+
+  if (!key->secret)
+    return GPG_ERR_INV_OBJ;
+  if (key->prepared && key->spec->decrypt_prepared)
+    return key->spec->decrypt_prepared (r_plain, s_data, key->prepared);
+  else if (key->spec->decrypt)
+    return key->spec->decrypt (r_plain, s_data, key->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_sign but using the key handle KEY.  */
+gcry_err_code_t
+_gcry_pk_sign_key (gcry_sexp_t *r_sig, gcry_sexp_t s_hash, gcry_pk_key_t key)
+{
+  *r_sig = NULL;
+
+  if (!key->secret)
+    return GPG_ERR_INV_OBJ;
+  if (key->prepared && key->spec->sign_prepared)
+    return key->spec->sign_prepared (r_sig, s_hash, key->prepared);
+  else if (key->spec->sign)
+    return key->spec->sign (r_sig, s_hash, key->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_verify but using the key handle KEY.  */
+gcry_err_code_t
+_gcry_pk_verify_key (gcry_sexp_t s_sig, gcry_sexp_t s_hash, gcry_pk_key_t key)
+{
+  if (key->prepared && key->spec->verify_prepared)
+    return key->spec->verify_prepared (s_sig, s_hash, key->prepared);
+  else if (key->spec->verify)
+    return key->spec->verify (s_sig, s_hash, key->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
 /*
    Test a key.
 
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include "g10lib.h"
 #include "mpi.h"
@@ -61,6 +62,35 @@ static const char *rsa_names[] =
     NULL,
   };
 
+/* Private key operations using the CRT with a modulus of at least
+   this many bits compute the two halves concurrently.  0 disables
+   this.  */
+static unsigned int crt_threads_nbits;
+
+/* Cache of blinding pairs for the private key operations.  The pair
+   for a key is taken out of the cache while it is in use; concurrent
+   operations with the same key thus simply create another pair.  The
+   list is kept in most recently used order.  */
+struct blinding_item
+{
+  struct blinding_item *next;
+  gcry_mpi_t n;         /* The modulus and ...  */
+  gcry_mpi_t e;         /* ... the public exponent of the key.  */
+  gcry_mpi_t a;         /* r^e mod n.  */
+  gcry_mpi_t ai;        /* r^(-1) mod n.  */
+  unsigned int uses;    /* Number of uses of the pair.  */
+  pid_t pid;            /* The process which created the pair.  */
+};
+static struct blinding_item *blinding_cache;
+GPGRT_LOCK_DEFINE (blinding_cache_lock);
+
+/* The number of keys in the cache.  */
+#define BLINDING_CACHE_SIZE 4
+
+/* The number of operations after which a fresh blinding pair is
+   created.  */
+#define BLINDING_MAX_USES 32
+
 
 /* A sample 2048 bit RSA key used for the selftests.  */
 static const char sample_secret_key[] =
@@ -356,6 +386,136 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
 }
 
 
+/* The number of candidates per thread which fips_find_prime tests at
+   once.  */
+#define FIPS_CANDIDATES_PER_THREAD 4
+
+/* A batch of candidates for fips_find_prime.  */
+struct fips_candidates
+{
+  gcry_mpi_t *cand;
+  unsigned int ncand;
+  unsigned int pbits;
+  gcry_mpi_t e;
+  unsigned int nparts;
+  gpgrt_lock_t lock;        /* Protects FOUND.  */
+  unsigned int found;       /* Index of the first prime or NCAND.  */
+};
+
+
+/* Test part PART of the candidates ARG.  */
+static void
+fips_check_part (void *arg, unsigned int part)
+{
+  struct fips_candidates *fc = arg;
+  gcry_mpi_t p1, g;
+  unsigned int i;
+  int done;
+
+  p1 = mpi_snew (fc->pbits);
+  g  = mpi_snew (fc->pbits);
+  for (i = part; i < fc->ncand; i += fc->nparts)
+    {
+      /* Stop if another part has found a prime at a lower index.  */
+      gpgrt_lock_lock (&fc->lock);
+      done = i > fc->found;
+      gpgrt_lock_unlock (&fc->lock);
+      if (done)
+        break;
+
+      mpi_sub_ui (p1, fc->cand[i], 1);
+      if (mpi_gcd (g, p1, fc->e)
+          && (_gcry_fips186_4_prime_check (fc->cand[i], fc->pbits)
+              == GPG_ERR_NO_ERROR))
+        {
+          gpgrt_lock_lock (&fc->lock);
+          if (i < fc->found)
+            fc->found = i;
+          gpgrt_lock_unlock (&fc->lock);
+          break;
+        }
+    }
+  _gcry_mpi_release (p1);
+  _gcry_mpi_release (g);
+}
+
+
+/* Helper for generate_fips to search for a prime with several
+   threads.  Draw up to LIMIT random candidates of PBITS bits which are
+   not less than MINP and, if OTHER is not NULL, differ from OTHER by
+   at least MINDIFF.  Store the first of them which is a prime P with
+   gcd(P-1, E) = 1 at R_PRIME.  The candidates are drawn in batches in
+   the same way as by the single threaded code and the candidates of a
+   batch are tested concurrently.  Thus the result does not depend on
+   the timing of the threads.  */
+static gpg_err_code_t
+fips_find_prime (gcry_mpi_t r_prime, unsigned int pbits,
+                 gcry_random_level_t random_level, gcry_mpi_t e,
+                 gcry_mpi_t minp, gcry_mpi_t other, gcry_mpi_t mindiff,
+                 unsigned int limit)
+{
+  gpg_err_code_t ec = GPG_ERR_NO_PRIME;
+  struct fips_candidates fc;
+  gcry_mpi_t diff;
+  unsigned int i, nbatch, tested;
+
+  memset (&fc, 0, sizeof fc);
+  fc.nparts = _gcry_primegen_get_threads ();
+  nbatch = fc.nparts * FIPS_CANDIDATES_PER_THREAD;
+  fc.cand = xtrycalloc (nbatch, sizeof *fc.cand);
+  if (!fc.cand)
+    return gpg_err_code_from_syserror ();
+  for (i = 0; i < nbatch; i++)
+    fc.cand[i] = mpi_snew (pbits);
+  fc.pbits = pbits;
+  fc.e = e;
+  gpgrt_lock_init (&fc.lock);
+  diff = mpi_new (pbits);
+
+  for (tested = 0; tested < limit; tested += fc.ncand)
+    {
+      for (fc.ncand = 0; fc.ncand < nbatch && tested + fc.ncand < limit;
+           fc.ncand++)
+        {
+          gcry_mpi_t x = fc.cand[fc.ncand];
+
+          for (;;)
+            {
+              _gcry_mpi_randomize (x, pbits, random_level);
+              if (mpi_cmp (x, minp) < 0)
+                continue;
+              if (other)
+                {
+                  if (mpi_cmp (x, other) > 0)
+                    mpi_sub (diff, x, other);
+                  else
+                    mpi_sub (diff, other, x);
+                  if (mpi_cmp (diff, mindiff) < 0)
+                    continue;
+                }
+              break;
+            }
+        }
+
+      fc.found = fc.ncand;
+      _gcry_primegen_run_parts (fc.nparts, fips_check_part, &fc);
+      if (fc.found < fc.ncand)
+        {
+          mpi_set (r_prime, fc.cand[fc.found]);
+          ec = 0;
+          break;
+        }
+    }
+
+  _gcry_mpi_release (diff);
+  gpgrt_lock_destroy (&fc.lock);
+  for (i = 0; i < nbatch; i++)
+    _gcry_mpi_release (fc.cand[i]);
+  xfree (fc.cand);
+  return ec;
+}
+
+
 /****************
  * Generate a key pair with a key of size NBITS.
  * USE_E = 0 let Libcgrypt decide what exponent to use.
@@ -468,6 +628,22 @@ generate_fips (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
   g  = mpi_snew (pbits);
 
  retry:
+  if (!testparms && _gcry_primegen_get_threads () > 1)
+    {
+      /* Test the candidates for p and q concurrently.  */
+      ec = fips_find_prime (p, pbits, random_level, e, minp,
+                            NULL, NULL, 5 * pbits);
+      if (!ec)
+        ec = fips_find_prime (q, pbits, random_level, e, minp,
+                              p, mindiff, 5 * pbits);
+      if (ec)
+        goto err;
+      pqswitch = mpi_cmp (p, q) > 0;
+      mpi_sub_ui (p1, p, 1);
+      mpi_sub_ui (q1, q, 1);
+      goto pq_done;
+    }
+
   /* generate p and q */
   for (i = 0; i < 5 * pbits; i++)
     {
@@ -549,6 +725,7 @@ generate_fips (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
   if (i >= 5 * pbits)
     goto err;
 
+ pq_done:
   if (testparms)
     {
       mpi_clear (p);
@@ -1004,52 +1181,86 @@ secret_core_std (gcry_mpi_t M, gcry_mpi_t C,
 }
 
 
+/* Argument of crt_half_job.  */
+struct crt_half
+{
+  gcry_mpi_t m;
+  gcry_mpi_t c;
+  gcry_mpi_t d;
+  gcry_mpi_t p;
+};
+
+static void
+crt_half_job (void *arg)
+{
+  struct crt_half *half = arg;
+
+  mpi_powm (half->m, half->c, half->d, half->p);
+}
+
+
 /* Secret key operation - using the CRT.
  *
  *      m1 = c ^ (d mod (p-1)) mod p
  *      m2 = c ^ (d mod (q-1)) mod q
  *      h = u * (m2 - m1) mod q
  *      m = m1 + h * p
+ *
+ * If CONCURRENT is set, m1 is computed on a worker thread while the
+ * calling thread computes m2.
  */
 static void
 secret_core_crt (gcry_mpi_t M, gcry_mpi_t C,
                  gcry_mpi_t D, unsigned int Nlimbs,
-                 gcry_mpi_t P, gcry_mpi_t Q, gcry_mpi_t U)
+                 gcry_mpi_t P, gcry_mpi_t Q, gcry_mpi_t U, int concurrent)
 {
   gcry_mpi_t m1 = mpi_alloc_secure ( Nlimbs + 1 );
   gcry_mpi_t m2 = mpi_alloc_secure ( Nlimbs + 1 );
   gcry_mpi_t h  = mpi_alloc_secure ( Nlimbs + 1 );
-  gcry_mpi_t D_blind = mpi_alloc_secure ( Nlimbs + 1 );
+  gcry_mpi_t D_blind1 = mpi_alloc_secure ( Nlimbs + 1 );
+  gcry_mpi_t D_blind2 = mpi_alloc_secure ( Nlimbs + 1 );
   gcry_mpi_t r;
   unsigned int r_nbits;
+  struct crt_half half;
+  void *job = NULL;
 
   r_nbits = mpi_get_nbits (P) / 4;
   if (r_nbits < 96)
     r_nbits = 96;
   r = mpi_secure_new (r_nbits);
 
-  /* d_blind = (d mod (p-1)) + (p-1) * r            */
-  /* m1 = c ^ d_blind mod p */
+  /* d_blind1 = (d mod (p-1)) + (p-1) * r            */
   _gcry_mpi_randomize (r, r_nbits, GCRY_WEAK_RANDOM);
   mpi_set_highbit (r, r_nbits - 1);
   mpi_sub_ui ( h, P, 1 );
-  mpi_mul ( D_blind, h, r );
+  mpi_mul ( D_blind1, h, r );
   mpi_fdiv_r ( h, D, h );
-  mpi_add ( D_blind, D_blind, h );
-  mpi_powm ( m1, C, D_blind, P );
+  mpi_add ( D_blind1, D_blind1, h );
 
-  /* d_blind = (d mod (q-1)) + (q-1) * r            */
-  /* m2 = c ^ d_blind mod q */
+  /* d_blind2 = (d mod (q-1)) + (q-1) * r            */
   _gcry_mpi_randomize (r, r_nbits, GCRY_WEAK_RANDOM);
   mpi_set_highbit (r, r_nbits - 1);
   mpi_sub_ui ( h, Q, 1  );
-  mpi_mul ( D_blind, h, r );
+  mpi_mul ( D_blind2, h, r );
   mpi_fdiv_r ( h, D, h );
-  mpi_add ( D_blind, D_blind, h );
-  mpi_powm ( m2, C, D_blind, Q );
+  mpi_add ( D_blind2, D_blind2, h );
 
   mpi_free ( r );
-  mpi_free ( D_blind );
+
+  /* m1 = c ^ d_blind1 mod p */
+  half.m = m1;
+  half.c = C;
+  half.d = D_blind1;
+  half.p = P;
+  if (!concurrent || _gcry_worker_start (&job, crt_half_job, &half))
+    crt_half_job (&half);
+
+  /* m2 = c ^ d_blind2 mod q */
+  mpi_powm ( m2, C, D_blind2, Q );
+
+  _gcry_worker_wait (job);
+  mpi_free ( D_blind1 );
+  mpi_free ( D_blind2 );
 
   /* h = u * ( m2 - m1 ) mod q */
   mpi_sub ( h, m2, m1 );
@@ -1084,55 +1295,169 @@ secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
   else
     {
       secret_core_crt (output, input, skey->d, mpi_get_nlimbs (skey->n),
-                       skey->p, skey->q, skey->u);
+                       skey->p, skey->q, skey->u,
+                       (crt_threads_nbits
+                        && mpi_get_nbits (skey->n) >= crt_threads_nbits));
     }
 }
 
 
 static void
-secret_blinded (gcry_mpi_t output, gcry_mpi_t input,
-                RSA_secret_key *sk, unsigned int nbits)
+blinding_cache_lock_lock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_lock (&blinding_cache_lock);
+  if (err)
+    log_fatal ("failed to acquire the blinding cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+static void
+blinding_cache_lock_unlock (void)
+{
+  gpg_err_code_t err;
+
+  err = gpgrt_lock_unlock (&blinding_cache_lock);
+  if (err)
+    log_fatal ("failed to release the blinding cache lock: %s\n",
+               gpg_strerror (err));
+}
+
+
+static void
+blinding_item_free (struct blinding_item *item)
 {
-  gcry_mpi_t r;	           /* Random number needed for blinding.  */
-  gcry_mpi_t ri;	   /* Modular multiplicative inverse of r.  */
-  gcry_mpi_t bldata;       /* Blinded data to decrypt.  */
+  _gcry_mpi_release (item->n);
+  _gcry_mpi_release (item->e);
+  _gcry_mpi_release (item->a);
+  _gcry_mpi_release (item->ai);
+  xfree (item);
+}
+
+
+/* Return a blinding pair for the key SK.  A cached pair is updated
+   by squaring both values; a new pair is created after
+   BLINDING_MAX_USES operations, after a fork and if there is none.
+   The pair must be returned with blinding_put.  */
+static struct blinding_item *
+blinding_get (RSA_secret_key *sk, unsigned int nbits)
+{
+  struct blinding_item **pp, *item;
+  gcry_mpi_t r;
+
+  blinding_cache_lock_lock ();
+  for (pp = &blinding_cache; (item = *pp); pp = &item->next)
+    if (!mpi_cmp (item->n, sk->n) && !mpi_cmp (item->e, sk->e))
+      {
+        *pp = item->next;
+        break;
+      }
+  blinding_cache_lock_unlock ();
+
+  if (item && item->uses < BLINDING_MAX_USES && item->pid == getpid ())
+    {
+      /* (r^2)^e = (r^e)^2 and (r^2)^(-1) = (r^(-1))^2.  */
+      mpi_mulm (item->a, item->a, item->a, sk->n);
+      mpi_mulm (item->ai, item->ai, item->ai, sk->n);
+      item->uses++;
+      return item;
+    }
+
+  if (!item)
+    {
+      item = xcalloc (1, sizeof *item);
+      item->n = mpi_copy (sk->n);
+      item->e = mpi_copy (sk->e);
+      item->a = mpi_snew (nbits);
+      item->ai = mpi_snew (nbits);
+    }
 
   /* First, we need a random number r between 0 and n - 1, which is
    * relatively prime to n (i.e. it is neither p nor q).  The random
    * number needs to be only unpredictable, thus we employ the
    * gcry_create_nonce function by using GCRY_WEAK_RANDOM with
    * gcry_mpi_randomize.  */
-  r  = mpi_snew (nbits);
-  ri = mpi_snew (nbits);
-  bldata = mpi_snew (nbits);
-
+  r = mpi_snew (nbits);
   do
     {
       _gcry_mpi_randomize (r, nbits, GCRY_WEAK_RANDOM);
       mpi_mod (r, r, sk->n);
     }
-  while (!mpi_invm (ri, r, sk->n));
+  while (!mpi_invm (item->ai, r, sk->n));
+  mpi_powm (item->a, r, sk->e, sk->n);
+  _gcry_mpi_release (r);
+
+  item->uses = 1;
+  item->pid = getpid ();
+  return item;
+}
+
+
+/* Put the blinding pair ITEM back into the cache.  */
+static void
+blinding_put (struct blinding_item *item)
+{
+  struct blinding_item **pp, *tmp;
+  unsigned int n;
+
+  blinding_cache_lock_lock ();
+  item->next = blinding_cache;
+  blinding_cache = item;
+  for (n = 1, pp = &item->next; (tmp = *pp); )
+    if (n >= BLINDING_CACHE_SIZE
+        || (!mpi_cmp (tmp->n, item->n) && !mpi_cmp (tmp->e, item->e)))
+      {
+        *pp = tmp->next;
+        blinding_item_free (tmp);
+      }
+    else
+      {
+        pp = &tmp->next;
+        n++;
+      }
+  blinding_cache_lock_unlock ();
+}
+
+
+static void
+secret_blinded (gcry_mpi_t output, gcry_mpi_t input,
+                RSA_secret_key *sk, unsigned int nbits)
+{
+  struct blinding_item *bl;  /* Blinding pair (r^e, r^-1).  */
+  gcry_mpi_t bldata;         /* Blinded data to decrypt.  */
+
+  bl = blinding_get (sk, nbits);
+  bldata = mpi_snew (nbits);
 
   /* Do blinding.  We calculate: y = (x * r^e) mod n, where r is the
    * random number, e is the public exponent, x is the non-blinded
    * input data and n is the RSA modulus.  */
-  mpi_powm (bldata, r, sk->e, sk->n);
-  mpi_mulm (bldata, bldata, input, sk->n);
+  mpi_mulm (bldata, bl->a, input, sk->n);
 
   /* Perform decryption.  */
   secret (output, bldata, sk);
   _gcry_mpi_release (bldata);
 
   /* Undo blinding.  Here we calculate: y = (x * r^-1) mod n, where x
-   * is the blinded decrypted data, ri is the modular multiplicative
+   * is the blinded decrypted data, r^-1 is the modular multiplicative
    * inverse of r and n is the RSA modulus.  */
-  mpi_mulm (output, output, ri, sk->n);
+  mpi_mulm (output, output, bl->ai, sk->n);
 
-  _gcry_mpi_release (r);
-  _gcry_mpi_release (ri);
+  blinding_put (bl);
 }
 
-
+
+/* Compute the two halves of private key operations with a modulus of
+   at least NBITS bits concurrently.  A value of 0 disables this.  */
+void
+_gcry_rsa_set_crt_threads (unsigned int nbits)
+{
+  crt_threads_nbits = nbits;
+}
+
+
 /*********************************************
  **************  interface  ******************
  *********************************************/
@@ -1274,17 +1599,17 @@ rsa_check_secret_key (gcry_sexp_t keyparms)
 }
 
 
+/* Encrypt S_DATA with the public key PK.  */
 static gcry_err_code_t
-rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_encrypt_key (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, RSA_public_key *pk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  RSA_public_key pk = {NULL, NULL};
   gcry_mpi_t ciph = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_ENCRYPT,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (pk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1298,19 +1623,15 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       goto leave;
     }
 
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("rsa_encrypt    n", pk.n);
-      log_mpidump ("rsa_encrypt    e", pk.e);
+      log_mpidump ("rsa_encrypt    n", pk->n);
+      log_mpidump ("rsa_encrypt    e", pk->e);
     }
 
   /* Do RSA computation and build result.  */
   ciph = mpi_new (0);
-  public (ciph, data, &pk);
+  public (ciph, data, pk);
   if (DBG_CIPHER)
     log_mpidump ("rsa_encrypt  res", ciph);
   if ((ctx.flags & PUBKEY_FLAG_FIXEDLEN))
@@ -1318,7 +1639,7 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       /* We need to make sure to return the correct length to avoid
          problems with missing leading zeroes.  */
       unsigned char *em;
-      size_t emlen = (mpi_get_nbits (pk.n)+7)/8;
+      size_t emlen = (mpi_get_nbits (pk->n)+7)/8;
 
       rc = _gcry_mpi_to_octet_string (&em, NULL, ciph, emlen);
       if (!rc)
@@ -1332,8 +1653,6 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
  leave:
   _gcry_mpi_release (ciph);
-  _gcry_mpi_release (pk.n);
-  _gcry_mpi_release (pk.e);
   _gcry_mpi_release (data);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
@@ -1343,20 +1662,34 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
 
 static gcry_err_code_t
-rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  RSA_public_key pk = {NULL, NULL};
+
+  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
+  if (!rc)
+    rc = rsa_encrypt_key (r_ciph, s_data, &pk);
+  _gcry_mpi_release (pk.n);
+  _gcry_mpi_release (pk.e);
+  return rc;
+}
 
+
+/* Decrypt S_DATA with the secret key SK.  */
+static gcry_err_code_t
+rsa_decrypt_key (gcry_sexp_t *r_plain, gcry_sexp_t s_data, RSA_secret_key *sk)
 {
   gpg_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_sexp_t l1 = NULL;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
   gcry_mpi_t plain = NULL;
   unsigned char *unpad = NULL;
   size_t unpadlen = 0;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_DECRYPT,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (sk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_preparse_encval (s_data, rsa_names, &l1, &ctx);
@@ -1373,22 +1706,16 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       goto leave;
     }
 
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
-                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_decrypt    n", sk.n);
-      log_printmpi ("rsa_decrypt    e", sk.e);
+      log_printmpi ("rsa_decrypt    n", sk->n);
+      log_printmpi ("rsa_decrypt    e", sk->e);
       if (!fips_mode ())
         {
-          log_printmpi ("rsa_decrypt    d", sk.d);
-          log_printmpi ("rsa_decrypt    p", sk.p);
-          log_printmpi ("rsa_decrypt    q", sk.q);
-          log_printmpi ("rsa_decrypt    u", sk.u);
+          log_printmpi ("rsa_decrypt    d", sk->d);
+          log_printmpi ("rsa_decrypt    p", sk->p);
+          log_printmpi ("rsa_decrypt    q", sk->q);
+          log_printmpi ("rsa_decrypt    u", sk->u);
         }
     }
 
@@ -1396,7 +1723,7 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
      the input and it has not been "padded" using multiples of N.
      This mitigates side-channel attacks (CVE-2013-4576).  */
   mpi_normalize (data);
-  mpi_fdiv_r (data, data, sk.n);
+  mpi_fdiv_r (data, data, sk->n);
 
   /* Allocate MPI for the plaintext.  */
   plain = mpi_snew (ctx.nbits);
@@ -1405,9 +1732,9 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
      be practically mounted over the network as shown by Brumley and
      Boney in 2003.  */
   if ((ctx.flags & PUBKEY_FLAG_NO_BLINDING))
-    secret (plain, data, &sk);
+    secret (plain, data, sk);
   else
-    secret_blinded (plain, data, &sk, ctx.nbits);
+    secret_blinded (plain, data, sk, ctx.nbits);
 
   if (DBG_CIPHER)
     log_printmpi ("rsa_decrypt  res", plain);
@@ -1445,34 +1772,49 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
  leave:
   xfree (unpad);
   _gcry_mpi_release (plain);
+  _gcry_mpi_release (data);
+  sexp_release (l1);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  if (DBG_CIPHER)
+    log_debug ("rsa_decrypt    => %s\n", gpg_strerror (rc));
+  return rc;
+}
+
+
+static gcry_err_code_t
+rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gpg_err_code_t rc;
+  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
+                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
+                           NULL);
+  if (!rc)
+    rc = rsa_decrypt_key (r_plain, s_data, &sk);
   _gcry_mpi_release (sk.n);
   _gcry_mpi_release (sk.e);
   _gcry_mpi_release (sk.d);
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
-  _gcry_mpi_release (data);
-  sexp_release (l1);
-  _gcry_pk_util_free_encoding_ctx (&ctx);
-  if (DBG_CIPHER)
-    log_debug ("rsa_decrypt    => %s\n", gpg_strerror (rc));
   return rc;
 }
 
 
+/* Sign S_DATA with the secret key SK.  */
 static gcry_err_code_t
-rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_sign_key (gcry_sexp_t *r_sig, gcry_sexp_t s_data, RSA_secret_key *sk)
 {
   gpg_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
   RSA_public_key pk;
   gcry_mpi_t sig = NULL;
   gcry_mpi_t result = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_SIGN,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (sk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1486,39 +1828,33 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       goto leave;
     }
 
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
-                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_sign      n", sk.n);
-      log_printmpi ("rsa_sign      e", sk.e);
+      log_printmpi ("rsa_sign      n", sk->n);
+      log_printmpi ("rsa_sign      e", sk->e);
       if (!fips_mode ())
         {
-          log_printmpi ("rsa_sign      d", sk.d);
-          log_printmpi ("rsa_sign      p", sk.p);
-          log_printmpi ("rsa_sign      q", sk.q);
-          log_printmpi ("rsa_sign      u", sk.u);
+          log_printmpi ("rsa_sign      d", sk->d);
+          log_printmpi ("rsa_sign      p", sk->p);
+          log_printmpi ("rsa_sign      q", sk->q);
+          log_printmpi ("rsa_sign      u", sk->u);
         }
     }
 
   /* Do RSA computation.  */
   sig = mpi_new (0);
   if ((ctx.flags & PUBKEY_FLAG_NO_BLINDING))
-    secret (sig, data, &sk);
+    secret (sig, data, sk);
   else
-    secret_blinded (sig, data, &sk, ctx.nbits);
+    secret_blinded (sig, data, sk, ctx.nbits);
   if (DBG_CIPHER)
     log_printmpi ("rsa_sign    res", sig);
 
   /* Check that the created signature is good.  This detects a failure
      of the CRT algorithm  (Lenstra's attack on RSA's use of the CRT).  */
   result = mpi_new (0);
-  pk.n = sk.n;
-  pk.e = sk.e;
+  pk.n = sk->n;
+  pk.e = sk->e;
   public (result, sig, &pk);
   if (mpi_cmp (result, data))
     {
@@ -1532,7 +1868,7 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       /* We need to make sure to return the correct length to avoid
          problems with missing leading zeroes.  */
       unsigned char *em;
-      size_t emlen = (mpi_get_nbits (sk.n)+7)/8;
+      size_t emlen = (mpi_get_nbits (sk->n)+7)/8;
 
       rc = _gcry_mpi_to_octet_string (&em, NULL, sig, emlen);
       if (!rc)
@@ -1548,33 +1884,48 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
  leave:
   _gcry_mpi_release (result);
   _gcry_mpi_release (sig);
+  _gcry_mpi_release (data);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  if (DBG_CIPHER)
+    log_debug ("rsa_sign      => %s\n", gpg_strerror (rc));
+  return rc;
+}
+
+
+static gcry_err_code_t
+rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gpg_err_code_t rc;
+  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
+                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
+                           NULL);
+  if (!rc)
+    rc = rsa_sign_key (r_sig, s_data, &sk);
   _gcry_mpi_release (sk.n);
   _gcry_mpi_release (sk.e);
   _gcry_mpi_release (sk.d);
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
-  _gcry_mpi_release (data);
-  _gcry_pk_util_free_encoding_ctx (&ctx);
-  if (DBG_CIPHER)
-    log_debug ("rsa_sign      => %s\n", gpg_strerror (rc));
   return rc;
 }
 
 
+/* Verify the signature S_SIG on S_DATA with the public key PK.  */
 static gcry_err_code_t
-rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_verify_key (gcry_sexp_t s_sig, gcry_sexp_t s_data, RSA_public_key *pk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_sexp_t l1 = NULL;
   gcry_mpi_t sig = NULL;
   gcry_mpi_t data = NULL;
-  RSA_public_key pk = { NULL, NULL };
   gcry_mpi_t result = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (pk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1598,19 +1949,15 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   if (DBG_CIPHER)
     log_printmpi ("rsa_verify  sig", sig);
 
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_verify    n", pk.n);
-      log_printmpi ("rsa_verify    e", pk.e);
+      log_printmpi ("rsa_verify    n", pk->n);
+      log_printmpi ("rsa_verify    e", pk->e);
     }
 
   /* Do RSA computation and compare.  */
   result = mpi_new (0);
-  public (result, sig, &pk);
+  public (result, sig, pk);
   if (DBG_CIPHER)
     log_printmpi ("rsa_verify  cmp", result);
   if (ctx.verify_cmp)
@@ -1620,8 +1967,6 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
  leave:
   _gcry_mpi_release (result);
-  _gcry_mpi_release (pk.n);
-  _gcry_mpi_release (pk.e);
   _gcry_mpi_release (data);
   _gcry_mpi_release (sig);
   sexp_release (l1);
@@ -1632,6 +1977,112 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 }
 
 
+static gcry_err_code_t
+rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  RSA_public_key pk = { NULL, NULL };
+
+  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
+  if (!rc)
+    rc = rsa_verify_key (s_sig, s_data, &pk);
+  _gcry_mpi_release (pk.n);
+  _gcry_mpi_release (pk.e);
+  return rc;
+}
+
+
+/* Parse the key KEYPARMS for use with the *_prepared functions.  The
+   secret parameters are optional so that a public key can be used as
+   well.  */
+static gcry_err_code_t
+rsa_prepare (void **r_key, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  RSA_secret_key *sk;
+
+  *r_key = NULL;
+  sk = xtrycalloc (1, sizeof *sk);
+  if (!sk)
+    return gpg_err_code_from_syserror ();
+
+  rc = sexp_extract_param (keyparms, NULL, "ned?p?q?u?",
+                           &sk->n, &sk->e, &sk->d, &sk->p, &sk->q, &sk->u,
+                           NULL);
+  if (rc)
+    {
+      xfree (sk);
+      return rc;
+    }
+
+  *r_key = sk;
+  return 0;
+}
+
+
+static void
+rsa_release_prepared (void *key)
+{
+  RSA_secret_key *sk = key;
+
+  if (!sk)
+    return;
+  _gcry_mpi_release (sk->n);
+  _gcry_mpi_release (sk->e);
+  _gcry_mpi_release (sk->d);
+  _gcry_mpi_release (sk->p);
+  _gcry_mpi_release (sk->q);
+  _gcry_mpi_release (sk->u);
+  xfree (sk);
+}
+
+
+static gcry_err_code_t
+rsa_encrypt_prepared (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, void *key)
+{
+  RSA_secret_key *sk = key;
+  RSA_public_key pk;
+
+  pk.n = sk->n;
+  pk.e = sk->e;
+  return rsa_encrypt_key (r_ciph, s_data, &pk);
+}
+
+
+static gcry_err_code_t
+rsa_decrypt_prepared (gcry_sexp_t *r_plain, gcry_sexp_t s_data, void *key)
+{
+  RSA_secret_key *sk = key;
+
+  if (!sk->d)
+    return GPG_ERR_NO_OBJ;
+  return rsa_decrypt_key (r_plain, s_data, sk);
+}
+
+
+static gcry_err_code_t
+rsa_sign_prepared (gcry_sexp_t *r_sig, gcry_sexp_t s_data, void *key)
+{
+  RSA_secret_key *sk = key;
+
+  if (!sk->d)
+    return GPG_ERR_NO_OBJ;
+  return rsa_sign_key (r_sig, s_data, sk);
+}
+
+
+static gcry_err_code_t
+rsa_verify_prepared (gcry_sexp_t s_sig, gcry_sexp_t s_data, void *key)
+{
+  RSA_secret_key *sk = key;
+  RSA_public_key pk;
+
+  pk.n = sk->n;
+  pk.e = sk->e;
+  return rsa_verify_key (s_sig, s_data, &pk);
+}
+
+
 
 /* Return the number of bits for the key described by PARMS.  On error
  * 0 is returned.  The format of PARMS starts with the algorithm name;
@@ -2031,5 +2482,12 @@ gcry_pk_spec_t _gcry_pubkey_spec_rsa =
     rsa_verify,
     rsa_get_nbits,
     run_selftests,
-    compute_keygrip
+    compute_keygrip,
+    NULL, NULL, NULL,
+    rsa_prepare,
+    rsa_release_prepared,
+    rsa_encrypt_prepared,
+    rsa_decrypt_prepared,
+    rsa_sign_prepared,
+    rsa_verify_prepared
   };
@@ -49,6 +49,22 @@
 #include "kdf-internal.h"
 #include "bufhelp.h"
 
+/* USE_AMD64_SSE2 indicates whether to compile with AMD64 SSE2 code. */
+#undef USE_AMD64_SSE2
+#if defined(__x86_64__) && (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+    defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_AMD64_SSE2 1
+#endif
+
+/* AMD64 assembly implementations use SystemV ABI, ABI conversion and
+ * additional stack to store XMM6-XMM15 needed on Win64. */
+#undef ASM_FUNC_ABI
+#if defined(USE_AMD64_SSE2) && defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS)
+# define ASM_FUNC_ABI __attribute__((sysv_abi))
+#else
+# define ASM_FUNC_ABI
+#endif
+
 /* We really need a 64 bit type for this code.  */
 #define SALSA20_INPUT_LENGTH 16
 
@@ -234,39 +250,160 @@ scrypt_ro_mix (u32 r, unsigned char *B, u64 N,
 }
 
 
-/*
- *
- */
-gcry_err_code_t
-_gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
-                  int algo, int subalgo,
-                  const unsigned char *salt, size_t saltlen,
-                  unsigned long iterations,
-                  size_t dkLen, unsigned char *DK)
+#ifdef USE_AMD64_SSE2
+/* Whether new contexts use the SSE2 BlockMix; cleared only by tests.  */
+static int scrypt_use_sse2 = 1;
+
+/* Compute OUT = BlockMix (IN ^ IN_XOR) with 2 * R blocks in the
+   diagonal word order; IN_XOR may be NULL.  */
+unsigned int _gcry_scrypt_block_mix_amd64_sse2 (void *out, const void *in,
+                                                const void *in_xor,
+                                                unsigned int r) ASM_FUNC_ABI;
+
+/* ROMix using the SSE2 BlockMix.  The blocks are converted to the
+   diagonal word order on entry and back on return; V needs N * 128 * R
+   bytes and TMP 2 * 128 * R bytes.  */
+static void
+scrypt_ro_mix_sse2 (u32 r, unsigned char *B, u64 N,
+                    unsigned char *V, unsigned char *tmp)
+{
+  size_t r128 = (size_t)r * 128;
+  unsigned char *X = tmp;
+  unsigned char *Y = tmp + r128;
+  unsigned char *t;
+  unsigned int k, w;
+  u64 i, j;
+
+  /* V[0] = X, in diagonal order.  */
+  for (k = 0; k < 2 * r; k++)
+    for (w = 0; w < 16; w++)
+      memcpy (&V[(k * 16 + w) * 4], &B[(k * 16 + (w * 5 % 16)) * 4], 4);
+
+  /* V[i + 1] = BlockMix (V[i]) */
+  for (i = 0; i + 1 < N; i++)
+    _gcry_scrypt_block_mix_amd64_sse2 (&V[(i + 1) * r128], &V[i * r128],
+                                       NULL, r);
+  _gcry_scrypt_block_mix_amd64_sse2 (X, &V[(N - 1) * r128], NULL, r);
+
+  for (i = 0; i < N; i++)
+    {
+      /* j = Integerify (X) mod N; input words 0 and 1 of the last
+         block are at positions 0 and 13.  */
+      j = buf_get_le32 (&X[r128 - 64]);
+      j |= (u64)buf_get_le32 (&X[r128 - 64 + 13 * 4]) << 32;
+      j %= N;
+
+      /* X = BlockMix (X ^ V[j]) */
+      _gcry_scrypt_block_mix_amd64_sse2 (Y, X, &V[j * r128], r);
+      t = X;
+      X = Y;
+      Y = t;
+    }
+
+  for (k = 0; k < 2 * r; k++)
+    for (w = 0; w < 16; w++)
+      memcpy (&B[(k * 16 + (w * 5 % 16)) * 4], &X[(k * 16 + w) * 4], 4);
+}
+#endif /*USE_AMD64_SSE2*/
+
+
+/* Select the SSE2 BlockMix for scrypt contexts opened from now on if
+   ENABLE is set and it is available, or the generic C code otherwise.
+   Returns true if the SSE2 code is used.  */
+int
+_gcry_scrypt_set_use_sse2 (int enable)
+{
+#ifdef USE_AMD64_SSE2
+  scrypt_use_sse2 = !!enable;
+  return scrypt_use_sse2;
+#else
+  (void)enable;
+  return 0;
+#endif
+}
+
+
+typedef struct scrypt_context *scrypt_ctx_t;
+
+/* Job data for one of the P lanes.  */
+struct scrypt_thread_data
 {
-  u64 N = subalgo;    /* CPU/memory cost parameter.  */
+  scrypt_ctx_t s;
+  unsigned int lane;
+  unsigned char *V;
+  unsigned char *tmp;
+};
+
+struct scrypt_context
+{
+  int algo;           /* Must be the first field; see kdf.c.  */
+
+  u64 N;              /* CPU/memory cost parameter.  */
   u32 r;              /* Block size.  */
-  u32 p = iterations; /* Parallelization parameter.  */
+  u32 p;              /* Parallelization parameter.  */
+  size_t r128;
+
+  unsigned char *passwd;
+  size_t passwdlen;
+  unsigned char *B;   /* P lanes of 128 * R bytes.  */
+
+  unsigned int use_sse2:1;
+  unsigned int computed:1;
+};
+
+
+static void
+scrypt_compute_lane (void *priv)
+{
+  const struct scrypt_thread_data *t = priv;
+  const scrypt_ctx_t s = t->s;
+  unsigned char *B = &s->B[t->lane * s->r128];
+
+#ifdef USE_AMD64_SSE2
+  if (s->use_sse2)
+    {
+      scrypt_ro_mix_sse2 (s->r, B, s->N, t->V, t->tmp);
+      return;
+    }
+#endif
+  scrypt_ro_mix (s->r, B, s->N, t->V, t->tmp);
+}
+
 
+static void
+scrypt_close (scrypt_ctx_t s)
+{
+  if (s->B)
+    {
+      wipememory (s->B, s->p * s->r128);
+      xfree (s->B);
+    }
+  if (s->passwd)
+    {
+      wipememory (s->passwd, s->passwdlen);
+      xfree (s->passwd);
+    }
+  wipememory (s, sizeof (*s));
+  xfree (s);
+}
+
+
+static gpg_err_code_t
+scrypt_open (scrypt_ctx_t *r_s, u64 N, u32 r, u32 p,
+             const unsigned char *passwd, size_t passwdlen,
+             const unsigned char *salt, size_t saltlen)
+{
   gpg_err_code_t ec;
-  u32 i;
-  unsigned char *B = NULL;
-  unsigned char *tmp1 = NULL;
-  unsigned char *tmp2 = NULL;
+  scrypt_ctx_t s;
   size_t r128;
   size_t nbytes;
 
-  if (subalgo < 1 || !iterations)
-    return GPG_ERR_INV_VALUE;
+  *r_s = NULL;
 
-  if (algo == GCRY_KDF_SCRYPT)
-    r = 8;
-  else if (algo == 41) /* Hack to allow the use of all test vectors.  */
-    r = 1;
-  else
-    return GPG_ERR_UNKNOWN_ALGORITHM;
+  if (N < 1 || !r || !p)
+    return GPG_ERR_INV_VALUE;
 
-  r128 = r * 128;
+  r128 = (size_t)r * 128;
   if (r128 / 128 != r)
     return GPG_ERR_ENOMEM;
 
@@ -278,45 +415,217 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
   if (r128 && nbytes / r128 != N)
     return GPG_ERR_ENOMEM;
 
-  nbytes = 64 + r128;
+  nbytes = 2 * r128;
   if (nbytes < r128)
     return GPG_ERR_ENOMEM;
 
-  B = xtrymalloc (p * r128);
-  if (!B)
+  s = xtrycalloc (1, sizeof (*s));
+  if (!s)
+    return gpg_err_code_from_syserror ();
+
+  s->algo = GCRY_KDF_SCRYPT;
+  s->N = N;
+  s->r = r;
+  s->p = p;
+  s->r128 = r128;
+#ifdef USE_AMD64_SSE2
+  s->use_sse2 = scrypt_use_sse2;
+#endif
+
+  /* The password is needed again for the final PBKDF2 step.  */
+  s->passwd = xtrymalloc_secure (passwdlen ? passwdlen : 1);
+  if (!s->passwd)
     {
       ec = gpg_err_code_from_syserror ();
       goto leave;
     }
+  memcpy (s->passwd, passwd, passwdlen);
+  s->passwdlen = passwdlen;
 
-  tmp1 = xtrymalloc (N * r128);
-  if (!tmp1)
+  s->B = xtrymalloc (p * r128);
+  if (!s->B)
     {
       ec = gpg_err_code_from_syserror ();
       goto leave;
     }
 
-  tmp2 = xtrymalloc (64 + r128);
-  if (!tmp2)
+  ec = _gcry_kdf_pkdf2 (passwd, passwdlen, GCRY_MD_SHA256, salt, saltlen,
+                        1 /* iterations */, p * r128, s->B);
+  if (ec)
+    goto leave;
+
+  *r_s = s;
+  return 0;
+
+ leave:
+  scrypt_close (s);
+  return ec;
+}
+
+
+/* Run the P lanes of ROMix.  With thread callbacks OPS each lane is a
+   job of its own and needs its own N * 128 * R bytes of memory;
+   otherwise the lanes are run in turn and share one buffer.  */
+static gpg_err_code_t
+scrypt_compute (scrypt_ctx_t s, const struct gcry_kdf_thread_ops *ops)
+{
+  gpg_err_code_t ec = 0;
+  struct scrypt_thread_data *t;
+  unsigned int nbufs = ops ? s->p : 1;
+  unsigned int i;
+  size_t vlen = s->N * s->r128;
+
+  t = xtrycalloc (s->p, sizeof (*t));
+  if (!t)
+    return gpg_err_code_from_syserror ();
+
+  for (i = 0; i < nbufs; i++)
+    {
+      t[i].V = xtrymalloc (vlen);
+      t[i].tmp = xtrymalloc (2 * s->r128);
+      if (!t[i].V || !t[i].tmp)
+        {
+          ec = gpg_err_code_from_syserror ();
+          goto leave;
+        }
+    }
+
+  for (i = 0; i < s->p; i++)
     {
-      ec = gpg_err_code_from_syserror ();
+      t[i].s = s;
+      t[i].lane = i;
+      if (!ops)
+        {
+          t[i].V = t[0].V;
+          t[i].tmp = t[0].tmp;
+          scrypt_compute_lane (&t[i]);
+        }
+      else if (ops->dispatch_job (ops->jobs_context,
+                                  scrypt_compute_lane, &t[i]) < 0)
+        {
+          ops->wait_all_jobs (ops->jobs_context);
+          ec = GPG_ERR_CANCELED;
+          goto leave;
+        }
+    }
+
+  if (ops && ops->wait_all_jobs (ops->jobs_context) < 0)
+    {
+      ec = GPG_ERR_CANCELED;
       goto leave;
     }
 
-  ec = _gcry_kdf_pkdf2 (passwd, passwdlen, GCRY_MD_SHA256, salt, saltlen,
-                        1 /* iterations */, p * r128, B);
+  s->computed = 1;
+
+ leave:
+  for (i = 0; i < nbufs; i++)
+    {
+      if (t[i].V)
+        {
+          wipememory (t[i].V, vlen);
+          xfree (t[i].V);
+        }
+      if (t[i].tmp)
+        {
+          wipememory (t[i].tmp, 2 * s->r128);
+          xfree (t[i].tmp);
+        }
+    }
+  xfree (t);
+  return ec;
+}
 
-  for (i = 0; !ec && i < p; i++)
-    scrypt_ro_mix (r, &B[i * r128], N, tmp1, tmp2);
 
-  for (i = 0; !ec && i < p; i++)
-    ec = _gcry_kdf_pkdf2 (passwd, passwdlen, GCRY_MD_SHA256, B, p * r128,
-                          1 /* iterations */, dkLen, DK);
+static gpg_err_code_t
+scrypt_final (scrypt_ctx_t s, size_t dkLen, unsigned char *DK)
+{
+  if (!s->computed)
+    return GPG_ERR_INV_STATE;
 
- leave:
-  xfree (tmp2);
-  xfree (tmp1);
-  xfree (B);
+  return _gcry_kdf_pkdf2 (s->passwd, s->passwdlen, GCRY_MD_SHA256,
+                          s->B, s->p * s->r128, 1 /* iterations */,
+                          dkLen, DK);
+}
+
+
+/* Create a scrypt handle; PARAM holds N, r and p.  */
+gpg_err_code_t
+_gcry_kdf_scrypt_open (gcry_kdf_hd_t *hd, int subalgo,
+                       const unsigned long *param, unsigned int paramlen,
+                       const void *passwd, size_t passwdlen,
+                       const void *salt, size_t saltlen)
+{
+  gpg_err_code_t ec;
+  scrypt_ctx_t s;
+
+  if (subalgo || paramlen != 3)
+    return GPG_ERR_INV_VALUE;
+  if (param[1] > 0xffffffff || param[2] > 0xffffffff)
+    return GPG_ERR_INV_VALUE;
+
+  ec = scrypt_open (&s, param[0], param[1], param[2],
+                    passwd, passwdlen, salt, saltlen);
+  if (!ec)
+    *hd = (gcry_kdf_hd_t)(void *)s;
+  return ec;
+}
+
+
+gpg_err_code_t
+_gcry_kdf_scrypt_compute (gcry_kdf_hd_t hd,
+                          const struct gcry_kdf_thread_ops *ops)
+{
+  return scrypt_compute ((scrypt_ctx_t)(void *)hd, ops);
+}
+
+
+gpg_err_code_t
+_gcry_kdf_scrypt_final (gcry_kdf_hd_t hd, size_t resultlen, void *result)
+{
+  return scrypt_final ((scrypt_ctx_t)(void *)hd, resultlen, result);
+}
+
+
+void
+_gcry_kdf_scrypt_close (gcry_kdf_hd_t hd)
+{
+  scrypt_close ((scrypt_ctx_t)(void *)hd);
+}
+
+
+/*
+ *
+ */
+gcry_err_code_t
+_gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
+                  int algo, int subalgo,
+                  const unsigned char *salt, size_t saltlen,
+                  unsigned long iterations,
+                  size_t dkLen, unsigned char *DK)
+{
+  gpg_err_code_t ec;
+  scrypt_ctx_t s;
+  u32 r;              /* Block size.  */
+
+  if (subalgo < 1 || !iterations)
+    return GPG_ERR_INV_VALUE;
+
+  if (algo == GCRY_KDF_SCRYPT)
+    r = 8;
+  else if (algo == 41) /* Hack to allow the use of all test vectors.  */
+    r = 1;
+  else
+    return GPG_ERR_UNKNOWN_ALGORITHM;
+
+  ec = scrypt_open (&s, subalgo, r, iterations,
+                    passwd, passwdlen, salt, saltlen);
+  if (ec)
+    return ec;
+
+  ec = scrypt_compute (s, NULL);
+  if (!ec)
+    ec = scrypt_final (s, dkLen, DK);
 
+  scrypt_close (s);
   return ec;
 }
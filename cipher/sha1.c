@@ -40,6 +40,7 @@
 #include "bithelp.h"
 #include "bufhelp.h"
 #include "cipher.h"
+#include "kdf-internal.h"
 #include "sha1.h"
 
 
@@ -632,6 +633,46 @@ sha1_read( void *context )
 }
 
 
+/*
+ * Apply the SHA-1 transform function of the implementation selected
+ * for CONTEXT to the NBLKS blocks at DATA.  The chaining value to
+ * start from is taken from the 5 words at IN, or from CONTEXT if IN
+ * is NULL; the resulting chaining value is stored at OUT.  Both are
+ * in host byte order.  CONTEXT must have been initialized by
+ * sha1_init; its chaining value is overwritten.  Returns the number
+ * of bytes which should be burned on the stack.
+ * WARNING: This is a special purpose function for exclusive use by
+ * the PBKDF2 code in kdf.c.
+ */
+unsigned int
+_gcry_sha1_compress (void *context, const void *in, void *out,
+                     const void *data, size_t nblks)
+{
+  SHA1_CONTEXT *hd = context;
+  const u32 *src = in;
+  u32 *dst = out;
+  unsigned int nburn = 0;
+
+  if (src)
+    {
+      hd->h0 = src[0];
+      hd->h1 = src[1];
+      hd->h2 = src[2];
+      hd->h3 = src[3];
+      hd->h4 = src[4];
+    }
+  if (nblks)
+    nburn = (*hd->bctx.bwrite) (hd, data, nblks);
+  dst[0] = hd->h0;
+  dst[1] = hd->h1;
+  dst[2] = hd->h2;
+  dst[3] = hd->h3;
+  dst[4] = hd->h4;
+
+  return nburn;
+}
+
+
 /****************
  * Shortcut functions which puts the hash value of the supplied buffer iov
  * into outbuf which must have a size of 20 bytes.
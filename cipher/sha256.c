@@ -45,6 +45,7 @@
 #include "bufhelp.h"
 #include "cipher.h"
 #include "hash-common.h"
+#include "kdf-internal.h"
 
 
 /* USE_SSSE3 indicates whether to compile with Intel SSSE3 code. */
@@ -628,6 +629,48 @@ sha256_read (void *context)
 }
 
 
+/* Apply the SHA-256 transform function of the implementation selected
+ * for CONTEXT, which has been initialized by sha256_init or
+ * sha224_init, to the NBLKS blocks at DATA.  The chaining value to
+ * start from is taken from the 8 words at IN, or from CONTEXT if IN
+ * is NULL; the result is stored at OUT and in CONTEXT.  Both are in
+ * host byte order.  Returns the number of bytes which should be burned on the
+ * stack.  This is for exclusive use by the PBKDF2 code in kdf.c.  */
+unsigned int
+_gcry_sha256_compress (void *context, const void *in, void *out,
+                       const void *data, size_t nblks)
+{
+  SHA256_CONTEXT *hd = context;
+  const u32 *src = in;
+  u32 *dst = out;
+  unsigned int nburn = 0;
+
+  if (src)
+    {
+      hd->h0 = src[0];
+      hd->h1 = src[1];
+      hd->h2 = src[2];
+      hd->h3 = src[3];
+      hd->h4 = src[4];
+      hd->h5 = src[5];
+      hd->h6 = src[6];
+      hd->h7 = src[7];
+    }
+  if (nblks)
+    nburn = (*hd->bctx.bwrite) (hd, data, nblks);
+  dst[0] = hd->h0;
+  dst[1] = hd->h1;
+  dst[2] = hd->h2;
+  dst[3] = hd->h3;
+  dst[4] = hd->h4;
+  dst[5] = hd->h5;
+  dst[6] = hd->h6;
+  dst[7] = hd->h7;
+
+  return nburn;
+}
+
+
 /* Shortcut functions which puts the hash value of the supplied buffer iov
  * into outbuf which must have a size of 32 bytes.  */
 static void
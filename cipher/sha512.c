@@ -53,6 +53,7 @@
 #include "bufhelp.h"
 #include "cipher.h"
 #include "hash-common.h"
+#include "kdf-internal.h"
 
 
 /* USE_ARM_NEON_ASM indicates whether to enable ARM NEON assembly code. */
@@ -862,6 +863,30 @@ sha512_read (void *context)
 }
 
 
+/* Apply the SHA-512 transform function of the implementation selected
+ * for CONTEXT, which has been initialized by one of the init functions
+ * of this file, to the NBLKS blocks at DATA.  The chaining value to
+ * start from is taken from the 8 words at IN, or from CONTEXT if IN
+ * is NULL; the result is stored at OUT and in CONTEXT.  Both are in
+ * host byte order.  Returns the number of bytes which should be burned on the
+ * stack.  This is for exclusive use by the PBKDF2 code in kdf.c.  */
+unsigned int
+_gcry_sha512_compress (void *context, const void *in, void *out,
+                       const void *data, size_t nblks)
+{
+  SHA512_CONTEXT *hd = context;
+  unsigned int nburn = 0;
+
+  if (in)
+    memcpy (&hd->state, in, sizeof hd->state);
+  if (nblks)
+    nburn = (*hd->bctx.bwrite) (hd, data, nblks);
+  memcpy (out, &hd->state, sizeof hd->state);
+
+  return nburn;
+}
+
+
 /* Shortcut functions which puts the hash value of the supplied buffer iov
  * into outbuf which must have a size of 64 bytes.  */
 static void
@@ -29,6 +29,23 @@
 #include "hash-common.h"
 
 
+/* USE_AMD64_SSE41 indicates whether to compile with Intel SSE4.1 code. */
+#undef USE_AMD64_SSE41
+#if defined(__x86_64__) && defined(ENABLE_SSE41_SUPPORT) && \
+    (defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) || \
+     defined(HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS))
+# define USE_AMD64_SSE41 1
+#endif
+
+
+/* Helper macro to force alignment to 64 bytes.  */
+#ifdef HAVE_GCC_ATTRIBUTE_ALIGNED
+# define ATTR_ALIGNED_64  __attribute__ ((aligned (64)))
+#else
+# define ATTR_ALIGNED_64
+#endif
+
+
 typedef struct
 {
   gcry_md_block_ctx_t bctx;
@@ -39,12 +56,24 @@ typedef struct
   };
   u64 N[8];
   u64 Sigma[8];
+#ifdef USE_AMD64_SSE41
+  unsigned int use_sse41:1;
+#endif
 } STRIBOG_CONTEXT;
 
 
+/* The LPS look-up tables and the iteration constants are kept together
+   in one cache line aligned block; the assembly implementation takes a
+   pointer to this structure. */
+struct stribog_tables_s {
+  u64 T[8][256];
+  u64 C[12][8];
+};
+
+static const struct stribog_tables_s tab ATTR_ALIGNED_64 =
+{
 /* Pre-computed results of multiplication of bytes on A and reordered with
    Pi[]. */
-static const u64 stribog_table[8][256] =
 {
   /* 0 */
   { U64_C(0xd01f715b5c7ef8e6), U64_C(0x16fa240980778325),
@@ -1078,9 +1107,9 @@ static const u64 stribog_table[8][256] =
     U64_C(0xe1e2f06a284d674a), U64_C(0xd2be8c74c97cfd80),
     U64_C(0x9a494faf67707e71), U64_C(0xb3dbd1eca9908293),
     U64_C(0x72d14d3493b2e388), U64_C(0xd6a30f258c153427) },
-};
+},
 
-static const u64 C16[12][8] =
+/* Iteration constants. */
 {
   { U64_C(0xdd806559f2a64507), U64_C(0x05767436cc744d23),
     U64_C(0xa2422a08a460d315), U64_C(0x4b7ce09192676901),
@@ -1130,8 +1159,12 @@ static const u64 C16[12][8] =
     U64_C(0xe71da4aa88e12852), U64_C(0x5d80ef9d1891cc86),
     U64_C(0xf82012d430219f9b), U64_C(0xcda43c32bcdf1d77),
     U64_C(0xd21380b00449b17a), U64_C(0x378ee767f11631ba) },
+}
 };
 
+#define stribog_table tab.T
+#define C16 tab.C
+
 
 #define strido(out, temp, i) do { \
 	u64 t; \
@@ -1193,6 +1226,38 @@ static inline void g (u64 *h, u64 *m, u64 *N)
 }
 
 
+#ifdef USE_AMD64_SSE41
+
+#ifdef HAVE_COMPATIBLE_GCC_WIN64_PLATFORM_AS
+# define ASM_FUNC_ABI __attribute__((sysv_abi))
+# define ASM_EXTRA_STACK (10 * 16)
+#else
+# define ASM_FUNC_ABI
+# define ASM_EXTRA_STACK 0
+#endif
+
+extern unsigned int
+_gcry_stribog_g_amd64_sse41 (u64 *h, const u64 *m, const u64 *N,
+                             const struct stribog_tables_s *tables)
+                             ASM_FUNC_ABI;
+
+#endif /* USE_AMD64_SSE41 */
+
+
+/* Compression function g_N(h, m); returns the stack burn depth. */
+static unsigned int
+do_g (STRIBOG_CONTEXT *hd, u64 *m, u64 *N)
+{
+#ifdef USE_AMD64_SSE41
+  if (hd->use_sse41)
+    return _gcry_stribog_g_amd64_sse41 (hd->h, m, N, &tab) + ASM_EXTRA_STACK;
+#endif
+
+  g (hd->h, m, N);
+  return /* burn_stack */ 768;
+}
+
+
 static unsigned int
 transform (void *context, const unsigned char *inbuf_arg, size_t datalen);
 
@@ -1201,13 +1266,19 @@ static void
 stribog_init_512 (void *context, unsigned int flags)
 {
   STRIBOG_CONTEXT *hd = context;
+  unsigned int features = _gcry_get_hw_features ();
 
   (void)flags;
+  (void)features;
 
   memset (hd, 0, sizeof (*hd));
 
   hd->bctx.blocksize_shift = _gcry_ctz(64);
   hd->bctx.bwrite = transform;
+
+#ifdef USE_AMD64_SSE41
+  hd->use_sse41 = (features & HWF_INTEL_SSE4_1) != 0;
+#endif
 }
 
 static void
@@ -1219,17 +1290,18 @@ stribog_init_256 (void *context, unsigned int flags)
   memset (hd->h, 1, 64);
 }
 
-static void
+static unsigned int
 transform_bits (STRIBOG_CONTEXT *hd, const unsigned char *data, unsigned count)
 {
   u64 M[8];
   u64 l, cf;
+  unsigned int burn;
   int i;
 
   for (i = 0; i < 8; i++)
     M[i] = buf_get_le64(data + i * 8);
 
-  g (hd->h, M, hd->N);
+  burn = do_g (hd, M, hd->N);
   l = hd->N[0];
   hd->N[0] += count;
   if (hd->N[0] < l)
@@ -1250,6 +1322,8 @@ transform_bits (STRIBOG_CONTEXT *hd, const unsigned char *data, unsigned count)
 	cf = (hd->Sigma[i-1] < M[i-1]);
       hd->Sigma[i] += M[i] + cf;
     }
+
+  return burn;
 }
 
 static unsigned int
@@ -1257,9 +1331,7 @@ transform_blk (void *context, const unsigned char *inbuf_arg)
 {
   STRIBOG_CONTEXT *hd = context;
 
-  transform_bits (hd, inbuf_arg, 64 * 8);
-
-  return /* burn_stack */ 768;
+  return transform_bits (hd, inbuf_arg, 64 * 8);
 }
 
 static unsigned int
@@ -1287,6 +1359,7 @@ stribog_final (void *context)
 {
   STRIBOG_CONTEXT *hd = context;
   u64 Z[8] = {};
+  unsigned int burn;
   int i;
 
   /* PAD. It does not count towards message length */
@@ -1296,17 +1369,17 @@ stribog_final (void *context)
   if (i < 64)
     memset (&hd->bctx.buf[i], 0, 64 - i);
   i = 64;
-  transform_bits (hd, hd->bctx.buf, hd->bctx.count * 8);
+  burn = transform_bits (hd, hd->bctx.buf, hd->bctx.count * 8);
 
-  g (hd->h, hd->N, Z);
-  g (hd->h, hd->Sigma, Z);
+  do_g (hd, hd->N, Z);
+  do_g (hd, hd->Sigma, Z);
 
   for (i = 0; i < 8; i++)
     hd->h[i] = le_bswap64(hd->h[i]);
 
   hd->bctx.count = 0;
 
-  _gcry_burn_stack (768);
+  _gcry_burn_stack (burn);
 }
 
 static byte *
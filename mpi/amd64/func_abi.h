@@ -24,6 +24,17 @@
 #endif
 #endif
 
+#ifdef HAVE_GCC_INLINE_ASM_ADX
+ /* Jump to LABEL if the BMI2 and ADX instructions shall be used.  The
+  * flag is set by _gcry_mpi_init.  */
+# ifdef __ELF__
+	.hidden C_SYMBOL_NAME(_gcry_mpih_use_adx)
+# endif
+ #define ADX_DISPATCH(label) \
+	testl $1, C_SYMBOL_NAME(_gcry_mpih_use_adx)(%rip); \
+	jnz label;
+#endif
+
 #ifdef USE_MS_ABI
  /* Store registers and move four first input arguments from MS ABI to
   * SYSV ABI.  */
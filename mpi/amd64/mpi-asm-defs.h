@@ -2,3 +2,8 @@
  * need to define the types on a per-CPU basis, so it is done with
  * this file here.  */
 #define BYTES_PER_MPI_LIMB  (SIZEOF_UNSIGNED_LONG_LONG)
+
+/* The BMI2/ADX code provides _gcry_mpih_addmul_4.  */
+#ifdef HAVE_GCC_INLINE_ASM_ADX
+# define HAVE_MPIH_ADDMUL_4 1
+#endif
@@ -1,4 +1,4 @@
-/* ec-ed25519.c -  Ed25519 optimized elliptic curve functions
+/* ec-ed25519.c -  Curve25519 and Ed25519 optimized elliptic curve functions
  * Copyright (C) 2013 g10 Code GmbH
  *
  * This file is part of Libgcrypt.
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "mpi-internal.h"
@@ -27,6 +28,7 @@
 #include "g10lib.h"
 #include "context.h"
 #include "ec-context.h"
+#include "ec-internal.h"
 
 
 void
@@ -35,3 +37,1090 @@ _gcry_mpi_ec_ed25519_mod (gcry_mpi_t a)
   (void)a;
 
 }
+
+
+#ifdef USE_FE25519_51
+
+/* Elements of the field GF(2^255-19) are kept in five limbs of 51
+   bits, so that the products of two limbs and their sums fit into a
+   128 bit integer and the carries are only propagated once per
+   multiplication.  The limbs of the values passed between the
+   functions may exceed 51 bits by a few bits; only fe_tobytes returns
+   the canonical representation.  */
+typedef unsigned __int128 fe_u128;
+typedef u64 fe25519[5];
+
+#define FE_MASK51 ((U64_C(1) << 51) - 1)
+
+
+static u64
+fe_load64 (const unsigned char *s)
+{
+  return ((u64)s[0]       | ((u64)s[1] << 8)  | ((u64)s[2] << 16)
+          | ((u64)s[3] << 24) | ((u64)s[4] << 32) | ((u64)s[5] << 40)
+          | ((u64)s[6] << 48) | ((u64)s[7] << 56));
+}
+
+
+static void
+fe_store64 (unsigned char *s, u64 a)
+{
+  int i;
+
+  for (i = 0; i < 8; i++)
+    s[i] = a >> (8 * i);
+}
+
+
+/* Store A in little endian order into the 32 bytes at BUF.  Returns
+   false if A is negative or does not fit into 32 bytes.  */
+int
+_gcry_mpi_ec_get_le32 (unsigned char *buf, gcry_mpi_t a)
+{
+  mpi_size_t idx;
+  int i;
+
+  if (mpi_is_opaque (a) || a->sign || mpi_get_nbits (a) > 256)
+    return 0;
+  for (i = 0; i < 32; i++)
+    {
+      idx = i / BYTES_PER_MPI_LIMB;
+      buf[i] = idx < a->nlimbs? a->d[idx] >> (8 * (i % BYTES_PER_MPI_LIMB)) : 0;
+    }
+  return 1;
+}
+
+
+/* H = the 255 bit little endian value S; bit 255 is ignored.  */
+static void
+fe_frombytes (fe25519 h, const unsigned char *s)
+{
+  u64 w0 = fe_load64 (s);
+  u64 w1 = fe_load64 (s + 8);
+  u64 w2 = fe_load64 (s + 16);
+  u64 w3 = fe_load64 (s + 24);
+
+  h[0] = w0 & FE_MASK51;
+  h[1] = ((w0 >> 51) | (w1 << 13)) & FE_MASK51;
+  h[2] = ((w1 >> 38) | (w2 << 26)) & FE_MASK51;
+  h[3] = ((w2 >> 25) | (w3 << 39)) & FE_MASK51;
+  h[4] = (w3 >> 12) & FE_MASK51;
+}
+
+
+/* Propagate the carries of H so that all limbs are below 2^51 + 2^13
+   and limbs 1 to 4 below 2^51.  */
+static void
+fe_carry (fe25519 h)
+{
+  u64 c;
+
+  c = h[0] >> 51; h[0] &= FE_MASK51; h[1] += c;
+  c = h[1] >> 51; h[1] &= FE_MASK51; h[2] += c;
+  c = h[2] >> 51; h[2] &= FE_MASK51; h[3] += c;
+  c = h[3] >> 51; h[3] &= FE_MASK51; h[4] += c;
+  c = h[4] >> 51; h[4] &= FE_MASK51; h[0] += c * 19;
+}
+
+
+/* S = the canonical 32 byte little endian representation of H.  */
+static void
+fe_tobytes (unsigned char *s, const fe25519 h)
+{
+  fe25519 t;
+  u64 q;
+
+  memcpy (t, h, sizeof t);
+  fe_carry (t);
+  fe_carry (t);
+
+  /* T is now below 2p; Q is 1 iff T >= p.  */
+  q = (t[0] + 19) >> 51;
+  q = (t[1] + q) >> 51;
+  q = (t[2] + q) >> 51;
+  q = (t[3] + q) >> 51;
+  q = (t[4] + q) >> 51;
+
+  /* T = T + 19Q - 2^255Q.  */
+  t[0] += 19 * q;
+  t[1] += t[0] >> 51; t[0] &= FE_MASK51;
+  t[2] += t[1] >> 51; t[1] &= FE_MASK51;
+  t[3] += t[2] >> 51; t[2] &= FE_MASK51;
+  t[4] += t[3] >> 51; t[3] &= FE_MASK51;
+  t[4] &= FE_MASK51;
+
+  fe_store64 (s,      t[0]         | (t[1] << 51));
+  fe_store64 (s + 8,  (t[1] >> 13) | (t[2] << 38));
+  fe_store64 (s + 16, (t[2] >> 26) | (t[3] << 25));
+  fe_store64 (s + 24, (t[3] >> 39) | (t[4] << 12));
+  wipememory (t, sizeof t);
+}
+
+
+static void
+fe_copy (fe25519 h, const fe25519 f)
+{
+  memcpy (h, f, sizeof (fe25519));
+}
+
+
+static void
+fe_add (fe25519 h, const fe25519 f, const fe25519 g)
+{
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+}
+
+
+/* H = F - G.  Four times p is added to avoid negative limbs; this
+   requires limbs of G below 2^53.  */
+static void
+fe_sub (fe25519 h, const fe25519 f, const fe25519 g)
+{
+  h[0] = (f[0] + U64_C(0x1fffffffffffb4)) - g[0];
+  h[1] = (f[1] + U64_C(0x1ffffffffffffc)) - g[1];
+  h[2] = (f[2] + U64_C(0x1ffffffffffffc)) - g[2];
+  h[3] = (f[3] + U64_C(0x1ffffffffffffc)) - g[3];
+  h[4] = (f[4] + U64_C(0x1ffffffffffffc)) - g[4];
+  fe_carry (h);
+}
+
+
+/* Reduce the five 128 bit column sums T into H.  */
+static void
+fe_reduce128 (fe25519 h, fe_u128 t0, fe_u128 t1, fe_u128 t2,
+              fe_u128 t3, fe_u128 t4)
+{
+  t1 += t0 >> 51;
+  t2 += t1 >> 51;
+  t3 += t2 >> 51;
+  t4 += t3 >> 51;
+  t0 = ((u64)t0 & FE_MASK51) + (t4 >> 51) * 19;
+  h[0] = (u64)t0 & FE_MASK51;
+  h[1] = ((u64)t1 & FE_MASK51) + (u64)(t0 >> 51);
+  h[2] = (u64)t2 & FE_MASK51;
+  h[3] = (u64)t3 & FE_MASK51;
+  h[4] = (u64)t4 & FE_MASK51;
+}
+
+
+/* H = F * G.  The limbs of F and G must be below 2^54.  */
+static void
+fe_mul (fe25519 h, const fe25519 f, const fe25519 g)
+{
+  u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  u64 g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  u64 g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+  fe_u128 t0, t1, t2, t3, t4;
+
+  t0 = ((fe_u128)f0 * g0 + (fe_u128)f1 * g4_19 + (fe_u128)f2 * g3_19
+        + (fe_u128)f3 * g2_19 + (fe_u128)f4 * g1_19);
+  t1 = ((fe_u128)f0 * g1 + (fe_u128)f1 * g0 + (fe_u128)f2 * g4_19
+        + (fe_u128)f3 * g3_19 + (fe_u128)f4 * g2_19);
+  t2 = ((fe_u128)f0 * g2 + (fe_u128)f1 * g1 + (fe_u128)f2 * g0
+        + (fe_u128)f3 * g4_19 + (fe_u128)f4 * g3_19);
+  t3 = ((fe_u128)f0 * g3 + (fe_u128)f1 * g2 + (fe_u128)f2 * g1
+        + (fe_u128)f3 * g0 + (fe_u128)f4 * g4_19);
+  t4 = ((fe_u128)f0 * g4 + (fe_u128)f1 * g3 + (fe_u128)f2 * g2
+        + (fe_u128)f3 * g1 + (fe_u128)f4 * g0);
+
+  fe_reduce128 (h, t0, t1, t2, t3, t4);
+}
+
+
+/* H = F^2.  */
+static void
+fe_sq (fe25519 h, const fe25519 f)
+{
+  u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  u64 f0_2 = 2 * f0, f1_2 = 2 * f1;
+  u64 f3_19 = 19 * f3, f4_19 = 19 * f4;
+  fe_u128 t0, t1, t2, t3, t4;
+
+  t0 = ((fe_u128)f0 * f0 + (fe_u128)f1_2 * f4_19
+        + (fe_u128)(2 * f2) * f3_19);
+  t1 = ((fe_u128)f0_2 * f1 + (fe_u128)(2 * f2) * f4_19
+        + (fe_u128)f3 * f3_19);
+  t2 = ((fe_u128)f0_2 * f2 + (fe_u128)f1 * f1
+        + (fe_u128)(2 * f3) * f4_19);
+  t3 = ((fe_u128)f0_2 * f3 + (fe_u128)f1_2 * f2
+        + (fe_u128)f4 * f4_19);
+  t4 = ((fe_u128)f0_2 * f4 + (fe_u128)f1_2 * f3
+        + (fe_u128)f2 * f2);
+
+  fe_reduce128 (h, t0, t1, t2, t3, t4);
+}
+
+
+/* H = F^(2^N).  */
+static void
+fe_sqn (fe25519 h, const fe25519 f, int n)
+{
+  fe_sq (h, f);
+  while (--n > 0)
+    fe_sq (h, h);
+}
+
+
+/* H = F * N for a small N.  */
+static void
+fe_mul_small (fe25519 h, const fe25519 f, u64 n)
+{
+  fe_reduce128 (h, (fe_u128)f[0] * n, (fe_u128)f[1] * n,
+                (fe_u128)f[2] * n, (fe_u128)f[3] * n, (fe_u128)f[4] * n);
+}
+
+
+/* Swap F and G if SWAP is 1 without a branch.  */
+static void
+fe_cswap (fe25519 f, fe25519 g, u64 swap)
+{
+  u64 mask = 0 - swap;
+  u64 x;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    {
+      x = mask & (f[i] ^ g[i]);
+      f[i] ^= x;
+      g[i] ^= x;
+    }
+}
+
+
+/* Compute Z^(2^250-1) into R and Z^11 into Z11, the common part of
+   the inversion and the square root.  */
+static void
+fe_pow250 (fe25519 r, fe25519 z11, const fe25519 z)
+{
+  fe25519 t0, t1, t2;
+
+  fe_sq (t0, z);                /* z^2 */
+  fe_sqn (t1, t0, 2);           /* z^8 */
+  fe_mul (t1, t1, z);           /* z^9 */
+  fe_mul (z11, t0, t1);         /* z^11 */
+  fe_sq (t0, z11);              /* z^22 */
+  fe_mul (t1, t1, t0);          /* z^(2^5-1) */
+  fe_sqn (t0, t1, 5);
+  fe_mul (t1, t0, t1);          /* z^(2^10-1) */
+  fe_sqn (t0, t1, 10);
+  fe_mul (t0, t0, t1);          /* z^(2^20-1) */
+  fe_sqn (t2, t0, 20);
+  fe_mul (t0, t2, t0);          /* z^(2^40-1) */
+  fe_sqn (t0, t0, 10);
+  fe_mul (t1, t0, t1);          /* z^(2^50-1) */
+  fe_sqn (t0, t1, 50);
+  fe_mul (t0, t0, t1);          /* z^(2^100-1) */
+  fe_sqn (t2, t0, 100);
+  fe_mul (t0, t2, t0);          /* z^(2^200-1) */
+  fe_sqn (t0, t0, 50);
+  fe_mul (r, t0, t1);           /* z^(2^250-1) */
+
+  wipememory (t0, sizeof t0);
+  wipememory (t1, sizeof t1);
+  wipememory (t2, sizeof t2);
+}
+
+
+/* H = 1/Z computed as Z^(p-2); this gives 0 for Z = 0.  */
+static void
+fe_invert (fe25519 h, const fe25519 z)
+{
+  fe25519 t, z11;
+
+  fe_pow250 (t, z11, z);
+  fe_sqn (t, t, 5);
+  fe_mul (h, t, z11);           /* z^(2^255-21) */
+
+  wipememory (t, sizeof t);
+  wipememory (z11, sizeof z11);
+}
+
+
+/* Compute the X25519 function of RFC-7748 without clamping: RESULT =
+   the u-coordinate of SCALAR * U.  All three values are 32 byte
+   little endian strings; all 256 bits of SCALAR are used and bit 255
+   of U is ignored.  The Montgomery ladder is run with conditional
+   swaps, so that the time does not depend on SCALAR.  Returns true if
+   the result is the point at infinity, in which case RESULT is 0.  */
+int
+_gcry_mpi_ec_x25519 (unsigned char *result, const unsigned char *scalar,
+                     const unsigned char *u)
+{
+  fe25519 x1, x2, z2, x3, z3, a, b, aa, bb, e, da, cb;
+  unsigned char zbuf[32];
+  u64 swap = 0, bit;
+  unsigned int zero;
+  int i;
+
+  fe_frombytes (x1, u);
+  memset (x2, 0, sizeof x2);
+  x2[0] = 1;
+  memset (z2, 0, sizeof z2);
+  fe_copy (x3, x1);
+  memset (z3, 0, sizeof z3);
+  z3[0] = 1;
+
+  for (i = 255; i >= 0; i--)
+    {
+      bit = (scalar[i >> 3] >> (i & 7)) & 1;
+      swap ^= bit;
+      fe_cswap (x2, x3, swap);
+      fe_cswap (z2, z3, swap);
+      swap = bit;
+
+      fe_add (a, x2, z2);
+      fe_sub (b, x2, z2);
+      fe_sq (aa, a);
+      fe_sq (bb, b);
+      fe_sub (e, aa, bb);
+      fe_add (x2, x3, z3);
+      fe_sub (z2, x3, z3);
+      fe_mul (da, z2, a);
+      fe_mul (cb, x2, b);
+      fe_add (x3, da, cb);
+      fe_sq (x3, x3);
+      fe_sub (z3, da, cb);
+      fe_sq (z3, z3);
+      fe_mul (z3, z3, x1);
+      fe_mul (x2, aa, bb);
+      fe_mul_small (z2, e, 121665);
+      fe_add (z2, z2, aa);
+      fe_mul (z2, z2, e);
+    }
+  fe_cswap (x2, x3, swap);
+  fe_cswap (z2, z3, swap);
+
+  fe_tobytes (zbuf, z2);
+  zero = 0;
+  for (i = 0; i < 32; i++)
+    zero |= zbuf[i];
+
+  fe_invert (z2, z2);
+  fe_mul (x2, x2, z2);
+  fe_tobytes (result, x2);
+
+  wipememory (x2, sizeof x2);
+  wipememory (z2, sizeof z2);
+  wipememory (x3, sizeof x3);
+  wipememory (z3, sizeof z3);
+  wipememory (a, sizeof a);
+  wipememory (b, sizeof b);
+  wipememory (aa, sizeof aa);
+  wipememory (bb, sizeof bb);
+  wipememory (e, sizeof e);
+  wipememory (da, sizeof da);
+  wipememory (cb, sizeof cb);
+  wipememory (&swap, sizeof swap);
+  wipememory (&bit, sizeof bit);
+
+  return !zero;
+}
+
+
+/* Ed25519 points are kept in the extended coordinates (X:Y:Z:T) with
+   x = X/Z, y = Y/Z and xy = T/Z of Hisil, Wong, Carter and Dawson,
+   "Twisted Edwards Curves Revisited", 2008.  The addition formulas
+   are complete because a = -1 is a square and d is not.  Addends are
+   kept as (Y+X, Y-X, 2Z, 2dT) or for affine points as (y+x, y-x,
+   2dxy).  */
+typedef struct
+{
+  fe25519 X, Y, Z, T;
+} ge25519;
+
+typedef struct
+{
+  fe25519 ypx, ymx, z2, t2d;
+} ge25519_cached;
+
+typedef struct
+{
+  fe25519 ypx, ymx, t2d;
+} ge25519_affine;
+
+static const unsigned char ed25519_d_le[32] = {
+  0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75,
+  0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00,
+  0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c,
+  0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
+};
+
+/* A square root of -1.  */
+static const unsigned char ed25519_sqrtm1_le[32] = {
+  0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4,
+  0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+  0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b,
+  0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b
+};
+
+static const unsigned char ed25519_gx_le[32] = {
+  0x1a, 0xd5, 0x25, 0x8f, 0x60, 0x2d, 0x56, 0xc9,
+  0xb2, 0xa7, 0x25, 0x95, 0x60, 0xc7, 0x2c, 0x69,
+  0x5c, 0xdc, 0xd6, 0xfd, 0x31, 0xe2, 0xa4, 0xc0,
+  0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21
+};
+
+static const unsigned char ed25519_gy_le[32] = {
+  0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+/* Window width of the odd multiples of G for the verification.  */
+#define ED25519_G_WNAF 7
+
+/* The tables are created on first use.  ED25519_G_COMB[I][J] is
+   (J+1)·256^I·G; ED25519_G_ODD[J] is (2J+1)·G.  */
+static struct
+{
+  int initialized;
+  fe25519 d2;
+  ge25519_affine comb[32][8];
+  ge25519_affine odd[1 << (ED25519_G_WNAF - 2)];
+} ed25519_tab;
+GPGRT_LOCK_DEFINE (ed25519_tab_lock);
+
+
+static void
+fe_zero (fe25519 h)
+{
+  memset (h, 0, sizeof (fe25519));
+}
+
+
+static void
+fe_one (fe25519 h)
+{
+  memset (h, 0, sizeof (fe25519));
+  h[0] = 1;
+}
+
+
+static void
+fe_neg (fe25519 h, const fe25519 f)
+{
+  fe25519 zero;
+
+  fe_zero (zero);
+  fe_sub (h, zero, f);
+}
+
+
+/* Set F to G if B is 1 without a branch.  */
+static void
+fe_cmov (fe25519 f, const fe25519 g, u64 b)
+{
+  u64 mask = 0 - b;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    f[i] ^= mask & (f[i] ^ g[i]);
+}
+
+
+static int
+fe_isodd (const fe25519 f)
+{
+  unsigned char s[32];
+
+  fe_tobytes (s, f);
+  return s[0] & 1;
+}
+
+
+/* H = A.  Returns false if A does not fit into 255 bits.  */
+static int
+fe_from_mpi (fe25519 h, gcry_mpi_t a)
+{
+  unsigned char buf[32];
+
+  if (!_gcry_mpi_ec_get_le32 (buf, a) || (buf[31] & 0x80))
+    return 0;
+  fe_frombytes (h, buf);
+  return 1;
+}
+
+
+static void
+ge_identity (ge25519 *r)
+{
+  fe_zero (r->X);
+  fe_one (r->Y);
+  fe_one (r->Z);
+  fe_zero (r->T);
+}
+
+
+static void
+ge_to_cached (ge25519_cached *r, const ge25519 *p)
+{
+  fe_add (r->ypx, p->Y, p->X);
+  fe_sub (r->ymx, p->Y, p->X);
+  fe_add (r->z2, p->Z, p->Z);
+  fe_mul (r->t2d, p->T, ed25519_tab.d2);
+}
+
+
+/* R = P + Q, or R = P - Q if NEG is set.  The variables of the
+   formulas "add-2008-hwcd-3" are used.  If Q is NULL, QA is added.  */
+static void
+ge_add (ge25519 *r, const ge25519 *p, const ge25519_cached *q,
+        const ge25519_affine *qa, int neg)
+{
+  fe25519 a, b, c, d, e, f, g, h;
+  const u64 *ypx, *ymx, *t2d;
+
+  if (q)
+    {
+      ypx = q->ypx;
+      ymx = q->ymx;
+      t2d = q->t2d;
+      fe_mul (d, p->Z, q->z2);
+    }
+  else
+    {
+      ypx = qa->ypx;
+      ymx = qa->ymx;
+      t2d = qa->t2d;
+      fe_add (d, p->Z, p->Z);
+    }
+  if (neg)
+    {
+      const u64 *tmp = ypx;
+      ypx = ymx;
+      ymx = tmp;
+    }
+
+  fe_sub (a, p->Y, p->X);
+  fe_mul (a, a, ymx);
+  fe_add (b, p->Y, p->X);
+  fe_mul (b, b, ypx);
+  fe_mul (c, p->T, t2d);
+  fe_sub (e, b, a);
+  fe_add (h, b, a);
+  if (neg)
+    {
+      fe_add (f, d, c);
+      fe_sub (g, d, c);
+    }
+  else
+    {
+      fe_sub (f, d, c);
+      fe_add (g, d, c);
+    }
+  fe_mul (r->X, e, f);
+  fe_mul (r->Y, g, h);
+  fe_mul (r->T, e, h);
+  fe_mul (r->Z, f, g);
+}
+
+
+/* R = 2P using "dbl-2008-hwcd" with all of E, F, G, H negated.  */
+static void
+ge_dbl (ge25519 *r, const ge25519 *p)
+{
+  fe25519 a, b, c, e, f, g, h;
+
+  fe_sq (a, p->X);
+  fe_sq (b, p->Y);
+  fe_sq (c, p->Z);
+  fe_add (c, c, c);
+  fe_add (h, a, b);
+  fe_add (e, p->X, p->Y);
+  fe_sq (e, e);
+  fe_sub (e, h, e);
+  fe_sub (g, a, b);
+  fe_add (f, c, g);
+  fe_mul (r->X, e, f);
+  fe_mul (r->Y, g, h);
+  fe_mul (r->T, e, h);
+  fe_mul (r->Z, f, g);
+}
+
+
+/* Encode P as specified by RFC-8032 into the 32 bytes at S.  */
+static void
+ge_tobytes (unsigned char *s, const ge25519 *p)
+{
+  fe25519 zi, x, y;
+
+  fe_invert (zi, p->Z);
+  fe_mul (x, p->X, zi);
+  fe_mul (y, p->Y, zi);
+  fe_tobytes (s, y);
+  s[31] |= fe_isodd (x) << 7;
+}
+
+
+/* Convert the N points P to the affine addends R using a single
+   inversion.  */
+static void
+ge_batch_to_affine (ge25519_affine *r, const ge25519 *p, unsigned int n)
+{
+  fe25519 *acc, inv, zi, x, y;
+  unsigned int i;
+
+  acc = xmalloc (n * sizeof *acc);
+  fe_copy (acc[0], p[0].Z);
+  for (i = 1; i < n; i++)
+    fe_mul (acc[i], acc[i-1], p[i].Z);
+  fe_invert (inv, acc[n-1]);
+  for (i = n; i-- > 0; )
+    {
+      if (i)
+        {
+          fe_mul (zi, inv, acc[i-1]);
+          fe_mul (inv, inv, p[i].Z);
+        }
+      else
+        fe_copy (zi, inv);
+      fe_mul (x, p[i].X, zi);
+      fe_mul (y, p[i].Y, zi);
+      fe_add (r[i].ypx, y, x);
+      fe_carry (r[i].ypx);
+      fe_sub (r[i].ymx, y, x);
+      fe_mul (r[i].t2d, x, y);
+      fe_mul (r[i].t2d, r[i].t2d, ed25519_tab.d2);
+    }
+  xfree (acc);
+}
+
+
+/* Create the tables of multiples of the base point.  */
+static void
+ed25519_tab_init (void)
+{
+  const unsigned int nodd = DIM (ed25519_tab.odd);
+  ge25519 *pts, g, p;
+  ge25519_cached c;
+  unsigned int i, j;
+  gpg_err_code_t rc;
+
+  rc = gpgrt_lock_lock (&ed25519_tab_lock);
+  if (rc)
+    log_fatal ("failed to acquire the Ed25519 table lock: %s\n",
+               gpg_strerror (rc));
+  if (ed25519_tab.initialized)
+    goto leave;
+
+  fe_frombytes (ed25519_tab.d2, ed25519_d_le);
+  fe_add (ed25519_tab.d2, ed25519_tab.d2, ed25519_tab.d2);
+  fe_carry (ed25519_tab.d2);
+
+  fe_frombytes (g.X, ed25519_gx_le);
+  fe_frombytes (g.Y, ed25519_gy_le);
+  fe_one (g.Z);
+  fe_mul (g.T, g.X, g.Y);
+
+  pts = xmalloc ((32 * 8 + nodd) * sizeof *pts);
+  for (i = 0; i < 32; i++)
+    {
+      pts[8*i] = g;
+      ge_to_cached (&c, &g);
+      for (j = 1; j < 8; j++)
+        ge_add (&pts[8*i+j], &pts[8*i+j-1], &c, NULL, 0);
+      for (j = 0; j < 8; j++)
+        ge_dbl (&g, &g);
+    }
+
+  fe_frombytes (g.X, ed25519_gx_le);
+  fe_frombytes (g.Y, ed25519_gy_le);
+  fe_one (g.Z);
+  fe_mul (g.T, g.X, g.Y);
+  ge_dbl (&p, &g);
+  ge_to_cached (&c, &p);
+  pts[32*8] = g;
+  for (j = 1; j < nodd; j++)
+    ge_add (&pts[32*8+j], &pts[32*8+j-1], &c, NULL, 0);
+
+  ge_batch_to_affine (&ed25519_tab.comb[0][0], pts, 32 * 8);
+  ge_batch_to_affine (ed25519_tab.odd, pts + 32 * 8, nodd);
+  xfree (pts);
+
+  ed25519_tab.initialized = 1;
+
+ leave:
+  rc = gpgrt_lock_unlock (&ed25519_tab_lock);
+  if (rc)
+    log_fatal ("failed to release the Ed25519 table lock: %s\n",
+               gpg_strerror (rc));
+}
+
+
+/* Load the entry B of the Ith row of the comb table into T, where B
+   is a digit in the range -8 to 8, without a branch or memory access
+   depending on B.  */
+static void
+ge_comb_select (ge25519_affine *t, int i, signed char b)
+{
+  unsigned int neg = (unsigned char)b >> 7;
+  unsigned int babs = b - ((0U - neg) & (2U * b));
+  fe25519 mt2d;
+  unsigned int j;
+  u64 eq;
+
+  fe_one (t->ypx);
+  fe_one (t->ymx);
+  fe_zero (t->t2d);
+  for (j = 0; j < 8; j++)
+    {
+      eq = ((u64)(babs ^ (j + 1)) - 1) >> 63;
+      fe_cmov (t->ypx, ed25519_tab.comb[i][j].ypx, eq);
+      fe_cmov (t->ymx, ed25519_tab.comb[i][j].ymx, eq);
+      fe_cmov (t->t2d, ed25519_tab.comb[i][j].t2d, eq);
+    }
+
+  /* -(x,y) = (-x,y) swaps y+x and y-x and negates 2dxy.  */
+  fe_cswap (t->ypx, t->ymx, neg);
+  fe_neg (mt2d, t->t2d);
+  fe_cmov (t->t2d, mt2d, neg);
+}
+
+
+/* Compute the encoding of SCALAR·G into the 32 bytes at RESULT, where
+   G is the base point of Ed25519.  SCALAR is recoded into 64 signed
+   radix 16 digits so that only 64 additions of table entries and 4
+   doublings are needed.  The sequence of operations and memory
+   accesses does not depend on SCALAR.  Returns false if SCALAR is
+   negative or has more than 255 bits.  */
+int
+_gcry_mpi_ec_ed25519_mul_base (unsigned char *result, gcry_mpi_t scalar)
+{
+  unsigned char k[32];
+  signed char e[64];
+  ge25519 r;
+  ge25519_affine t;
+  int i, carry;
+
+  if (!_gcry_mpi_ec_get_le32 (k, scalar) || (k[31] & 0x80))
+    {
+      wipememory (k, sizeof k);
+      return 0;
+    }
+  ed25519_tab_init ();
+
+  for (i = 0; i < 32; i++)
+    {
+      e[2*i]   = k[i] & 15;
+      e[2*i+1] = k[i] >> 4;
+    }
+  carry = 0;
+  for (i = 0; i < 63; i++)
+    {
+      e[i] += carry;
+      carry = (e[i] + 8) >> 4;
+      e[i] -= carry * 16;
+    }
+  e[63] += carry;
+
+  ge_identity (&r);
+  for (i = 1; i < 64; i += 2)
+    {
+      ge_comb_select (&t, i / 2, e[i]);
+      ge_add (&r, &r, NULL, &t, 0);
+    }
+  ge_dbl (&r, &r);
+  ge_dbl (&r, &r);
+  ge_dbl (&r, &r);
+  ge_dbl (&r, &r);
+  for (i = 0; i < 64; i += 2)
+    {
+      ge_comb_select (&t, i / 2, e[i]);
+      ge_add (&r, &r, NULL, &t, 0);
+    }
+
+  ge_tobytes (result, &r);
+
+  wipememory (k, sizeof k);
+  wipememory (e, sizeof e);
+  wipememory (&r, sizeof r);
+  wipememory (&t, sizeof t);
+  return 1;
+}
+
+
+/* Number of digits of the non-adjacent forms.  A 256 bit value has
+   at most 257 digits.  */
+#define ED25519_NAF_LEN 260
+
+/* Compute the width W non-adjacent form of the 256 bit little endian
+   value K into the ED25519_NAF_LEN digits at NAF.  */
+static void
+ed25519_wnaf (signed char *naf, const unsigned char *k, int w)
+{
+  u64 x[5];
+  int i, j, d;
+
+#define WNAF_BIT(n) ((x[(n) / 64] >> ((n) % 64)) & 1)
+  for (i = 0; i < 4; i++)
+    x[i] = fe_load64 (k + 8 * i);
+  x[4] = 0;
+
+  memset (naf, 0, ED25519_NAF_LEN);
+  for (i = 0; i < ED25519_NAF_LEN; i++)
+    {
+      if (!WNAF_BIT (i))
+        continue;
+      d = 0;
+      for (j = w - 1; j >= 0; j--)
+        d = 2 * d + (i + j < 320? WNAF_BIT (i + j) : 0);
+      for (j = 0; j < w && i + j < 320; j++)
+        x[(i + j) / 64] &= ~((u64)1 << ((i + j) % 64));
+      if (d >= (1 << (w - 1)))
+        {
+          /* Negative digit: add 2^(i+W) to the remaining value.  */
+          d -= 1 << w;
+          for (j = i + w; WNAF_BIT (j); j++)
+            x[j / 64] &= ~((u64)1 << (j % 64));
+          x[j / 64] |= (u64)1 << (j % 64);
+        }
+      naf[i] = d;
+    }
+#undef WNAF_BIT
+}
+
+
+/* Compute the encoding of S·G - H·Q into the 32 bytes at RESULT,
+   where G is the base point of Ed25519.  Interleaved sliding windows
+   are used for S and H; the computation is not constant time.
+   Returns false if S or H do not fit into 256 bits or the coordinates
+   of Q into 255 bits.  */
+int
+_gcry_mpi_ec_ed25519_mul_double (unsigned char *result, gcry_mpi_t s,
+                                 gcry_mpi_t h, mpi_point_t q)
+{
+  unsigned char sbuf[32], hbuf[32];
+  signed char snaf[ED25519_NAF_LEN], hnaf[ED25519_NAF_LEN];
+  ge25519 r, p;
+  ge25519_cached qtab[8], q2;
+  fe25519 x, y, z;
+  int i, j;
+
+  if (!_gcry_mpi_ec_get_le32 (sbuf, s) || !_gcry_mpi_ec_get_le32 (hbuf, h)
+      || !fe_from_mpi (x, q->x) || !fe_from_mpi (y, q->y)
+      || !fe_from_mpi (z, q->z))
+    return 0;
+  ed25519_tab_init ();
+
+  /* (XZ : YZ : Z^2 : XY) are extended coordinates of (X : Y : Z);
+     negate X for -Q.  */
+  fe_neg (x, x);
+  fe_mul (p.X, x, z);
+  fe_mul (p.Y, y, z);
+  fe_sq (p.Z, z);
+  fe_mul (p.T, x, y);
+
+  /* QTAB[J] = (2J+1)·-Q.  */
+  ge_to_cached (&qtab[0], &p);
+  ge_dbl (&r, &p);
+  ge_to_cached (&q2, &r);
+  for (j = 1; j < 8; j++)
+    {
+      ge_add (&p, &p, &q2, NULL, 0);
+      ge_to_cached (&qtab[j], &p);
+    }
+
+  ed25519_wnaf (snaf, sbuf, ED25519_G_WNAF);
+  ed25519_wnaf (hnaf, hbuf, 5);
+
+  for (i = ED25519_NAF_LEN - 1; i >= 0 && !snaf[i] && !hnaf[i]; i--)
+    ;
+  ge_identity (&r);
+  for (; i >= 0; i--)
+    {
+      ge_dbl (&r, &r);
+      if (snaf[i] > 0)
+        ge_add (&r, &r, NULL, &ed25519_tab.odd[snaf[i] / 2], 0);
+      else if (snaf[i] < 0)
+        ge_add (&r, &r, NULL, &ed25519_tab.odd[-snaf[i] / 2], 1);
+      if (hnaf[i] > 0)
+        ge_add (&r, &r, &qtab[hnaf[i] / 2], NULL, 0);
+      else if (hnaf[i] < 0)
+        ge_add (&r, &r, &qtab[-hnaf[i] / 2], NULL, 1);
+    }
+
+  ge_tobytes (result, &r);
+  return 1;
+}
+
+
+/* Store the field element F into the MPI A.  */
+static void
+fe_to_mpi (gcry_mpi_t a, const fe25519 f)
+{
+  unsigned char buf[32], tmp;
+  int i;
+
+  fe_tobytes (buf, f);
+  for (i = 0; i < 16; i++)
+    {
+      tmp = buf[i];
+      buf[i] = buf[31 - i];
+      buf[31 - i] = tmp;
+    }
+  _gcry_mpi_set_buffer (a, buf, 32, 0);
+}
+
+
+/* Decode the 32 byte encoding S of an Ed25519 point as specified by
+   RFC-8032 into RESULT.  Returns false if S is not the canonical
+   encoding of a point.  */
+int
+_gcry_mpi_ec_ed25519_decodepoint (mpi_point_t result, const unsigned char *s)
+{
+  unsigned char buf[32], tmp[32];
+  fe25519 x, y, u, v, v3, t, z11, one;
+  int sign = s[31] >> 7;
+
+  memcpy (buf, s, 32);
+  buf[31] &= 0x7f;
+  fe_frombytes (y, buf);
+  fe_tobytes (tmp, y);
+  if (memcmp (tmp, buf, 32))
+    return 0;
+
+  /* x^2 = u/v with u = y^2 - 1 and v = dy^2 + 1; the candidate root
+     is x = uv^3·(uv^7)^((p-5)/8).  */
+  fe_one (one);
+  fe_frombytes (t, ed25519_d_le);
+  fe_sq (u, y);
+  fe_mul (v, u, t);
+  fe_sub (u, u, one);
+  fe_add (v, v, one);
+  fe_sq (v3, v);
+  fe_mul (v3, v3, v);
+  fe_sq (x, v3);
+  fe_mul (x, x, v);
+  fe_mul (x, x, u);
+  fe_pow250 (t, z11, x);
+  fe_sqn (t, t, 2);
+  fe_mul (t, t, x);             /* (uv^7)^(2^252-3) */
+  fe_mul (x, t, v3);
+  fe_mul (x, x, u);
+
+  /* If vx^2 = -u, x·sqrt(-1) is the root.  */
+  fe_sq (t, x);
+  fe_mul (t, t, v);
+  fe_tobytes (buf, t);
+  fe_tobytes (tmp, u);
+  if (memcmp (buf, tmp, 32))
+    {
+      fe_neg (u, u);
+      fe_tobytes (tmp, u);
+      if (memcmp (buf, tmp, 32))
+        return 0;
+      fe_frombytes (t, ed25519_sqrtm1_le);
+      fe_mul (x, x, t);
+    }
+
+  if (fe_isodd (x) != sign)
+    {
+      fe_neg (x, x);
+      if (fe_isodd (x) != sign)
+        return 0;               /* x = 0 with the sign bit set.  */
+    }
+
+  fe_to_mpi (result->x, x);
+  fe_to_mpi (result->y, y);
+  mpi_set_ui (result->z, 1);
+  return 1;
+}
+
+
+/* Compute the encoding of 8·(S·G + sum K[J]·P[J]) for J < N into the
+   32 bytes at RESULT, where G is the base point of Ed25519 and 8 its
+   cofactor.  Interleaved sliding windows are used; the computation
+   is not constant time.  Returns false if a scalar does not fit into
+   256 bits, the coordinates of a point into 255 bits, or if memory is
+   short.  */
+int
+_gcry_mpi_ec_ed25519_mul_points (unsigned char *result, gcry_mpi_t s,
+                                 unsigned int n, gcry_mpi_t *k,
+                                 mpi_point_t *p)
+{
+  unsigned char buf[32];
+  signed char snaf[ED25519_NAF_LEN];
+  signed char (*naf)[ED25519_NAF_LEN];
+  ge25519_cached (*tab)[8], p2;
+  ge25519 r, t;
+  fe25519 x, y, z;
+  unsigned int j, m;
+  int i, top, d;
+  int ok = 0;
+
+  naf = xtrymalloc (n * sizeof *naf);
+  tab = xtrymalloc (n * sizeof *tab);
+  if (!naf || !tab || !_gcry_mpi_ec_get_le32 (buf, s))
+    goto leave;
+  ed25519_tab_init ();
+  ed25519_wnaf (snaf, buf, ED25519_G_WNAF);
+
+  for (j = 0; j < n; j++)
+    {
+      if (!_gcry_mpi_ec_get_le32 (buf, k[j])
+          || !fe_from_mpi (x, p[j]->x) || !fe_from_mpi (y, p[j]->y)
+          || !fe_from_mpi (z, p[j]->z))
+        goto leave;
+      ed25519_wnaf (naf[j], buf, 5);
+
+      /* TAB[J][M] = (2M+1)·P[J].  */
+      fe_mul (t.X, x, z);
+      fe_mul (t.Y, y, z);
+      fe_sq (t.Z, z);
+      fe_mul (t.T, x, y);
+      ge_to_cached (&tab[j][0], &t);
+      ge_dbl (&r, &t);
+      ge_to_cached (&p2, &r);
+      for (m = 1; m < 8; m++)
+        {
+          ge_add (&t, &t, &p2, NULL, 0);
+          ge_to_cached (&tab[j][m], &t);
+        }
+    }
+
+  for (top = ED25519_NAF_LEN - 1; top >= 0 && !snaf[top]; top--)
+    ;
+  for (j = 0; j < n; j++)
+    for (i = ED25519_NAF_LEN - 1; i > top; i--)
+      if (naf[j][i])
+        {
+          top = i;
+          break;
+        }
+
+  ge_identity (&r);
+  for (i = top; i >= 0; i--)
+    {
+      ge_dbl (&r, &r);
+      if (snaf[i] > 0)
+        ge_add (&r, &r, NULL, &ed25519_tab.odd[snaf[i] / 2], 0);
+      else if (snaf[i] < 0)
+        ge_add (&r, &r, NULL, &ed25519_tab.odd[-snaf[i] / 2], 1);
+      for (j = 0; j < n; j++)
+        {
+          d = naf[j][i];
+          if (d > 0)
+            ge_add (&r, &r, &tab[j][d / 2], NULL, 0);
+          else if (d < 0)
+            ge_add (&r, &r, &tab[j][-d / 2], NULL, 1);
+        }
+    }
+  ge_dbl (&r, &r);
+  ge_dbl (&r, &r);
+  ge_dbl (&r, &r);
+
+  ge_tobytes (result, &r);
+  ok = 1;
+
+ leave:
+  xfree (tab);
+  xfree (naf);
+  return ok;
+}
+
+#endif /*USE_FE25519_51*/
@@ -576,6 +576,369 @@ ec_pow2_448 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
   ec_mulm_448 (w, b, b, ctx);
 }
 
+/* Routines for the NIST primes P-256, P-384 and P-521.  Products are
+   reduced with the fast reduction of FIPS 186-4, D.2; additions and
+   subtractions work on limb arrays of the size of P.  The functions
+   accept operands of any size below 2^NBITS and fall back to the
+   generic functions for other operands.  */
+
+#define LIMB_SIZE_NIST_MAX ((521+BITS_PER_MPI_LIMB-1)/BITS_PER_MPI_LIMB)
+
+#if BITS_PER_MPI_LIMB == 64
+# define NIST_LIMB_WORDS 2
+#elif BITS_PER_MPI_LIMB == 32
+# define NIST_LIMB_WORDS 1
+#else
+# error please implement for this limb size.
+#endif
+
+/* Load the NWORDS 32 bit words of the limbs at AP into W.  */
+static inline void
+nist_load (u32 *w, mpi_ptr_t ap, int nwords)
+{
+  int i;
+
+  for (i = 0; i < nwords; i++)
+#if NIST_LIMB_WORDS == 2
+    w[i] = ap[i / 2] >> ((i % 2) * 32);
+#else
+    w[i] = ap[i];
+#endif
+}
+
+/* Store the NWORDS 32 bit words W into the limbs at RP.  */
+static inline void
+nist_store (mpi_ptr_t rp, const u32 *w, int nwords)
+{
+  int i;
+
+#if NIST_LIMB_WORDS == 2
+  for (i = 0; i < nwords / 2; i++)
+    rp[i] = w[2*i] | ((mpi_limb_t)w[2*i+1] << 32);
+#else
+  for (i = 0; i < nwords; i++)
+    rp[i] = w[i];
+#endif
+}
+
+
+/* The WSIZE limbs at RP plus CY * 2^N are the result of one of the
+   reductions below with a small signed CY.  Reduce this to the range
+   [0, P) using 2^N = P + DELTA.  */
+static void
+nist_fixup (mpi_ptr_t rp, long cy, mpi_size_t wsize, mpi_ec_t ctx)
+{
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t delta[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t top;
+  int i;
+
+  for (i = 0; i < wsize; i++)
+    delta[i] = ~ctx->p->d[i];
+  _gcry_mpih_add_1 (delta, delta, wsize, 1);
+  if (cy > 0)
+    {
+      top = _gcry_mpih_addmul_1 (rp, delta, wsize, cy);
+      _gcry_mpih_sub_n (t, rp, ctx->p->d, wsize);
+      mpih_set_cond (rp, t, wsize, (top != 0UL));
+    }
+  else if (cy < 0)
+    {
+      top = _gcry_mpih_submul_1 (rp, delta, wsize, -cy);
+      _gcry_mpih_add_n (t, rp, ctx->p->d, wsize);
+      mpih_set_cond (rp, t, wsize, (top != 0UL));
+    }
+
+  top = _gcry_mpih_sub_n (t, rp, ctx->p->d, wsize);
+  mpih_set_cond (rp, t, wsize, (top == 0UL));
+}
+
+
+/* Helpers to sum up the columns of the reductions in 32 bit words
+   with a signed accumulator.  */
+#define A(i) ((int64_t)in[i])
+#define NIST_COL(i) do { out[i] = (u32)acc; acc >>= 32; } while (0)
+
+/* P-256: T + 2 S1 + 2 S2 + S3 + S4 - D1 - D2 - D3 - D4.  */
+static void
+nist256_reduce (mpi_ptr_t rp, mpi_ptr_t ap, mpi_ec_t ctx)
+{
+  u32 in[16];
+  u32 out[8];
+  int64_t acc = 0;
+
+  nist_load (in, ap, 16);
+
+  acc += A(0) + A(8) + A(9) - A(11) - A(12) - A(13) - A(14);
+  NIST_COL (0);
+  acc += A(1) + A(9) + A(10) - A(12) - A(13) - A(14) - A(15);
+  NIST_COL (1);
+  acc += A(2) + A(10) + A(11) - A(13) - A(14) - A(15);
+  NIST_COL (2);
+  acc += A(3) + 2 * A(11) + 2 * A(12) + A(13) - A(8) - A(9) - A(15);
+  NIST_COL (3);
+  acc += A(4) + 2 * A(12) + 2 * A(13) + A(14) - A(9) - A(10);
+  NIST_COL (4);
+  acc += A(5) + 2 * A(13) + 2 * A(14) + A(15) - A(10) - A(11);
+  NIST_COL (5);
+  acc += A(6) + A(13) + 3 * A(14) + 2 * A(15) - A(8) - A(9);
+  NIST_COL (6);
+  acc += A(7) + A(8) + 3 * A(15) - A(10) - A(11) - A(12) - A(13);
+  NIST_COL (7);
+
+  nist_store (rp, out, 8);
+  nist_fixup (rp, acc, ctx->p->nlimbs, ctx);
+}
+
+
+/* P-384: T + 2 S1 + S2 + S3 + S4 + S5 + S6 - D1 - D2 - D3.  */
+static void
+nist384_reduce (mpi_ptr_t rp, mpi_ptr_t ap, mpi_ec_t ctx)
+{
+  u32 in[24];
+  u32 out[12];
+  int64_t acc = 0;
+
+  nist_load (in, ap, 24);
+
+  acc += A(0) + A(12) + A(20) + A(21) - A(23);
+  NIST_COL (0);
+  acc += A(1) + A(13) + A(22) + A(23) - A(12) - A(20);
+  NIST_COL (1);
+  acc += A(2) + A(14) + A(23) - A(13) - A(21);
+  NIST_COL (2);
+  acc += A(3) + A(12) + A(15) + A(20) + A(21) - A(14) - A(22) - A(23);
+  NIST_COL (3);
+  acc += (A(4) + A(12) + A(13) + A(16) + A(20) + 2 * A(21) + A(22)
+          - A(15) - 2 * A(23));
+  NIST_COL (4);
+  acc += A(5) + A(13) + A(14) + A(17) + A(21) + 2 * A(22) + A(23) - A(16);
+  NIST_COL (5);
+  acc += A(6) + A(14) + A(15) + A(18) + A(22) + 2 * A(23) - A(17);
+  NIST_COL (6);
+  acc += A(7) + A(15) + A(16) + A(19) + A(23) - A(18);
+  NIST_COL (7);
+  acc += A(8) + A(16) + A(17) + A(20) - A(19);
+  NIST_COL (8);
+  acc += A(9) + A(17) + A(18) + A(21) - A(20);
+  NIST_COL (9);
+  acc += A(10) + A(18) + A(19) + A(22) - A(21);
+  NIST_COL (10);
+  acc += A(11) + A(19) + A(20) + A(23) - A(22);
+  NIST_COL (11);
+
+  nist_store (rp, out, 12);
+  nist_fixup (rp, acc, ctx->p->nlimbs, ctx);
+}
+
+#undef A
+#undef NIST_COL
+
+
+/* For P = 2^521 - 1 the high part is simply added to the low part.  */
+static void
+nist521_reduce (mpi_ptr_t rp, mpi_ptr_t ap, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX + 1];
+  mpi_limb_t mask = ((mpi_limb_t)1 << (521 % BITS_PER_MPI_LIMB)) - 1;
+  mpi_limb_t cy;
+
+  _gcry_mpih_rshift (t, ap + wsize - 1, wsize + 1, 521 % BITS_PER_MPI_LIMB);
+  MPN_COPY (rp, ap, wsize);
+  rp[wsize-1] &= mask;
+  _gcry_mpih_add_n (rp, rp, t, wsize);
+
+  /* RP is now less than 2^522; fold the top bit once more.  */
+  cy = rp[wsize-1] >> (521 % BITS_PER_MPI_LIMB);
+  rp[wsize-1] &= mask;
+  _gcry_mpih_add_1 (rp, rp, wsize, cy);
+
+  cy = _gcry_mpih_sub_n (t, rp, ctx->p->d, wsize);
+  mpih_set_cond (rp, t, wsize, (cy == 0UL));
+}
+
+
+/* Copy A zero-padded to the limbs at AP.  Return false if A is
+   negative or not less than 2^NBITS of the prime.  */
+static inline int
+nist_get (mpi_ptr_t ap, gcry_mpi_t a, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  unsigned int rem = ctx->nbits % BITS_PER_MPI_LIMB;
+
+  if (a->sign || a->nlimbs > wsize
+      || (a->nlimbs == wsize && rem && (a->d[wsize-1] >> rem)))
+    return 0;
+  MPN_COPY (ap, a->d, a->nlimbs);
+  MPN_ZERO (ap + a->nlimbs, wsize - a->nlimbs);
+  return 1;
+}
+
+/* Like nist_get but also reduce A modulo the prime.  As the high bit
+   of the prime is set, a value less than 2^NBITS needs at most one
+   subtraction, which is done without branches.  The sums and
+   differences below are then correct with a single correction.  */
+static inline int
+nist_get_reduced (mpi_ptr_t ap, gcry_mpi_t a, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t borrow;
+
+  if (!nist_get (ap, a, ctx))
+    return 0;
+  borrow = _gcry_mpih_sub_n (t, ap, ctx->p->d, wsize);
+  mpih_set_cond (ap, t, wsize, (borrow == 0UL));
+  return 1;
+}
+
+/* Store the WSIZE limbs at RP into W.  */
+static inline void
+nist_set (gcry_mpi_t w, mpi_ptr_t rp, mpi_size_t wsize)
+{
+  mpi_resize (w, wsize);
+  MPN_COPY (w->d, rp, wsize);
+  w->nlimbs = wsize;
+  w->sign = 0;
+  MPN_NORMALIZE (w->d, w->nlimbs);
+}
+
+
+static void
+ec_addm_nist (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t up[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t vp[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t cy, borrow;
+
+  if (!nist_get_reduced (up, u, ctx) || !nist_get_reduced (vp, v, ctx))
+    {
+      ec_addm (w, u, v, ctx);
+      return;
+    }
+
+  cy = _gcry_mpih_add_n (up, up, vp, wsize);
+  borrow = _gcry_mpih_sub_n (t, up, ctx->p->d, wsize);
+  mpih_set_cond (up, t, wsize, (cy != 0UL || borrow == 0UL));
+  nist_set (w, up, wsize);
+}
+
+static void
+ec_subm_nist (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t up[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t vp[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t borrow;
+
+  if (!nist_get_reduced (up, u, ctx) || !nist_get_reduced (vp, v, ctx))
+    {
+      ec_subm (w, u, v, ctx);
+      return;
+    }
+
+  borrow = _gcry_mpih_sub_n (up, up, vp, wsize);
+  _gcry_mpih_add_n (t, up, ctx->p->d, wsize);
+  mpih_set_cond (up, t, wsize, (borrow != 0UL));
+  nist_set (w, up, wsize);
+}
+
+static void
+ec_mul2_nist (gcry_mpi_t w, gcry_mpi_t u, mpi_ec_t ctx)
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t up[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t t[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t cy, borrow;
+
+  if (!nist_get_reduced (up, u, ctx))
+    {
+      ec_mul2 (w, u, ctx);
+      return;
+    }
+
+  cy = _gcry_mpih_lshift (up, up, wsize, 1);
+  borrow = _gcry_mpih_sub_n (t, up, ctx->p->d, wsize);
+  mpih_set_cond (up, t, wsize, (cy != 0UL || borrow == 0UL));
+  nist_set (w, up, wsize);
+}
+
+/* W = U * V mod P using REDUCE for the product.  */
+static void
+ec_mulm_nist (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx,
+              void (*reduce) (mpi_ptr_t rp, mpi_ptr_t ap, mpi_ec_t ctx))
+{
+  mpi_size_t wsize = ctx->p->nlimbs;
+  mpi_limb_t up[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t vp[LIMB_SIZE_NIST_MAX];
+  mpi_limb_t n[LIMB_SIZE_NIST_MAX*2];
+
+  if (!nist_get (up, u, ctx))
+    {
+      ec_mulm (w, u, v, ctx);
+      return;
+    }
+
+  if (u == v)
+    _gcry_mpih_mul_n (n, up, up, wsize);
+  else if (v->nlimbs == 1 && !v->sign)
+    {
+      /* The small constants of the point formulas.  */
+      n[wsize] = _gcry_mpih_mul_1 (n, up, wsize, v->d[0]);
+      MPN_ZERO (n + wsize + 1, wsize - 1);
+    }
+  else if (nist_get (vp, v, ctx))
+    _gcry_mpih_mul_n (n, up, vp, wsize);
+  else
+    {
+      ec_mulm (w, u, v, ctx);
+      return;
+    }
+
+  reduce (up, n, ctx);
+  nist_set (w, up, wsize);
+}
+
+static void
+ec_mulm_nist256 (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, u, v, ctx, nist256_reduce);
+}
+
+static void
+ec_pow2_nist256 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, b, b, ctx, nist256_reduce);
+}
+
+static void
+ec_mulm_nist384 (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, u, v, ctx, nist384_reduce);
+}
+
+static void
+ec_pow2_nist384 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, b, b, ctx, nist384_reduce);
+}
+
+static void
+ec_mulm_nist521 (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, u, v, ctx, nist521_reduce);
+}
+
+static void
+ec_pow2_nist521 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
+{
+  ec_mulm_nist (w, b, b, ctx, nist521_reduce);
+}
+
 struct field_table {
   const char *p;
 
@@ -605,6 +968,32 @@ static const struct field_table field_table[] = {
     ec_mul2_448,
     ec_pow2_448
   },
+  {
+    "0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF",
+    ec_addm_nist,
+    ec_subm_nist,
+    ec_mulm_nist256,
+    ec_mul2_nist,
+    ec_pow2_nist256
+  },
+  {
+    "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE"
+    "FFFFFFFF0000000000000000FFFFFFFF",
+    ec_addm_nist,
+    ec_subm_nist,
+    ec_mulm_nist384,
+    ec_mul2_nist,
+    ec_pow2_nist384
+  },
+  {
+    "0x01FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+    "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+    ec_addm_nist,
+    ec_subm_nist,
+    ec_mulm_nist521,
+    ec_mul2_nist,
+    ec_pow2_nist521
+  },
   { NULL, NULL, NULL, NULL, NULL, NULL },
 };
 
@@ -614,6 +1003,9 @@ _gcry_mpi_ec_get_reset (mpi_ec_t ec)
 {
   ec->t.valid.a_is_pminus3 = 0;
   ec->t.valid.two_inv_p = 0;
+  ec->t.valid.base_comb = 0;
+  _gcry_mpi_ec_comb_free (ec->t.key_comb);
+  ec->t.key_comb = NULL;
 }
 
 
@@ -651,6 +1043,19 @@ ec_get_two_inv_p (mpi_ec_t ec)
 }
 
 
+/* Accessor for helper variable.  */
+static mpi_ec_comb_t
+ec_get_base_comb (mpi_ec_t ec)
+{
+  if (!ec->t.valid.base_comb)
+    {
+      ec->t.valid.base_comb = 1;
+      ec->t.base_comb = _gcry_ecc_get_base_comb (ec);
+    }
+  return ec->t.base_comb;
+}
+
+
 static const char *const curve25519_bad_points[] = {
   "0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed",
   "0x0000000000000000000000000000000000000000000000000000000000000000",
@@ -832,6 +1237,7 @@ ec_deinit (void *opaque)
 
   /* Private data of ec.c.  */
   mpi_free (ctx->t.two_inv_p);
+  _gcry_mpi_ec_comb_free (ctx->t.key_comb);
 
   for (i=0; i< DIM(ctx->t.scratch); i++)
     mpi_free (ctx->t.scratch[i]);
@@ -980,6 +1386,22 @@ _gcry_mpi_ec_decode_point (mpi_point_t result, gcry_mpi_t value, mpi_ec_t ec)
 }
 
 
+/* Return true if A is one.  Unlike mpi_cmp_ui this does not
+   normalize A, which would break the fixed-size field functions.  */
+static int
+one_p (gcry_mpi_t a)
+{
+  mpi_size_t i;
+
+  if (a->sign || !a->nlimbs || a->d[0] != 1)
+    return 0;
+  for (i = 1; i < a->nlimbs; i++)
+    if (a->d[i])
+      return 0;
+  return 1;
+}
+
+
 /* Compute the affine coordinates from the projective coordinates in
    POINT.  Set them into X and Y.  If one coordinate is not required,
    X or Y may be passed as NULL.  CTX is the usual context. Returns: 0
@@ -999,7 +1421,10 @@ _gcry_mpi_ec_get_affine (gcry_mpi_t x, gcry_mpi_t y, mpi_point_t point,
 
         z1 = mpi_new (0);
         z2 = mpi_new (0);
-        ec_invm (z1, point->z, ctx);  /* z1 = z^(-1) mod p  */
+        if (one_p (point->z))
+          mpi_set_ui (z1, 1);
+        else
+          ec_invm (z1, point->z, ctx);  /* z1 = z^(-1) mod p  */
         ec_mulm (z2, z1, z1, ctx);    /* z2 = z^(-2) mod p  */
 
         if (x)
@@ -1037,7 +1462,10 @@ _gcry_mpi_ec_get_affine (gcry_mpi_t x, gcry_mpi_t y, mpi_point_t point,
         gcry_mpi_t z;
 
         z = mpi_new (0);
-        ec_invm (z, point->z, ctx);
+        if (one_p (point->z))
+          mpi_set_ui (z, 1);
+        else
+          ec_invm (z, point->z, ctx);
 
         mpi_resize (z, ctx->p->nlimbs);
         z->nlimbs = ctx->p->nlimbs;
@@ -1094,47 +1522,48 @@ dup_point_weierstrass (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
           /* L1 = 3(X - Z^2)(X + Z^2) */
           /*                          T1: used for Z^2. */
           /*                          T2: used for the right term.  */
-          ec_pow2 (t1, point->z, ctx);
-          ec_subm (l1, point->x, t1, ctx);
-          ec_mulm (l1, l1, mpi_const (MPI_C_THREE), ctx);
-          ec_addm (t2, point->x, t1, ctx);
-          ec_mulm (l1, l1, t2, ctx);
+          ctx->pow2 (t1, point->z, ctx);
+          ctx->subm (l1, point->x, t1, ctx);
+          ctx->mulm (l1, l1, mpi_const (MPI_C_THREE), ctx);
+          ctx->addm (t2, point->x, t1, ctx);
+          ctx->mulm (l1, l1, t2, ctx);
         }
       else /* Standard case. */
         {
           /* L1 = 3X^2 + aZ^4 */
           /*                          T1: used for aZ^4. */
-          ec_pow2 (l1, point->x, ctx);
-          ec_mulm (l1, l1, mpi_const (MPI_C_THREE), ctx);
-          ec_powm (t1, point->z, mpi_const (MPI_C_FOUR), ctx);
-          ec_mulm (t1, t1, ctx->a, ctx);
-          ec_addm (l1, l1, t1, ctx);
+          ctx->pow2 (l1, point->x, ctx);
+          ctx->mulm (l1, l1, mpi_const (MPI_C_THREE), ctx);
+          ctx->pow2 (t1, point->z, ctx);
+          ctx->pow2 (t1, t1, ctx);
+          ctx->mulm (t1, t1, ctx->a, ctx);
+          ctx->addm (l1, l1, t1, ctx);
         }
       /* Z3 = 2YZ */
-      ec_mulm (z3, point->y, point->z, ctx);
-      ec_mul2 (z3, z3, ctx);
+      ctx->mulm (z3, point->y, point->z, ctx);
+      ctx->mul2 (z3, z3, ctx);
 
       /* L2 = 4XY^2 */
       /*                              T2: used for Y2; required later. */
-      ec_pow2 (t2, point->y, ctx);
-      ec_mulm (l2, t2, point->x, ctx);
-      ec_mulm (l2, l2, mpi_const (MPI_C_FOUR), ctx);
+      ctx->pow2 (t2, point->y, ctx);
+      ctx->mulm (l2, t2, point->x, ctx);
+      ctx->mulm (l2, l2, mpi_const (MPI_C_FOUR), ctx);
 
       /* X3 = L1^2 - 2L2 */
       /*                              T1: used for L2^2. */
-      ec_pow2 (x3, l1, ctx);
-      ec_mul2 (t1, l2, ctx);
-      ec_subm (x3, x3, t1, ctx);
+      ctx->pow2 (x3, l1, ctx);
+      ctx->mul2 (t1, l2, ctx);
+      ctx->subm (x3, x3, t1, ctx);
 
       /* L3 = 8Y^4 */
       /*                              T2: taken from above. */
-      ec_pow2 (t2, t2, ctx);
-      ec_mulm (l3, t2, mpi_const (MPI_C_EIGHT), ctx);
+      ctx->pow2 (t2, t2, ctx);
+      ctx->mulm (l3, t2, mpi_const (MPI_C_EIGHT), ctx);
 
       /* Y3 = L1(L2 - X3) - L3 */
-      ec_subm (y3, l2, x3, ctx);
-      ec_mulm (y3, y3, l1, ctx);
-      ec_subm (y3, y3, l3, ctx);
+      ctx->subm (y3, l2, x3, ctx);
+      ctx->mulm (y3, y3, l1, ctx);
+      ctx->subm (y3, y3, l3, ctx);
     }
 
 #undef x3
@@ -1253,11 +1682,12 @@ _gcry_mpi_ec_dup_point (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
 }
 
 
-/* RESULT = P1 + P2  (Weierstrass version).*/
+/* RESULT = P1 + P2  (Weierstrass version).  If CT is set the
+   multiplications by a Z coordinate of one are not skipped.  */
 static void
 add_points_weierstrass (mpi_point_t result,
                         mpi_point_t p1, mpi_point_t p2,
-                        mpi_ec_t ctx)
+                        mpi_ec_t ctx, int ct)
 {
 #define x1 (p1->x    )
 #define y1 (p1->y    )
@@ -1301,35 +1731,47 @@ add_points_weierstrass (mpi_point_t result,
     }
   else
     {
-      int z1_is_one = !mpi_cmp_ui (z1, 1);
-      int z2_is_one = !mpi_cmp_ui (z2, 1);
+      int z1_is_one = !ct && !mpi_cmp_ui (z1, 1);
+      int z2_is_one = !ct && !mpi_cmp_ui (z2, 1);
 
       /* l1 = x1 z2^2  */
       /* l2 = x2 z1^2  */
+      /*                              T1: used for z2^2.  */
+      /*                              T2: used for z1^2.  */
       if (z2_is_one)
         mpi_set (l1, x1);
       else
         {
-          ec_pow2 (l1, z2, ctx);
-          ec_mulm (l1, l1, x1, ctx);
+          ctx->pow2 (t1, z2, ctx);
+          ctx->mulm (l1, t1, x1, ctx);
         }
       if (z1_is_one)
         mpi_set (l2, x2);
       else
         {
-          ec_pow2 (l2, z1, ctx);
-          ec_mulm (l2, l2, x2, ctx);
+          ctx->pow2 (t2, z1, ctx);
+          ctx->mulm (l2, t2, x2, ctx);
         }
       /* l3 = l1 - l2 */
-      ec_subm (l3, l1, l2, ctx);
+      ctx->subm (l3, l1, l2, ctx);
       /* l4 = y1 z2^3  */
-      ec_powm (l4, z2, mpi_const (MPI_C_THREE), ctx);
-      ec_mulm (l4, l4, y1, ctx);
+      if (z2_is_one)
+        mpi_set (l4, y1);
+      else
+        {
+          ctx->mulm (l4, t1, z2, ctx);
+          ctx->mulm (l4, l4, y1, ctx);
+        }
       /* l5 = y2 z1^3  */
-      ec_powm (l5, z1, mpi_const (MPI_C_THREE), ctx);
-      ec_mulm (l5, l5, y2, ctx);
+      if (z1_is_one)
+        mpi_set (l5, y2);
+      else
+        {
+          ctx->mulm (l5, t2, z1, ctx);
+          ctx->mulm (l5, l5, y2, ctx);
+        }
       /* l6 = l4 - l5  */
-      ec_subm (l6, l4, l5, ctx);
+      ctx->subm (l6, l4, l5, ctx);
 
       if (!mpi_cmp_ui (l3, 0))
         {
@@ -1349,26 +1791,32 @@ add_points_weierstrass (mpi_point_t result,
       else
         {
           /* l7 = l1 + l2  */
-          ec_addm (l7, l1, l2, ctx);
+          ctx->addm (l7, l1, l2, ctx);
           /* l8 = l4 + l5  */
-          ec_addm (l8, l4, l5, ctx);
+          ctx->addm (l8, l4, l5, ctx);
           /* z3 = z1 z2 l3  */
-          ec_mulm (z3, z1, z2, ctx);
-          ec_mulm (z3, z3, l3, ctx);
+          if (z2_is_one)
+            ctx->mulm (z3, z1, l3, ctx);
+          else
+            {
+              ctx->mulm (z3, z1, z2, ctx);
+              ctx->mulm (z3, z3, l3, ctx);
+            }
           /* x3 = l6^2 - l7 l3^2  */
-          ec_pow2 (t1, l6, ctx);
-          ec_pow2 (t2, l3, ctx);
-          ec_mulm (t2, t2, l7, ctx);
-          ec_subm (x3, t1, t2, ctx);
+          /*                          L1: used for l3^2; required later. */
+          ctx->pow2 (t1, l6, ctx);
+          ctx->pow2 (l1, l3, ctx);
+          ctx->mulm (t2, l1, l7, ctx);
+          ctx->subm (x3, t1, t2, ctx);
           /* l9 = l7 l3^2 - 2 x3  */
-          ec_mul2 (t1, x3, ctx);
-          ec_subm (l9, t2, t1, ctx);
+          ctx->mul2 (t1, x3, ctx);
+          ctx->subm (l9, t2, t1, ctx);
           /* y3 = (l9 l6 - l8 l3^3)/2  */
-          ec_mulm (l9, l9, l6, ctx);
-          ec_powm (t1, l3, mpi_const (MPI_C_THREE), ctx); /* fixme: Use saved value*/
-          ec_mulm (t1, t1, l8, ctx);
-          ec_subm (y3, l9, t1, ctx);
-          ec_mulm (y3, y3, ec_get_two_inv_p (ctx), ctx);
+          ctx->mulm (l9, l9, l6, ctx);
+          ctx->mulm (t1, l1, l3, ctx);
+          ctx->mulm (t1, t1, l8, ctx);
+          ctx->subm (y3, l9, t1, ctx);
+          ctx->mulm (y3, y3, ec_get_two_inv_p (ctx), ctx);
         }
     }
 
@@ -1410,11 +1858,12 @@ add_points_montgomery (mpi_point_t result,
 }
 
 
-/* RESULT = P1 + P2  (Twisted Edwards version).*/
+/* RESULT = P1 + P2  (Twisted Edwards version).  If CT is set the
+   multiplication by a Z2 of one is not skipped.  */
 static void
 add_points_edwards (mpi_point_t result,
                     mpi_point_t p1, mpi_point_t p2,
-                    mpi_ec_t ctx)
+                    mpi_ec_t ctx, int ct)
 {
 #define X1 (p1->x)
 #define Y1 (p1->y)
@@ -1439,7 +1888,10 @@ add_points_edwards (mpi_point_t result,
   /* Compute: (X_3 : Y_3 : Z_3) = (X_1 : Y_1 : Z_1) + (X_2 : Y_2 : Z_3)  */
 
   /* A = Z1 · Z2 */
-  ctx->mulm (A, Z1, Z2, ctx);
+  if (!ct && one_p (Z2))
+    mpi_set (A, Z1);
+  else
+    ctx->mulm (A, Z1, Z2, ctx);
 
   /* B = A^2 */
   ctx->pow2 (B, A, ctx);
@@ -1544,18 +1996,33 @@ _gcry_mpi_ec_add_points (mpi_point_t result,
   switch (ctx->model)
     {
     case MPI_EC_WEIERSTRASS:
-      add_points_weierstrass (result, p1, p2, ctx);
+      add_points_weierstrass (result, p1, p2, ctx, 0);
       break;
     case MPI_EC_MONTGOMERY:
       add_points_montgomery (result, p1, p2, ctx);
       break;
     case MPI_EC_EDWARDS:
-      add_points_edwards (result, p1, p2, ctx);
+      add_points_edwards (result, p1, p2, ctx, 0);
       break;
     }
 }
 
 
+/* RESULT = P1 + P2 for the constant-time scalar multiplication.
+   Unlike _gcry_mpi_ec_add_points the field operations do not depend
+   on whether a Z coordinate is one, so that adding a table entry
+   which happens to be affine takes the same time as any other.  */
+static void
+ec_add_points_ct (mpi_point_t result, mpi_point_t p1, mpi_point_t p2,
+                  mpi_ec_t ctx)
+{
+  if (ctx->model == MPI_EC_EDWARDS)
+    add_points_edwards (result, p1, p2, ctx, 1);
+  else
+    add_points_weierstrass (result, p1, p2, ctx, 1);
+}
+
+
 /* RESULT = P1 - P2  (Weierstrass version).*/
 static void
 sub_points_weierstrass (mpi_point_t result,
@@ -1595,7 +2062,7 @@ sub_points_edwards (mpi_point_t result,
   mpi_point_t p2i = _gcry_mpi_point_new (0);
   point_set (p2i, p2);
   ctx->subm (p2i->x, ctx->p, p2i->x, ctx);
-  add_points_edwards (result, p1, p2i, ctx);
+  add_points_edwards (result, p1, p2i, ctx, 0);
   _gcry_mpi_point_release (p2i);
 }
 
@@ -1621,6 +2088,1025 @@ _gcry_mpi_ec_sub_points (mpi_point_t result,
 }
 
 
+/* Precomputed table for the fixed-base comb method of Lim and Lee.
+   The scalar is split into TEETH rows of SPACING bits each.  Entry U
+   of the table holds the sum of 2^(I*SPACING)·BASE over all bits I
+   set in U, so that one column of the scalar is processed by a single
+   point doubling and a single addition of a table entry.  The entries
+   are stored in affine coordinates: first the X coordinates of all
+   entries followed by the Y coordinates, each NLIMBS limbs long.  */
+#define COMB_MAX_TEETH 7
+
+struct mpi_ec_comb_s
+{
+  unsigned int nbits;    /* Maximum length of a scalar in bits.  */
+  unsigned int teeth;    /* Number of rows.  */
+  unsigned int spacing;  /* Number of columns.  */
+  mpi_size_t nlimbs;     /* Length of a coordinate in limbs.  */
+  mpi_limb_t *table;     /* 2^TEETH points.  */
+};
+
+
+/* Create a comb table for scalars of up to NBITS bits and the point
+   BASE.  Returns NULL if the table can't be created.  The table needs
+   to be released using _gcry_mpi_ec_comb_free.  */
+mpi_ec_comb_t
+_gcry_mpi_ec_comb_new (mpi_point_t base, unsigned int nbits, mpi_ec_t ctx)
+{
+  mpi_ec_comb_t comb;
+  mpi_point_struct *points;
+  mpi_point_struct rows[COMB_MAX_TEETH];
+  gcry_mpi_t *acc;
+  gcry_mpi_t x, y, zinv, inv;
+  unsigned int nentries, i, j, top;
+  mpi_size_t nlimbs = ctx->p->nlimbs;
+  mpi_limb_t *tx, *ty;
+  int ok = 1;
+
+  if (ctx->model == MPI_EC_MONTGOMERY || !nbits)
+    return NULL;
+
+  comb = xtrycalloc (1, sizeof *comb);
+  if (!comb)
+    return NULL;
+  comb->nbits = nbits;
+  comb->teeth = nbits > 384? COMB_MAX_TEETH : COMB_MAX_TEETH - 1;
+  comb->spacing = (nbits + comb->teeth - 1) / comb->teeth;
+  comb->nlimbs = nlimbs;
+  nentries = 1 << comb->teeth;
+  comb->table = xtrycalloc (2 * nentries * nlimbs, sizeof (mpi_limb_t));
+  if (!comb->table)
+    {
+      xfree (comb);
+      return NULL;
+    }
+
+  points = xtrycalloc (nentries, sizeof *points);
+  acc = xtrycalloc (nentries, sizeof *acc);
+  if (!points || !acc)
+    {
+      xfree (points);
+      xfree (acc);
+      _gcry_mpi_ec_comb_free (comb);
+      return NULL;
+    }
+  for (i = 0; i < nentries; i++)
+    point_init (&points[i]);
+
+  /* ROWS[I] = 2^(I*SPACING)·BASE.  */
+  for (i = 0; i < comb->teeth; i++)
+    {
+      point_init (&rows[i]);
+      point_set (&rows[i], i? &rows[i-1] : base);
+      if (ctx->model == MPI_EC_EDWARDS)
+        mpi_point_resize (&rows[i], ctx);
+      for (j = 0; i && j < comb->spacing; j++)
+        _gcry_mpi_ec_dup_point (&rows[i], &rows[i], ctx);
+    }
+
+  /* Entry 0 is never used for Weierstrass curves; the neutral element
+     of Edwards curves can be stored in affine coordinates.  */
+  if (ctx->model == MPI_EC_EDWARDS)
+    {
+      mpi_set_ui (points[0].x, 0);
+      mpi_set_ui (points[0].y, 1);
+      mpi_set_ui (points[0].z, 1);
+      mpi_point_resize (&points[0], ctx);
+    }
+  else
+    point_set (&points[0], base);
+
+  for (i = 1; i < nentries; i++)
+    {
+      for (top = 0; (i >> (top + 1)); top++)
+        ;
+      if (i == (1U << top))
+        point_set (&points[i], &rows[top]);
+      else
+        {
+          if (ctx->model == MPI_EC_EDWARDS)
+            mpi_point_resize (&points[i], ctx);
+          _gcry_mpi_ec_add_points (&points[i], &points[i ^ (1U << top)],
+                                   &rows[top], ctx);
+        }
+    }
+
+  /* Convert all entries to affine coordinates using a single
+     inversion: ACC[I] is the product of the Z coordinates of the
+     entries 0 to I.  */
+  for (i = 0; i < nentries; i++)
+    {
+      if (!mpi_cmp_ui (points[i].z, 0))
+        ok = 0;  /* Point at infinity.  */
+      acc[i] = mpi_copy (points[i].z);
+      if (i)
+        mpi_mulm (acc[i], acc[i], acc[i-1], ctx->p);
+    }
+
+  x = mpi_new (0);
+  y = mpi_new (0);
+  zinv = mpi_new (0);
+  inv = mpi_new (0);
+  if (ok)
+    ec_invm (inv, acc[nentries-1], ctx);
+  tx = comb->table;
+  ty = comb->table + nentries * nlimbs;
+  for (i = nentries; ok && i-- > 0; )
+    {
+      if (i)
+        {
+          mpi_mulm (zinv, inv, acc[i-1], ctx->p);
+          mpi_mulm (inv, inv, points[i].z, ctx->p);
+        }
+      else
+        mpi_set (zinv, inv);
+
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          /* Using Jacobian coordinates.  */
+          mpi_mulm (y, zinv, zinv, ctx->p);
+          mpi_mulm (x, points[i].x, y, ctx->p);
+          mpi_mulm (y, y, zinv, ctx->p);
+          mpi_mulm (y, points[i].y, y, ctx->p);
+        }
+      else
+        {
+          mpi_mulm (x, points[i].x, zinv, ctx->p);
+          mpi_mulm (y, points[i].y, zinv, ctx->p);
+        }
+
+      if (x->nlimbs > nlimbs || y->nlimbs > nlimbs)
+        ok = 0;
+      else
+        {
+          MPN_COPY (tx + i * nlimbs, x->d, x->nlimbs);
+          MPN_COPY (ty + i * nlimbs, y->d, y->nlimbs);
+        }
+    }
+  mpi_free (x);
+  mpi_free (y);
+  mpi_free (zinv);
+  mpi_free (inv);
+  for (i = 0; i < nentries; i++)
+    mpi_free (acc[i]);
+  xfree (acc);
+
+  for (i = 0; i < comb->teeth; i++)
+    point_free (&rows[i]);
+  for (i = 0; i < nentries; i++)
+    point_free (&points[i]);
+  xfree (points);
+
+  if (!ok)
+    {
+      _gcry_mpi_ec_comb_free (comb);
+      comb = NULL;
+    }
+  return comb;
+}
+
+
+/* Release the comb table COMB.  COMB may be NULL.  */
+void
+_gcry_mpi_ec_comb_free (mpi_ec_comb_t comb)
+{
+  if (comb)
+    {
+      xfree (comb->table);
+      xfree (comb);
+    }
+}
+
+
+/* Create a comb table for the public key Q of EC, so that later
+   calls of _gcry_mpi_ec_mul_point2 with Q as second point need fewer
+   point operations.  This pays off only if the context is used for
+   several verifications.  The table covers scalars up to the group
+   order times the cofactor.  Nothing is done if the table already
+   exists or can't be created.  */
+void
+_gcry_mpi_ec_precompute_key (mpi_ec_t ec)
+{
+  gcry_mpi_t order;
+
+  if (ec->t.key_comb || !ec->Q || !ec->n || ec->model == MPI_EC_MONTGOMERY)
+    return;
+
+  order = mpi_new (0);
+  mpi_mul_ui (order, ec->n, ec->h? ec->h : 1);
+  ec->t.key_comb = _gcry_mpi_ec_comb_new (ec->Q, mpi_get_nbits (order), ec);
+  mpi_free (order);
+}
+
+
+/* Return true if the coordinates A are given by the NLIMBS limbs at
+   BP.  A is not modified.  */
+static int
+limbs_equal_p (gcry_mpi_t a, mpi_ptr_t bp, mpi_size_t nlimbs)
+{
+  mpi_size_t asize = a->nlimbs;
+  mpi_size_t i;
+
+  if (mpi_is_opaque (a) || a->sign)
+    return 0;
+  MPN_NORMALIZE (a->d, asize);
+  if (asize > nlimbs)
+    return 0;
+  for (i = asize; i < nlimbs; i++)
+    if (bp[i])
+      return 0;
+  return !asize || !_gcry_mpih_cmp (a->d, bp, asize);
+}
+
+
+/* Return true if POINT is the base point of COMB in affine
+   coordinates.  */
+static int
+comb_base_p (mpi_ec_comb_t comb, mpi_point_t point)
+{
+  unsigned int nentries = 1 << comb->teeth;
+  mpi_size_t nlimbs = comb->nlimbs;
+  mpi_limb_t one[1] = { 1 };
+
+  /* Entry 1 of the table is the base point itself.  */
+  return (limbs_equal_p (point->z, one, 1)
+          && limbs_equal_p (point->x, comb->table + nlimbs, nlimbs)
+          && limbs_equal_p (point->y, comb->table + (nentries + 1) * nlimbs,
+                            nlimbs));
+}
+
+
+/* Load the table entry IDX of COMB into POINT.  All entries are
+   accessed so that the memory access pattern does not depend on
+   IDX.  */
+static void
+comb_lookup (mpi_point_t point, mpi_ec_comb_t comb, unsigned long idx,
+             mpi_ec_t ctx)
+{
+  unsigned int nentries = 1 << comb->teeth;
+  mpi_size_t nlimbs = comb->nlimbs;
+
+  mpih_lookup_cond (point->x->d, comb->table, nlimbs, nentries, idx);
+  mpih_lookup_cond (point->y->d, comb->table + nentries * nlimbs,
+                    nlimbs, nentries, idx);
+  point->x->nlimbs = nlimbs;
+  point->y->nlimbs = nlimbs;
+  if (ctx->model != MPI_EC_EDWARDS)
+    {
+      /* The generic field functions want normalized input.  */
+      MPN_NORMALIZE (point->x->d, point->x->nlimbs);
+      MPN_NORMALIZE (point->y->d, point->y->nlimbs);
+    }
+}
+
+
+/* RESULT = SCALAR * BASE using the comb table COMB for BASE.  SCALAR
+   must be non-negative and not longer than COMB->NBITS.  All table
+   entries are affine and every column takes one doubling and one
+   addition; all entries are read for each lookup.  The Edwards
+   formulas are complete.  For Weierstrass curves the accumulator
+   starts at BASE instead of the point at infinity, so that leading
+   zero columns don't take the shortcuts for infinity; the final
+   subtraction of 2^SPACING·BASE, which is table entry 2, removes it
+   again.  Only with negligible probability does an addition meet
+   equal or inverse points and thus take a different path.  */
+static void
+ec_mul_point_comb (mpi_point_t result, gcry_mpi_t scalar,
+                   mpi_ec_comb_t comb, mpi_ec_t ctx)
+{
+  mpi_point_struct entry, tmppnt;
+  unsigned long idx;
+  unsigned int i;
+  int j;
+
+  point_init (&entry);
+  point_init (&tmppnt);
+  mpi_resize (entry.x, comb->nlimbs);
+  mpi_resize (entry.y, comb->nlimbs);
+  mpi_set_ui (entry.z, 1);
+
+  if (ctx->model == MPI_EC_WEIERSTRASS)
+    {
+      mpi_resize (result->x, comb->nlimbs);
+      mpi_resize (result->y, comb->nlimbs);
+      comb_lookup (result, comb, 1, ctx);
+      mpi_set_ui (result->z, 1);
+    }
+  else
+    {
+      mpi_set_ui (result->x, 0);
+      mpi_set_ui (result->y, 1);
+      mpi_set_ui (result->z, 1);
+      mpi_point_resize (&entry, ctx);
+    }
+  mpi_point_resize (result, ctx);
+  mpi_point_resize (&tmppnt, ctx);
+
+  for (j = comb->spacing - 1; j >= 0; j--)
+    {
+      idx = 0;
+      for (i = 0; i < comb->teeth; i++)
+        idx |= (unsigned long)mpi_test_bit (scalar, i * comb->spacing + j)
+                << i;
+
+      _gcry_mpi_ec_dup_point (result, result, ctx);
+      comb_lookup (&entry, comb, idx, ctx);
+      if (ctx->model == MPI_EC_EDWARDS)
+        _gcry_mpi_ec_add_points (result, result, &entry, ctx);
+      else
+        {
+          /* Entry 0 stands for the point at infinity.  */
+          _gcry_mpi_ec_add_points (&tmppnt, result, &entry, ctx);
+          point_swap_cond (result, &tmppnt, idx != 0, ctx);
+        }
+    }
+
+  if (ctx->model == MPI_EC_WEIERSTRASS)
+    {
+      /* Remove the start value, which has been doubled SPACING
+         times.  */
+      comb_lookup (&entry, comb, 2, ctx);
+      mpi_sub (entry.y, ctx->p, entry.y);
+      _gcry_mpi_ec_add_points (result, result, &entry, ctx);
+    }
+
+  point_free (&entry);
+  point_free (&tmppnt);
+}
+
+
+/* Maximum window width of the wNAF method.  */
+#define WNAF_MAX_WINDOW 6
+
+/* Compute the width-W non-adjacent form of the non-negative SCALAR of
+   NBITS bits.  Digit I of NAF is the coefficient of 2^I; all non-zero
+   digits are odd and less than 2^(W-1) in absolute value.  NAF must
+   have room for NBITS + 1 digits.  Returns the number of digits.  */
+static unsigned int
+wnaf_recode (signed char *naf, gcry_mpi_t scalar, unsigned int nbits,
+             unsigned int w)
+{
+  unsigned int bit, i;
+  unsigned int len = 0;
+  int carry = 0;
+  int word;
+
+  memset (naf, 0, nbits + 1);
+  for (bit = 0; bit < nbits || carry; )
+    {
+      if (mpi_test_bit (scalar, bit) == carry)
+        {
+          bit++;
+          continue;
+        }
+
+      word = carry;
+      for (i = 0; i < w; i++)
+        word += mpi_test_bit (scalar, bit + i) << i;
+      carry = (word >> (w - 1)) & 1;
+      naf[bit] = word - (carry << w);
+      len = bit + 1;
+      bit += w;
+    }
+
+  return len;
+}
+
+
+/* Load the table entry IDX of COMB into POINT.  Unlike comb_lookup
+   only the requested entry is accessed; thus IDX must be public.  */
+static void
+comb_load (mpi_point_t point, mpi_ec_comb_t comb, unsigned long idx,
+           mpi_ec_t ctx)
+{
+  unsigned int nentries = 1 << comb->teeth;
+  mpi_size_t nlimbs = comb->nlimbs;
+
+  MPN_COPY (point->x->d, comb->table + idx * nlimbs, nlimbs);
+  MPN_COPY (point->y->d, comb->table + (nentries + idx) * nlimbs, nlimbs);
+  point->x->nlimbs = nlimbs;
+  point->y->nlimbs = nlimbs;
+  if (ctx->model != MPI_EC_EDWARDS)
+    {
+      MPN_NORMALIZE (point->x->d, point->x->nlimbs);
+      MPN_NORMALIZE (point->y->d, point->y->nlimbs);
+    }
+}
+
+
+/* The width-w NAF of a scalar together with the odd multiples of the
+   point it is to be multiplied with.  */
+struct wnaf_s
+{
+  unsigned int count;   /* Number of positive entries in TABLE.  */
+  unsigned int len;     /* Number of digits in NAF.  */
+  signed char *naf;
+  /* TABLE[I] = (2I+1)·P and TABLE[COUNT+I] = -(2I+1)·P.  */
+  mpi_point_struct table[2 << (WNAF_MAX_WINDOW - 2)];
+};
+
+
+/* Prepare WN for the product of the non-negative SCALAR and POINT.
+   The table entries are kept in projective coordinates; an inversion
+   to make them affine costs more than it saves for a single
+   scalar.  */
+static void
+wnaf_init (struct wnaf_s *wn, gcry_mpi_t scalar, mpi_point_t point,
+           mpi_ec_t ctx)
+{
+  mpi_point_struct twice;
+  unsigned int nbits, w, count, i;
+
+  nbits = mpi_get_nbits (scalar);
+  w = (nbits > 384? WNAF_MAX_WINDOW : nbits > 128? 5 : nbits > 32? 4 : 3);
+  count = wn->count = 1 << (w - 2);
+
+  for (i = 0; i < 2 * count; i++)
+    point_init (&wn->table[i]);
+  point_init (&twice);
+  point_set (&wn->table[0], point);
+  if (ctx->model == MPI_EC_EDWARDS)
+    {
+      mpi_point_resize (&wn->table[0], ctx);
+      mpi_point_resize (&twice, ctx);
+    }
+  _gcry_mpi_ec_dup_point (&twice, &wn->table[0], ctx);
+  for (i = 1; i < count; i++)
+    {
+      if (ctx->model == MPI_EC_EDWARDS)
+        mpi_point_resize (&wn->table[i], ctx);
+      _gcry_mpi_ec_add_points (&wn->table[i], &wn->table[i-1], &twice, ctx);
+    }
+  for (i = 0; i < count; i++)
+    {
+      point_set (&wn->table[count+i], &wn->table[i]);
+      if (ctx->model == MPI_EC_EDWARDS)
+        {
+          mpi_point_resize (&wn->table[count+i], ctx);
+          ctx->subm (wn->table[count+i].x, ctx->p, wn->table[i].x, ctx);
+        }
+      else
+        ctx->subm (wn->table[count+i].y, ctx->p, wn->table[i].y, ctx);
+    }
+  point_free (&twice);
+
+  wn->naf = xmalloc (nbits + 1);
+  wn->len = wnaf_recode (wn->naf, scalar, nbits, w);
+}
+
+
+static void
+wnaf_free (struct wnaf_s *wn)
+{
+  unsigned int i;
+
+  xfree (wn->naf);
+  for (i = 0; i < 2 * wn->count; i++)
+    point_free (&wn->table[i]);
+}
+
+
+/* Return the table entry of WN for the non-zero digit D.  */
+static mpi_point_t
+wnaf_entry (struct wnaf_s *wn, int d)
+{
+  if (d > 0)
+    return &wn->table[(d - 1) / 2];
+  else
+    return &wn->table[wn->count + (-d - 1) / 2];
+}
+
+
+/* RESULT += POINT.  *STARTED is false as long as RESULT is still the
+   neutral element; this saves the first addition as well as the
+   doublings of the neutral element.  */
+static void
+point_accumulate (mpi_point_t result, mpi_point_t point, int *started,
+                  mpi_ec_t ctx)
+{
+  if (*started)
+    _gcry_mpi_ec_add_points (result, result, point, ctx);
+  else
+    {
+      point_set (result, point);
+      if (ctx->model == MPI_EC_EDWARDS)
+        mpi_point_resize (result, ctx);
+      *started = 1;
+    }
+}
+
+
+/* RESULT += the sum of the table entries of COMB selected by column
+   J of the public SCALAR.  ENTRY is used as scratch space.  */
+static void
+comb_accumulate (mpi_point_t result, mpi_point_t entry, mpi_ec_comb_t comb,
+                 gcry_mpi_t scalar, int j, int *started, mpi_ec_t ctx)
+{
+  unsigned long idx;
+  unsigned int i;
+
+  if (j >= comb->spacing)
+    return;
+
+  idx = 0;
+  for (i = 0; i < comb->teeth; i++)
+    idx |= (unsigned long)mpi_test_bit (scalar, i * comb->spacing + j) << i;
+  /* Entry 0 stands for the neutral element.  */
+  if (idx)
+    {
+      comb_load (entry, comb, idx, ctx);
+      point_accumulate (result, entry, started, ctx);
+    }
+}
+
+
+/* RESULT = SCALAR1 * POINT1 + SCALAR2 * POINT2 for non-negative
+   scalars using their width-w NAFs and tables of the odd multiples of
+   the points.  Both products share the doublings.  SCALAR2 may be
+   NULL to compute only the first product.  If COMB1 is not NULL, it
+   is the comb table for POINT1 and SCALAR1 is not longer than
+   COMB1->NBITS; the columns of SCALAR1 are then added from COMB1
+   instead of using a wNAF.  COMB2 does the same for POINT2.  The
+   sequence of point operations depends on the scalars; thus this must
+   only be used for public scalars.  */
+static void
+ec_mul_point_wnaf (mpi_point_t result,
+                   gcry_mpi_t scalar1, mpi_point_t point1, mpi_ec_comb_t comb1,
+                   gcry_mpi_t scalar2, mpi_point_t point2, mpi_ec_comb_t comb2,
+                   mpi_ec_t ctx)
+{
+  struct wnaf_s wn1, wn2;
+  mpi_point_struct entry;
+  unsigned int len = 0;
+  int j;
+  int started = 0;
+
+  /* Everything is read from the points before RESULT is written, so
+     that RESULT may be one of them.  */
+  point_init (&entry);
+  if (comb1 || comb2)
+    {
+      mpi_resize (entry.x, ctx->p->nlimbs);
+      mpi_resize (entry.y, ctx->p->nlimbs);
+      mpi_set_ui (entry.z, 1);
+      if (ctx->model == MPI_EC_EDWARDS)
+        mpi_point_resize (&entry, ctx);
+    }
+  if (comb1)
+    len = comb1->spacing;
+  else
+    {
+      wnaf_init (&wn1, scalar1, point1, ctx);
+      len = wn1.len;
+    }
+  if (comb2)
+    {
+      if (comb2->spacing > len)
+        len = comb2->spacing;
+    }
+  else if (scalar2)
+    {
+      wnaf_init (&wn2, scalar2, point2, ctx);
+      if (wn2.len > len)
+        len = wn2.len;
+    }
+
+  for (j = (int)len - 1; j >= 0; j--)
+    {
+      if (started)
+        _gcry_mpi_ec_dup_point (result, result, ctx);
+
+      if (comb1)
+        comb_accumulate (result, &entry, comb1, scalar1, j, &started, ctx);
+      else if (j < wn1.len && wn1.naf[j])
+        point_accumulate (result, wnaf_entry (&wn1, wn1.naf[j]),
+                          &started, ctx);
+
+      if (comb2)
+        comb_accumulate (result, &entry, comb2, scalar2, j, &started, ctx);
+      else if (scalar2 && j < wn2.len && wn2.naf[j])
+        point_accumulate (result, wnaf_entry (&wn2, wn2.naf[j]),
+                          &started, ctx);
+    }
+
+  if (!started)
+    {
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          mpi_set_ui (result->x, 1);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 0);
+        }
+      else
+        {
+          mpi_set_ui (result->x, 0);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 1);
+          mpi_point_resize (result, ctx);
+        }
+    }
+
+  if (!comb1)
+    wnaf_free (&wn1);
+  if (scalar2 && !comb2)
+    wnaf_free (&wn2);
+  point_free (&entry);
+}
+
+
+/* RESULT = SCALAR1 * POINT1 + SCALAR2 * POINT2.  This is the core
+   operation of signature verification.  For public scalars the two
+   products are computed in a single pass and the comb table of the
+   base point is used if POINT1 is the base point.  Likewise the table
+   created by _gcry_mpi_ec_precompute_key is used if POINT2 is the
+   public key.  */
+void
+_gcry_mpi_ec_mul_point2 (mpi_point_t result,
+                         gcry_mpi_t scalar1, mpi_point_t point1,
+                         gcry_mpi_t scalar2, mpi_point_t point2,
+                         mpi_ec_t ctx)
+{
+  mpi_point_struct tmp1, tmp2;
+  mpi_ec_comb_t comb1, comb2;
+
+  if (ctx->model != MPI_EC_MONTGOMERY
+      && !mpi_is_opaque (scalar1) && !mpi_has_sign (scalar1)
+      && !mpi_is_secure (scalar1)
+      && !mpi_is_opaque (scalar2) && !mpi_has_sign (scalar2)
+      && !mpi_is_secure (scalar2))
+    {
+      comb1 = ec_get_base_comb (ctx);
+      if (comb1 && (!comb_base_p (comb1, point1)
+                    || mpi_get_nbits (scalar1) > comb1->nbits))
+        comb1 = NULL;
+      comb2 = ctx->t.key_comb;
+      if (comb2 && (!comb_base_p (comb2, point2)
+                    || mpi_get_nbits (scalar2) > comb2->nbits))
+        comb2 = NULL;
+
+      ec_mul_point_wnaf (result, scalar1, point1, comb1,
+                         scalar2, point2, comb2, ctx);
+      return;
+    }
+
+  point_init (&tmp1);
+  point_init (&tmp2);
+  _gcry_mpi_ec_mul_point (&tmp1, scalar1, point1, ctx);
+  _gcry_mpi_ec_mul_point (&tmp2, scalar2, point2, ctx);
+  _gcry_mpi_ec_add_points (result, &tmp1, &tmp2, ctx);
+  point_free (&tmp1);
+  point_free (&tmp2);
+}
+
+
+/* Maximum window width of the bucket method.  */
+#define MSM_MAX_WINDOW 12
+
+/* RESULT = SCALARS[0] * POINTS[0] + ... + SCALARS[COUNT-1] *
+   POINTS[COUNT-1] using the bucket method of Pippenger: The scalars
+   are recoded to signed digits of C bits.  For each digit position,
+   every point is added to or subtracted from the bucket selected by
+   the absolute value of its digit, and the buckets are then summed up
+   weighted with their digits using running sums.  The scalars must be
+   non-negative and public.  RESULT must not be one of POINTS.  */
+void
+_gcry_mpi_ec_mul_points (mpi_point_t result, unsigned int count,
+                         gcry_mpi_t *scalars, mpi_point_t *points,
+                         mpi_ec_t ctx)
+{
+  mpi_point_struct *buckets, *negpoints;
+  mpi_point_struct running, sum;
+  int *used, *digits;
+  unsigned int nbits, c, k, i, nwin, nbuckets;
+  unsigned long cost, best;
+  int j, d, carry, started, run_started, sum_started;
+
+  nbits = 0;
+  for (i = 0; i < count; i++)
+    if (mpi_get_nbits (scalars[i]) > nbits)
+      nbits = mpi_get_nbits (scalars[i]);
+
+  /* With windows of C bits each scalar of N bits takes about (N+1)/C
+     additions to fill the buckets, and each of the (NBITS+1)/C
+     windows takes two additions per bucket to sum them up.  */
+  c = 1;
+  best = ~0UL;
+  for (k = 1; k <= MSM_MAX_WINDOW; k++)
+    {
+      cost = (unsigned long)(nbits + k) / k << k;
+      for (i = 0; i < count; i++)
+        cost += (mpi_get_nbits (scalars[i]) + k) / k;
+      if (cost < best)
+        {
+          best = cost;
+          c = k;
+        }
+    }
+  nwin = (nbits + c) / c;
+  nbuckets = 1 << (c - 1);
+
+  /* Recode the scalars to digits in [-2^(C-1), 2^(C-1)].  */
+  digits = xmalloc (count * nwin * sizeof *digits);
+  for (i = 0; i < count; i++)
+    {
+      carry = 0;
+      for (j = 0; j < nwin; j++)
+        {
+          d = carry;
+          for (k = 0; k < c; k++)
+            d += mpi_test_bit (scalars[i], j * c + k) << k;
+          carry = d > (1 << (c - 1));
+          digits[i * nwin + j] = d - (carry << c);
+        }
+    }
+
+  negpoints = xmalloc (count * sizeof *negpoints);
+  for (i = 0; i < count; i++)
+    {
+      point_init (&negpoints[i]);
+      point_set (&negpoints[i], points[i]);
+      if (ctx->model == MPI_EC_EDWARDS)
+        {
+          mpi_point_resize (&negpoints[i], ctx);
+          ctx->subm (negpoints[i].x, ctx->p, points[i]->x, ctx);
+        }
+      else
+        ctx->subm (negpoints[i].y, ctx->p, points[i]->y, ctx);
+    }
+
+  buckets = xmalloc (nbuckets * sizeof *buckets);
+  used = xmalloc (nbuckets * sizeof *used);
+  for (k = 0; k < nbuckets; k++)
+    point_init (&buckets[k]);
+  point_init (&running);
+  point_init (&sum);
+
+  started = 0;
+  for (j = nwin - 1; j >= 0; j--)
+    {
+      if (started)
+        for (k = 0; k < c; k++)
+          _gcry_mpi_ec_dup_point (result, result, ctx);
+
+      memset (used, 0, nbuckets * sizeof *used);
+      for (i = 0; i < count; i++)
+        {
+          d = digits[i * nwin + j];
+          if (d > 0)
+            point_accumulate (&buckets[d-1], points[i], &used[d-1], ctx);
+          else if (d < 0)
+            point_accumulate (&buckets[-d-1], &negpoints[i], &used[-d-1],
+                              ctx);
+        }
+
+      /* SUM = 1·BUCKETS[0] + 2·BUCKETS[1] + ... as the sum of the
+         running sums from the top bucket down.  */
+      run_started = sum_started = 0;
+      for (k = nbuckets; k > 0; k--)
+        {
+          if (used[k-1])
+            point_accumulate (&running, &buckets[k-1], &run_started, ctx);
+          if (run_started)
+            point_accumulate (&sum, &running, &sum_started, ctx);
+        }
+      if (sum_started)
+        point_accumulate (result, &sum, &started, ctx);
+    }
+
+  if (!started)
+    {
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          mpi_set_ui (result->x, 1);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 0);
+        }
+      else
+        {
+          mpi_set_ui (result->x, 0);
+          mpi_set_ui (result->y, 1);
+          mpi_set_ui (result->z, 1);
+          mpi_point_resize (result, ctx);
+        }
+    }
+
+  point_free (&sum);
+  point_free (&running);
+  for (k = 0; k < nbuckets; k++)
+    point_free (&buckets[k]);
+  for (i = 0; i < count; i++)
+    point_free (&negpoints[i]);
+  xfree (buckets);
+  xfree (used);
+  xfree (negpoints);
+  xfree (digits);
+}
+
+
+/* Window width of the constant-time method.  */
+#define CT_WINDOW 5
+
+/* Load the entry for the odd digit D from the table TAB of
+   ec_mul_point_window into POINT.  The table holds the projective
+   coordinates of NENTRIES points, each coordinate NLIMBS limbs long.
+   All entries are accessed and POINT is negated if D is negative
+   without any branch depending on D.  TMP is scratch space of NLIMBS
+   limbs.  */
+static void
+window_lookup (mpi_point_t point, mpi_limb_t *tab, unsigned int nentries,
+               int d, mpi_ptr_t tmp, mpi_ec_t ctx)
+{
+  mpi_size_t nlimbs = ctx->p->nlimbs;
+  unsigned int neg = (unsigned int)d >> (8 * sizeof (int) - 1);
+  unsigned int idx = (((unsigned int)d ^ (0U - neg)) + neg) >> 1;
+  gcry_mpi_t c;
+
+  mpih_lookup_cond (point->x->d, tab, nlimbs, nentries, idx);
+  mpih_lookup_cond (point->y->d, tab + nentries * nlimbs,
+                    nlimbs, nentries, idx);
+  mpih_lookup_cond (point->z->d, tab + 2 * nentries * nlimbs,
+                    nlimbs, nentries, idx);
+
+  /* -(x,y,z) is (x,-y,z) for Weierstrass and (-x,y,z) for Edwards
+     curves.  */
+  c = ctx->model == MPI_EC_EDWARDS? point->x : point->y;
+  _gcry_mpih_sub_n (tmp, ctx->p->d, c->d, nlimbs);
+  mpih_set_cond (c->d, tmp, nlimbs, neg);
+
+  point->x->nlimbs = nlimbs;
+  point->y->nlimbs = nlimbs;
+  point->z->nlimbs = nlimbs;
+  if (ctx->model != MPI_EC_EDWARDS)
+    {
+      /* The generic field functions want normalized input.  */
+      MPN_NORMALIZE (point->x->d, point->x->nlimbs);
+      MPN_NORMALIZE (point->y->d, point->y->nlimbs);
+      MPN_NORMALIZE (point->z->d, point->z->nlimbs);
+    }
+}
+
+
+/* RESULT = SCALAR * POINT for a secret SCALAR of up to NBITS bits
+   using a fixed window of signed odd digits.  With K = SCALAR | 1 the
+   digits are
+
+     d_i = ((K >> wi) mod 2^(w+1) | 1) - 2^w
+
+   for all but the last and the last one is (K >> wi) | 1 (see Joye
+   and Tunstall, "Exponent recoding and regular exponentiation
+   algorithms", 2009).  All digits are odd, so that the table holds
+   only the odd multiples of POINT and every window takes exactly W
+   doublings and one addition.  The result for an even SCALAR is
+   fixed up by a final conditional subtraction of POINT.  The sequence
+   of point operations and table accesses does not depend on the value
+   of SCALAR.  The first entry of the table is POINT itself, which is
+   affine for the base point and for decoded points; the additions
+   thus use ec_add_points_ct, which must never skip work for a Z
+   coordinate of one.  */
+static void
+ec_mul_point_window (mpi_point_t result, gcry_mpi_t scalar,
+                     mpi_point_t point, unsigned int nbits, mpi_ec_t ctx)
+{
+  const unsigned int w = CT_WINDOW;
+  const unsigned int nentries = 1 << (w - 1);
+  mpi_size_t nlimbs = ctx->p->nlimbs;
+  mpi_point_struct entry, twice, tmppnt;
+  mpi_limb_t *tab, *tmp;
+  unsigned int ndigits, i, j, word;
+  unsigned long odd;
+  gcry_mpi_t c[3];
+  int d;
+
+  tab = xcalloc (3 * nentries * nlimbs + nlimbs, sizeof *tab);
+  tmp = tab + 3 * nentries * nlimbs;
+
+  point_init (&entry);
+  point_init (&twice);
+  point_init (&tmppnt);
+  mpi_resize (entry.x, nlimbs);
+  mpi_resize (entry.y, nlimbs);
+  mpi_resize (entry.z, nlimbs);
+  point_set (&tmppnt, point);
+  if (ctx->model == MPI_EC_EDWARDS)
+    {
+      mpi_point_resize (&tmppnt, ctx);
+      mpi_point_resize (&twice, ctx);
+      mpi_point_resize (result, ctx);
+    }
+
+  /* TAB[J] = (2J+1)·POINT.  */
+  _gcry_mpi_ec_dup_point (&twice, &tmppnt, ctx);
+  for (j = 0; j < nentries; j++)
+    {
+      if (j)
+        _gcry_mpi_ec_add_points (&tmppnt, &tmppnt, &twice, ctx);
+      c[0] = tmppnt.x;
+      c[1] = tmppnt.y;
+      c[2] = tmppnt.z;
+      for (i = 0; i < 3; i++)
+        {
+          if (c[i]->nlimbs > nlimbs)
+            log_bug ("ec_mul_point_window: coordinate not reduced\n");
+          MPN_COPY (tab + (i * nentries + j) * nlimbs, c[i]->d, c[i]->nlimbs);
+        }
+    }
+
+  odd = mpi_test_bit (scalar, 0);
+  ndigits = (nbits + w - 1) / w;
+  if (!ndigits)
+    ndigits = 1;
+
+  /* The most significant digit is positive.  */
+  word = 1;
+  for (i = 0; i < w; i++)
+    word |= mpi_test_bit (scalar, (ndigits - 1) * w + i) << i;
+  mpi_resize (result->x, nlimbs);
+  mpi_resize (result->y, nlimbs);
+  mpi_resize (result->z, nlimbs);
+  window_lookup (result, tab, nentries, word, tmp, ctx);
+
+  for (j = ndigits - 1; j-- > 0; )
+    {
+      for (i = 0; i < w; i++)
+        _gcry_mpi_ec_dup_point (result, result, ctx);
+
+      word = 1;
+      for (i = 1; i <= w; i++)
+        word |= mpi_test_bit (scalar, j * w + i) << i;
+      d = (int)word - (1 << w);
+      window_lookup (&entry, tab, nentries, d, tmp, ctx);
+      ec_add_points_ct (result, result, &entry, ctx);
+    }
+
+  /* Subtract POINT if SCALAR is even.  */
+  window_lookup (&entry, tab, nentries, -1, tmp, ctx);
+  ec_add_points_ct (&tmppnt, result, &entry, ctx);
+  mpi_point_resize (result, ctx);
+  mpi_point_resize (&tmppnt, ctx);
+  point_swap_cond (result, &tmppnt, !odd, ctx);
+
+  point_free (&entry);
+  point_free (&twice);
+  point_free (&tmppnt);
+  xfree (tab);
+}
+
+
+#ifdef USE_FE25519_51
+/* RESULT = SCALAR * POINT for Curve25519 using the radix 2^51 code
+   of ec-ed25519.c.  The clamping of an opaque SCALAR is the same as
+   in _gcry_mpi_ec_mul_point.  Returns false if the generic code needs
+   to be used because the curve is not Curve25519 or SCALAR or POINT do
+   not fit into 32 bytes.  */
+static int
+mul_point_x25519 (mpi_point_t result, gcry_mpi_t scalar, mpi_point_t point,
+                  mpi_ec_t ctx)
+{
+  mpi_limb_t a24 = 121665;
+  unsigned char k[32], u[32];
+  const unsigned char *raw;
+  unsigned int n;
+  int inf;
+
+  if (ctx->mulm != ec_mulm_25519 || !limbs_equal_p (ctx->a, &a24, 1)
+      || ctx->h != 8)
+    return 0;
+  if (!_gcry_mpi_ec_get_le32 (u, point->x) || (u[31] & 0x80))
+    return 0;
+
+  if (mpi_is_opaque (scalar))
+    {
+      raw = mpi_get_opaque (scalar, &n);
+      if ((n+7)/8 != 32)
+        return 0;
+      memcpy (k, raw, 32);
+      k[31] &= 0x7f;
+      k[31] |= 0x40;
+      k[0] &= 256 - ctx->h;
+    }
+  else if (!_gcry_mpi_ec_get_le32 (k, scalar))
+    return 0;
+
+  inf = _gcry_mpi_ec_x25519 (u, k, u);
+  wipememory (k, sizeof k);
+
+  mpi_clear (result->y);
+  if (inf)
+    {
+      mpi_set_ui (result->x, 1);
+      mpi_set_ui (result->z, 0);
+    }
+  else
+    {
+      reverse_buffer (u, 32);
+      _gcry_mpi_set_buffer (result->x, u, 32, 0);
+      mpi_set_ui (result->z, 1);
+    }
+  return 1;
+}
+#endif /*USE_FE25519_51*/
+
+
 /* Scalar point multiplication - the main function for ECC.  If takes
    an integer SCALAR and a POINT as well as the usual context CTX.
    RESULT will be set to the resulting point. */
@@ -1633,6 +3119,26 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
   unsigned int i, loops;
   mpi_point_struct p1, p2, p1inv;
 
+  if (ctx->model != MPI_EC_MONTGOMERY
+      && !mpi_is_opaque (scalar) && !mpi_has_sign (scalar))
+    {
+      mpi_ec_comb_t comb = ec_get_base_comb (ctx);
+
+      if (comb && comb_base_p (comb, point)
+          && mpi_get_nbits (scalar) <= comb->nbits)
+        {
+          ec_mul_point_comb (result, scalar, comb, ctx);
+          return;
+        }
+
+      if (!mpi_is_secure (scalar))
+        {
+          ec_mul_point_wnaf (result, scalar, point, NULL,
+                             NULL, NULL, NULL, ctx);
+          return;
+        }
+    }
+
   if (ctx->model == MPI_EC_EDWARDS
       || (ctx->model == MPI_EC_WEIERSTRASS
           && mpi_is_secure (scalar)))
@@ -1669,18 +3175,7 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
         {
           /* If SCALAR is in secure memory we assume that it is the
              secret key we use constant time operation.  */
-          mpi_point_struct tmppnt;
-
-          point_init (&tmppnt);
-          mpi_point_resize (result, ctx);
-          mpi_point_resize (&tmppnt, ctx);
-          for (j=nbits-1; j >= 0; j--)
-            {
-              _gcry_mpi_ec_dup_point (result, result, ctx);
-              _gcry_mpi_ec_add_points (&tmppnt, result, point, ctx);
-              point_swap_cond (result, &tmppnt, mpi_test_bit (scalar, j), ctx);
-            }
-          point_free (&tmppnt);
+          ec_mul_point_window (result, scalar, point, nbits, ctx);
         }
       else
         {
@@ -1709,6 +3204,11 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
       mpi_size_t rsize;
       int scalar_copied = 0;
 
+#ifdef USE_FE25519_51
+      if (mul_point_x25519 (result, scalar, point, ctx))
+        return;
+#endif
+
       /* Compute scalar point multiplication with Montgomery Ladder.
          Note that we don't use Y-coordinate in the points at all.
          RESULT->Y will be filled by zero.  */
@@ -0,0 +1,115 @@
+/* mpih-mont.c  -  MPI helper functions for Montgomery multiplication
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mpi-internal.h"
+#include "longlong.h"
+
+
+/* Montgomery multiplication using the coarsely integrated operand
+ * scanning (CIOS) method:
+ *
+ *   RES_PTR = U * V / B^SIZE  mod M
+ *
+ * where B is the limb base and M_INV = -M^-1 mod B.  U and V must be
+ * less than M, which must be odd.  The SIZE low limbs of the result
+ * are stored at RES_PTR and the high limb (0 or 1) is returned; the
+ * full result is less than 2 * M.  RES_PTR must not overlap with any
+ * of the inputs.
+ */
+mpi_limb_t
+_gcry_mpih_mont_mul (mpi_ptr_t res_ptr, mpi_ptr_t u_ptr, mpi_ptr_t v_ptr,
+                     mpi_ptr_t m_ptr, mpi_size_t size, mpi_limb_t m_inv)
+{
+  mpi_limb_t top_limb;
+  mpi_limb_t v_limb, q_limb;
+  mpi_limb_t cy1, cy2;
+  mpi_limb_t prod_high, prod_low, x;
+  mpi_size_t i, j;
+
+  MPN_ZERO (res_ptr, size);
+  top_limb = 0;
+
+  for (i = 0; i < size; i++)
+    {
+      v_limb = v_ptr[i];
+
+      /* T += U * V[i]; Q = T[0] * M_INV; T = (T + Q * M) / B  */
+      umul_ppmm (prod_high, prod_low, u_ptr[0], v_limb);
+      x = res_ptr[0] + prod_low;
+      cy1 = prod_high + (x < prod_low);
+      q_limb = x * m_inv;
+      umul_ppmm (prod_high, prod_low, m_ptr[0], q_limb);
+      prod_low += x;
+      cy2 = prod_high + (prod_low < x);
+
+      for (j = 1; j < size; j++)
+        {
+          umul_ppmm (prod_high, prod_low, u_ptr[j], v_limb);
+          prod_low += cy1;
+          prod_high += prod_low < cy1;
+          x = res_ptr[j] + prod_low;
+          cy1 = prod_high + (x < prod_low);
+
+          umul_ppmm (prod_high, prod_low, m_ptr[j], q_limb);
+          prod_low += cy2;
+          prod_high += prod_low < cy2;
+          x += prod_low;
+          cy2 = prod_high + (x < prod_low);
+          res_ptr[j - 1] = x;
+        }
+
+      x = cy1 + cy2;
+      cy1 = x < cy2;
+      x += top_limb;
+      cy1 += x < top_limb;
+      res_ptr[size - 1] = x;
+      top_limb = cy1;
+    }
+
+  return top_limb;
+}
+
+
+/* Montgomery squaring:
+ *
+ *   RES_PTR = U * U / B^SIZE  mod M
+ *
+ * with the same conventions as _gcry_mpih_mont_mul, except that
+ * RES_PTR must have room for 2 * SIZE limbs.  The square is computed
+ * by _gcry_mpih_sqr_n_basecase and then reduced one limb at a time
+ * (REDC).
+ */
+mpi_limb_t
+_gcry_mpih_mont_sqr (mpi_ptr_t res_ptr, mpi_ptr_t u_ptr, mpi_ptr_t m_ptr,
+                     mpi_size_t size, mpi_limb_t m_inv)
+{
+  mpi_size_t i;
+
+  _gcry_mpih_sqr_n_basecase (res_ptr, u_ptr, size);
+
+  /* Clear one limb per step; the carry out of each step is kept in
+   * the limb which has just been cleared and added at the end.  */
+  for (i = 0; i < size; i++)
+    res_ptr[i] = _gcry_mpih_addmul_1 (res_ptr + i, m_ptr, size,
+                                      res_ptr[i] * m_inv);
+
+  return _gcry_mpih_add_n (res_ptr, res_ptr + size, res_ptr, size);
+}
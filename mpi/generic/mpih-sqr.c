@@ -0,0 +1,66 @@
+/* mpih-sqr.c  -  MPI helper functions for squaring
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mpi-internal.h"
+#include "longlong.h"
+
+
+/* Square U_PTR of SIZE limbs into the 2 * SIZE limbs at PROD_PTR,
+ * which must not overlap with U_PTR.  Each cross product U[i] * U[j]
+ * with i < j is computed only once; their sum is then doubled and
+ * the squares U[i]^2 are added on the diagonal.  This takes about
+ * half of the limb multiplications of a general multiplication.
+ */
+void
+_gcry_mpih_sqr_n_basecase (mpi_ptr_t prod_ptr, mpi_ptr_t u_ptr,
+                           mpi_size_t size)
+{
+  mpi_limb_t cy_limb;
+  mpi_limb_t prod_high, prod_low;
+  mpi_size_t i;
+
+  /* Sum of U[i] * U[j] * B^(i+j) for i < j.  */
+  prod_ptr[0] = 0;
+  prod_ptr[2 * size - 1] = 0;
+  if (size > 1)
+    {
+      prod_ptr[size] = _gcry_mpih_mul_1 (prod_ptr + 1, u_ptr + 1, size - 1,
+                                         u_ptr[0]);
+      for (i = 1; i < size - 1; i++)
+        prod_ptr[size + i] = _gcry_mpih_addmul_1 (prod_ptr + 2 * i + 1,
+                                                  u_ptr + i + 1,
+                                                  size - i - 1, u_ptr[i]);
+    }
+
+  /* Double it and add the squares U[i]^2 * B^(2i).  */
+  _gcry_mpih_lshift (prod_ptr, prod_ptr, 2 * size, 1);
+  cy_limb = 0;
+  for (i = 0; i < size; i++)
+    {
+      umul_ppmm (prod_high, prod_low, u_ptr[i], u_ptr[i]);
+      prod_low += cy_limb;
+      prod_high += prod_low < cy_limb;
+      prod_ptr[2 * i] += prod_low;
+      prod_high += prod_ptr[2 * i] < prod_low;
+      prod_ptr[2 * i + 1] += prod_high;
+      cy_limb = prod_ptr[2 * i + 1] < prod_high;
+    }
+}
@@ -67,6 +67,33 @@
 #define KARATSUBA_THRESHOLD 2
 #endif
 
+/* Squaring uses a basecase of its own which is faster than a
+ * multiplication; thus Karatsuba's algorithm pays off later.  */
+#ifndef KARATSUBA_SQR_THRESHOLD
+#define KARATSUBA_SQR_THRESHOLD 32
+#endif
+#if KARATSUBA_SQR_THRESHOLD < 2
+#undef KARATSUBA_SQR_THRESHOLD
+#define KARATSUBA_SQR_THRESHOLD 32
+#endif
+
+/* The sizes in limbs from which on Toom-Cook 3-way multiplication and
+ * squaring are used.  "pkbench --toom3-sweep" determines them for the
+ * build machine.  */
+#ifndef TOOM3_MUL_THRESHOLD
+#define TOOM3_MUL_THRESHOLD 128
+#endif
+#ifndef TOOM3_SQR_THRESHOLD
+#define TOOM3_SQR_THRESHOLD 128
+#endif
+
+/* The size in limbs of the modulus from which on Montgomery products
+ * are computed as a full product followed by a separate reduction, so
+ * that Karatsuba and Toom-3 are used.  */
+#ifndef MONT_REDC_THRESHOLD
+#define MONT_REDC_THRESHOLD 20
+#endif
+
 
 typedef mpi_limb_t *mpi_ptr_t; /* pointer to a limb */
 typedef int mpi_size_t;        /* (must be a signed type) */
@@ -128,14 +155,6 @@ typedef int mpi_size_t;        /* (must be a signed type) */
 	}				    \
     } while(0)
 
-#define MPN_MUL_N_RECURSE(prodp, up, vp, size, tspace) \
-    do {						\
-	if( (size) < KARATSUBA_THRESHOLD )		\
-	    mul_n_basecase (prodp, up, vp, size);	\
-	else						\
-	    mul_n (prodp, up, vp, size, tspace);	\
-    } while (0);
-
 
 /* Divide the two-limb number in (NH,,NL) by D, with DI being the largest
  * limb not larger than (2**(2*BITS_PER_MP_LIMB))/D - (2**BITS_PER_MP_LIMB).
@@ -224,7 +243,6 @@ void _gcry_mpih_mul_n( mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
 						   mpi_size_t size);
 mpi_limb_t _gcry_mpih_mul( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t usize,
 					 mpi_ptr_t vp, mpi_size_t vsize);
-void _gcry_mpih_sqr_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size );
 void _gcry_mpih_sqr_n( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size,
 						mpi_ptr_t tspace);
 
@@ -232,12 +250,42 @@ void _gcry_mpih_mul_karatsuba_case( mpi_ptr_t prodp,
 				 mpi_ptr_t up, mpi_size_t usize,
 				 mpi_ptr_t vp, mpi_size_t vsize,
 				 struct karatsuba_ctx *ctx );
+mpi_size_t _gcry_mpih_mul_n_tspace (mpi_size_t size);
+mpi_size_t _gcry_mpih_sqr_n_tspace (mpi_size_t size);
+void _gcry_mpih_mul_n_recurse (mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
+                               mpi_size_t size, mpi_ptr_t tspace);
+void _gcry_mpih_sqr_n_recurse (mpi_ptr_t prodp, mpi_ptr_t up,
+                               mpi_size_t size, mpi_ptr_t tspace);
+
 
+/*-- mpiutil.c --*/
+/* True if the AMD64 limb functions shall use the BMI2 and ADX
+ * instructions.  This is read by the assembler code.  */
+extern int _gcry_mpih_use_adx;
 
 /*-- mpih-mul_1.c (or xxx/cpu/ *.S) --*/
 mpi_limb_t _gcry_mpih_mul_1( mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
 			  mpi_size_t s1_size, mpi_limb_t s2_limb);
 
+#ifdef HAVE_MPIH_ADDMUL_4
+/*-- amd64/mpih-mul2.S --*/
+/* Only to be used if _gcry_mpih_use_adx is set.  */
+void _gcry_mpih_addmul_4 (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                          mpi_size_t s1_size, mpi_ptr_t s2_ptr);
+#endif
+
+/*-- mpih-mont.c (or xxx/cpu/ *.S) --*/
+mpi_limb_t _gcry_mpih_mont_mul (mpi_ptr_t res_ptr, mpi_ptr_t u_ptr,
+                                mpi_ptr_t v_ptr, mpi_ptr_t m_ptr,
+                                mpi_size_t size, mpi_limb_t m_inv);
+mpi_limb_t _gcry_mpih_mont_sqr (mpi_ptr_t res_ptr, mpi_ptr_t u_ptr,
+                                mpi_ptr_t m_ptr, mpi_size_t size,
+                                mpi_limb_t m_inv);
+
+/*-- mpih-sqr.c (or xxx/cpu/ *.S) --*/
+void _gcry_mpih_sqr_n_basecase (mpi_ptr_t prodp, mpi_ptr_t up,
+                                mpi_size_t size);
+
 /*-- mpih-div.c --*/
 mpi_limb_t _gcry_mpih_mod_1(mpi_ptr_t dividend_ptr, mpi_size_t dividend_size,
 						 mpi_limb_t divisor_limb);
@@ -260,6 +308,8 @@ mpi_limb_t _gcry_mpih_rshift( mpi_ptr_t wp, mpi_ptr_t up, mpi_size_t usize,
 #define mpih_sub_n_cond(w,u,v,s,o) _gcry_mpih_sub_n_cond ((w),(u),(v),(s),(o))
 #define mpih_swap_cond(u,v,s,o) _gcry_mpih_swap_cond ((u),(v),(s),(o))
 #define mpih_abs_cond(w,u,s,o) _gcry_mpih_abs_cond ((w),(u),(s),(o))
+#define mpih_lookup_cond(w,t,s,n,i) \
+  _gcry_mpih_lookup_cond ((w),(t),(s),(n),(i))
 #define mpih_mod(v,vs,u,us) _gcry_mpih_mod ((v),(vs),(u),(us))
 
 void _gcry_mpih_set_cond (mpi_ptr_t wp, mpi_ptr_t up, mpi_size_t usize,
@@ -272,6 +322,8 @@ void _gcry_mpih_swap_cond (mpi_ptr_t up, mpi_ptr_t vp, mpi_size_t usize,
                            unsigned long op_enable);
 void _gcry_mpih_abs_cond (mpi_ptr_t wp, mpi_ptr_t up,
                           mpi_size_t usize, unsigned long op_enable);
+void _gcry_mpih_lookup_cond (mpi_ptr_t wp, mpi_ptr_t table, mpi_size_t usize,
+                             unsigned int nents, unsigned long idx);
 mpi_ptr_t _gcry_mpih_mod (mpi_ptr_t vp, mpi_size_t vsize,
                           mpi_ptr_t up, mpi_size_t usize);
 int _gcry_mpih_cmp_ui (mpi_ptr_t up, mpi_size_t usize, unsigned long v);
@@ -24,82 +24,254 @@
 #include "g10lib.h"
 
 /*
- * This uses a modular inversion algorithm designed by Niels Möller
- * which was implemented in Nettle.  The same algorithm was later also
- * adapted to GMP in mpn_sec_invert.
+ * The inversion modulo an odd number uses the "safegcd" algorithm by
+ * Daniel J. Bernstein and Bo-Yin Yang:
+ *   "Fast constant-time gcd computation and modular inversion",
+ *   https://eprint.iacr.org/2019/266
  *
- * For the description of the algorithm, see Algorithm 5 in Appendix A
- * of "Fast Software Polynomial Multiplication on ARM Processors using
- * the NEON Engine" by Danilo Câmara, Conrado P. L. Gouvêa, Julio
- * López, and Ricardo Dahab:
- *   https://hal.inria.fr/hal-01506572/document
- *
- * Note that in the reference above, at the line 2 of Algorithm 5,
- * initial value of V was described as V:=1 wrongly.  It must be V:=0.
+ * Batches of 62 divsteps are run on the low 64 bits of F and G only.
+ * The resulting transition matrix, scaled by 2^62, is then applied to
+ * the full values of F and G and to the coefficients D and E, which
+ * satisfy D * A = F and E * A = G modulo N.  The number of divsteps
+ * only depends on the size of N, so that the whole computation runs
+ * in constant time.  The multi-precision values are kept in two's
+ * complement with LIMBS_PER_U64 limbs in addition to the size of N.
  */
-static mpi_ptr_t
-mpih_invm_odd (mpi_ptr_t ap, mpi_ptr_t np, mpi_size_t nsize)
+
+#if BITS_PER_MPI_LIMB == 64
+# define LIMBS_PER_U64 1
+#elif BITS_PER_MPI_LIMB == 32
+# define LIMBS_PER_U64 2
+#else
+# error please define LIMBS_PER_U64 for this limb size
+#endif
+
+#define SAFEGCD_STEPS 62
+#define SAFEGCD_MASK ((U64_C(1) << SAFEGCD_STEPS) - 1)
+
+
+/* Return the low 64 bits of UP.  */
+static u64
+safegcd_get_u64 (mpi_ptr_t up)
 {
-  int secure;
-  unsigned int iterations;
-  mpi_ptr_t n1hp;
-  mpi_ptr_t bp;
-  mpi_ptr_t up, vp;
+#if LIMBS_PER_U64 == 1
+  return up[0];
+#else
+  return (u64)up[0] | ((u64)up[1] << BITS_PER_MPI_LIMB);
+#endif
+}
 
-  secure = _gcry_is_secure (ap);
-  up = mpi_alloc_limb_space (nsize, secure);
-  MPN_ZERO (up, nsize);
-  up[0] = 1;
 
-  vp = mpi_alloc_limb_space (nsize, secure);
-  MPN_ZERO (vp, nsize);
+/* W = U * V modulo B^SIZE.  W and U must not overlap.  */
+static void
+safegcd_mul_u64 (mpi_ptr_t wp, mpi_ptr_t up, mpi_size_t size, u64 v)
+{
+#if LIMBS_PER_U64 == 1
+  _gcry_mpih_mul_1 (wp, up, size, v);
+#else
+  _gcry_mpih_mul_1 (wp, up, size, (mpi_limb_t)v);
+  _gcry_mpih_addmul_1 (wp + 1, up, size - 1,
+                       (mpi_limb_t)(v >> BITS_PER_MPI_LIMB));
+#endif
+}
 
-  secure = _gcry_is_secure (np);
-  bp = mpi_alloc_limb_space (nsize, secure);
-  MPN_COPY (bp, np, nsize);
 
-  n1hp = mpi_alloc_limb_space (nsize, secure);
-  MPN_COPY (n1hp, np, nsize);
-  _gcry_mpih_rshift (n1hp, n1hp, nsize, 1);
-  _gcry_mpih_add_1 (n1hp, n1hp, nsize, 1);
+/* W = U * S + V * T modulo B^SIZE, where S and T are signed values
+ * with an absolute value of at most 2^62 and U and V are in two's
+ * complement.  TP is used as scratch space of SIZE limbs.  */
+static void
+safegcd_lincomb (mpi_ptr_t wp, mpi_ptr_t up, u64 s, mpi_ptr_t vp, u64 t,
+                 mpi_ptr_t tp, mpi_size_t size)
+{
+  u64 s_neg = s >> 63;
+  u64 t_neg = t >> 63;
+
+  safegcd_mul_u64 (wp, up, size, (s ^ (0 - s_neg)) + s_neg);
+  mpih_abs_cond (wp, wp, size, (unsigned long)s_neg);
+  safegcd_mul_u64 (tp, vp, size, (t ^ (0 - t_neg)) + t_neg);
+  mpih_abs_cond (tp, tp, size, (unsigned long)t_neg);
+  _gcry_mpih_add_n (wp, wp, tp, size);
+}
 
-  iterations = 2 * nsize * BITS_PER_MPI_LIMB;
 
-  while (iterations-- > 0)
-    {
-      mpi_limb_t odd_a, odd_u, underflow, borrow;
+/* Shift the two's complement value U, whose low 62 bits are zero,
+ * right by 62 bits.  */
+static void
+safegcd_rshift (mpi_ptr_t up, mpi_size_t size)
+{
+  mpi_limb_t sign = 0 - (up[size - 1] >> (BITS_PER_MPI_LIMB - 1));
+#if LIMBS_PER_U64 == 1
+  _gcry_mpih_rshift (up, up, size, SAFEGCD_STEPS);
+#else
+  mpi_size_t i;
 
-      odd_a = ap[0] & 1;
+  for (i = 0; i < size - 1; i++)
+    up[i] = up[i + 1];
+  up[size - 1] = sign;
+  _gcry_mpih_rshift (up, up, size, SAFEGCD_STEPS - BITS_PER_MPI_LIMB);
+#endif
+  up[size - 1] |= sign << (BITS_PER_MPI_LIMB * LIMBS_PER_U64 - SAFEGCD_STEPS);
+}
 
-      underflow = mpih_sub_n_cond (ap, ap, bp, nsize, odd_a);
-      mpih_add_n_cond (bp, bp, ap, nsize, underflow);
-      mpih_abs_cond (ap, ap, nsize, underflow);
-      mpih_swap_cond (up, vp, nsize, underflow);
 
-      _gcry_mpih_rshift (ap, ap, nsize, 1);
+/* Bring X, which is larger than -N and less than 2N, into the range
+ * [0, N).  TP is used as scratch space of SIZE limbs.  */
+static void
+safegcd_normalize (mpi_ptr_t xp, mpi_ptr_t np, mpi_ptr_t tp,
+                   mpi_size_t size)
+{
+  mpih_add_n_cond (xp, xp, np, size,
+                   xp[size - 1] >> (BITS_PER_MPI_LIMB - 1));
+  _gcry_mpih_sub_n (tp, xp, np, size);
+  mpih_set_cond (xp, tp, size,
+                 (tp[size - 1] >> (BITS_PER_MPI_LIMB - 1)) ^ 1);
+}
 
-      borrow = mpih_sub_n_cond (up, up, vp, nsize, odd_a);
-      mpih_add_n_cond (up, up, np, nsize, borrow);
 
-      odd_u = _gcry_mpih_rshift (up, up, nsize, 1) != 0;
-      mpih_add_n_cond (up, up, n1hp, nsize, odd_u);
+/* Run 62 divsteps on the low 64 bits F and G of the current values
+ * and return the new DELTA.  The transition matrix scaled by 2^62 is
+ * stored at T as U, V, Q, R with
+ *   2^62 F' = U F + V G  and  2^62 G' = Q F + R G.
+ * The absolute values of U + V and Q + R are at most 2^62.  */
+static u64
+safegcd_divsteps (u64 delta, u64 f, u64 g, u64 t[4])
+{
+  u64 u = 1, v = 0, q = 0, r = 1;
+  u64 c1, c2, x;
+  int i;
+
+  for (i = 0; i < SAFEGCD_STEPS; i++)
+    {
+      /* C2 is all ones if G is odd, C1 if also DELTA > 0.  */
+      c2 = g & 1;
+      c1 = 0 - (((0 - delta) >> 63) & c2);
+      c2 = 0 - c2;
+
+      /* If C1: DELTA = -DELTA, F = G, G = -F.  */
+      x = (f ^ g) & c1;
+      f ^= x; g ^= x; g = (g ^ c1) - c1;
+      x = (u ^ q) & c1;
+      u ^= x; q ^= x; q = (q ^ c1) - c1;
+      x = (v ^ r) & c1;
+      v ^= x; r ^= x; r = (r ^ c1) - c1;
+      delta = ((delta ^ c1) - c1) + 1;
+
+      /* If C2: G = G + F.  Then G = G / 2, which is recorded by
+         doubling the row of F instead.  */
+      g += f & c2;
+      q += u & c2;
+      r += v & c2;
+      g >>= 1;
+      u <<= 1;
+      v <<= 1;
     }
 
-  _gcry_mpi_free_limb_space (n1hp, nsize);
-  _gcry_mpi_free_limb_space (up, nsize);
+  t[0] = u;
+  t[1] = v;
+  t[2] = q;
+  t[3] = r;
+  return delta;
+}
+
 
-  if (_gcry_mpih_cmp_ui (bp, nsize, 1) == 0)
+/*
+ * Compute the inverse of A modulo the odd N, both of NSIZE limbs.
+ * Return a new limb space of NSIZE limbs with the inverse or NULL if
+ * it does not exist.
+ */
+static mpi_ptr_t
+mpih_invm_odd (mpi_ptr_t ap, mpi_ptr_t np, mpi_size_t nsize)
+{
+  int secure;
+  mpi_size_t size = nsize + LIMBS_PER_U64;
+  mpi_ptr_t space, fp, gp, dp, ep, mp, t1p, t2p, t3p, xp, swap;
+  unsigned int bits, steps, iterations;
+  u64 t[4], ninv, n0, delta, md, me;
+
+  secure = _gcry_is_secure (ap) || _gcry_is_secure (np);
+  space = mpi_alloc_limb_space (8 * size, secure);
+  fp = space;
+  gp = fp + size;
+  dp = gp + size;
+  ep = dp + size;
+  mp = ep + size;
+  t1p = mp + size;
+  t2p = t1p + size;
+  t3p = t2p + size;
+
+  MPN_ZERO (space, 8 * size);
+  MPN_COPY (fp, np, nsize);
+  MPN_COPY (gp, ap, nsize);
+  MPN_COPY (mp, np, nsize);
+  ep[0] = 1;
+
+  /* NINV = N^(-1) mod 2^64 by Newton iteration; each step doubles the
+     number of correct bits starting with 3.  */
+  n0 = safegcd_get_u64 (mp);
+  ninv = n0;
+  ninv *= 2 - n0 * ninv;
+  ninv *= 2 - n0 * ninv;
+  ninv *= 2 - n0 * ninv;
+  ninv *= 2 - n0 * ninv;
+  ninv *= 2 - n0 * ninv;
+
+  /* The bound on the number of divsteps from Theorem 11.2 of the
+     paper; F and G are less than 2^BITS.  */
+  bits = nsize * BITS_PER_MPI_LIMB;
+  if (bits < 46)
+    steps = (49 * bits + 80 + 16) / 17;
+  else
+    steps = (49 * bits + 57 + 16) / 17;
+  iterations = (steps + SAFEGCD_STEPS - 1) / SAFEGCD_STEPS;
+
+  delta = 1;
+  while (iterations-- > 0)
     {
-      /* Inverse exists.  */
-      _gcry_mpi_free_limb_space (bp, nsize);
-      return vp;
+      delta = safegcd_divsteps (delta, safegcd_get_u64 (fp),
+                                safegcd_get_u64 (gp), t);
+
+      /* F = (U F + V G) / 2^62, G = (Q F + R G) / 2^62.  */
+      safegcd_lincomb (t1p, fp, t[0], gp, t[1], t3p, size);
+      safegcd_lincomb (t2p, fp, t[2], gp, t[3], t3p, size);
+      safegcd_rshift (t1p, size);
+      safegcd_rshift (t2p, size);
+      swap = fp; fp = t1p; t1p = swap;
+      swap = gp; gp = t2p; t2p = swap;
+
+      /* D = (U D + V E + MD N) / 2^62, E = (Q D + R E + ME N) / 2^62,
+         where MD and ME are chosen to make the divisions exact.  */
+      safegcd_lincomb (t1p, dp, t[0], ep, t[1], t3p, size);
+      md = ((0 - safegcd_get_u64 (t1p)) * ninv) & SAFEGCD_MASK;
+      safegcd_mul_u64 (t3p, mp, size, md);
+      _gcry_mpih_add_n (t1p, t1p, t3p, size);
+      safegcd_lincomb (t2p, dp, t[2], ep, t[3], t3p, size);
+      me = ((0 - safegcd_get_u64 (t2p)) * ninv) & SAFEGCD_MASK;
+      safegcd_mul_u64 (t3p, mp, size, me);
+      _gcry_mpih_add_n (t2p, t2p, t3p, size);
+      safegcd_rshift (t1p, size);
+      safegcd_rshift (t2p, size);
+      swap = dp; dp = t1p; t1p = swap;
+      swap = ep; ep = t2p; t2p = swap;
+      safegcd_normalize (dp, mp, t3p, size);
+      safegcd_normalize (ep, mp, t3p, size);
     }
-  else
+
+  /* Now G is zero and F is the GCD of A and N up to its sign.  The
+     inverse is D with the sign of F.  */
+  mpih_abs_cond (dp, dp, size, fp[size - 1] >> (BITS_PER_MPI_LIMB - 1));
+  mpih_abs_cond (fp, fp, size, fp[size - 1] >> (BITS_PER_MPI_LIMB - 1));
+  safegcd_normalize (dp, mp, t3p, size);
+
+  xp = NULL;
+  if (_gcry_mpih_cmp_ui (fp, size, 1) == 0)
     {
-      _gcry_mpi_free_limb_space (bp, nsize);
-      _gcry_mpi_free_limb_space (vp, nsize);
-      return NULL;
+      /* Inverse exists.  */
+      xp = mpi_alloc_limb_space (nsize, secure);
+      MPN_COPY (xp, dp, nsize);
     }
+
+  _gcry_mpi_free_limb_space (space, 8 * size);
+  return xp;
 }
 
 
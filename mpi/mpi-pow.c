@@ -223,19 +223,19 @@ _gcry_mpi_powm (gcry_mpi_t res,
             mpi_size_t xsize;
 
             /*mpih_mul_n(xp, rp, rp, rsize);*/
-            if ( rsize < KARATSUBA_THRESHOLD )
+            if ( rsize < KARATSUBA_SQR_THRESHOLD )
               _gcry_mpih_sqr_n_basecase( xp, rp, rsize );
             else
               {
                 if ( !tspace )
                   {
-                    tsize = 2 * rsize;
+                    tsize = _gcry_mpih_sqr_n_tspace (rsize);
                     tspace = mpi_alloc_limb_space( tsize, 0 );
                   }
-                else if ( tsize < (2*rsize) )
+                else if ( tsize < _gcry_mpih_sqr_n_tspace (rsize) )
                   {
                     _gcry_mpi_free_limb_space (tspace, 0);
-                    tsize = 2 * rsize;
+                    tsize = _gcry_mpih_sqr_n_tspace (rsize);
                     tspace = mpi_alloc_limb_space (tsize, 0 );
                   }
                 _gcry_mpih_sqr_n (xp, rp, rsize, tspace);
@@ -351,6 +351,33 @@ _gcry_mpi_powm (gcry_mpi_t res,
   if (tspace)
     _gcry_mpi_free_limb_space( tspace, 0 );
 }
+
+
+/* Precomputed tables require the Montgomery implementation; the
+   callers fall back to _gcry_mpi_powm.  */
+mpi_powm_comb_t
+_gcry_mpi_powm_comb_new (gcry_mpi_t base, gcry_mpi_t mod, unsigned int nbits)
+{
+  (void)base;
+  (void)mod;
+  (void)nbits;
+  return NULL;
+}
+
+void
+_gcry_mpi_powm_comb_free (mpi_powm_comb_t comb)
+{
+  (void)comb;
+}
+
+void
+_gcry_mpi_powm_comb (gcry_mpi_t res, gcry_mpi_t expo, mpi_powm_comb_t comb)
+{
+  (void)res;
+  (void)expo;
+  (void)comb;
+  BUG ();
+}
 #else
 /**
  * Internal function to compute
@@ -388,6 +415,484 @@ mul_mod (mpi_ptr_t xp, mpi_size_t *xsize_p,
      *xsize_p = rsize + ssize;
 }
 
+/* State of a Montgomery domain computation for an odd modulus.  */
+struct mont_ctx
+{
+  mpi_ptr_t mp;         /* The modulus M.  */
+  mpi_size_t n;         /* Size of M in limbs.  */
+  mpi_limb_t m_inv;     /* -M^-1 mod B.  */
+  mpi_ptr_t tp;         /* 2 * N limbs of scratch space.  */
+  mpi_ptr_t tspace;     /* mont_tspace_nlimbs (N) limbs of scratch space.  */
+};
+
+
+/* Return the number of limbs of scratch space for the products of
+ * mont_mul and mont_sqr with a modulus of N limbs.  */
+static mpi_size_t
+mont_tspace_nlimbs (mpi_size_t n)
+{
+  mpi_size_t mul, sqr;
+
+  if (n < MONT_REDC_THRESHOLD)
+    return 0;
+  mul = _gcry_mpih_mul_n_tspace (n);
+  sqr = _gcry_mpih_sqr_n_tspace (n);
+  return mul > sqr? mul : sqr;
+}
+
+
+/* Return -X^-1 mod B for an odd limb X.  Each Newton step doubles the
+ * number of correct bits; X itself is an inverse modulo 2^3.  */
+static mpi_limb_t
+mont_limb_inv (mpi_limb_t x)
+{
+  mpi_limb_t inv = x;
+  int bits;
+
+  for (bits = 3; bits < BITS_PER_MPI_LIMB; bits *= 2)
+    inv *= 2 - x * inv;
+
+  return -inv;
+}
+
+
+/* XP = T mod M for the value T < 2 * M given by the limbs at CTX->TP
+ * and the high limb CY.  The subtraction is done without branches.  */
+static void
+mont_final_sub (mpi_ptr_t xp, mpi_limb_t cy, struct mont_ctx *ctx)
+{
+  mpi_limb_t borrow;
+
+  borrow = _gcry_mpih_sub_n (xp, ctx->tp, ctx->mp, ctx->n);
+  mpih_set_cond (xp, ctx->tp, ctx->n, (borrow & ~cy) & 1);
+}
+
+
+/* Reduce the product of 2 * N limbs at CTX->TP: the N low limbs of
+ * CTX->TP are set to the product / B^N mod M up to one subtraction of
+ * M, whose need is indicated by the returned high limb.  */
+static mpi_limb_t
+mont_redc (struct mont_ctx *ctx)
+{
+  mpi_ptr_t tp = ctx->tp;
+  mpi_size_t i;
+
+  /* Clear one limb per step; the carry out of each step is kept in
+   * the limb which has just been cleared and added at the end.  */
+  for (i = 0; i < ctx->n; i++)
+    tp[i] = _gcry_mpih_addmul_1 (tp + i, ctx->mp, ctx->n,
+                                 tp[i] * ctx->m_inv);
+
+  return _gcry_mpih_add_n (tp, tp + ctx->n, tp, ctx->n);
+}
+
+
+/* XP = UP * VP / B^N mod M.  UP and VP must be less than M; they may
+ * overlap with XP.  Large operands are multiplied with the
+ * sub-quadratic code of mpih-mul.c, which unlike the interleaved
+ * kernels branches on comparisons of the operand halves.  */
+static void
+mont_mul (mpi_ptr_t xp, mpi_ptr_t up, mpi_ptr_t vp, struct mont_ctx *ctx)
+{
+  mpi_limb_t cy;
+
+  if (ctx->n >= MONT_REDC_THRESHOLD)
+    {
+      if (up == vp)
+        _gcry_mpih_sqr_n_recurse (ctx->tp, up, ctx->n, ctx->tspace);
+      else
+        _gcry_mpih_mul_n_recurse (ctx->tp, up, vp, ctx->n, ctx->tspace);
+      cy = mont_redc (ctx);
+    }
+  else
+    cy = _gcry_mpih_mont_mul (ctx->tp, up, vp, ctx->mp, ctx->n, ctx->m_inv);
+  mont_final_sub (xp, cy, ctx);
+}
+
+
+/* XP = UP * UP / B^N mod M.  UP must be less than M; it may overlap
+ * with XP.  */
+static void
+mont_sqr (mpi_ptr_t xp, mpi_ptr_t up, struct mont_ctx *ctx)
+{
+  mpi_limb_t cy;
+
+  if (ctx->n >= MONT_REDC_THRESHOLD)
+    {
+      _gcry_mpih_sqr_n_recurse (ctx->tp, up, ctx->n, ctx->tspace);
+      cy = mont_redc (ctx);
+    }
+  else
+    cy = _gcry_mpih_mont_sqr (ctx->tp, up, ctx->mp, ctx->n, ctx->m_inv);
+  mont_final_sub (xp, cy, ctx);
+}
+
+
+/* XP = UP * B^N mod M, i.e. convert U into the Montgomery domain.
+ * MP_NORM is M shifted left by SHIFT bits so that its high bit is set
+ * as required by _gcry_mpih_divrem.  TP provides USIZE + N + 1 limbs
+ * of scratch space.  */
+static void
+mont_to (mpi_ptr_t xp, mpi_ptr_t up, mpi_size_t usize,
+         mpi_ptr_t mp_norm, int shift, mpi_size_t n, mpi_ptr_t tp)
+{
+  mpi_size_t tsize = usize + n;
+
+  MPN_ZERO (tp, n);
+  if (shift)
+    {
+      tp[tsize] = _gcry_mpih_lshift (tp + n, up, usize, shift);
+      tsize++;
+    }
+  else
+    MPN_COPY (tp + n, up, usize);
+
+  /* The quotient is not needed; store it above the remainder.  */
+  _gcry_mpih_divrem (tp + n, 0, tp, tsize, mp_norm, n);
+
+  if (shift)
+    _gcry_mpih_rshift (xp, tp, n, shift);
+  else
+    MPN_COPY (xp, tp, n);
+}
+
+
+/* Return the W bits of the exponent EP starting at bit position POS.  */
+static mpi_limb_t
+mont_window (mpi_ptr_t ep, mpi_size_t esize, unsigned int pos, int w)
+{
+  mpi_size_t i = pos / BITS_PER_MPI_LIMB;
+  unsigned int sh = pos % BITS_PER_MPI_LIMB;
+  mpi_limb_t e;
+
+  e = ep[i] >> sh;
+  if (sh + w > BITS_PER_MPI_LIMB && i + 1 < esize)
+    e |= ep[i + 1] << (BITS_PER_MPI_LIMB - sh);
+
+  return e & (((mpi_limb_t)1 << w) - 1);
+}
+
+
+/****************
+ * RES = BASE ^ EXPO mod MOD for an odd MOD.
+ *
+ * EP and ESIZE are the normalized limbs of EXPO; ESIZE must not be
+ * zero.  All products are computed in the Montgomery domain, which
+ * replaces the division after each multiplication by an interleaved
+ * reduction.  Secret exponents and exponents of more than one limb
+ * are processed with a fixed window: each window costs W squarings
+ * and one multiplication by an entry of the table BASE^0 ..
+ * BASE^(2^W - 1), which is read in full for every lookup.  Squarings
+ * use a faster dedicated kernel; they occur at fixed positions of the
+ * sequence.  Thus neither the sequence of operations nor the memory
+ * access pattern depends on the exponent bits.  Short exponents which
+ * are not stored in secure memory, such as public RSA exponents, use
+ * plain left-to-right binary exponentiation.
+ */
+static void
+mont_powm (gcry_mpi_t res, gcry_mpi_t base, gcry_mpi_t expo,
+           mpi_ptr_t ep, mpi_size_t esize, gcry_mpi_t mod)
+{
+  struct mont_ctx ctx;
+  mpi_ptr_t space, mp_norm, cp, table, xp, yp, rp;
+  mpi_ptr_t bp = base->d;
+  mpi_size_t bsize = base->nlimbs;
+  mpi_size_t n = mod->nlimbs;
+  mpi_size_t rsize, csize;
+  unsigned int space_nlimbs;
+  unsigned int ebits, pos;
+  int msign = mod->sign;
+  int negative_result;
+  int sec, shift, cnt, w, nentries, i;
+  mpi_limb_t one = 1;
+
+  MPN_NORMALIZE (bp, bsize);
+  if (!bsize)
+    {
+      res->nlimbs = 0;
+      res->sign = 0;
+      return;
+    }
+  negative_result = (ep[0] & 1) && base->sign;
+
+  count_leading_zeros (cnt, ep[esize - 1]);
+  ebits = esize * BITS_PER_MPI_LIMB - cnt;
+  if (ebits > 512)
+    w = 5;
+  else if (ebits > 256)
+    w = 4;
+  else if (ebits > 128)
+    w = 3;
+  else if (ebits > BITS_PER_MPI_LIMB || mpi_is_secure (expo))
+    w = 2;
+  else
+    w = 1;
+  nentries = 1 << w;
+
+  sec = mpi_is_secure (base) || mpi_is_secure (expo) || mpi_is_secure (mod);
+  csize = (bsize > n ? bsize : n) + n + 1;
+  space_nlimbs = (6 + nentries) * n + csize + mont_tspace_nlimbs (n);
+  space = mpi_alloc_limb_space (space_nlimbs, sec);
+  ctx.mp = space;
+  ctx.n = n;
+  ctx.m_inv = mont_limb_inv (mod->d[0]);
+  ctx.tp = ctx.mp + n;
+  mp_norm = ctx.tp + 2 * n;
+  xp = mp_norm + n;
+  yp = xp + n;
+  table = yp + n;
+  cp = table + nentries * n;
+  ctx.tspace = cp + csize;
+
+  MPN_COPY (ctx.mp, mod->d, n);
+  count_leading_zeros (shift, ctx.mp[n - 1]);
+  if (shift)
+    _gcry_mpih_lshift (mp_norm, ctx.mp, n, shift);
+  else
+    MPN_COPY (mp_norm, ctx.mp, n);
+
+  /* TABLE[i] = BASE^i * B^N mod M.  */
+  mont_to (table, &one, 1, mp_norm, shift, n, cp);
+  mont_to (table + n, bp, bsize, mp_norm, shift, n, cp);
+  for (i = 2; i < nentries; i++)
+    mont_mul (table + i * n, table + (i - 1) * n, table + n, &ctx);
+
+  if (w == 1)
+    {
+      MPN_COPY (xp, table + n, n);
+      for (pos = ebits - 1; pos > 0; pos--)
+        {
+          mont_sqr (xp, xp, &ctx);
+          if (mont_window (ep, esize, pos - 1, 1))
+            mont_mul (xp, xp, table + n, &ctx);
+        }
+    }
+  else
+    {
+      pos = ((ebits - 1) / w) * w;
+      mpih_lookup_cond (xp, table, n, nentries,
+                        mont_window (ep, esize, pos, w));
+      while (pos)
+        {
+          pos -= w;
+          for (i = 0; i < w; i++)
+            mont_sqr (xp, xp, &ctx);
+          mpih_lookup_cond (yp, table, n, nentries,
+                            mont_window (ep, esize, pos, w));
+          mont_mul (xp, xp, yp, &ctx);
+        }
+    }
+
+  /* Leave the Montgomery domain by multiplying with 1.  */
+  MPN_ZERO (yp, n);
+  yp[0] = 1;
+  mont_mul (xp, xp, yp, &ctx);
+
+  /* BASE, EXPO and MOD may be identical to RES; they are not used
+     anymore.  */
+  RESIZE_IF_NEEDED (res, n);
+  rp = res->d;
+  rsize = n;
+  MPN_COPY (rp, xp, n);
+  MPN_NORMALIZE (rp, rsize);
+  res->sign = 0;
+
+  /* Fixup for negative results.  */
+  if (negative_result && rsize)
+    {
+      _gcry_mpih_sub (rp, ctx.mp, n, rp, rsize);
+      rsize = n;
+      res->sign = msign;
+      MPN_NORMALIZE (rp, rsize);
+    }
+  res->nlimbs = rsize;
+
+  _gcry_mpi_free_limb_space (space, sec ? space_nlimbs : 0);
+}
+
+
+/* Precomputed table for BASE ^ E mod M with a fixed BASE and an odd M
+ * as used by the fixed-base comb method of Lim and Lee.  An exponent
+ * of up to NBITS bits is split into TEETH rows of SPACING bits each;
+ * entry U of the table holds the product of BASE^(2^(I*SPACING)) over
+ * all bits I set in U, in the Montgomery domain.  Each column of the
+ * exponent then costs one squaring and one multiplication, and the
+ * squarings for the rows are done once when the table is created.  */
+struct mpi_powm_comb_s
+{
+  unsigned int nbits;   /* Maximum size of an exponent in bits.  */
+  unsigned int teeth;   /* Number of rows.  */
+  unsigned int spacing; /* Number of columns.  */
+  gcry_mpi_t base;      /* Used for longer exponents.  */
+  gcry_mpi_t mod;
+  mpi_limb_t m_inv;     /* -M^-1 mod B.  */
+  mpi_ptr_t table;      /* 2^TEETH entries of MOD->NLIMBS limbs.  */
+};
+
+/* The number of rows of a comb.  Together with the rows the size of
+ * the table doubles, while the number of columns and thus the work
+ * for one exponentiation only shrinks by a factor of (TEETH+1)/TEETH.  */
+#define POWM_COMB_TEETH 5
+
+
+/* Create a table for BASE ^ E mod MOD with exponents E of up to NBITS
+ * bits.  NULL is returned if MOD is not odd or BASE is not in the
+ * range 0 < BASE < MOD; the caller shall then use _gcry_mpi_powm.  */
+mpi_powm_comb_t
+_gcry_mpi_powm_comb_new (gcry_mpi_t base, gcry_mpi_t mod, unsigned int nbits)
+{
+  mpi_powm_comb_t comb;
+  struct mont_ctx ctx;
+  mpi_ptr_t space, mp_norm, cp, rowp, table;
+  mpi_size_t n, bsize, csize;
+  unsigned int space_nlimbs, nentries, i, j, u;
+  int shift;
+  mpi_limb_t one = 1;
+
+  if (!nbits || mpi_is_opaque (base) || mpi_is_opaque (mod)
+      || base->sign || mod->sign
+      || mpi_cmp_ui (mod, 1) <= 0 || !mpi_test_bit (mod, 0)
+      || !mpi_cmp_ui (base, 0) || mpi_cmp (base, mod) >= 0)
+    return NULL;
+
+  comb = xtrycalloc (1, sizeof *comb);
+  if (!comb)
+    return NULL;
+  comb->nbits = nbits;
+  comb->teeth = nbits < POWM_COMB_TEETH? nbits : POWM_COMB_TEETH;
+  comb->spacing = (nbits + comb->teeth - 1) / comb->teeth;
+  comb->base = mpi_copy (base);
+  comb->mod = mpi_copy (mod);
+  n = comb->mod->nlimbs;
+  MPN_NORMALIZE (comb->mod->d, n);
+  comb->mod->nlimbs = n;
+  bsize = comb->base->nlimbs;
+  MPN_NORMALIZE (comb->base->d, bsize);
+  comb->m_inv = mont_limb_inv (comb->mod->d[0]);
+
+  nentries = 1 << comb->teeth;
+  comb->table = xtrymalloc (nentries * n * sizeof (mpi_limb_t));
+  if (!comb->table)
+    {
+      _gcry_mpi_powm_comb_free (comb);
+      return NULL;
+    }
+  table = comb->table;
+
+  csize = n + n + 1;
+  space_nlimbs = 4 * n + csize + mont_tspace_nlimbs (n);
+  space = mpi_alloc_limb_space (space_nlimbs, 0);
+  ctx.mp = comb->mod->d;
+  ctx.n = n;
+  ctx.m_inv = comb->m_inv;
+  ctx.tp = space;
+  mp_norm = ctx.tp + 2 * n;
+  rowp = mp_norm + n;
+  cp = rowp + n;
+  ctx.tspace = cp + csize;
+
+  count_leading_zeros (shift, ctx.mp[n - 1]);
+  if (shift)
+    _gcry_mpih_lshift (mp_norm, ctx.mp, n, shift);
+  else
+    MPN_COPY (mp_norm, ctx.mp, n);
+
+  mont_to (table, &one, 1, mp_norm, shift, n, cp);
+  mont_to (rowp, comb->base->d, bsize, mp_norm, shift, n, cp);
+  for (i = 0; i < comb->teeth; i++)
+    {
+      /* ROWP = BASE^(2^(I*SPACING)); the entries with the highest bit
+       * I are the products of ROWP with the previous entries.  */
+      if (i)
+        for (j = 0; j < comb->spacing; j++)
+          mont_sqr (rowp, rowp, &ctx);
+      MPN_COPY (table + (1 << i) * n, rowp, n);
+      for (u = (1 << i) + 1; u < (2 << i); u++)
+        mont_mul (table + u * n, table + (u - (1 << i)) * n, rowp, &ctx);
+    }
+
+  _gcry_mpi_free_limb_space (space, 0);
+  return comb;
+}
+
+
+void
+_gcry_mpi_powm_comb_free (mpi_powm_comb_t comb)
+{
+  if (!comb)
+    return;
+  mpi_free (comb->base);
+  mpi_free (comb->mod);
+  xfree (comb->table);
+  xfree (comb);
+}
+
+
+/****************
+ * RES = BASE ^ EXPO mod MOD with BASE and MOD given by the table COMB.
+ *
+ * The bits of EXPO at the positions I * SPACING + J for all rows I form
+ * the index of the table entry for column J.  The columns are processed
+ * from the highest to the lowest, each with one squaring and one
+ * multiplication by an entry which is read with a full scan of the
+ * table.  Thus for a secret exponent of up to COMB->NBITS bits neither
+ * the sequence of operations nor the memory access pattern depends on
+ * its value.  Other exponents are passed to _gcry_mpi_powm.
+ */
+void
+_gcry_mpi_powm_comb (gcry_mpi_t res, gcry_mpi_t expo, mpi_powm_comb_t comb)
+{
+  struct mont_ctx ctx;
+  mpi_ptr_t space, xp, yp, rp;
+  mpi_size_t n = comb->mod->nlimbs;
+  unsigned int space_nlimbs, nentries, i, j, idx;
+  int sec;
+
+  if (expo->sign || mpi_get_nbits (expo) > comb->nbits)
+    {
+      _gcry_mpi_powm (res, comb->base, expo, comb->mod);
+      return;
+    }
+  nentries = 1 << comb->teeth;
+
+  sec = mpi_is_secure (expo);
+  space_nlimbs = 4 * n + mont_tspace_nlimbs (n);
+  space = mpi_alloc_limb_space (space_nlimbs, sec);
+  ctx.mp = comb->mod->d;
+  ctx.n = n;
+  ctx.m_inv = comb->m_inv;
+  ctx.tp = space;
+  xp = ctx.tp + 2 * n;
+  yp = xp + n;
+  ctx.tspace = yp + n;
+
+  MPN_COPY (xp, comb->table, n);
+  for (j = comb->spacing; j-- > 0; )
+    {
+      idx = 0;
+      for (i = 0; i < comb->teeth; i++)
+        idx |= mpi_test_bit (expo, i * comb->spacing + j) << i;
+      mont_sqr (xp, xp, &ctx);
+      mpih_lookup_cond (yp, comb->table, n, nentries, idx);
+      mont_mul (xp, xp, yp, &ctx);
+    }
+
+  /* Leave the Montgomery domain by multiplying with 1.  */
+  MPN_ZERO (yp, n);
+  yp[0] = 1;
+  mont_mul (xp, xp, yp, &ctx);
+
+  RESIZE_IF_NEEDED (res, n);
+  rp = res->d;
+  MPN_COPY (rp, xp, n);
+  MPN_NORMALIZE (rp, n);
+  res->nlimbs = n;
+  res->sign = 0;
+
+  _gcry_mpi_free_limb_space (space, sec ? space_nlimbs : 0);
+}
+
+
 #define SIZE_PRECOMP ((1 << (5 - 1)))
 
 /****************
@@ -474,6 +979,14 @@ _gcry_mpi_powm (gcry_mpi_t res,
       goto leave;
     }
 
+  /* Odd moduli, as used by RSA, DSA, Elgamal and DH, are handled in
+     the Montgomery domain.  */
+  if ((mod->d[0] & 1))
+    {
+      mont_powm (res, base, expo, ep, esize, mod);
+      goto leave;
+    }
+
   /* Normalize MOD (i.e. make its most significant bit set) as
      required by mpn_divrem.  This will make the intermediate values
      in the calculation slightly larger, but the correct result is
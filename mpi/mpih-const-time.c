@@ -158,6 +158,32 @@ _gcry_mpih_abs_cond (mpi_ptr_t wp, mpi_ptr_t up, mpi_size_t usize,
 }
 
 
+/*
+ *  W = TABLE[IDX], where TABLE holds NENTS entries of USIZE limbs
+ *  each.  All entries are read so that the memory access pattern
+ *  does not depend on IDX.
+ */
+void
+_gcry_mpih_lookup_cond (mpi_ptr_t wp, mpi_ptr_t table, mpi_size_t usize,
+                        unsigned int nents, unsigned long idx)
+{
+  mpi_size_t i;
+  unsigned int k;
+
+  for (i = 0; i < usize; i++)
+    wp[i] = 0;
+
+  for (k = 0; k < nents; k++)
+    {
+      mpi_limb_t mask = vzero - (unsigned long)(k == idx);
+      mpi_ptr_t up = table + k * usize;
+
+      for (i = 0; i < usize; i++)
+        wp[i] |= up[i] & mask;
+    }
+}
+
+
 /*
  * Allocating memory for W,
  * compute W = V % U, then return W
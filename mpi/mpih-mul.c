@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "mpi-internal.h"
 #include "longlong.h"
 #include "g10lib.h"
@@ -37,19 +38,40 @@
     do {						\
 	if( (size) < KARATSUBA_THRESHOLD )		\
 	    mul_n_basecase (prodp, up, vp, size);	\
-	else						\
+	else if( (size) < toom3_mul_threshold )		\
 	    mul_n (prodp, up, vp, size, tspace);	\
+	else						\
+	    mul_n_toom3 (prodp, up, vp, size, tspace);	\
     } while (0);
 
 #define MPN_SQR_N_RECURSE(prodp, up, size, tspace) \
     do {					    \
-	if ((size) < KARATSUBA_THRESHOLD)	    \
+	if ((size) < KARATSUBA_SQR_THRESHOLD)	    \
 	    _gcry_mpih_sqr_n_basecase (prodp, up, size);	 \
-	else					    \
+	else if ((size) < toom3_sqr_threshold)	    \
 	    _gcry_mpih_sqr_n (prodp, up, size, tspace);	 \
+	else					    \
+	    sqr_n_toom3 (prodp, up, size, tspace);  \
     } while (0);
 
 
+/* The smallest operands, in limbs, for which Toom-Cook 3-way
+ * multiplication and squaring are used instead of Karatsuba's
+ * algorithm.  They can be changed for benchmarks with
+ * _gcry_mpih_set_toom3_thresholds.  */
+static mpi_size_t toom3_mul_threshold = TOOM3_MUL_THRESHOLD;
+static mpi_size_t toom3_sqr_threshold = TOOM3_SQR_THRESHOLD;
+
+/* Toom-3 splits the operands into three parts of which the last must
+ * not be empty.  */
+#define TOOM3_MIN_SIZE 8
+
+static void mul_n_toom3 (mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
+                         mpi_size_t size, mpi_ptr_t tspace);
+static void sqr_n_toom3 (mpi_ptr_t prodp, mpi_ptr_t up,
+                         mpi_size_t size, mpi_ptr_t tspace);
+
+
 
 
 /* Multiply the natural numbers u (pointed to by UP) and v (pointed to by VP),
@@ -69,6 +91,27 @@
  * algorithm below.
  */
 
+#ifdef HAVE_MPIH_ADDMUL_4
+/* Basecase multiplication with the BMI2/ADX kernel, which adds four
+ * rows of the product in one pass.  Returns the most significant limb
+ * of the product.  */
+static mpi_limb_t
+mul_basecase_4( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t usize,
+                mpi_ptr_t vp, mpi_size_t vsize )
+{
+    mpi_size_t i;
+
+    MPN_ZERO( prodp, usize );
+    for( i = 0; i + 4 <= vsize; i += 4 )
+	_gcry_mpih_addmul_4( prodp + i, up, usize, vp + i );
+    for( ; i < vsize; i++ )
+	prodp[usize + i] = _gcry_mpih_addmul_1( prodp + i, up, usize, vp[i] );
+
+    return prodp[usize + vsize - 1];
+}
+#endif /*HAVE_MPIH_ADDMUL_4*/
+
+
 static mpi_limb_t
 mul_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up,
 				 mpi_ptr_t vp, mpi_size_t size)
@@ -77,6 +120,11 @@ mul_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up,
     mpi_limb_t cy;
     mpi_limb_t v_limb;
 
+#ifdef HAVE_MPIH_ADDMUL_4
+    if( _gcry_mpih_use_adx && size >= 4 )
+	return mul_basecase_4( prodp, up, size, vp, size );
+#endif
+
     /* Multiply by the first limb in V separately, as the result can be
      * stored (not added) to PROD.  We also avoid a loop for zeroing.  */
     v_limb = vp[0];
@@ -222,51 +270,17 @@ mul_n( mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
 }
 
 
-void
-_gcry_mpih_sqr_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size )
-{
-    mpi_size_t i;
-    mpi_limb_t cy_limb;
-    mpi_limb_t v_limb;
-
-    /* Multiply by the first limb in V separately, as the result can be
-     * stored (not added) to PROD.  We also avoid a loop for zeroing.  */
-    v_limb = up[0];
-    if( v_limb <= 1 ) {
-	if( v_limb == 1 )
-	    MPN_COPY( prodp, up, size );
-	else
-	    MPN_ZERO(prodp, size);
-	cy_limb = 0;
-    }
-    else
-	cy_limb = _gcry_mpih_mul_1( prodp, up, size, v_limb );
-
-    prodp[size] = cy_limb;
-    prodp++;
-
-    /* For each iteration in the outer loop, multiply one limb from
-     * U with one limb from V, and add it to PROD.  */
-    for( i=1; i < size; i++) {
-	v_limb = up[i];
-	if( v_limb <= 1 ) {
-	    cy_limb = 0;
-	    if( v_limb == 1 )
-		cy_limb = _gcry_mpih_add_n(prodp, prodp, up, size);
-	}
-	else
-	    cy_limb = _gcry_mpih_addmul_1(prodp, up, size, v_limb);
-
-	prodp[size] = cy_limb;
-	prodp++;
-    }
-}
-
-
+/* Square UP of SIZE limbs into PRODP.  TSPACE must provide
+ * _gcry_mpih_sqr_n_tspace (SIZE) limbs.  */
 void
 _gcry_mpih_sqr_n( mpi_ptr_t prodp,
                   mpi_ptr_t up, mpi_size_t size, mpi_ptr_t tspace)
 {
+    if( size >= toom3_sqr_threshold ) {
+	sqr_n_toom3( prodp, up, size, tspace );
+	return;
+    }
+
     if( size & 1 ) {
 	/* The size is odd, and the code below doesn't handle that.
 	 * Multiply the least significant (size - 1) limbs with a recursive
@@ -341,6 +355,286 @@ _gcry_mpih_sqr_n( mpi_ptr_t prodp,
 }
 
 
+/* Toom-Cook 3-way multiplication.
+ *
+ * The operands are split into three parts of K, K and R limbs,
+ *
+ *   U = U2*(B**2k) + U1*(B**k) + U0,
+ *
+ * and taken as polynomials U(x) = U2*x^2 + U1*x + U0 and V(x).  The
+ * product W(x) = U(x)V(x) has five coefficients W0 .. W4.  W0 and W4
+ * are the products U0*V0 and U2*V2; the others are interpolated from
+ * the products at the points 1, -1 and 2.  Thus five products of a
+ * third of the size replace the nine of the schoolbook method.
+ *
+ * The values at the points take K+1 limbs; the products at them are
+ * stored in TSPACE, which needs to provide _gcry_mpih_mul_n_tspace
+ * limbs.
+ */
+
+/* EP = X0 + X1 + X2 with K+1 limbs.  */
+static void
+toom3_eval_1 (mpi_ptr_t ep, mpi_ptr_t xp, mpi_size_t k, mpi_size_t r)
+{
+    mpi_limb_t cy;
+
+    cy = _gcry_mpih_add_n (ep, xp, xp + k, k);
+    cy += _gcry_mpih_add (ep, ep, k, xp + 2 * k, r);
+    ep[k] = cy;
+}
+
+/* EP = |X0 - X1 + X2| with K+1 limbs.  Returns true if the value is
+ * negative.  */
+static int
+toom3_eval_m1 (mpi_ptr_t ep, mpi_ptr_t xp, mpi_size_t k, mpi_size_t r)
+{
+    ep[k] = _gcry_mpih_add (ep, xp, k, xp + 2 * k, r);
+    if (ep[k] || _gcry_mpih_cmp (ep, xp + k, k) >= 0) {
+	_gcry_mpih_sub (ep, ep, k + 1, xp + k, k);
+	return 0;
+    }
+    _gcry_mpih_sub_n (ep, xp + k, ep, k);
+    return 1;
+}
+
+/* EP = X0 + 2*X1 + 4*X2 with K+1 limbs.  */
+static void
+toom3_eval_2 (mpi_ptr_t ep, mpi_ptr_t xp, mpi_size_t k, mpi_size_t r)
+{
+    MPN_COPY (ep, xp + 2 * k, r);
+    MPN_ZERO (ep + r, k + 1 - r);
+    ep[k] = _gcry_mpih_lshift (ep, ep, k, 1);
+    ep[k] += _gcry_mpih_add_n (ep, ep, xp + k, k);
+    _gcry_mpih_lshift (ep, ep, k + 1, 1);
+    ep[k] += _gcry_mpih_add_n (ep, ep, xp, k);
+}
+
+/* QP = AP / 3 for an AP of N limbs which is a multiple of 3.  QP may
+ * be equal to AP.  */
+static void
+toom3_divexact_by3 (mpi_ptr_t qp, mpi_ptr_t ap, mpi_size_t n)
+{
+    const mpi_limb_t inv = (~(mpi_limb_t)0 / 3) * 2 + 1; /* 3^-1 mod B */
+    mpi_limb_t c = 0;
+    mpi_limb_t a, s, q, hi, lo GCC_ATTR_UNUSED;
+    mpi_size_t i;
+
+    for (i = 0; i < n; i++) {
+	a = ap[i];
+	s = a - c;
+	c = s > a;
+	q = s * inv;
+	qp[i] = q;
+	umul_ppmm (hi, lo, q, 3);
+	c += hi;
+    }
+}
+
+/* Add WP with WSIZE limbs to RP with RSIZE limbs.  The sum must fit
+ * into RSIZE limbs.  */
+static void
+toom3_add_at (mpi_ptr_t rp, mpi_size_t rsize, mpi_ptr_t wp, mpi_size_t wsize)
+{
+    mpi_limb_t cy;
+
+    MPN_NORMALIZE (wp, wsize);
+    if (!wsize)
+	return;
+    cy = _gcry_mpih_add_n (rp, rp, wp, wsize);
+    if (cy && rsize > wsize)
+	_gcry_mpih_add_1 (rp + wsize, rp + wsize, rsize - wsize, cy);
+}
+
+/* Compute the product at PRODP from W0 and W4, which are already
+ * stored at PRODP and PRODP + 4K, and the products P1, PM1 and P2 at
+ * the points 1, -1 and 2, each with 2K+2 limbs.  NEG is true if the
+ * product PM1 is negative.  TP provides 2K+2 limbs of scratch space.
+ * P1, PM1 and P2 are destroyed.  */
+static void
+toom3_interpolate (mpi_ptr_t prodp, mpi_size_t size,
+                   mpi_size_t k, mpi_size_t r,
+                   mpi_ptr_t p1, mpi_ptr_t pm1, int neg, mpi_ptr_t p2,
+                   mpi_ptr_t tp)
+{
+    mpi_size_t wsize = 2 * k + 2;
+    mpi_ptr_t w4p = prodp + 4 * k;
+
+    /* P1 = W0 + W2 + W4 = (P1 + PM1) / 2,
+     * PM1 = W1 + W3 = (P1 - PM1) / 2 */
+    if (neg) {
+	_gcry_mpih_add_n (tp, p1, pm1, wsize);
+	_gcry_mpih_sub_n (p1, p1, pm1, wsize);
+    }
+    else {
+	_gcry_mpih_sub_n (tp, p1, pm1, wsize);
+	_gcry_mpih_add_n (p1, p1, pm1, wsize);
+    }
+    _gcry_mpih_rshift (pm1, tp, wsize, 1);
+    _gcry_mpih_rshift (p1, p1, wsize, 1);
+
+    /* P1 = W2 */
+    _gcry_mpih_sub (p1, p1, wsize, prodp, 2 * k);
+    _gcry_mpih_sub (p1, p1, wsize, w4p, 2 * r);
+
+    /* P2 = W1 + 4*W3 = (P2 - W0 - 4*W2 - 16*W4) / 2 */
+    _gcry_mpih_sub (p2, p2, wsize, prodp, 2 * k);
+    _gcry_mpih_lshift (tp, p1, wsize, 2);
+    _gcry_mpih_sub_n (p2, p2, tp, wsize);
+    tp[2 * r] = _gcry_mpih_lshift (tp, w4p, 2 * r, 4);
+    _gcry_mpih_sub (p2, p2, wsize, tp, 2 * r + 1);
+    _gcry_mpih_rshift (p2, p2, wsize, 1);
+
+    /* P2 = W3 = (P2 - PM1) / 3,
+     * PM1 = W1 = PM1 - W3 */
+    _gcry_mpih_sub_n (p2, p2, pm1, wsize);
+    toom3_divexact_by3 (p2, p2, wsize);
+    _gcry_mpih_sub_n (pm1, pm1, p2, wsize);
+
+    /* Add W1, W2 and W3 at their positions.  */
+    MPN_ZERO (prodp + 2 * k, 2 * k);
+    toom3_add_at (prodp + k, 2 * size - k, pm1, wsize);
+    toom3_add_at (prodp + 2 * k, 2 * size - 2 * k, p1, wsize);
+    toom3_add_at (prodp + 3 * k, 2 * size - 3 * k, p2, wsize);
+}
+
+
+static void
+mul_n_toom3 (mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
+             mpi_size_t size, mpi_ptr_t tspace)
+{
+    mpi_size_t k = (size + 2) / 3;
+    mpi_size_t r = size - 2 * k;
+    mpi_size_t wsize = 2 * k + 2;
+    mpi_ptr_t p1 = tspace;
+    mpi_ptr_t pm1 = p1 + wsize;
+    mpi_ptr_t p2 = pm1 + wsize;
+    mpi_ptr_t ue = p2 + wsize;
+    mpi_ptr_t ve = ue + k + 1;
+    mpi_ptr_t ws = ve + k + 1;
+    int neg;
+
+    toom3_eval_1 (ue, up, k, r);
+    toom3_eval_1 (ve, vp, k, r);
+    MPN_MUL_N_RECURSE (p1, ue, ve, k + 1, ws);
+
+    neg = toom3_eval_m1 (ue, up, k, r);
+    neg ^= toom3_eval_m1 (ve, vp, k, r);
+    MPN_MUL_N_RECURSE (pm1, ue, ve, k + 1, ws);
+
+    toom3_eval_2 (ue, up, k, r);
+    toom3_eval_2 (ve, vp, k, r);
+    MPN_MUL_N_RECURSE (p2, ue, ve, k + 1, ws);
+
+    MPN_MUL_N_RECURSE (prodp, up, vp, k, ws);
+    MPN_MUL_N_RECURSE (prodp + 4 * k, up + 2 * k, vp + 2 * k, r, ws);
+
+    toom3_interpolate (prodp, size, k, r, p1, pm1, neg, p2, ue);
+}
+
+
+static void
+sqr_n_toom3 (mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size, mpi_ptr_t tspace)
+{
+    mpi_size_t k = (size + 2) / 3;
+    mpi_size_t r = size - 2 * k;
+    mpi_size_t wsize = 2 * k + 2;
+    mpi_ptr_t p1 = tspace;
+    mpi_ptr_t pm1 = p1 + wsize;
+    mpi_ptr_t p2 = pm1 + wsize;
+    mpi_ptr_t ue = p2 + wsize;
+    mpi_ptr_t ws = ue + 2 * k + 2;
+
+    toom3_eval_1 (ue, up, k, r);
+    MPN_SQR_N_RECURSE (p1, ue, k + 1, ws);
+
+    toom3_eval_m1 (ue, up, k, r);
+    MPN_SQR_N_RECURSE (pm1, ue, k + 1, ws);
+
+    toom3_eval_2 (ue, up, k, r);
+    MPN_SQR_N_RECURSE (p2, ue, k + 1, ws);
+
+    MPN_SQR_N_RECURSE (prodp, up, k, ws);
+    MPN_SQR_N_RECURSE (prodp + 4 * k, up + 2 * k, r, ws);
+
+    toom3_interpolate (prodp, size, k, r, p1, pm1, 0, p2, ue);
+}
+
+
+/* PRODP = UP * VP for operands of SIZE limbs with UP != VP.  TSPACE
+ * provides _gcry_mpih_mul_n_tspace (SIZE) limbs of scratch space.  */
+void
+_gcry_mpih_mul_n_recurse (mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
+                          mpi_size_t size, mpi_ptr_t tspace)
+{
+    MPN_MUL_N_RECURSE (prodp, up, vp, size, tspace);
+}
+
+
+/* PRODP = UP * UP for an operand of SIZE limbs.  TSPACE provides
+ * _gcry_mpih_sqr_n_tspace (SIZE) limbs of scratch space.  */
+void
+_gcry_mpih_sqr_n_recurse (mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size,
+                          mpi_ptr_t tspace)
+{
+    MPN_SQR_N_RECURSE (prodp, up, size, tspace);
+}
+
+
+/* Return the number of limbs of scratch space needed for a product of
+ * SIZE limbs if Karatsuba's algorithm is used from KTHRESHOLD and
+ * Toom-3 from THRESHOLD limbs on.  */
+static mpi_size_t
+tspace_size (mpi_size_t size, mpi_size_t kthreshold, mpi_size_t threshold)
+{
+    mpi_size_t k1;
+
+    if (size < kthreshold)
+	return 0;
+    if (size < threshold)
+	return 2 * size;
+    k1 = (size + 2) / 3 + 1;
+    return 8 * k1 + tspace_size (k1, kthreshold, threshold);
+}
+
+
+/* Return the number of limbs of scratch space needed by mul_n for
+ * operands of SIZE limbs.  */
+mpi_size_t
+_gcry_mpih_mul_n_tspace (mpi_size_t size)
+{
+    return tspace_size (size, KARATSUBA_THRESHOLD, toom3_mul_threshold);
+}
+
+
+/* Return the number of limbs of scratch space needed by
+ * _gcry_mpih_sqr_n for an operand of SIZE limbs.  */
+mpi_size_t
+_gcry_mpih_sqr_n_tspace (mpi_size_t size)
+{
+    return tspace_size (size, KARATSUBA_SQR_THRESHOLD, toom3_sqr_threshold);
+}
+
+
+/* Set the thresholds for Toom-3 multiplication and squaring to MUL
+ * and SQR limbs; 0 selects the default.  This is only meant for
+ * benchmarks and must not be called while other threads use the MPI
+ * functions.  */
+void
+_gcry_mpih_set_toom3_thresholds (unsigned int mul, unsigned int sqr)
+{
+    if (mul > INT_MAX)
+	mul = INT_MAX;
+    if (sqr > INT_MAX)
+	sqr = INT_MAX;
+    toom3_mul_threshold = !mul? TOOM3_MUL_THRESHOLD : mul;
+    toom3_sqr_threshold = !sqr? TOOM3_SQR_THRESHOLD : sqr;
+    if (toom3_mul_threshold < TOOM3_MIN_SIZE)
+	toom3_mul_threshold = TOOM3_MIN_SIZE;
+    if (toom3_sqr_threshold < TOOM3_MIN_SIZE)
+	toom3_sqr_threshold = TOOM3_MIN_SIZE;
+}
+
+
 /* This should be made into an inline function in gmp.h.  */
 void
 _gcry_mpih_mul_n( mpi_ptr_t prodp,
@@ -349,14 +643,15 @@ _gcry_mpih_mul_n( mpi_ptr_t prodp,
     int secure;
 
     if( up == vp ) {
-	if( size < KARATSUBA_THRESHOLD )
+	if( size < KARATSUBA_SQR_THRESHOLD )
 	    _gcry_mpih_sqr_n_basecase( prodp, up, size );
 	else {
 	    mpi_ptr_t tspace;
+	    mpi_size_t tsize = _gcry_mpih_sqr_n_tspace (size);
 	    secure = _gcry_is_secure( up );
-	    tspace = mpi_alloc_limb_space( 2 * size, secure );
-	    _gcry_mpih_sqr_n( prodp, up, size, tspace );
-	    _gcry_mpi_free_limb_space (tspace, 2 * size );
+	    tspace = mpi_alloc_limb_space( tsize, secure );
+	    MPN_SQR_N_RECURSE (prodp, up, size, tspace);
+	    _gcry_mpi_free_limb_space (tspace, tsize );
 	}
     }
     else {
@@ -364,10 +659,11 @@ _gcry_mpih_mul_n( mpi_ptr_t prodp,
 	    mul_n_basecase( prodp, up, vp, size );
 	else {
 	    mpi_ptr_t tspace;
+	    mpi_size_t tsize = _gcry_mpih_mul_n_tspace (size);
 	    secure = _gcry_is_secure( up ) || _gcry_is_secure( vp );
-	    tspace = mpi_alloc_limb_space( 2 * size, secure );
-	    mul_n (prodp, up, vp, size, tspace);
-	    _gcry_mpi_free_limb_space (tspace, 2 * size );
+	    tspace = mpi_alloc_limb_space( tsize, secure );
+	    MPN_MUL_N_RECURSE (prodp, up, vp, size, tspace);
+	    _gcry_mpi_free_limb_space (tspace, tsize );
 	}
     }
 }
@@ -385,8 +681,8 @@ _gcry_mpih_mul_karatsuba_case( mpi_ptr_t prodp,
     if( !ctx->tspace || ctx->tspace_size < vsize ) {
 	if( ctx->tspace )
 	    _gcry_mpi_free_limb_space( ctx->tspace, ctx->tspace_nlimbs );
-        ctx->tspace_nlimbs = 2 * vsize;
-	ctx->tspace = mpi_alloc_limb_space (2 * vsize,
+        ctx->tspace_nlimbs = MAX (2 * vsize, _gcry_mpih_mul_n_tspace (vsize));
+	ctx->tspace = mpi_alloc_limb_space (ctx->tspace_nlimbs,
 				            (_gcry_is_secure (up)
                                              || _gcry_is_secure (vp)));
 	ctx->tspace_size = vsize;
@@ -480,6 +776,12 @@ _gcry_mpih_mul( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t usize,
     mpi_limb_t cy;
     struct karatsuba_ctx ctx;
 
+    /* Squares use the faster squaring code.  */
+    if( up == vp && usize == vsize && vsize ) {
+	_gcry_mpih_mul_n( prodp, up, vp, vsize );
+	return *prod_endp;
+    }
+
     if( vsize < KARATSUBA_THRESHOLD ) {
 	mpi_size_t i;
 	mpi_limb_t v_limb;
@@ -487,6 +789,11 @@ _gcry_mpih_mul( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t usize,
 	if( !vsize )
 	    return 0;
 
+#ifdef HAVE_MPIH_ADDMUL_4
+	if( _gcry_mpih_use_adx && vsize >= 4 )
+	    return mul_basecase_4( prodp, up, usize, vp, vsize );
+#endif
+
 	/* Multiply by the first limb in V separately, as the result can be
 	 * stored (not added) to PROD.	We also avoid a loop for zeroing.  */
 	v_limb = vp[0];
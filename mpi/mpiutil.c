@@ -60,6 +60,27 @@ _gcry_mpi_get_hw_config (void)
 }
 
 
+int _gcry_mpih_use_adx;
+
+
+/* Select the BMI2/ADX variants of the limb functions if ENABLE is set
+   and the CPU supports them, or the plain variants otherwise.  Returns
+   true if the BMI2/ADX variants are used.  */
+int
+_gcry_mpih_set_use_adx (int enable)
+{
+#if defined(HAVE_CPU_ARCH_X86) && defined(HAVE_GCC_INLINE_ASM_ADX)
+  unsigned int hwf = _gcry_get_hw_features ();
+
+  _gcry_mpih_use_adx = (enable
+                        && (hwf & HWF_INTEL_BMI2) && (hwf & HWF_INTEL_ADX));
+#else
+  (void)enable;
+#endif
+  return _gcry_mpih_use_adx;
+}
+
+
 /* Initialize the MPI subsystem.  This is called early and allows to
    do some initialization without taking care of threading issues.  */
 gcry_err_code_t
@@ -68,6 +89,8 @@ _gcry_mpi_init (void)
   int idx;
   unsigned long value;
 
+  _gcry_mpih_set_use_adx (1);
+
   for (idx=0; idx < MPI_NUMBER_OF_CONSTANTS; idx++)
     {
       switch (idx)
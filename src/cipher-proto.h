@@ -76,9 +76,38 @@ typedef gcry_err_code_t (*gcry_pk_verify_t) (gcry_sexp_t s_sig,
                                              gcry_sexp_t s_data,
                                              gcry_sexp_t keyparms);
 
+/* Type for the pk_verify_batch function.  */
+typedef gcry_err_code_t (*gcry_pk_verify_batch_t) (unsigned int count,
+                                                   const gcry_sexp_t *s_sigs,
+                                                   const gcry_sexp_t *s_data,
+                                                   const gcry_sexp_t *keyparms,
+                                                   gcry_err_code_t *results);
+
 /* Type for the pk_get_nbits function.  */
 typedef unsigned (*gcry_pk_get_nbits_t) (gcry_sexp_t keyparms);
 
+/* Type for the pk_prepare function.  It parses KEYPARMS into an
+   algorithm specific object which is stored at R_KEY.  */
+typedef gcry_err_code_t (*gcry_pk_prepare_t) (void **r_key,
+                                              gcry_sexp_t keyparms);
+
+/* Type for the pk_release_prepared function.  */
+typedef void (*gcry_pk_release_prepared_t) (void *key);
+
+/* Types for the functions using a key returned by pk_prepare.  */
+typedef gcry_err_code_t (*gcry_pk_encrypt_prepared_t) (gcry_sexp_t *r_ciph,
+                                                       gcry_sexp_t s_data,
+                                                       void *key);
+typedef gcry_err_code_t (*gcry_pk_decrypt_prepared_t) (gcry_sexp_t *r_plain,
+                                                       gcry_sexp_t s_data,
+                                                       void *key);
+typedef gcry_err_code_t (*gcry_pk_sign_prepared_t) (gcry_sexp_t *r_sig,
+                                                    gcry_sexp_t s_data,
+                                                    void *key);
+typedef gcry_err_code_t (*gcry_pk_verify_prepared_t) (gcry_sexp_t s_sig,
+                                                      gcry_sexp_t s_data,
+                                                      void *key);
+
 
 /* The type used to compute the keygrip.  */
 typedef gpg_err_code_t (*pk_comp_keygrip_t) (gcry_md_hd_t md,
@@ -119,6 +148,13 @@ typedef struct gcry_pk_spec
   pk_comp_keygrip_t comp_keygrip;
   pk_get_curve_t get_curve;
   pk_get_curve_param_t get_curve_param;
+  gcry_pk_verify_batch_t verify_batch;
+  gcry_pk_prepare_t prepare;
+  gcry_pk_release_prepared_t release_prepared;
+  gcry_pk_encrypt_prepared_t encrypt_prepared;
+  gcry_pk_decrypt_prepared_t decrypt_prepared;
+  gcry_pk_sign_prepared_t sign_prepared;
+  gcry_pk_verify_prepared_t verify_prepared;
 } gcry_pk_spec_t;
 
 
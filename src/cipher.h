@@ -44,6 +44,7 @@
 #define PUBKEY_FLAG_DJB_TWEAK      (1 << 15)
 #define PUBKEY_FLAG_SM2            (1 << 16)
 #define PUBKEY_FLAG_PREHASH        (1 << 17)
+#define PUBKEY_FLAG_COFACTORED     (1 << 18)
 
 
 enum pk_operation
@@ -101,6 +102,8 @@ enum gcry_cipher_internal_modes
 gcry_err_code_t _gcry_cipher_open_internal (gcry_cipher_hd_t *handle,
 					    int algo, int mode,
 					    unsigned int flags);
+gcry_err_code_t _gcry_cipher_copy_internal (gcry_cipher_hd_t *handle,
+					    gcry_cipher_hd_t src);
 
 /*-- cipher-cmac.c --*/
 gcry_err_code_t _gcry_cipher_cmac_authenticate
@@ -123,6 +126,9 @@ gcry_err_code_t _gcry_blake2_init_with_key(void *ctx, unsigned int flags,
 					   const unsigned char *key,
 					   size_t keylen, int algo);
 
+/*-- rsa.c --*/
+void _gcry_rsa_set_crt_threads (unsigned int nbits);
+
 /*-- dsa.c --*/
 void _gcry_register_pk_dsa_progress (gcry_handler_progress_t cbc, void *cb_data);
 
@@ -134,6 +140,7 @@ void _gcry_register_pk_elg_progress (gcry_handler_progress_t cb,
 /*-- ecc.c --*/
 void _gcry_register_pk_ecc_progress (gcry_handler_progress_t cbc,
                                      void *cb_data);
+void _gcry_ecc_set_verify_cache (unsigned int max);
 
 
 /*-- primegen.c --*/
@@ -142,6 +149,9 @@ void _gcry_register_primegen_progress (gcry_handler_progress_t cb,
 
 /*-- pubkey.c --*/
 
+/*-- scrypt.c --*/
+int _gcry_scrypt_set_use_sse2 (int enable);
+
 /* Declarations for the cipher specifications.  */
 extern gcry_cipher_spec_t _gcry_cipher_spec_blowfish;
 extern gcry_cipher_spec_t _gcry_cipher_spec_des;
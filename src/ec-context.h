@@ -20,6 +20,11 @@
 #ifndef GCRY_EC_CONTEXT_H
 #define GCRY_EC_CONTEXT_H
 
+/* Precomputed table for fixed-base scalar multiplication.  The
+   structure is private to mpi/ec.c.  */
+struct mpi_ec_comb_s;
+typedef struct mpi_ec_comb_s *mpi_ec_comb_t;
+
 /* This context is used with all our EC functions. */
 struct mpi_ec_ctx_s
 {
@@ -51,12 +56,18 @@ struct mpi_ec_ctx_s
     struct {
       unsigned int a_is_pminus3:1;
       unsigned int two_inv_p:1;
+      unsigned int base_comb:1;
     } valid; /* Flags to help setting the helper vars below.  */
 
     int a_is_pminus3;  /* True if A = P - 3. */
 
     gcry_mpi_t two_inv_p;
 
+    mpi_ec_comb_t base_comb;  /* Shared table for the standard base
+                                 point or NULL.  */
+
+    mpi_ec_comb_t key_comb;   /* Table for the public key Q or NULL.  */
+
     mpi_barrett_t p_barrett;
 
     /* Scratch variables.  */
@@ -79,6 +90,28 @@ struct mpi_ec_ctx_s
 
 /*-- mpi/ec.c --*/
 void _gcry_mpi_ec_get_reset (mpi_ec_t ec);
+mpi_ec_comb_t _gcry_mpi_ec_comb_new (mpi_point_t base, unsigned int nbits,
+                                     mpi_ec_t ec);
+void _gcry_mpi_ec_comb_free (mpi_ec_comb_t comb);
+void _gcry_mpi_ec_precompute_key (mpi_ec_t ec);
+
+/*-- mpi/ec-ed25519.c --*/
+/* The radix 2^51 arithmetic for the field of Curve25519 requires a
+   128 bit integer type.  */
+#if defined(HAVE_TYPE_U64) && defined(__SIZEOF_INT128__)
+# define USE_FE25519_51 1
+int _gcry_mpi_ec_get_le32 (unsigned char *buf, gcry_mpi_t a);
+int _gcry_mpi_ec_x25519 (unsigned char *result, const unsigned char *scalar,
+                         const unsigned char *u);
+int _gcry_mpi_ec_ed25519_mul_base (unsigned char *result, gcry_mpi_t scalar);
+int _gcry_mpi_ec_ed25519_mul_double (unsigned char *result, gcry_mpi_t s,
+                                     gcry_mpi_t h, mpi_point_t q);
+int _gcry_mpi_ec_ed25519_decodepoint (mpi_point_t result,
+                                      const unsigned char *s);
+int _gcry_mpi_ec_ed25519_mul_points (unsigned char *result, gcry_mpi_t s,
+                                     unsigned int n, gcry_mpi_t *k,
+                                     mpi_point_t *p);
+#endif
 
 
 /*-- cipher/ecc-curves.c --*/
@@ -88,6 +121,9 @@ gpg_err_code_t   _gcry_ecc_set_mpi (const char *name,
                                     gcry_mpi_t newvalue, mpi_ec_t ec);
 gpg_err_code_t   _gcry_ecc_set_point (const char *name,
                                       gcry_mpi_point_t newvalue, mpi_ec_t ec);
+mpi_ec_comb_t    _gcry_ecc_get_base_comb (mpi_ec_t ec);
+int              _gcry_ecc_std_domain_p (mpi_ec_t ec);
+int              _gcry_ecc_same_curve_p (mpi_ec_t a, mpi_ec_t b);
 
 /*-- cipher/ecc-misc.c --*/
 gpg_err_code_t _gcry_ecc_sec_decodepoint (gcry_mpi_t value, mpi_ec_t ec,
@@ -151,6 +151,16 @@ int   _gcry_is_secure (const void *a) _GCRY_GCC_ATTR_PURE;
 #define xfree(a)         _gcry_free ((a))
 
 
+/*-- src/worker.c --*/
+gpg_err_code_t _gcry_worker_start (void **r_job,
+                                   void (*fn) (void *arg), void *arg);
+void _gcry_worker_wait (void *job);
+gpg_err_code_t _gcry_worker_start_background (void (*fn) (void *arg),
+                                              void *arg);
+void _gcry_worker_checkpoint (void);
+int _gcry_worker_self_p (void);
+
+
 /*-- src/misc.c --*/
 
 #if defined(JNLIB_GCC_M_FUNCTION) || __STDC_VERSION__ >= 199901L
@@ -238,6 +248,7 @@ char **_gcry_strtokenize (const char *string, const char *delim);
 #define HWF_INTEL_RDTSC         (1 << 15)
 #define HWF_INTEL_SHAEXT        (1 << 16)
 #define HWF_INTEL_VAES_VPCLMUL  (1 << 17)
+#define HWF_INTEL_ADX           (1 << 18)
 
 #elif defined(HAVE_CPU_ARCH_ARM)
 
@@ -281,6 +292,17 @@ const char *_gcry_mpi_get_hw_config (void);
 
 /*-- primegen.c --*/
 gcry_err_code_t _gcry_primegen_init (void);
+void _gcry_primegen_set_threads (unsigned int nthreads);
+unsigned int _gcry_primegen_get_threads (void);
+gpg_err_code_t _gcry_primegen_set_pool (unsigned int nbits,
+                                        unsigned int count);
+gpg_err_code_t _gcry_primegen_get_pool_stats (unsigned int nbits,
+                                              unsigned int *r_ready,
+                                              unsigned int *r_hits,
+                                              unsigned int *r_misses);
+void _gcry_primegen_run_parts (unsigned int nparts,
+                               void (*fn) (void *arg, unsigned int part),
+                               void *arg);
 gcry_mpi_t _gcry_generate_secret_prime (unsigned int nbits,
                                  gcry_random_level_t random_level,
                                  int (*extra_check)(void*, gcry_mpi_t),
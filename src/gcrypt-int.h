@@ -95,6 +95,21 @@ gpg_err_code_t _gcry_pk_sign (gcry_sexp_t *result,
                               gcry_sexp_t data, gcry_sexp_t skey);
 gpg_err_code_t _gcry_pk_verify (gcry_sexp_t sigval,
                                 gcry_sexp_t data, gcry_sexp_t pkey);
+gpg_err_code_t _gcry_pk_verify_batch (unsigned int count,
+                                      const gcry_sexp_t *sigvals,
+                                      const gcry_sexp_t *data,
+                                      const gcry_sexp_t *pkeys,
+                                      gpg_error_t *results);
+gpg_err_code_t _gcry_pk_key_new (gcry_pk_key_t *r_key, gcry_sexp_t s_key);
+void _gcry_pk_key_release (gcry_pk_key_t key);
+gpg_err_code_t _gcry_pk_encrypt_key (gcry_sexp_t *result,
+                                     gcry_sexp_t data, gcry_pk_key_t key);
+gpg_err_code_t _gcry_pk_decrypt_key (gcry_sexp_t *result,
+                                     gcry_sexp_t data, gcry_pk_key_t key);
+gpg_err_code_t _gcry_pk_sign_key (gcry_sexp_t *result,
+                                  gcry_sexp_t data, gcry_pk_key_t key);
+gpg_err_code_t _gcry_pk_verify_key (gcry_sexp_t sigval,
+                                    gcry_sexp_t data, gcry_pk_key_t key);
 gpg_err_code_t _gcry_pk_testkey (gcry_sexp_t key);
 gpg_err_code_t _gcry_pk_genkey (gcry_sexp_t *r_key, gcry_sexp_t s_parms);
 gpg_err_code_t _gcry_pk_ctl (int cmd, void *buffer, size_t buflen);
@@ -168,6 +183,8 @@ void _gcry_md_debug (gcry_md_hd_t hd, const char *suffix);
 gpg_err_code_t _gcry_mac_open (gcry_mac_hd_t *handle, int algo,
                             unsigned int flags, gcry_ctx_t ctx);
 void _gcry_mac_close (gcry_mac_hd_t h);
+gpg_err_code_t _gcry_mac_copy (gcry_mac_hd_t *handle_dst,
+                               gcry_mac_hd_t handle_src);
 gpg_err_code_t _gcry_mac_ctl (gcry_mac_hd_t h, int cmd, void *buffer,
                            size_t buflen);
 gpg_err_code_t _gcry_mac_algo_info (int algo, int what, void *buffer,
@@ -195,6 +212,28 @@ gpg_err_code_t _gcry_kdf_derive (const void *passphrase, size_t passphraselen,
                                  const void *salt, size_t saltlen,
                                  unsigned long iterations,
                                  size_t keysize, void *keybuffer);
+gpg_err_code_t _gcry_kdf_derive_batch (unsigned int count,
+                                       const void * const *passphrases,
+                                       const size_t *passphraselens,
+                                       int algo, int subalgo,
+                                       const void * const *salts,
+                                       const size_t *saltlens,
+                                       unsigned long iterations,
+                                       size_t keysize,
+                                       void * const *keybuffers);
+
+gpg_err_code_t _gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+                               const unsigned long *param,
+                               unsigned int paramlen,
+                               const void *passphrase, size_t passphraselen,
+                               const void *salt, size_t saltlen,
+                               const void *key, size_t keylen,
+                               const void *ad, size_t adlen);
+gpg_err_code_t _gcry_kdf_compute (gcry_kdf_hd_t h,
+                                  const gcry_kdf_thread_ops_t *ops);
+gpg_err_code_t _gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen,
+                                void *result);
+void _gcry_kdf_close (gcry_kdf_hd_t h);
 
 
 gpg_err_code_t _gcry_prime_generate (gcry_mpi_t *prime,
@@ -32,6 +32,9 @@
 #define PRIV_CTL_DEINIT_EXTRNG_TEST 60
 #define PRIV_CTL_EXTERNAL_LOCK_TEST 61
 #define PRIV_CTL_DUMP_SECMEM_STATS  62
+#define PRIV_CTL_SET_TOOM3_THRESHOLDS 82
+#define PRIV_CTL_SET_MPIH_ADX       86
+#define PRIV_CTL_SET_SCRYPT_SSE2    87
 
 #define EXTERNAL_LOCK_TEST_INIT       30111
 #define EXTERNAL_LOCK_TEST_LOCK       30112
@@ -37,6 +37,7 @@
 #include "g10lib.h"
 #include "gcrypt-testapi.h"
 #include "cipher.h"
+#include "mpi.h"
 #include "stdmem.h" /* our own memory allocator */
 #include "secmem.h" /* our own secmem allocator */
 
@@ -761,6 +762,32 @@ _gcry_vcontrol (enum gcry_ctl_cmds cmd, va_list arg_ptr)
     case PRIV_CTL_DUMP_SECMEM_STATS:
       _gcry_secmem_dump_stats (1);
       break;
+    case PRIV_CTL_SET_TOOM3_THRESHOLDS: /* Used by benchmarks and tests.  */
+      {
+        unsigned int mul = va_arg (arg_ptr, unsigned int);
+        unsigned int sqr = va_arg (arg_ptr, unsigned int);
+        _gcry_mpih_set_toom3_thresholds (mul, sqr);
+      }
+      break;
+    case PRIV_CTL_SET_MPIH_ADX: /* Used by tests.  */
+      {
+        int enable = va_arg (arg_ptr, int);
+        if (_gcry_mpih_set_use_adx (enable) != !!enable)
+          rc = GPG_ERR_NOT_SUPPORTED;
+      }
+      break;
+    case PRIV_CTL_SET_SCRYPT_SSE2: /* Used by tests.  */
+      {
+        int enable = va_arg (arg_ptr, int);
+#if USE_SCRYPT
+        if (_gcry_scrypt_set_use_sse2 (enable) != !!enable)
+          rc = GPG_ERR_NOT_SUPPORTED;
+#else
+        (void)enable;
+        rc = GPG_ERR_NOT_SUPPORTED;
+#endif
+      }
+      break;
 
     case GCRYCTL_DISABLE_HWF:
       {
@@ -835,6 +862,45 @@ _gcry_vcontrol (enum gcry_ctl_cmds cmd, va_list arg_ptr)
         gpgrt_get_syscall_clamp (&pre_syscall_func, &post_syscall_func);
       break;
 
+    case GCRYCTL_SET_ECC_VERIFY_CACHE:
+      {
+        unsigned int max = va_arg (arg_ptr, unsigned int);
+        _gcry_ecc_set_verify_cache (max);
+      }
+      break;
+
+    case GCRYCTL_SET_RSA_CRT_THREADS:
+      {
+        unsigned int nbits = va_arg (arg_ptr, unsigned int);
+        _gcry_rsa_set_crt_threads (nbits);
+      }
+      break;
+
+    case GCRYCTL_SET_PRIMEGEN_THREADS:
+      {
+        unsigned int nthreads = va_arg (arg_ptr, unsigned int);
+        _gcry_primegen_set_threads (nthreads);
+      }
+      break;
+
+    case GCRYCTL_SET_PRIME_POOL:
+      {
+        unsigned int nbits = va_arg (arg_ptr, unsigned int);
+        unsigned int count = va_arg (arg_ptr, unsigned int);
+        rc = _gcry_primegen_set_pool (nbits, count);
+      }
+      break;
+
+    case GCRYCTL_GET_PRIME_POOL_STATS:
+      {
+        unsigned int nbits = va_arg (arg_ptr, unsigned int);
+        unsigned int *r_ready = va_arg (arg_ptr, unsigned int *);
+        unsigned int *r_hits = va_arg (arg_ptr, unsigned int *);
+        unsigned int *r_misses = va_arg (arg_ptr, unsigned int *);
+        rc = _gcry_primegen_get_pool_stats (nbits, r_ready, r_hits, r_misses);
+      }
+      break;
+
     default:
       _gcry_set_preferred_rng_type (0);
       rc = GPG_ERR_INV_OP;
@@ -376,6 +376,10 @@ detect_x86_gnuc (void)
       if (features & 0x00000100)
           result |= HWF_INTEL_BMI2;
 
+      /* Test bit 19 for ADX.  */
+      if (features & 0x00080000)
+          result |= HWF_INTEL_ADX;
+
 #ifdef ENABLE_AVX2_SUPPORT
       /* Test bit 5 for AVX2.  */
       if (features & 0x00000020)
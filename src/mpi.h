@@ -211,10 +211,27 @@ void _gcry_mpi_mul_barrett (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
                             mpi_barrett_t ctx);
 
 
+/*-- mpi-pow.c --*/
+/* Precomputed table for exponentiations with a fixed base.  */
+struct mpi_powm_comb_s;
+typedef struct mpi_powm_comb_s *mpi_powm_comb_t;
+
+mpi_powm_comb_t _gcry_mpi_powm_comb_new (gcry_mpi_t base, gcry_mpi_t mod,
+                                         unsigned int nbits);
+void _gcry_mpi_powm_comb_free (mpi_powm_comb_t comb);
+void _gcry_mpi_powm_comb (gcry_mpi_t res, gcry_mpi_t expo,
+                          mpi_powm_comb_t comb);
+
 /*-- mpi-mpow.c --*/
 #define mpi_mulpowm(a,b,c,d) _gcry_mpi_mulpowm ((a),(b),(c),(d))
 void _gcry_mpi_mulpowm( gcry_mpi_t res, gcry_mpi_t *basearray, gcry_mpi_t *exparray, gcry_mpi_t mod);
 
+/*-- mpih-mul.c --*/
+void _gcry_mpih_set_toom3_thresholds (unsigned int mul, unsigned int sqr);
+
+/*-- mpiutil.c --*/
+int _gcry_mpih_set_use_adx (int enable);
+
 /*-- mpi-scan.c --*/
 #define mpi_trailing_zeros(a) _gcry_mpi_trailing_zeros ((a))
 int      _gcry_mpi_getbyte( gcry_mpi_t a, unsigned idx );
@@ -298,6 +315,13 @@ void _gcry_mpi_ec_sub_points (mpi_point_t result,
 void _gcry_mpi_ec_mul_point (mpi_point_t result,
                              gcry_mpi_t scalar, mpi_point_t point,
                              mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_point2 (mpi_point_t result,
+                              gcry_mpi_t scalar1, mpi_point_t point1,
+                              gcry_mpi_t scalar2, mpi_point_t point2,
+                              mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_points (mpi_point_t result, unsigned int count,
+                              gcry_mpi_t *scalars, mpi_point_t *points,
+                              mpi_ec_t ctx);
 int  _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx);
 int _gcry_mpi_ec_bad_point (gcry_mpi_point_t point, mpi_ec_t ctx);
 
@@ -940,6 +940,18 @@ gcry_mac_close (gcry_mac_hd_t hd)
   _gcry_mac_close (hd);
 }
 
+gcry_error_t
+gcry_mac_copy (gcry_mac_hd_t *handle_dst, gcry_mac_hd_t handle_src)
+{
+  if (!fips_is_operational ())
+    {
+      *handle_dst = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+
+  return gpg_error (_gcry_mac_copy (handle_dst, handle_src));
+}
+
 gcry_error_t
 gcry_mac_setkey (gcry_mac_hd_t hd, const void *key, size_t keylen)
 {
@@ -1035,6 +1047,75 @@ gcry_pk_verify (gcry_sexp_t sigval, gcry_sexp_t data, gcry_sexp_t pkey)
   return gpg_error (_gcry_pk_verify (sigval, data, pkey));
 }
 
+gcry_error_t
+gcry_pk_verify_batch (unsigned int count, const gcry_sexp_t *sigvals,
+                      const gcry_sexp_t *data, const gcry_sexp_t *pkeys,
+                      gcry_error_t *results)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_pk_verify_batch (count, sigvals, data, pkeys,
+                                           results));
+}
+
+gcry_error_t
+gcry_pk_key_new (gcry_pk_key_t *r_key, gcry_sexp_t s_key)
+{
+  if (!fips_is_operational ())
+    {
+      *r_key = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_key_new (r_key, s_key));
+}
+
+void
+gcry_pk_key_release (gcry_pk_key_t key)
+{
+  _gcry_pk_key_release (key);
+}
+
+gcry_error_t
+gcry_pk_encrypt_key (gcry_sexp_t *result, gcry_sexp_t data, gcry_pk_key_t key)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_encrypt_key (result, data, key));
+}
+
+gcry_error_t
+gcry_pk_decrypt_key (gcry_sexp_t *result, gcry_sexp_t data, gcry_pk_key_t key)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_decrypt_key (result, data, key));
+}
+
+gcry_error_t
+gcry_pk_sign_key (gcry_sexp_t *result, gcry_sexp_t data, gcry_pk_key_t key)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_sign_key (result, data, key));
+}
+
+gcry_error_t
+gcry_pk_verify_key (gcry_sexp_t sigval, gcry_sexp_t data, gcry_pk_key_t key)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_pk_verify_key (sigval, data, key));
+}
+
 gcry_error_t
 gcry_pk_testkey (gcry_sexp_t key)
 {
@@ -1339,6 +1420,63 @@ gcry_kdf_derive (const void *passphrase, size_t passphraselen,
                                       keysize, keybuffer));
 }
 
+gpg_error_t
+gcry_kdf_derive_batch (unsigned int count,
+                       const void * const *passphrases,
+                       const size_t *passphraselens,
+                       int algo, int subalgo,
+                       const void * const *salts, const size_t *saltlens,
+                       unsigned long iterations,
+                       size_t keysize, void * const *keybuffers)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_kdf_derive_batch (count, passphrases, passphraselens,
+                                            algo, subalgo, salts, saltlens,
+                                            iterations, keysize, keybuffers));
+}
+
+gpg_error_t
+gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+               const unsigned long *param, unsigned int paramlen,
+               const void *passphrase, size_t passphraselen,
+               const void *salt, size_t saltlen,
+               const void *key, size_t keylen,
+               const void *ad, size_t adlen)
+{
+  if (!fips_is_operational ())
+    {
+      if (hd)
+        *hd = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_kdf_open (hd, algo, subalgo, param, paramlen,
+                                    passphrase, passphraselen, salt, saltlen,
+                                    key, keylen, ad, adlen));
+}
+
+gpg_error_t
+gcry_kdf_compute (gcry_kdf_hd_t h, const gcry_kdf_thread_ops_t *ops)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_kdf_compute (h, ops));
+}
+
+gpg_error_t
+gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen, void *result)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_kdf_final (h, resultlen, result));
+}
+
+void
+gcry_kdf_close (gcry_kdf_hd_t h)
+{
+  _gcry_kdf_close (h);
+}
+
 void
 gcry_randomize (void *buffer, size_t length, enum gcry_random_level level)
 {
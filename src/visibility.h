@@ -143,6 +143,7 @@ MARK_VISIBLEX (gcry_mac_get_algo_maclen)
 MARK_VISIBLEX (gcry_mac_get_algo_keylen)
 MARK_VISIBLEX (gcry_mac_open)
 MARK_VISIBLEX (gcry_mac_close)
+MARK_VISIBLEX (gcry_mac_copy)
 MARK_VISIBLEX (gcry_mac_setkey)
 MARK_VISIBLEX (gcry_mac_setiv)
 MARK_VISIBLEX (gcry_mac_write)
@@ -164,11 +165,23 @@ MARK_VISIBLEX (gcry_pk_map_name)
 MARK_VISIBLEX (gcry_pk_sign)
 MARK_VISIBLEX (gcry_pk_testkey)
 MARK_VISIBLEX (gcry_pk_verify)
+MARK_VISIBLEX (gcry_pk_verify_batch)
+MARK_VISIBLEX (gcry_pk_key_new)
+MARK_VISIBLEX (gcry_pk_key_release)
+MARK_VISIBLEX (gcry_pk_encrypt_key)
+MARK_VISIBLEX (gcry_pk_decrypt_key)
+MARK_VISIBLEX (gcry_pk_sign_key)
+MARK_VISIBLEX (gcry_pk_verify_key)
 MARK_VISIBLEX (gcry_pubkey_get_sexp)
 MARK_VISIBLEX (gcry_ecc_get_algo_keylen)
 MARK_VISIBLEX (gcry_ecc_mul_point)
 
 MARK_VISIBLEX (gcry_kdf_derive)
+MARK_VISIBLEX (gcry_kdf_open)
+MARK_VISIBLEX (gcry_kdf_compute)
+MARK_VISIBLEX (gcry_kdf_final)
+MARK_VISIBLEX (gcry_kdf_close)
+MARK_VISIBLEX (gcry_kdf_derive_batch)
 
 MARK_VISIBLEX (gcry_prime_check)
 MARK_VISIBLEX (gcry_prime_generate)
@@ -363,6 +376,13 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_pk_sign                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_testkey             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_verify              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_verify_batch        _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_key_new             _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_key_release         _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_encrypt_key         _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_decrypt_key         _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_sign_key            _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_verify_key          _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pubkey_get_sexp        _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_ecc_get_algo_keylen    _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_ecc_mul_point          _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -398,6 +418,7 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_mac_get_algo_keylen    _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_open               _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_close              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_mac_copy               _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_setkey             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_setiv              _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_mac_write              _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -406,6 +427,11 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_mac_ctl                _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_kdf_derive             _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_open               _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_compute            _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_final              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_close              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_derive_batch       _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_prime_check            _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_prime_generate         _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -0,0 +1,414 @@
+/* worker.c - Internal pool of worker threads
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The pool is used by operations which can split their work into a
+   few independent parts.  Threads are created on demand up to a small
+   maximum and then wait for further jobs; they are never terminated.
+   If no thread is available for a job, _gcry_worker_start fails and
+   the caller is expected to run the job itself.  Thus a job never
+   waits in a queue behind the jobs of other callers.
+
+   For long running tasks a separate thread with a low scheduling
+   priority can be started by _gcry_worker_start_background.  Such a
+   thread takes the locks of the RNG and of the secure memory while
+   the application may call fork at any time; a lock held at that
+   moment would stay locked in the child forever.  The thread thus
+   calls _gcry_worker_checkpoint whenever it holds no lock and fork
+   waits until all these threads have reached a checkpoint.  */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+# include <signal.h>
+# include <sched.h>
+#endif
+
+#include "g10lib.h"
+
+
+#ifdef HAVE_PTHREAD
+
+/* The maximum number of threads in the pool.  */
+#define MAX_WORKERS 8
+
+struct worker_job
+{
+  struct worker_job *next;
+  void (*fn) (void *arg);
+  void *arg;
+  int done;
+};
+
+/* WORKER_LOCK protects all following variables.  A new job is
+   announced with WORKER_COND; a finished one with WORKER_DONE_COND.
+   WORKER_IDLE is the number of threads which are not running a job
+   and have not been assigned one.  */
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t worker_done_cond = PTHREAD_COND_INITIALIZER;
+static struct worker_job *worker_queue;
+static int worker_count;
+static int worker_idle;
+static pthread_once_t worker_once = PTHREAD_ONCE_INIT;
+
+/* Set to a non-NULL value in the threads of the pool and to the
+   background_job in a background thread.  */
+static pthread_key_t worker_key;
+
+
+/* A running thread started by _gcry_worker_start_background.  */
+struct background_job
+{
+  struct background_job *next;
+  void (*fn) (void *arg);
+  void *arg;
+  pthread_t thread;
+  int parked;               /* Waiting in _gcry_worker_checkpoint.  */
+};
+
+/* BACKGROUND_LOCK protects the following variables.  BACKGROUND_COND
+   is signaled when a thread has been parked and when FORKING has been
+   reset.  FORKING is set by the prepare handler of fork.  */
+static pthread_mutex_t background_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t background_cond = PTHREAD_COND_INITIALIZER;
+static struct background_job *background_list;
+static int forking;
+
+
+/* Wait until all background threads are parked and keep
+   BACKGROUND_LOCK until the fork has been done.  A thread scheduled
+   with SCHED_IDLE gets little CPU time while other threads keep the
+   CPUs busy; where the process is permitted to do so it is thus
+   raised to the normal policy and lowers itself again in
+   _gcry_worker_checkpoint.  */
+static void
+worker_atfork_prepare (void)
+{
+  struct background_job *job;
+  int waiting;
+
+  pthread_mutex_lock (&background_lock);
+  forking = 1;
+  for (;;)
+    {
+      waiting = 0;
+      for (job = background_list; job; job = job->next)
+        if (!job->parked)
+          {
+#ifdef SCHED_IDLE
+            struct sched_param param;
+
+            memset (&param, 0, sizeof param);
+            pthread_setschedparam (job->thread, SCHED_OTHER, &param);
+#endif
+            waiting = 1;
+          }
+      if (!waiting)
+        break;
+      pthread_cond_wait (&background_cond, &background_lock);
+    }
+}
+
+
+static void
+worker_atfork_parent (void)
+{
+  forking = 0;
+  pthread_cond_broadcast (&background_cond);
+  pthread_mutex_unlock (&background_lock);
+}
+
+
+/* The threads are not inherited by a child process.  The state of the
+   pool is reset in the child; this includes the condition variables
+   which may still account for the waiting threads of the parent.  */
+static void
+worker_atfork_child (void)
+{
+  pthread_mutex_init (&worker_lock, NULL);
+  pthread_cond_init (&worker_cond, NULL);
+  pthread_cond_init (&worker_done_cond, NULL);
+  worker_queue = NULL;
+  worker_count = 0;
+  worker_idle = 0;
+
+  pthread_mutex_init (&background_lock, NULL);
+  pthread_cond_init (&background_cond, NULL);
+  background_list = NULL;
+  forking = 0;
+}
+
+
+static void
+worker_init (void)
+{
+  pthread_key_create (&worker_key, NULL);
+  pthread_atfork (worker_atfork_prepare, worker_atfork_parent,
+                  worker_atfork_child);
+}
+
+
+static void *
+worker_thread (void *arg)
+{
+  struct worker_job *job;
+
+  (void)arg;
+
+  pthread_setspecific (worker_key, &worker_key);
+  pthread_mutex_lock (&worker_lock);
+  for (;;)
+    {
+      while (!worker_queue)
+        pthread_cond_wait (&worker_cond, &worker_lock);
+      job = worker_queue;
+      worker_queue = job->next;
+      pthread_mutex_unlock (&worker_lock);
+
+      job->fn (job->arg);
+
+      pthread_mutex_lock (&worker_lock);
+      job->done = 1;
+      worker_idle++;
+      pthread_cond_broadcast (&worker_done_cond);
+    }
+
+  return NULL;
+}
+
+
+/* Create a detached thread running START_ROUTINE (ARG).  */
+static gpg_err_code_t
+worker_create (void *(*start_routine) (void *), void *arg)
+{
+  pthread_attr_t attr;
+  pthread_t thread;
+  sigset_t all, old;
+  int rc;
+
+  if (pthread_attr_init (&attr))
+    return GPG_ERR_RESOURCE_LIMIT;
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+  /* The threads shall not receive the signals of the application.  */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  rc = pthread_create (&thread, &attr, start_routine, arg);
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  pthread_attr_destroy (&attr);
+
+  return rc? GPG_ERR_RESOURCE_LIMIT : 0;
+}
+
+
+/* Set the scheduling policy of the calling background thread.  */
+static void
+background_set_idle (void)
+{
+#ifdef SCHED_IDLE
+  struct sched_param param;
+
+  memset (&param, 0, sizeof param);
+  pthread_setschedparam (pthread_self (), SCHED_IDLE, &param);
+#endif
+}
+
+
+static void *
+background_thread (void *arg)
+{
+  struct background_job job = *(struct background_job *)arg;
+  struct background_job **pp;
+
+  xfree (arg);
+  job.thread = pthread_self ();
+  job.parked = 0;
+  pthread_setspecific (worker_key, &job);
+  background_set_idle ();
+
+  pthread_mutex_lock (&background_lock);
+  while (forking)
+    pthread_cond_wait (&background_cond, &background_lock);
+  job.next = background_list;
+  background_list = &job;
+  pthread_mutex_unlock (&background_lock);
+
+  job.fn (job.arg);
+
+  pthread_mutex_lock (&background_lock);
+  for (pp = &background_list; *pp != &job; pp = &(*pp)->next)
+    ;
+  *pp = job.next;
+  pthread_cond_broadcast (&background_cond);
+  pthread_mutex_unlock (&background_lock);
+  return NULL;
+}
+
+#endif /*HAVE_PTHREAD*/
+
+
+/* Run FN (ARG) on a thread of the pool.  On success a handle for the
+   job is stored at R_JOB, which must be passed to _gcry_worker_wait.
+   If no thread is available an error is returned and the caller
+   needs to run FN itself.  */
+gpg_err_code_t
+_gcry_worker_start (void **r_job, void (*fn) (void *arg), void *arg)
+{
+#ifdef HAVE_PTHREAD
+  struct worker_job *job, **pp;
+  gpg_err_code_t rc = 0;
+
+  *r_job = NULL;
+
+  job = xtrymalloc (sizeof *job);
+  if (!job)
+    return gpg_err_code_from_syserror ();
+  job->next = NULL;
+  job->fn = fn;
+  job->arg = arg;
+  job->done = 0;
+
+  pthread_once (&worker_once, worker_init);
+  pthread_mutex_lock (&worker_lock);
+  if (worker_idle)
+    worker_idle--;
+  else if (worker_count < MAX_WORKERS
+           && !(rc = worker_create (worker_thread, NULL)))
+    worker_count++;
+  else if (!rc)
+    rc = GPG_ERR_EAGAIN;
+
+  if (!rc)
+    {
+      for (pp = &worker_queue; *pp; pp = &(*pp)->next)
+        ;
+      *pp = job;
+      pthread_cond_signal (&worker_cond);
+    }
+  pthread_mutex_unlock (&worker_lock);
+
+  if (rc)
+    xfree (job);
+  else
+    *r_job = job;
+  return rc;
+#else /*!HAVE_PTHREAD*/
+  (void)fn;
+  (void)arg;
+  *r_job = NULL;
+  return GPG_ERR_NOT_SUPPORTED;
+#endif /*!HAVE_PTHREAD*/
+}
+
+
+/* Wait until the job JOB started by _gcry_worker_start has finished
+   and release JOB.  */
+void
+_gcry_worker_wait (void *job)
+{
+#ifdef HAVE_PTHREAD
+  struct worker_job *j = job;
+
+  if (!j)
+    return;
+  pthread_mutex_lock (&worker_lock);
+  while (!j->done)
+    pthread_cond_wait (&worker_done_cond, &worker_lock);
+  pthread_mutex_unlock (&worker_lock);
+  xfree (j);
+#else
+  (void)job;
+#endif
+}
+
+
+/* Run FN (ARG) on a new thread which terminates when FN returns.
+   Where supported the thread runs with the lowest scheduling
+   priority, so that it only uses otherwise idle CPU time.  The thread
+   is not part of the pool but _gcry_worker_self_p returns true for
+   it.  */
+gpg_err_code_t
+_gcry_worker_start_background (void (*fn) (void *arg), void *arg)
+{
+#ifdef HAVE_PTHREAD
+  struct background_job *job;
+  gpg_err_code_t rc;
+
+  job = xtrymalloc (sizeof *job);
+  if (!job)
+    return gpg_err_code_from_syserror ();
+  job->fn = fn;
+  job->arg = arg;
+
+  pthread_once (&worker_once, worker_init);
+  rc = worker_create (background_thread, job);
+  if (rc)
+    xfree (job);
+  return rc;
+#else /*!HAVE_PTHREAD*/
+  (void)fn;
+  (void)arg;
+  return GPG_ERR_NOT_SUPPORTED;
+#endif /*!HAVE_PTHREAD*/
+}
+
+
+/* Let a fork proceed if one is pending.  Must be called by the
+   threads started by _gcry_worker_start_background at points where
+   they do not hold any lock; in other threads this does nothing.  */
+void
+_gcry_worker_checkpoint (void)
+{
+#ifdef HAVE_PTHREAD
+  struct background_job *job;
+
+  pthread_once (&worker_once, worker_init);
+  job = pthread_getspecific (worker_key);
+  if (!job || job == (void *)&worker_key)
+    return;
+
+  pthread_mutex_lock (&background_lock);
+  if (forking)
+    {
+      job->parked = 1;
+      pthread_cond_broadcast (&background_cond);
+      while (forking)
+        pthread_cond_wait (&background_cond, &background_lock);
+      job->parked = 0;
+      background_set_idle ();
+    }
+  pthread_mutex_unlock (&background_lock);
+#endif
+}
+
+
+/* Return true if the calling thread is a thread of the pool or has
+   been started by _gcry_worker_start_background.  */
+int
+_gcry_worker_self_p (void)
+{
+#ifdef HAVE_PTHREAD
+  pthread_once (&worker_once, worker_init);
+  return !!pthread_getspecific (worker_key);
+#else
+  return 0;
+#endif
+}
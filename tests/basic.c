@@ -12368,6 +12368,7 @@ check_one_mac (int algo, const char *data, int datalen,
 	       const char *expect, int test_buffering)
 {
   gcry_mac_hd_t hd;
+  gcry_mac_hd_t hd2 = NULL;
   unsigned char *p;
   unsigned int maclen;
   size_t macoutlen;
@@ -12428,6 +12429,14 @@ check_one_mac (int algo, const char *data, int datalen,
         goto out;
     }
 
+  /* Take a copy of the keyed handle; it is checked below.  */
+  clutter_vector_registers();
+  err = gcry_mac_copy (&hd2, hd);
+  if (err)
+    fail("algo %d, mac gcry_mac_copy failed: %s\n", algo, gpg_strerror (err));
+  if (err)
+    goto out;
+
   if (test_buffering)
     {
       for (i = 0; i < datalen; i++)
@@ -12534,9 +12543,28 @@ check_one_mac (int algo, const char *data, int datalen,
   if (err)
     goto out;
 
+  /* The copy of the keyed handle must compute the same MAC.  */
+  if (!test_buffering && !((*data == '!' || *data == '?') && !data[1]))
+    {
+      clutter_vector_registers();
+      err = gcry_mac_write (hd2, data, datalen);
+      if (err)
+        fail("algo %d, mac gcry_mac_write on copy failed: %s\n", algo,
+             gpg_strerror (err));
+      if (err)
+        goto out;
+
+      clutter_vector_registers();
+      err = gcry_mac_verify (hd2, expect, maclen);
+      if (err)
+        fail("algo %d, mac gcry_mac_verify on copy failed: %s\n", algo,
+             gpg_strerror (err));
+    }
+
 out:
   free (p);
   gcry_mac_close (hd);
+  gcry_mac_close (hd2);
 }
 
 static void
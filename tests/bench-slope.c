@@ -2021,9 +2021,22 @@ bench_kdf_init (struct bench_obj *obj)
       obj->max_bufsize = 2 * 32;
       obj->step_size = 2;
     }
+  else if (mode->algo == GCRY_KDF_SCRYPT)
+    {
+      /* The slope is over the parallelization parameter, thus the
+       * result is the cost of one ROMix lane. */
+      obj->min_bufsize = 1;
+      obj->max_bufsize = 3;
+      obj->step_size = 1;
+    }
 
   obj->num_measure_repetitions = num_measurement_repetitions;
 
+  /* One lane of realistic scrypt parameters takes a considerable
+   * fraction of a second; limit the repetitions. */
+  if (mode->algo == GCRY_KDF_SCRYPT && obj->num_measure_repetitions > 2)
+    obj->num_measure_repetitions = 2;
+
   return 0;
 }
 
@@ -2046,6 +2059,11 @@ bench_kdf_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
       gcry_kdf_derive("qwerty", 6, mode->algo, mode->subalgo, "01234567", 8,
 		      buflen, sizeof(keybuf), keybuf);
     }
+  else if (mode->algo == GCRY_KDF_SCRYPT)
+    {
+      gcry_kdf_derive("qwerty", 6, mode->algo, mode->subalgo, "01234567", 8,
+		      buflen, sizeof(keybuf), keybuf);
+    }
 }
 
 static struct bench_ops kdf_ops = {
@@ -2066,29 +2084,34 @@ kdf_bench_one (int algo, int subalgo)
   mode.algo = algo;
   mode.subalgo = subalgo;
 
-  switch (subalgo)
-    {
-    case GCRY_MD_CRC32:
-    case GCRY_MD_CRC32_RFC1510:
-    case GCRY_MD_CRC24_RFC2440:
-    case GCRY_MD_MD4:
-      /* Skip CRC32s. */
-      return;
-    }
-
-  if (gcry_md_get_algo_dlen (subalgo) == 0)
-    {
-      /* Skip XOFs */
-      return;
-    }
-
   *algo_name = 0;
 
   if (algo == GCRY_KDF_PBKDF2)
     {
+      switch (subalgo)
+	{
+	case GCRY_MD_CRC32:
+	case GCRY_MD_CRC32_RFC1510:
+	case GCRY_MD_CRC24_RFC2440:
+	case GCRY_MD_MD4:
+	  /* Skip CRC32s. */
+	  return;
+	}
+
+      if (gcry_md_get_algo_dlen (subalgo) == 0)
+	{
+	  /* Skip XOFs */
+	  return;
+	}
+
       snprintf (algo_name, sizeof(algo_name), "PBKDF2-HMAC-%s",
 		gcry_md_algo_name (subalgo));
     }
+  else if (algo == GCRY_KDF_SCRYPT)
+    {
+      /* N = 2^17, r = 8 (128 MiB per lane). */
+      strcpy (algo_name, "SCRYPT-N17-r8");
+    }
 
   bench_print_algo (-24, algo_name);
 
@@ -2124,6 +2147,9 @@ kdf_bench (char **argv, int argc)
 	      if (!strcmp(argv[i], algo_name))
 		kdf_bench_one (GCRY_KDF_PBKDF2, j);
 	    }
+
+	  if (!strcmp(argv[i], "SCRYPT-N17-r8"))
+	    kdf_bench_one (GCRY_KDF_SCRYPT, 1 << 17);
 	}
     }
   else
@@ -2131,6 +2157,8 @@ kdf_bench (char **argv, int argc)
       for (i = 1; i < 400; i++)
 	if (!gcry_md_test_algo (i))
 	  kdf_bench_one (GCRY_KDF_PBKDF2, i);
+
+      kdf_bench_one (GCRY_KDF_SCRYPT, 1 << 17);
     }
 
   bench_print_footer (24);
@@ -25,6 +25,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#ifdef HAVE_PTHREAD
+# include <errno.h>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/wait.h>
+#endif
 #include "../src/gcrypt-int.h"
 
 
@@ -645,6 +651,113 @@ check_nonce (void)
 }
 
 
+static void
+check_prime_pool (void)
+{
+#ifdef HAVE_PTHREAD
+  gcry_sexp_t keyparm, key;
+  unsigned int ready = 0, hits, misses;
+  int rc, i;
+
+  if (verbose)
+    info ("checking the prime pool\n");
+  rc = gcry_control (GCRYCTL_SET_PRIME_POOL, 512u, 2u);
+  if (rc)
+    {
+      fail ("error setting up the prime pool: %s\n", gpg_strerror (rc));
+      return;
+    }
+
+  /* Wait for the background thread.  */
+  for (i=0; i < 60; i++)
+    {
+      rc = gcry_control (GCRYCTL_GET_PRIME_POOL_STATS, 512u, &ready,
+                         NULL, NULL);
+      if (rc || ready == 2)
+        break;
+      sleep (1);
+    }
+  if (rc)
+    fail ("error getting the prime pool stats: %s\n", gpg_strerror (rc));
+  else if (ready != 2)
+    fail ("prime pool has not been filled\n");
+
+  rc = gcry_sexp_new (&keyparm,
+                      "(genkey\n"
+                      " (rsa\n"
+                      "  (nbits 4:1024)\n"
+                      " ))", 0, 1);
+  if (rc)
+    die ("error creating S-expression: %s\n", gpg_strerror (rc));
+  rc = gcry_pk_genkey (&key, keyparm);
+  gcry_sexp_release (keyparm);
+  if (rc)
+    fail ("error generating RSA key: %s\n", gpg_strerror (rc));
+  else
+    check_generated_rsa_key (key, 65537);
+  gcry_sexp_release (key);
+
+  /* A prime is only left in the pool if it does not suit e.  */
+  rc = gcry_control (GCRYCTL_GET_PRIME_POOL_STATS, 512u, NULL,
+                     &hits, &misses);
+  if (rc)
+    fail ("error getting the prime pool stats: %s\n", gpg_strerror (rc));
+  else if (!hits || hits + misses != 2)
+    fail ("prime pool not used (hits=%u misses=%u)\n", hits, misses);
+
+  rc = gcry_control (GCRYCTL_SET_PRIME_POOL, 512u, 0u);
+  if (rc)
+    fail ("error releasing the prime pool: %s\n", gpg_strerror (rc));
+  rc = gcry_control (GCRYCTL_GET_PRIME_POOL_STATS, 512u, &ready, NULL, NULL);
+  if (gpg_err_code (rc) != GPG_ERR_NOT_FOUND)
+    fail ("prime pool not released: %s\n", gpg_strerror (rc));
+  rc = gcry_control (GCRYCTL_SET_PRIME_POOL, 32u, 1u);
+  if (gpg_err_code (rc) != GPG_ERR_INV_ARG)
+    fail ("prime pool accepted a too small size: %s\n", gpg_strerror (rc));
+
+  /* A child forked while the pool is being filled must be able to
+     use the RNG and the secure memory.  */
+  rc = gcry_control (GCRYCTL_SET_PRIME_POOL, 1024u, 8u);
+  if (rc)
+    {
+      fail ("error setting up the prime pool: %s\n", gpg_strerror (rc));
+      return;
+    }
+  for (i=0; i < 200; i++)
+    {
+      pid_t pid;
+      int status;
+
+      pid = fork ();
+      if (pid == (pid_t)(-1))
+        die ("fork failed: %s\n", strerror (errno));
+      if (!pid)
+        {
+          gcry_mpi_t a;
+
+          alarm (10);
+          a = gcry_mpi_snew (1024);
+          gcry_mpi_randomize (a, 1024, GCRY_STRONG_RANDOM);
+          gcry_mpi_release (a);
+          rc = gcry_control (GCRYCTL_GET_PRIME_POOL_STATS, 1024u, &ready,
+                             NULL, NULL);
+          _exit (rc || ready);
+        }
+      while ((rc = waitpid (pid, &status, 0)) == -1 && errno == EINTR)
+        ;
+      if (rc == -1 || !WIFEXITED (status) || WEXITSTATUS (status))
+        {
+          fail ("child process forked while filling the prime pool failed\n");
+          break;
+        }
+    }
+  rc = gcry_control (GCRYCTL_SET_PRIME_POOL, 1024u, 0u);
+  if (rc)
+    fail ("error releasing the prime pool: %s\n", gpg_strerror (rc));
+#endif /*HAVE_PTHREAD*/
+}
+
+
 static void
 progress_cb (void *cb_data, const char *what, int printchar,
 		  int current, int total)
@@ -765,6 +878,14 @@ main (int argc, char **argv)
       check_dsa_keys ();
       check_ecc_keys ();
       check_nonce ();
+      if (!in_fips_mode)
+        check_prime_pool ();
+
+      /* Run the RSA checks again with the candidates for the primes
+         tested on several threads.  */
+      xgcry_control ((GCRYCTL_SET_PRIMEGEN_THREADS, 4u));
+      check_rsa_keys ();
+      xgcry_control ((GCRYCTL_SET_PRIMEGEN_THREADS, 0u));
     }
   else
     {
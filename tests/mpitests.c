@@ -32,6 +32,8 @@
 # include <gcrypt.h>
 #endif
 
+#include "../src/gcrypt-testapi.h"
+
 #define PGM "mpitests"
 #include "t-common.h"
 
@@ -582,6 +584,431 @@ test_powm (void)
 }
 
 
+/* Odd moduli are handled by a Montgomery multiplication based code
+   path.  Compare its results with the division based code used for
+   the even modulus 2 * MOD, for all window sizes and a few special
+   cases of the base.  */
+static int
+test_powm_odd (void)
+{
+  static const unsigned int mod_bits[] = {
+    64, 65, 191, 512, 1031, 1280, 2048, 4096
+  };
+  static const unsigned int exp_bits[] = { 1, 17, 64, 100, 200, 300, 1024 };
+  gcry_mpi_t base = gcry_mpi_new (0);
+  gcry_mpi_t exp = gcry_mpi_new (0);
+  gcry_mpi_t sexp = gcry_mpi_snew (0);
+  gcry_mpi_t e;
+  gcry_mpi_t mod = gcry_mpi_new (0);
+  gcry_mpi_t mod2 = gcry_mpi_new (0);
+  gcry_mpi_t res = gcry_mpi_new (0);
+  gcry_mpi_t res2 = gcry_mpi_new (0);
+  int i, j, k;
+
+  for (i = 0; i < DIM (mod_bits); i++)
+    for (j = 0; j < DIM (exp_bits); j++)
+      for (k = 0; k < 5; k++)
+        {
+          /* Secret exponents always use a fixed window.  */
+          e = k == 4? sexp : exp;
+          gcry_mpi_randomize (mod, mod_bits[i], GCRY_WEAK_RANDOM);
+          gcry_mpi_set_bit (mod, 0);
+          gcry_mpi_set_bit (mod, mod_bits[i] - 1);
+          gcry_mpi_randomize (e, exp_bits[j], GCRY_WEAK_RANDOM);
+          gcry_mpi_set_bit (e, exp_bits[j] - 1);
+          if (k == 0)         /* Base larger than the modulus.  */
+            gcry_mpi_randomize (base, mod_bits[i] + 70, GCRY_WEAK_RANDOM);
+          else if (k == 1)    /* Base equal to modulus minus one.  */
+            gcry_mpi_sub_ui (base, mod, 1);
+          else
+            gcry_mpi_randomize (base, mod_bits[i] - 1, GCRY_WEAK_RANDOM);
+          if (k == 3)
+            gcry_mpi_neg (base, base);
+
+          gcry_mpi_add (mod2, mod, mod);
+          gcry_mpi_powm (res2, base, e, mod2);
+          gcry_mpi_mod (res2, res2, mod);
+          if (gcry_mpi_is_neg (res2) && gcry_mpi_cmp_ui (res2, 0))
+            gcry_mpi_add (res2, res2, mod);
+
+          gcry_mpi_powm (res, base, e, mod);
+          if (gcry_mpi_is_neg (res) && gcry_mpi_cmp_ui (res, 0))
+            gcry_mpi_add (res, res, mod);
+          if (gcry_mpi_cmp (res, res2))
+            {
+              if (verbose)
+                {
+                  fprintf (stderr, "mod: ");
+                  gcry_mpi_dump (mod);
+                  fprintf (stderr, "\nexp: ");
+                  gcry_mpi_dump (e);
+                  fprintf (stderr, "\nbase: ");
+                  gcry_mpi_dump (base);
+                  putc ('\n', stderr);
+                }
+              die ("test_powm_odd failed for %u bit modulus and"
+                   " %u bit exponent (case %d)\n",
+                   mod_bits[i], exp_bits[j], k);
+            }
+        }
+
+  gcry_mpi_release (base);
+  gcry_mpi_release (exp);
+  gcry_mpi_release (sexp);
+  gcry_mpi_release (mod);
+  gcry_mpi_release (mod2);
+  gcry_mpi_release (res);
+  gcry_mpi_release (res2);
+  return 1;
+}
+
+
+/* Squares are computed by dedicated code.  Compare them with the
+   product of two distinct copies of the operand for sizes around the
+   basecase and Karatsuba thresholds.  The operands are random, have
+   all bits set or consist of limbs with the values 0 and 1.  */
+static int
+test_sqr (void)
+{
+  gcry_mpi_t u = gcry_mpi_new (0);
+  gcry_mpi_t v = gcry_mpi_new (0);
+  gcry_mpi_t sqr = gcry_mpi_new (0);
+  gcry_mpi_t prod = gcry_mpi_new (0);
+  unsigned int nlimbs, nbits, i;
+  int k;
+
+  for (nlimbs = 1; nlimbs <= 80; nlimbs++)
+    for (k = 0; k < 3; k++)
+      {
+        nbits = nlimbs * 64;
+        if (k == 0)
+          {
+            gcry_mpi_randomize (u, nbits, GCRY_WEAK_RANDOM);
+            gcry_mpi_set_bit (u, nbits - 1);
+          }
+        else if (k == 1)
+          {
+            gcry_mpi_set_ui (u, 1);
+            gcry_mpi_mul_2exp (u, u, nbits);
+            gcry_mpi_sub_ui (u, u, 1);
+          }
+        else
+          {
+            gcry_mpi_set_ui (u, 0);
+            for (i = 0; i < nbits; i += 64)
+              if (!(i & 64) || !(i % 192))
+                gcry_mpi_set_bit (u, i);
+          }
+        gcry_mpi_set (v, u);
+
+        gcry_mpi_mul (sqr, u, u);
+        gcry_mpi_mul (prod, u, v);
+        if (gcry_mpi_cmp (sqr, prod))
+          {
+            if (verbose)
+              {
+                fprintf (stderr, "u: ");
+                gcry_mpi_dump (u);
+                putc ('\n', stderr);
+              }
+            die ("test_sqr failed for %u limbs (case %d)\n", nlimbs, k);
+          }
+
+        /* Squaring in place.  */
+        gcry_mpi_mul (u, u, u);
+        if (gcry_mpi_cmp (u, prod))
+          die ("test_sqr failed in place for %u limbs (case %d)\n",
+               nlimbs, k);
+      }
+
+  gcry_mpi_release (u);
+  gcry_mpi_release (v);
+  gcry_mpi_release (sqr);
+  gcry_mpi_release (prod);
+  return 1;
+}
+
+
+/* Compare products and squares computed with Toom-3 multiplication
+   forced for all sizes, with Toom-3 disabled and with the default
+   thresholds.  The operands are random or have all bits set, which
+   makes the carries in the interpolation as large as possible.  The
+   odd modulus checks the Montgomery reduction of large products.  */
+static int
+test_mul_toom3 (void)
+{
+  static const unsigned int nlimbs[] = {
+    8, 9, 10, 11, 17, 24, 25, 26, 40, 64, 65, 100, 128, 129, 200, 257
+  };
+  static const unsigned int thresholds[][2] = {
+    { 8, 8 }, { 0, 0 }
+  };
+  gcry_mpi_t u = gcry_mpi_new (0);
+  gcry_mpi_t v = gcry_mpi_new (0);
+  gcry_mpi_t m = gcry_mpi_new (0);
+  gcry_mpi_t mo = gcry_mpi_new (0);
+  gcry_mpi_t e = gcry_mpi_new (0);
+  gcry_mpi_t ref[5], res[5];
+  int i, j, k, t;
+
+  for (j = 0; j < DIM (ref); j++)
+    {
+      ref[j] = gcry_mpi_new (0);
+      res[j] = gcry_mpi_new (0);
+    }
+
+  for (i = 0; i < DIM (nlimbs); i++)
+    for (k = 0; k < 3; k++)
+      {
+        unsigned int nbits = nlimbs[i] * 64;
+
+        if (k == 2)
+          {
+            gcry_mpi_set_ui (u, 1);
+            gcry_mpi_mul_2exp (u, u, nbits);
+            gcry_mpi_sub_ui (u, u, 1);
+            gcry_mpi_set (v, u);
+          }
+        else
+          {
+            gcry_mpi_randomize (u, nbits, GCRY_WEAK_RANDOM);
+            gcry_mpi_set_bit (u, nbits - 1);
+            /* The second case multiplies operands of different sizes.  */
+            gcry_mpi_randomize (v, k? nbits / 3 + 1 : nbits,
+                                GCRY_WEAK_RANDOM);
+          }
+        gcry_mpi_set (m, u);
+        gcry_mpi_set_bit (m, nbits);
+        gcry_mpi_clear_bit (m, 0);
+        gcry_mpi_add_ui (mo, m, 1);
+        gcry_mpi_randomize (e, 100, GCRY_WEAK_RANDOM);
+
+        for (t = -1; t < (int)DIM (thresholds); t++)
+          {
+            gcry_mpi_t *r = t < 0? ref : res;
+
+            if (t < 0)  /* Disable Toom-3 for the reference values.  */
+              xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS, ~0u, ~0u));
+            else
+              xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS,
+                              thresholds[t][0], thresholds[t][1]));
+            gcry_mpi_mul (r[0], u, v);
+            gcry_mpi_mul (r[1], u, u);
+            gcry_mpi_mul (r[2], v, u);
+            /* Even moduli are handled with plain squarings.  */
+            gcry_mpi_powm (r[3], v, e, m);
+            gcry_mpi_powm (r[4], u, e, mo);
+            if (t < 0)
+              continue;
+
+            for (j = 0; j < DIM (ref); j++)
+              if (gcry_mpi_cmp (res[j], ref[j]))
+                {
+                  if (verbose)
+                    {
+                      fprintf (stderr, "u: ");
+                      gcry_mpi_dump (u);
+                      fprintf (stderr, "\nv: ");
+                      gcry_mpi_dump (v);
+                      putc ('\n', stderr);
+                    }
+                  die ("test_mul_toom3 failed for %u limbs"
+                       " (case %d, thresholds %u, result %d)\n",
+                       nlimbs[i], k, thresholds[t][0], j);
+                }
+          }
+      }
+
+  xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS, 0, 0));
+  for (j = 0; j < DIM (ref); j++)
+    {
+      gcry_mpi_release (ref[j]);
+      gcry_mpi_release (res[j]);
+    }
+  gcry_mpi_release (u);
+  gcry_mpi_release (v);
+  gcry_mpi_release (m);
+  gcry_mpi_release (mo);
+  gcry_mpi_release (e);
+  return 1;
+}
+
+
+/* Compare products, squares, quotients and remainders computed with
+   the BMI2/ADX variants of the limb functions with those of the plain
+   variants.  All size pairs up to 40 limbs are used, so that the
+   basecase multiplication also handles row counts which are not a
+   multiple of four.  The operands are random or have all bits set.  */
+static int
+test_mul_adx (void)
+{
+  gcry_mpi_t u = gcry_mpi_new (0);
+  gcry_mpi_t v = gcry_mpi_new (0);
+  gcry_mpi_t w = gcry_mpi_new (0);
+  gcry_mpi_t m = gcry_mpi_new (0);
+  gcry_mpi_t e = gcry_mpi_new (0);
+  gcry_mpi_t ref[5], res[5];
+  unsigned int usize, vsize;
+  int j, k, pass;
+
+  if (gcry_control (PRIV_CTL_SET_MPIH_ADX, 1))
+    {
+      if (verbose)
+        info ("BMI2/ADX not available - skipping test_mul_adx\n");
+      return 1;
+    }
+
+  for (j = 0; j < DIM (ref); j++)
+    {
+      ref[j] = gcry_mpi_new (0);
+      res[j] = gcry_mpi_new (0);
+    }
+
+  for (usize = 1; usize <= 40; usize++)
+    for (vsize = 1; vsize <= usize; vsize++)
+      for (k = 0; k < 3; k++)
+        {
+          if (k == 1)
+            {
+              gcry_mpi_set_ui (u, 1);
+              gcry_mpi_mul_2exp (u, u, usize * 64);
+              gcry_mpi_sub_ui (u, u, 1);
+            }
+          else
+            {
+              gcry_mpi_randomize (u, usize * 64, GCRY_WEAK_RANDOM);
+              gcry_mpi_set_bit (u, usize * 64 - 1);
+            }
+          if (k)
+            {
+              gcry_mpi_set_ui (v, 1);
+              gcry_mpi_mul_2exp (v, v, vsize * 64);
+              gcry_mpi_sub_ui (v, v, 1);
+            }
+          else
+            {
+              gcry_mpi_randomize (v, vsize * 64, GCRY_WEAK_RANDOM);
+              gcry_mpi_set_bit (v, vsize * 64 - 1);
+            }
+          gcry_mpi_mul (w, u, v);
+          gcry_mpi_sub_ui (w, w, 1);
+          gcry_mpi_set (m, u);
+          gcry_mpi_set_bit (m, 0);
+          gcry_mpi_randomize (e, 64, GCRY_WEAK_RANDOM);
+
+          for (pass = 0; pass < 2; pass++)
+            {
+              gcry_mpi_t *r = pass? res : ref;
+
+              xgcry_control ((PRIV_CTL_SET_MPIH_ADX, pass));
+              gcry_mpi_mul (r[0], u, v);
+              gcry_mpi_mul (r[1], u, u);
+              gcry_mpi_div (r[2], r[3], w, v, 0);
+              gcry_mpi_powm (r[4], v, e, m);
+            }
+
+          for (j = 0; j < DIM (ref); j++)
+            if (gcry_mpi_cmp (res[j], ref[j]))
+              {
+                if (verbose)
+                  {
+                    fprintf (stderr, "u: ");
+                    gcry_mpi_dump (u);
+                    fprintf (stderr, "\nv: ");
+                    gcry_mpi_dump (v);
+                    putc ('\n', stderr);
+                  }
+                die ("test_mul_adx failed for %u and %u limbs"
+                     " (case %d, result %d)\n", usize, vsize, k, j);
+              }
+        }
+
+  for (j = 0; j < DIM (ref); j++)
+    {
+      gcry_mpi_release (ref[j]);
+      gcry_mpi_release (res[j]);
+    }
+  gcry_mpi_release (u);
+  gcry_mpi_release (v);
+  gcry_mpi_release (w);
+  gcry_mpi_release (m);
+  gcry_mpi_release (e);
+  return 1;
+}
+
+
+/* Check inverses modulo odd moduli, which are computed with the
+   safegcd algorithm, and modulo even moduli, whose odd part uses the
+   same code.  The values are random, larger than the modulus, equal
+   to the modulus minus one or have a common factor with it.  */
+static int
+test_invm (void)
+{
+  static const unsigned int mod_bits[] = {
+    5, 17, 63, 64, 65, 192, 255, 256, 521, 1024, 2049, 4096
+  };
+  gcry_mpi_t a = gcry_mpi_new (0);
+  gcry_mpi_t mod = gcry_mpi_new (0);
+  gcry_mpi_t x = gcry_mpi_new (0);
+  gcry_mpi_t t = gcry_mpi_new (0);
+  int i, k, ok, expected;
+
+  for (i = 0; i < DIM (mod_bits); i++)
+    for (k = 0; k < 6; k++)
+      {
+        gcry_mpi_randomize (mod, mod_bits[i], GCRY_WEAK_RANDOM);
+        gcry_mpi_set_bit (mod, 0);
+        gcry_mpi_set_bit (mod, mod_bits[i] - 1);
+        if (k == 0)         /* Value larger than the modulus.  */
+          gcry_mpi_randomize (a, mod_bits[i] + 70, GCRY_WEAK_RANDOM);
+        else if (k == 1)    /* Value equal to modulus minus one.  */
+          gcry_mpi_sub_ui (a, mod, 1);
+        else
+          gcry_mpi_randomize (a, mod_bits[i] - 1, GCRY_WEAK_RANDOM);
+        if (k == 3)         /* Even modulus.  */
+          gcry_mpi_mul_2exp (mod, mod, 5);
+        if (k >= 3)
+          gcry_mpi_set_bit (a, 0);
+        if (k == 5)         /* No inverse.  */
+          {
+            gcry_mpi_mul_ui (mod, mod, 3);
+            gcry_mpi_mul_ui (a, a, 3);
+          }
+        if (!gcry_mpi_cmp_ui (a, 0))
+          gcry_mpi_set_ui (a, 1);
+
+        expected = gcry_mpi_gcd (t, a, mod);
+        ok = gcry_mpi_invm (x, a, mod);
+        if (ok)
+          {
+            gcry_mpi_mulm (t, a, x, mod);
+            if (gcry_mpi_cmp_ui (t, 1) || gcry_mpi_is_neg (x)
+                || gcry_mpi_cmp (x, mod) >= 0)
+              ok = -1;
+          }
+        if (ok != expected || (k == 5 && ok))
+          {
+            if (verbose)
+              {
+                fprintf (stderr, "mod: ");
+                gcry_mpi_dump (mod);
+                fprintf (stderr, "\na: ");
+                gcry_mpi_dump (a);
+                putc ('\n', stderr);
+              }
+            die ("test_invm failed for %u bit modulus (case %d)\n",
+                 mod_bits[i], k);
+          }
+      }
+
+  gcry_mpi_release (a);
+  gcry_mpi_release (mod);
+  gcry_mpi_release (x);
+  gcry_mpi_release (t);
+  return 1;
+}
+
+
 int
 main (int argc, char* argv[])
 {
@@ -605,6 +1032,11 @@ main (int argc, char* argv[])
   test_sub ();
   test_mul ();
   test_powm ();
+  test_powm_odd ();
+  test_sqr ();
+  test_mul_toom3 ();
+  test_mul_adx ();
+  test_invm ();
 
   return !!error_count;
 }
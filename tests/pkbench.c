@@ -34,9 +34,16 @@
 #include <time.h>
 #include <errno.h>
 
+#include "../src/gcrypt-testapi.h"
+
 #define PGM "pkbench"
 #include "t-common.h"
 
+/* The size of an MPI limb in bits, as used by the MPI code.  */
+#define LIMB_BITS (SIZEOF_UNSIGNED_LONG * 8)
+
+/* Number of operations timed for each worker.  */
+static unsigned int repetitions = 10;
 
 typedef struct context
 {
@@ -110,7 +117,7 @@ static void
 benchmark (work_t worker, context_t context)
 {
   clock_t timer_start, timer_stop;
-  unsigned int loop = 10;
+  unsigned int loop = repetitions;
   unsigned int i = 0;
   struct tms timer;
   int ret = 0;
@@ -135,8 +142,8 @@ benchmark (work_t worker, context_t context)
 #endif
 
   if (ret)
-    printf ("%.0f ms\n",
-	    (((double) ((timer_stop - timer_start) / loop)) / CLOCKS_PER_SEC)
+    printf ("%.2f ms\n",
+	    (((double) (timer_stop - timer_start) / loop) / CLOCKS_PER_SEC)
 	    * 10000000);
   else
     printf ("[skipped]\n");
@@ -389,12 +396,101 @@ generate_key (const char *algorithm, const char *key_size)
 
 
 
+/* Return the CPU time in microseconds of one multiplication of U and
+   V, or one squaring of U if V is NULL.  */
+static double
+time_mul (gcry_mpi_t u, gcry_mpi_t v)
+{
+  gcry_mpi_t w = gcry_mpi_new (0);
+  unsigned long loop;
+  unsigned long i;
+  clock_t start, elapsed;
+
+  /* Double the number of iterations until the time can be measured
+     with some accuracy.  */
+  for (loop = 1; ; loop *= 2)
+    {
+      start = clock ();
+      for (i = 0; i < loop; i++)
+        gcry_mpi_mul (w, u, v? v : u);
+      elapsed = clock () - start;
+      if (elapsed >= CLOCKS_PER_SEC / 20)
+        break;
+    }
+
+  gcry_mpi_release (w);
+  return (double)elapsed * 1000000 / CLOCKS_PER_SEC / loop;
+}
+
+
+/* Compare the time of Karatsuba and Toom-3 multiplication and
+   squaring for operands of up to MAX_LIMBS limbs and print the size
+   from which on Toom-3 is faster.  At each size Toom-3 is only used
+   for the operands themselves; the smaller products are computed by
+   Karatsuba's algorithm in both cases.  */
+static void
+toom3_sweep (unsigned int max_limbs)
+{
+  gcry_mpi_t u = gcry_mpi_new (0);
+  gcry_mpi_t v = gcry_mpi_new (0);
+  unsigned int n, sqr;
+  unsigned int crossover[2] = { 0, 0 };
+  double kara, toom;
+
+  printf ("%6s %8s  %-10s %12s %12s\n",
+          "limbs", "bits", "operation", "Karatsuba", "Toom-3");
+  for (n = 16; n <= max_limbs; n += n / 8)
+    {
+      gcry_mpi_randomize (u, n * LIMB_BITS, GCRY_WEAK_RANDOM);
+      gcry_mpi_set_bit (u, n * LIMB_BITS - 1);
+      gcry_mpi_randomize (v, n * LIMB_BITS, GCRY_WEAK_RANDOM);
+      gcry_mpi_set_bit (v, n * LIMB_BITS - 1);
+
+      for (sqr = 0; sqr < 2; sqr++)
+        {
+          xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS, ~0u, ~0u));
+          kara = time_mul (u, sqr? NULL : v);
+          xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS, n, n));
+          toom = time_mul (u, sqr? NULL : v);
+
+          printf ("%6u %8u  %-10s %9.2f us %9.2f us\n",
+                  n, (unsigned int)(n * LIMB_BITS), sqr? "square" : "multiply",
+                  kara, toom);
+
+          /* Remember the smallest size from which on Toom-3 was
+             always faster.  */
+          if (toom < kara)
+            {
+              if (!crossover[sqr])
+                crossover[sqr] = n;
+            }
+          else
+            crossover[sqr] = 0;
+        }
+    }
+  xgcry_control ((PRIV_CTL_SET_TOOM3_THRESHOLDS, 0, 0));
+
+  for (sqr = 0; sqr < 2; sqr++)
+    {
+      if (crossover[sqr])
+        printf ("TOOM3_%s_THRESHOLD %u\n", sqr? "SQR" : "MUL", crossover[sqr]);
+      else
+        printf ("TOOM3_%s_THRESHOLD: no crossover up to %u limbs\n",
+                sqr? "SQR" : "MUL", max_limbs);
+    }
+
+  gcry_mpi_release (u);
+  gcry_mpi_release (v);
+}
+
+
 int
 main (int argc, char **argv)
 {
   int last_argc = -1;
   int genkey_mode = 0;
   int fips_mode = 0;
+  unsigned int toom3_sweep_limbs = 0;
 
   if (argc)
     { argc--; argv++; }
@@ -413,6 +509,8 @@ main (int argc, char **argv)
                 "Various public key tests:\n\n"
                 "  Default is to process all given key files\n\n"
                 "  --genkey ALGONAME SIZE  Generate a public key\n"
+                "  --repetitions N         Time N operations per test\n"
+                "  --toom3-sweep [LIMBS]   Find the Toom-3 thresholds\n"
                 "\n"
                 "  --verbose    enable extra informational output\n"
                 "  --debug      enable additional debug output\n"
@@ -434,11 +532,32 @@ main (int argc, char **argv)
           genkey_mode = 1;
           argc--; argv++;
         }
+      else if (!strcmp (*argv, "--repetitions"))
+        {
+          argc--; argv++;
+          if (argc)
+            {
+              repetitions = atoi (*argv);
+              if (!repetitions)
+                repetitions = 1;
+              argc--; argv++;
+            }
+        }
       else if (!strcmp (*argv, "--fips"))
         {
           fips_mode = 1;
           argc--; argv++;
         }
+      else if (!strcmp (*argv, "--toom3-sweep"))
+        {
+          toom3_sweep_limbs = 512;
+          argc--; argv++;
+          if (argc && isdigit (**argv))
+            {
+              toom3_sweep_limbs = atoi (*argv);
+              argc--; argv++;
+            }
+        }
     }
 
   xgcry_control ((GCRYCTL_SET_VERBOSITY, (int)verbose));
@@ -463,7 +582,11 @@ main (int argc, char **argv)
   xgcry_control ((GCRYCTL_INITIALIZATION_FINISHED, 0));
 
 
-  if (genkey_mode && argc == 2)
+  if (toom3_sweep_limbs)
+    {
+      toom3_sweep (toom3_sweep_limbs);
+    }
+  else if (genkey_mode && argc == 2)
     {
       generate_key (argv[0], argv[1]);
     }
@@ -300,6 +300,47 @@ check_keys (gcry_sexp_t pkey, gcry_sexp_t skey, unsigned int nbits_data,
   gcry_sexp_release (plain);
 }
 
+/* Sign random data of NBITS_DATA bits COUNT times with SKEY and check
+   the signatures with PKEY; a signature of other data must not
+   verify.  */
+static void
+check_keys_sign (gcry_sexp_t pkey, gcry_sexp_t skey, unsigned int nbits_data,
+                 int count)
+{
+  gcry_sexp_t data, baddata, sig;
+  gcry_mpi_t x;
+  int rc;
+
+  x = gcry_mpi_new (nbits_data);
+  while (count--)
+    {
+      gcry_mpi_randomize (x, nbits_data, GCRY_WEAK_RANDOM);
+      rc = gcry_sexp_build (&data, NULL, "(data (flags raw) (value %m))", x);
+      if (rc)
+        die ("converting data for signing failed: %s\n", gcry_strerror (rc));
+      gcry_mpi_add_ui (x, x, 1);
+      rc = gcry_sexp_build (&baddata, NULL,
+                            "(data (flags raw) (value %m))", x);
+      if (rc)
+        die ("converting data for signing failed: %s\n", gcry_strerror (rc));
+
+      rc = gcry_pk_sign (&sig, data, skey);
+      if (rc)
+        die ("signing failed: %s\n", gcry_strerror (rc));
+      rc = gcry_pk_verify (sig, data, pkey);
+      if (rc)
+        fail ("verify failed: %s\n", gcry_strerror (rc));
+      rc = gcry_pk_verify (sig, baddata, pkey);
+      if (gpg_err_code (rc) != GPG_ERR_BAD_SIGNATURE)
+        fail ("verify of bad data returned: %s\n", gcry_strerror (rc));
+
+      gcry_sexp_release (sig);
+      gcry_sexp_release (baddata);
+      gcry_sexp_release (data);
+    }
+  gcry_mpi_release (x);
+}
+
 static void
 get_keys_sample (gcry_sexp_t *pkey, gcry_sexp_t *skey, int secret_variant)
 {
@@ -627,7 +668,7 @@ check_run (void)
 {
   gpg_error_t err;
   gcry_sexp_t pkey, skey;
-  int variant;
+  int variant, i;
 
   for (variant=0; variant < 3; variant++)
     {
@@ -698,11 +739,15 @@ check_run (void)
   gcry_sexp_release (skey);
 
   if (verbose)
-    fprintf (stderr, "Generating DSA key with given domain.\n");
-  get_dsa_key_with_domain_new (&pkey, &skey);
-  /* Fixme:  Add a check function for DSA keys.  */
-  gcry_sexp_release (pkey);
-  gcry_sexp_release (skey);
+    fprintf (stderr, "Generating DSA keys with given domain.\n");
+  /* Repeated use of a domain switches to a table for its generator.  */
+  for (i=0; i < 2; i++)
+    {
+      get_dsa_key_with_domain_new (&pkey, &skey);
+      check_keys_sign (pkey, skey, 152, 4);
+      gcry_sexp_release (pkey);
+      gcry_sexp_release (skey);
+    }
 
   /* We need new test vectors for get_dsa_key_fips186_with_domain_new.  */
   if (verbose)
@@ -1167,9 +1212,206 @@ check_ed25519ecdsa_sample_key (void)
 }
 
 
+/* Return true if the S-expressions A and B are equal.  */
+static int
+sexp_equal_p (gcry_sexp_t a, gcry_sexp_t b)
+{
+  char bufa[2048], bufb[2048];
+  size_t lena, lenb;
+
+  lena = gcry_sexp_sprint (a, GCRYSEXP_FMT_CANON, bufa, sizeof bufa);
+  lenb = gcry_sexp_sprint (b, GCRYSEXP_FMT_CANON, bufb, sizeof bufb);
+  return lena && lena == lenb && !memcmp (bufa, bufb, lena);
+}
+
+
+/* Return true if the result PLAIN of a decryption is X.  */
+static int
+plain_equal_p (gcry_sexp_t plain, gcry_mpi_t x)
+{
+  gcry_sexp_t l;
+  gcry_mpi_t y;
+  int equal;
+
+  l = gcry_sexp_find_token (plain, "value", 0);
+  if (l)
+    {
+      y = gcry_sexp_nth_mpi (l, 1, GCRYMPI_FMT_USG);
+      gcry_sexp_release (l);
+    }
+  else
+    y = gcry_sexp_nth_mpi (plain, 0, GCRYMPI_FMT_USG);
+  equal = y && !gcry_mpi_cmp (x, y);
+  gcry_mpi_release (y);
+  return equal;
+}
+
+
+/* Check the functions using a key handle with the key pair PKEY,SKEY
+   against the S-expression based functions.  The signatures for
+   DATA_STRING need to be deterministic; BAD_DATA_STRING describes
+   other data of the same kind.  */
+static void
+check_key_handle_one (const char *desc, gcry_sexp_t pkey, gcry_sexp_t skey,
+                      const char *data_string, const char *bad_data_string,
+                      int encr)
+{
+  gpg_error_t err;
+  gcry_pk_key_t hpkey, hskey;
+  gcry_sexp_t data, sig, sig2, plain, plain2, ciph;
+  gcry_mpi_t x;
+  int i;
+
+  if (verbose)
+    fprintf (stderr, "Checking key handles for %s.\n", desc);
+
+  if ((err = gcry_pk_key_new (&hpkey, pkey)))
+    die ("%s: gcry_pk_key_new failed: %s", desc, gpg_strerror (err));
+  if ((err = gcry_pk_key_new (&hskey, skey)))
+    die ("%s: gcry_pk_key_new failed: %s", desc, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&data, data_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+
+  if ((err = gcry_pk_sign (&sig, data, skey)))
+    die ("%s: gcry_pk_sign failed: %s", desc, gpg_strerror (err));
+  /* Use the handles more than once to check that they are not
+     modified in a way which changes the results.  */
+  for (i=0; i < 3; i++)
+    {
+      if ((err = gcry_pk_sign_key (&sig2, data, hskey)))
+        die ("%s: gcry_pk_sign_key failed: %s", desc, gpg_strerror (err));
+      if (!sexp_equal_p (sig, sig2))
+        fail ("%s: gcry_pk_sign_key returned a different signature\n", desc);
+      if ((err = gcry_pk_verify_key (sig2, data, hpkey)))
+        fail ("%s: gcry_pk_verify_key failed: %s", desc, gpg_strerror (err));
+      if ((err = gcry_pk_verify_key (sig2, data, hskey)))
+        fail ("%s: gcry_pk_verify_key with the private key failed: %s",
+              desc, gpg_strerror (err));
+      gcry_sexp_release (sig2);
+    }
+
+  err = gcry_pk_sign_key (&sig2, data, hpkey);
+  if (gpg_err_code (err) != GPG_ERR_INV_OBJ)
+    fail ("%s: gcry_pk_sign_key with a public key returned: %s\n",
+          desc, gpg_strerror (err));
+  gcry_sexp_release (data);
+
+  /* Verify with data which does not match.  */
+  if ((err = gcry_sexp_new (&data, bad_data_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  err = gcry_pk_verify_key (sig, data, hpkey);
+  if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+    fail ("%s: gcry_pk_verify_key with bad data returned: %s\n",
+          desc, gpg_strerror (err));
+  gcry_sexp_release (data);
+
+  if (encr)
+    {
+      x = gcry_mpi_new (800);
+      gcry_mpi_randomize (x, 800, GCRY_WEAK_RANDOM);
+      err = gcry_sexp_build (&plain, NULL, "(data (flags raw) (value %m))", x);
+      if (err)
+        die ("line %d: %s", __LINE__, gpg_strerror (err));
+
+      if ((err = gcry_pk_encrypt_key (&ciph, plain, hpkey)))
+        die ("%s: gcry_pk_encrypt_key failed: %s", desc, gpg_strerror (err));
+      if ((err = gcry_pk_decrypt_key (&plain2, ciph, hskey)))
+        die ("%s: gcry_pk_decrypt_key failed: %s", desc, gpg_strerror (err));
+      if (!plain_equal_p (plain2, x))
+        fail ("%s: gcry_pk_decrypt_key returned wrong data\n", desc);
+      gcry_sexp_release (plain2);
+
+      err = gcry_pk_decrypt_key (&plain2, ciph, hpkey);
+      if (gpg_err_code (err) != GPG_ERR_INV_OBJ)
+        fail ("%s: gcry_pk_decrypt_key with a public key returned: %s\n",
+              desc, gpg_strerror (err));
+      gcry_sexp_release (ciph);
+
+      if ((err = gcry_pk_encrypt (&ciph, plain, pkey)))
+        die ("%s: gcry_pk_encrypt failed: %s", desc, gpg_strerror (err));
+      if ((err = gcry_pk_decrypt_key (&plain2, ciph, hskey)))
+        die ("%s: gcry_pk_decrypt_key failed: %s", desc, gpg_strerror (err));
+      if (!plain_equal_p (plain2, x))
+        fail ("%s: gcry_pk_decrypt_key returned wrong data\n", desc);
+      gcry_sexp_release (plain2);
+      gcry_sexp_release (ciph);
+      gcry_sexp_release (plain);
+      gcry_mpi_release (x);
+    }
+
+  gcry_sexp_release (sig);
+  gcry_pk_key_release (hpkey);
+  gcry_pk_key_release (hskey);
+}
+
+
+static void
+check_key_handle (void)
+{
+  static const char rsa_data[] =
+    "(data (flags pkcs1)\n"
+    " (hash sha256 #00112233445566778899AABBCCDDEEFF"
+    /* */          "000102030405060708090A0B0C0D0E0F#))";
+  static const char rsa_bad_data[] =
+    "(data (flags pkcs1)\n"
+    " (hash sha256 #00112233445566778899AABBCCDDEEFF"
+    /* */          "000102030405060708090A0B0C0D0E1F#))";
+  static const char ecdsa_data[] =
+    "(data (flags rfc6979)\n"
+    " (hash sha256 #00112233445566778899AABBCCDDEEFF"
+    /* */          "000102030405060708090A0B0C0D0E0F#))";
+  static const char ecdsa_bad_data[] =
+    "(data (flags rfc6979)\n"
+    " (hash sha256 #00112233445566778899AABBCCDDEEFF"
+    /* */          "000102030405060708090A0B0C0D0E1F#))";
+  static const char eddsa_data[] =
+    "(data (flags eddsa) (hash-algo sha512)\n"
+    " (value #00112233445566778899AABBCCDDEEFF#))";
+  static const char eddsa_bad_data[] =
+    "(data (flags eddsa) (hash-algo sha512)\n"
+    " (value #00112233445566778899AABBCCDDEE1F#))";
+  static const char *ecc_specs[] =
+    {
+      "(genkey (ecc (curve \"NIST P-256\")))",
+      "(genkey (ecc (curve \"Ed25519\") (flags eddsa)))"
+    };
+  gpg_error_t err;
+  gcry_sexp_t pkey, skey, spec, key;
+  int i;
+
+  get_keys_sample (&pkey, &skey, 0);
+  check_key_handle_one ("RSA", pkey, skey, rsa_data, rsa_bad_data, 1);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+
+  for (i=0; i < DIM (ecc_specs); i++)
+    {
+      if (i == 1 && gcry_fips_mode_active ())
+        continue;
+      if ((err = gcry_sexp_new (&spec, ecc_specs[i], 0, 1)))
+        die ("line %d: %s", __LINE__, gpg_strerror (err));
+      if ((err = gcry_pk_genkey (&key, spec)))
+        die ("error generating ECC key: %s\n", gpg_strerror (err));
+      gcry_sexp_release (spec);
+      pkey = gcry_sexp_find_token (key, "public-key", 0);
+      skey = gcry_sexp_find_token (key, "private-key", 0);
+      if (!pkey || !skey)
+        die ("public or private part missing in key\n");
+      gcry_sexp_release (key);
+
+      check_key_handle_one (i? "Ed25519" : "ECDSA", pkey, skey,
+                            i? eddsa_data : ecdsa_data,
+                            i? eddsa_bad_data : ecdsa_bad_data, 0);
+      gcry_sexp_release (pkey);
+      gcry_sexp_release (skey);
+    }
+}
+
+
 int
 main (int argc, char **argv)
 {
+  gcry_sexp_t pkey, skey;
   int i;
 
   if (argc > 1 && !strcmp (argv[1], "--verbose"))
@@ -1192,12 +1434,38 @@ main (int argc, char **argv)
   for (i=0; i < 2; i++)
     check_run ();
 
+  /* Use one key more often than a blinding pair is reused.  */
+  get_keys_sample (&pkey, &skey, 0);
+  for (i=0; i < 40; i++)
+    check_keys (pkey, skey, 800, 0);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+
   for (i=0; i < 4; i++)
     check_x931_derived_key (i);
 
+  check_key_handle ();
+
   check_ecc_sample_key ();
   if (!gcry_fips_mode_active ())
     check_ed25519ecdsa_sample_key ();
 
+  /* Run the ECC checks again with the verify cache enabled; the
+     second round uses the precomputed tables for the sample keys.  */
+  xgcry_control ((GCRYCTL_SET_ECC_VERIFY_CACHE, 4u));
+  for (i=0; i < 2; i++)
+    {
+      check_ecc_sample_key ();
+      if (!gcry_fips_mode_active ())
+        check_ed25519ecdsa_sample_key ();
+    }
+  xgcry_control ((GCRYCTL_SET_ECC_VERIFY_CACHE, 0u));
+
+  /* Run the RSA checks again with the CRT halves computed on two
+     threads.  */
+  xgcry_control ((GCRYCTL_SET_RSA_CRT_THREADS, 1024u));
+  check_run ();
+  xgcry_control ((GCRYCTL_SET_RSA_CRT_THREADS, 0u));
+
   return !!error_count;
 }
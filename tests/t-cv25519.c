@@ -301,12 +301,136 @@ test_cv_x25519 (int testno, const char *k_str, const char *u_str,
   xfree (point);
 }
 
+/*
+ * Test X25519 computation with the generic Montgomery ladder.
+ *
+ * Input: K (as hex string), U (as hex string), R (as hex string)
+ *
+ * The MPI routines use the same fixed-size code as gcry_ecc_mul_point
+ * unless the scalar is larger than 256 bits.  Adding a multiple of the
+ * orders of the curve and of its twist to the clamped K does not
+ * change the result for any U but selects the generic ladder.
+ *
+ */
+static void
+test_cv_generic (int testno, const char *k_str, const char *u_str,
+                 const char *result_str)
+{
+  gcry_ctx_t ctx;
+  gpg_error_t err;
+  unsigned char *buffer = NULL;
+  size_t buflen;
+  gcry_mpi_t mpi_k = NULL, mpi_u = NULL, p, n, l, x;
+  gcry_mpi_point_t P = NULL, Q;
+  unsigned char res[32];
+  char result_hex[65];
+  int i;
+
+  if (verbose > 1)
+    info ("Running test %d with the generic ladder\n", testno);
+
+  if ((err = gcry_mpi_ec_new (&ctx, NULL, "Curve25519")))
+    die ("gcry_mpi_ec_new failed: %s\n", gpg_strerror (err));
+  p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+  n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+  l = gcry_mpi_new (0);
+  x = gcry_mpi_new (0);
+  Q = gcry_mpi_point_new (0);
+
+  /* L = 8n·(2p + 2 - 8n); the second factor is the order of the
+     twist.  */
+  gcry_mpi_mul_ui (x, n, 8);
+  gcry_mpi_add (l, p, p);
+  gcry_mpi_add_ui (l, l, 2);
+  gcry_mpi_sub (l, l, x);
+  gcry_mpi_mul (l, l, x);
+
+  if (!(buffer = hex2buffer (k_str, &buflen)) || buflen != 32)
+    {
+      fail ("error scanning MPI for test %d, %s: %s",
+            testno, "k", "invalid hex string");
+      goto leave;
+    }
+  buffer[0] &= 248;
+  buffer[31] &= 127;
+  buffer[31] |= 64;
+  reverse_buffer (buffer, buflen);
+  if ((err = gcry_mpi_scan (&mpi_k, GCRYMPI_FMT_USG, buffer, buflen, NULL)))
+    {
+      fail ("error scanning MPI for test %d, %s: %s",
+            testno, "k", gpg_strerror (err));
+      goto leave;
+    }
+  gcry_mpi_add (mpi_k, mpi_k, l);
+  xfree (buffer);
+
+  /* Non-canonical values of U are reduced as required by RFC-7748.  */
+  if (!(buffer = hex2buffer (u_str, &buflen)) || buflen != 32)
+    {
+      fail ("error scanning MPI for test %d, %s: %s",
+            testno, "u", "invalid hex string");
+      goto leave;
+    }
+  buffer[31] &= 127;
+  reverse_buffer (buffer, buflen);
+  if ((err = gcry_mpi_scan (&mpi_u, GCRYMPI_FMT_USG, buffer, buflen, NULL)))
+    {
+      fail ("error scanning MPI for test %d, %s: %s",
+            testno, "u", gpg_strerror (err));
+      goto leave;
+    }
+  gcry_mpi_mod (mpi_u, mpi_u, p);
+
+  P = gcry_mpi_point_set (NULL, mpi_u, NULL, GCRYMPI_CONST_ONE);
+  gcry_mpi_ec_mul (Q, mpi_k, P, ctx);
+
+  /* The point at infinity gives 0.  */
+  memset (res, 0, sizeof res);
+  if (!gcry_mpi_ec_get_affine (x, NULL, Q, ctx))
+    {
+      if ((err = gcry_mpi_print (GCRYMPI_FMT_USG, res, sizeof res, &buflen,
+                                 x)))
+        {
+          fail ("error printing MPI for test %d: %s",
+                testno, gpg_strerror (err));
+          goto leave;
+        }
+      memmove (res + sizeof res - buflen, res, buflen);
+      memset (res, 0, sizeof res - buflen);
+      reverse_buffer (res, sizeof res);
+    }
+
+  for (i=0; i < 32; i++)
+    snprintf (&result_hex[i*2], 3, "%02x", res[i]);
+
+  if (strcmp (result_str, result_hex))
+    {
+      fail ("generic ladder failed for test %d: %s",
+            testno, "wrong value returned");
+      info ("  expected: '%s'", result_str);
+      info ("       got: '%s'", result_hex);
+    }
+
+ leave:
+  gcry_mpi_point_release (P);
+  gcry_mpi_point_release (Q);
+  gcry_mpi_release (mpi_u);
+  gcry_mpi_release (mpi_k);
+  gcry_mpi_release (x);
+  gcry_mpi_release (l);
+  gcry_mpi_release (n);
+  gcry_mpi_release (p);
+  xfree (buffer);
+  gcry_ctx_release (ctx);
+}
+
 static void
 test_cv (int testno, const char *k_str, const char *u_str,
          const char *result_str)
 {
   test_cv_hl (testno, k_str, u_str, result_str);
   test_cv_x25519 (testno, k_str, u_str, result_str);
+  test_cv_generic (testno, k_str, u_str, result_str);
 }
 
 /*
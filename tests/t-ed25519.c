@@ -37,6 +37,13 @@ static int sign_with_pk;
 static int no_verify;
 static int custom_data_file;
 
+/* Signatures collected for checking gcry_pk_verify_batch.  */
+#define BATCH_SIZE 64
+static gcry_sexp_t batch_sig[BATCH_SIZE];
+static gcry_sexp_t batch_msg[BATCH_SIZE];
+static gcry_sexp_t batch_pk[BATCH_SIZE];
+static int batch_count;
+
 
 static void
 show_note (const char *format, ...)
@@ -181,6 +188,273 @@ hexdowncase (char *string)
 }
 
 
+/* Verify the collected signatures with gcry_pk_verify_batch.  Then
+ * swap the signatures of the first two items of a full batch and check
+ * that exactly these two are reported as bad.  */
+static void
+check_batch (void)
+{
+  gpg_error_t err;
+  gpg_error_t results[BATCH_SIZE];
+  gcry_sexp_t s_tmp;
+  int i;
+
+  if (!batch_count)
+    return;
+
+  err = gcry_pk_verify_batch (batch_count, batch_sig, batch_msg, batch_pk,
+                              results);
+  if (err)
+    fail ("gcry_pk_verify_batch failed: %s", gpg_strerror (err));
+  for (i=0; i < batch_count; i++)
+    if (results[i])
+      fail ("gcry_pk_verify_batch failed for item %d: %s",
+            i, gpg_strerror (results[i]));
+
+  if (batch_count == BATCH_SIZE)
+    {
+      s_tmp = batch_sig[0];
+      batch_sig[0] = batch_sig[1];
+      batch_sig[1] = s_tmp;
+      err = gcry_pk_verify_batch (batch_count, batch_sig, batch_msg, batch_pk,
+                                  results);
+      if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+        fail ("gcry_pk_verify_batch did not detect a bad signature: %s",
+              gpg_strerror (err));
+      for (i=0; i < batch_count; i++)
+        if ((i < 2) != (gpg_err_code (results[i]) == GPG_ERR_BAD_SIGNATURE))
+          fail ("gcry_pk_verify_batch wrong result for item %d: %s",
+                i, gpg_strerror (results[i]));
+    }
+
+  for (i=0; i < batch_count; i++)
+    {
+      gcry_sexp_release (batch_sig[i]);
+      gcry_sexp_release (batch_msg[i]);
+      gcry_sexp_release (batch_pk[i]);
+    }
+  batch_count = 0;
+}
+
+
+/* Store the 32 byte little-endian encoding of the non-negative A at
+ * BUF.  */
+static void
+mpi_to_le32 (unsigned char *buf, gcry_mpi_t a)
+{
+  unsigned char tmp[32];
+  size_t n, i;
+
+  if (gcry_mpi_print (GCRYMPI_FMT_USG, tmp, sizeof tmp, &n, a))
+    die ("mpi_to_le32 failed\n");
+  memset (buf, 0, 32);
+  for (i=0; i < n; i++)
+    buf[i] = tmp[n - 1 - i];
+}
+
+
+/* Return the integer given by the LEN little-endian bytes at BUF.  */
+static gcry_mpi_t
+le_to_mpi (const unsigned char *buf, size_t len)
+{
+  unsigned char tmp[64];
+  gcry_mpi_t a;
+  size_t i;
+
+  for (i=0; i < len; i++)
+    tmp[i] = buf[len - 1 - i];
+  if (gcry_mpi_scan (&a, GCRYMPI_FMT_USG, tmp, len, NULL))
+    die ("le_to_mpi failed\n");
+  return a;
+}
+
+
+/* Create the signature of MSG for the secret scalar A and the public
+ * key PK with the nonce point rG + ADD.  The signature is only good
+ * if ADD is the neutral element.  */
+static gcry_sexp_t
+make_sig (gcry_ctx_t ctx, gcry_mpi_t a, const unsigned char *pk,
+          const char *msg, gcry_mpi_t r, gcry_mpi_point_t add)
+{
+  gcry_mpi_t n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+  gcry_mpi_point_t G = gcry_mpi_ec_get_point ("g", ctx, 1);
+  gcry_mpi_point_t R = gcry_mpi_point_new (0);
+  gcry_mpi_t x = gcry_mpi_new (0);
+  gcry_mpi_t y = gcry_mpi_new (0);
+  gcry_mpi_t h, s;
+  unsigned char rbuf[32], sbuf[32], digest[64];
+  gcry_md_hd_t md;
+  gcry_sexp_t sig;
+
+  gcry_mpi_ec_mul (R, r, G, ctx);
+  gcry_mpi_ec_add (R, R, add, ctx);
+  if (gcry_mpi_ec_get_affine (x, y, R, ctx))
+    die ("make_sig: point at infinity\n");
+  mpi_to_le32 (rbuf, y);
+  if (gcry_mpi_test_bit (x, 0))
+    rbuf[31] |= 0x80;
+
+  /* S = r + SHA512(R || PK || MSG) * a mod n.  */
+  if (gcry_md_open (&md, GCRY_MD_SHA512, 0))
+    die ("make_sig: gcry_md_open failed\n");
+  gcry_md_write (md, rbuf, 32);
+  gcry_md_write (md, pk, 32);
+  gcry_md_write (md, msg, strlen (msg));
+  memcpy (digest, gcry_md_read (md, 0), 64);
+  gcry_md_close (md);
+  h = le_to_mpi (digest, 64);
+  s = gcry_mpi_new (0);
+  gcry_mpi_mulm (s, h, a, n);
+  gcry_mpi_addm (s, s, r, n);
+  mpi_to_le32 (sbuf, s);
+
+  if (gcry_sexp_build (&sig, NULL, "(sig-val(eddsa(r %b)(s %b)))",
+                       32, rbuf, 32, sbuf))
+    die ("make_sig: gcry_sexp_build failed\n");
+
+  gcry_mpi_release (s);
+  gcry_mpi_release (h);
+  gcry_mpi_release (y);
+  gcry_mpi_release (x);
+  gcry_mpi_point_release (R);
+  gcry_mpi_point_release (G);
+  gcry_mpi_release (n);
+  return sig;
+}
+
+
+/* Check that gcry_pk_verify_batch gives the same results as
+ * gcry_pk_verify for a signature whose R has a component of order 2.
+ * The default check rejects it and the cofactored check accepts it;
+ * the combined check must not depend on its random coefficients, so
+ * it is repeated a few times.  */
+static void
+check_batch_small_order (void)
+{
+  /* The key of the first test of RFC 8032.  */
+  static const char sk_hex[] =
+    "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60";
+  static const char pk_hex[] =
+    "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a";
+  static const char msg[] = "Signature with a small order component";
+  gcry_ctx_t ctx;
+  gcry_mpi_t a, r, p, n, zero, pm1;
+  gcry_mpi_point_t neutral, t2;
+  unsigned char digest[64];
+  unsigned char *sk, *pk;
+  size_t sklen, pklen;
+  gcry_sexp_t s_pk, s_msg, s_msg_c, s_good, s_bad;
+  gcry_sexp_t sigs[3], msgs[3], msgs_c[3], pks[3];
+  gpg_error_t err, results[3], expected[3];
+  int i, round;
+
+  if (verbose)
+    info ("checking batch verification with a small order R\n");
+
+  sk = hex2buffer (sk_hex, &sklen);
+  pk = hex2buffer (pk_hex, &pklen);
+  if (!sk || !pk)
+    die ("check_batch_small_order: bad hex string\n");
+  if (gcry_mpi_ec_new (&ctx, NULL, "Ed25519"))
+    die ("check_batch_small_order: gcry_mpi_ec_new failed\n");
+
+  /* The secret scalar is the clamped first half of SHA512(SK).  */
+  gcry_md_hash_buffer (GCRY_MD_SHA512, digest, sk, sklen);
+  digest[0] &= 248;
+  digest[31] &= 127;
+  digest[31] |= 64;
+  a = le_to_mpi (digest, 32);
+
+  n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+  r = gcry_mpi_new (0);
+  gcry_mpi_randomize (r, 256, GCRY_WEAK_RANDOM);
+  gcry_mpi_mod (r, r, n);
+
+  /* The neutral element (0, 1) and the point (0, -1) of order 2.  */
+  p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+  zero = gcry_mpi_set_ui (NULL, 0);
+  pm1 = gcry_mpi_new (0);
+  gcry_mpi_sub_ui (pm1, p, 1);
+  neutral = gcry_mpi_point_set (NULL, zero, GCRYMPI_CONST_ONE,
+                                GCRYMPI_CONST_ONE);
+  t2 = gcry_mpi_point_set (NULL, zero, pm1, GCRYMPI_CONST_ONE);
+
+  s_good = make_sig (ctx, a, pk, msg, r, neutral);
+  s_bad = make_sig (ctx, a, pk, msg, r, t2);
+
+  if (gcry_sexp_build (&s_pk, NULL,
+                       "(public-key(ecc(curve \"Ed25519\")(flags eddsa)"
+                       "(q %b)))", (int)pklen, pk)
+      || gcry_sexp_build (&s_msg, NULL,
+                          "(data(flags eddsa)(hash-algo sha512)(value %s))",
+                          msg)
+      || gcry_sexp_build (&s_msg_c, NULL,
+                          "(data(flags eddsa cofactored)(hash-algo sha512)"
+                          "(value %s))", msg))
+    die ("check_batch_small_order: gcry_sexp_build failed\n");
+
+  for (i=0; i < 3; i++)
+    {
+      sigs[i] = i == 1? s_bad : s_good;
+      msgs[i] = s_msg;
+      msgs_c[i] = s_msg_c;
+      pks[i] = s_pk;
+      expected[i] = gcry_pk_verify (sigs[i], msgs[i], pks[i]);
+    }
+  if (expected[0])
+    fail ("check_batch_small_order: good signature rejected: %s",
+          gpg_strerror (expected[0]));
+  if (gpg_err_code (expected[1]) != GPG_ERR_BAD_SIGNATURE)
+    fail ("check_batch_small_order: bad signature not rejected: %s",
+          gpg_strerror (expected[1]));
+
+  for (round=0; round < 32; round++)
+    {
+      err = gcry_pk_verify_batch (3, sigs, msgs, pks, results);
+      if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+        fail ("check_batch_small_order: batch returned: %s",
+              gpg_strerror (err));
+      for (i=0; i < 3; i++)
+        if (gpg_err_code (results[i]) != gpg_err_code (expected[i]))
+          fail ("check_batch_small_order: round %d item %d: %s", round, i,
+                gpg_strerror (results[i]));
+    }
+
+  err = gcry_pk_verify (s_bad, s_msg_c, s_pk);
+  if (err)
+    fail ("check_batch_small_order: cofactored check failed: %s",
+          gpg_strerror (err));
+  for (round=0; round < 32; round++)
+    {
+      err = gcry_pk_verify_batch (3, sigs, msgs_c, pks, results);
+      if (err)
+        fail ("check_batch_small_order: cofactored batch returned: %s",
+              gpg_strerror (err));
+      for (i=0; i < 3; i++)
+        if (results[i])
+          fail ("check_batch_small_order: cofactored round %d item %d: %s",
+                round, i, gpg_strerror (results[i]));
+    }
+
+  gcry_sexp_release (s_msg_c);
+  gcry_sexp_release (s_msg);
+  gcry_sexp_release (s_pk);
+  gcry_sexp_release (s_bad);
+  gcry_sexp_release (s_good);
+  gcry_mpi_point_release (t2);
+  gcry_mpi_point_release (neutral);
+  gcry_mpi_release (pm1);
+  gcry_mpi_release (zero);
+  gcry_mpi_release (p);
+  gcry_mpi_release (r);
+  gcry_mpi_release (n);
+  gcry_mpi_release (a);
+  gcry_ctx_release (ctx);
+  xfree (pk);
+  xfree (sk);
+}
+
+
 static void
 one_test (int testno, const char *sk, const char *pk,
           const char *msg, const char *sig)
@@ -327,6 +601,29 @@ one_test (int testno, const char *sk, const char *pk,
       fail ("gcry_pk_verify failed for test %d: %s",
             testno, gpg_strerror (err));
 
+  /* The batch combines only signatures with the cofactored check.  */
+  if (!no_verify && s_sig)
+    {
+      gcry_sexp_release (s_msg);
+      if ((err = gcry_sexp_build (&s_msg, NULL,
+                                  "(data"
+                                  " (flags eddsa cofactored)"
+                                  " (hash-algo sha512)"
+                                  " (value %b))",  (int)buflen, buffer)))
+        {
+          fail ("error building s-exp for test %d, %s: %s",
+                testno, "msg", gpg_strerror (err));
+          goto leave;
+        }
+      if ((err = gcry_pk_verify (s_sig, s_msg, s_pk)))
+        fail ("gcry_pk_verify (cofactored) failed for test %d: %s",
+              testno, gpg_strerror (err));
+      batch_sig[batch_count] = s_sig; s_sig = NULL;
+      batch_msg[batch_count] = s_msg; s_msg = NULL;
+      batch_pk[batch_count] = s_pk; s_pk = NULL;
+      if (++batch_count == BATCH_SIZE)
+        check_batch ();
+    }
 
  leave:
   gcry_sexp_release (s_sig);
@@ -394,6 +691,8 @@ check_ed25519 (const char *fname)
   xfree (msg);
   xfree (sig);
 
+  check_batch ();
+
   if (ntests != N_TESTS && !custom_data_file)
     fail ("did %d tests but expected %d", ntests, N_TESTS);
   else if ((ntests % 256))
@@ -487,6 +786,7 @@ main (int argc, char **argv)
 
   start_timer ();
   check_ed25519 (fname);
+  check_batch_small_order ();
   stop_timer ();
 
   xfree (fname);
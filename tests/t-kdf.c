@@ -26,7 +26,11 @@
 #include <string.h>
 #include <stdarg.h>
 #include <assert.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
 
+#include "../src/gcrypt-testapi.h"
 #include "stopwatch.h"
 #define PGM "t-kdf"
 #include "t-common.h"
@@ -962,6 +966,91 @@ check_pbkdf2 (void)
       "\x13\x3a\x4c\xe8\x37\xb4\xd2\x52\x1e\xe2"
       "\xbf\x03\xe1\x1c\x71\xca\x79\x4e\x07\x97"
     },
+    { /* From RFC-7914 */
+      "passwd", 6,
+      "salt", 4,
+      GCRY_MD_SHA256,
+      1,
+      64,
+      "\x55\xac\x04\x6e\x56\xe3\x08\x9f\xec\x16\x91\xc2\x25\x44\xb6\x05"
+      "\xf9\x41\x85\x21\x6d\xde\x04\x65\xe6\x8b\x9d\x57\xc2\x0d\xac\xbc"
+      "\x49\xca\x9c\xcc\xf1\x79\xb6\x45\x99\x16\x64\xb3\x9d\x77\xef\x31"
+      "\x7c\x71\xb8\x45\xb1\xe3\x0b\xd5\x09\x11\x20\x41\xd3\xa1\x97\x83"
+    },
+    { /* From RFC-7914 */
+      "Password", 8,
+      "NaCl", 4,
+      GCRY_MD_SHA256,
+      80000,
+      64,
+      "\x4d\xdc\xd8\xf6\x0b\x98\xbe\x21\x83\x0c\xee\x5e\xf2\x27\x01\xf9"
+      "\x64\x1a\x44\x18\xd0\x4c\x04\x14\xae\xff\x08\x87\x6b\x34\xab\x56"
+      "\xa1\xd4\x25\xa1\x22\x58\x33\x54\x9a\xdb\x84\x1b\x51\xc9\xb3\x17"
+      "\x6a\x27\x2b\xde\xbb\xa1\xd0\x78\x47\x8f\x62\xb3\x97\xf3\x3c\x8d"
+    },
+    { /* Passphrase longer than the block size, not in an RFC */
+      "passwordPASSWORDpasswordpasswordPASSWORDpassword"
+      "passwordPASSWORDpassword", 72,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA224,
+      4096,
+      50,
+      "\x76\x51\xa9\x61\x4e\xc1\xd8\x28\x6f\xa4\x08\xce\xab\xa4\x1f\x7d"
+      "\x96\x26\xbe\xfa\x44\xa5\x12\x10\x74\x89\xc7\x20\xc2\x92\x03\x16"
+      "\x69\xe3\x5d\x12\x5a\xfc\xc4\xdf\xcf\xad\x91\x72\x66\xc4\xd6\xa7"
+      "\xe1\x57"
+    },
+    { /* not in an RFC */
+      "passwordPASSWORDpassword", 24,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA384,
+      4096,
+      100,
+      "\x81\x91\x43\xad\x66\xdf\x9a\x55\x25\x59\xb9\xe1\x31\xc5\x2a\xe6"
+      "\xc5\xc1\xb0\xee\xd1\x8f\x4d\x28\x3b\x8c\x5c\x9e\xae\xb9\x2b\x39"
+      "\x2c\x14\x7c\xc2\xd2\x86\x9d\x58\xff\xe2\xf7\xda\x13\xd1\x5f\x8d"
+      "\x92\x57\x21\xf0\xed\x1a\xfa\xfa\x24\x48\x0d\x55\xcf\x60\x60\xb1"
+      "\x7f\x11\x2a\x3d\xe7\x4c\xae\x25\xfd\xf3\x56\x9e\x24\x7f\x29\xe4"
+      "\xdb\xb8\x44\x21\x84\x78\x22\xea\x99\xbd\x20\x28\x3c\x3a\x25\xa6"
+      "\x0d\x3d\xb9\x5a"
+    },
+    { /* Passphrase longer than the block size, not in an RFC */
+      "passwordPASSWORDpasswordpasswordPASSWORDpassword"
+      "passwordPASSWORDpasswordpasswordPASSWORDpassword"
+      "passwordPASSWORDpasswordpasswordPASSWORDpassword", 144,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA512,
+      4096,
+      100,
+      "\xa8\xc4\xae\x57\xc6\xdf\x34\xd6\x87\x78\x52\x5d\xc1\x1f\x06\x60"
+      "\xaf\xd1\xf8\x9b\x18\x7b\xe7\xfe\x4f\xd6\xad\xea\x39\x43\x09\x9b"
+      "\x29\x51\xb5\xdf\x58\xcb\xc1\xb2\x2c\xcd\x4b\x83\x50\xf9\x5f\x1e"
+      "\xc8\x53\xb7\x98\x9d\xaa\xf4\xcf\x0e\x47\x35\xc2\x00\x31\xac\xcd"
+      "\x03\x34\xf2\x56\xf2\x3a\x4c\xc6\xcb\xfe\xa6\x1e\x39\xb7\xb5\x1a"
+      "\x3e\xb9\x8d\xfc\xfe\x3c\x7f\x62\xd3\x5f\x4a\xe1\x6d\x87\x61\xd2"
+      "\x14\xbd\x24\x9c"
+    },
+    { /* not in an RFC */
+      "passwordPASSWORDpassword", 24,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA512_256,
+      1000,
+      40,
+      "\xda\xa7\xf4\x1a\xfa\x56\x9a\xea\x39\xe9\x5f\x03\xb1\xbc\x2c\x6e"
+      "\xfb\x99\xfc\x78\x71\xe5\xff\xed\x46\x92\x09\xc8\x22\xd0\xab\xe6"
+      "\x3e\xa4\x63\xd7\x19\x8e\xb1\x27"
+    },
+    { /* not in an RFC */
+      "passwordPASSWORDpassword", 24,
+      "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36,
+      GCRY_MD_SHA512_224,
+      1000,
+      60,
+      "\x29\xa1\x77\x8b\xd7\x2e\xdd\x4b\x7e\xc7\xd9\x27\x28\xcd\x8a\x77"
+      "\xd2\x3f\x5b\x02\x5a\x2c\x4c\x06\xc5\x14\x08\xc5\xf1\xb8\xed\x61"
+      "\x2d\xd3\x75\xa5\x7e\x57\xd7\x82\x77\x00\xe6\x22\x17\x9b\x48\x6a"
+      "\x93\xad\x98\xcf\x56\xea\x48\x68\x8b\x83\x82\xab"
+    },
     {
       "password", 8,
       "salt", 4,
@@ -1118,6 +1207,16 @@ check_pbkdf2 (void)
 }
 
 
+static gcry_error_t my_kdf_derive (int parallel, int algo, int subalgo,
+                                    const unsigned long *params,
+                                    unsigned int paramslen,
+                                    const unsigned char *pass, size_t passlen,
+                                    const unsigned char *salt, size_t saltlen,
+                                    const unsigned char *key, size_t keylen,
+                                    const unsigned char *ad, size_t adlen,
+                                    size_t outlen, unsigned char *out);
+
+
 static void
 check_scrypt (void)
 {
@@ -1187,6 +1286,7 @@ check_scrypt (void)
   int tvidx;
   gpg_error_t err;
   unsigned char outbuf[64];
+  unsigned long param[3];
   int i;
 
   for (tvidx=0; tvidx < DIM(tv); tvidx++)
@@ -1211,7 +1311,351 @@ check_scrypt (void)
             fprintf (stderr, " %02x", outbuf[i]);
           putc ('\n', stderr);
         }
+
+      /* Run the lanes as parallel jobs.  */
+      param[0] = tv[tvidx].parm_n;
+      param[1] = tv[tvidx].parm_r;
+      param[2] = tv[tvidx].parm_p;
+      memset (outbuf, 0, sizeof outbuf);
+      err = my_kdf_derive (1, GCRY_KDF_SCRYPT, 0, param, 3,
+                           (const unsigned char *)tv[tvidx].p, tv[tvidx].plen,
+                           (const unsigned char *)tv[tvidx].salt,
+                           tv[tvidx].saltlen, NULL, 0, NULL, 0,
+                           tv[tvidx].dklen, outbuf);
+      if (err)
+        fail ("scrypt test %d (jobs) failed: %s\n",
+              tvidx, gpg_strerror (err));
+      else if (memcmp (outbuf, tv[tvidx].dk, tv[tvidx].dklen))
+        fail ("scrypt test %d (jobs) failed: mismatch\n", tvidx);
+    }
+}
+
+
+/* Check that gcry_kdf_derive_batch yields the same keys as separate
+   calls to gcry_kdf_derive.  */
+static void
+check_kdf_batch (void)
+{
+  static struct {
+    int algo;
+    int subalgo;
+    unsigned long c;
+    size_t dklen;
+  } tv[] = {
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA1,       100, 20 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA256,     100, 32 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA256,     100, 70 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA384,     100, 48 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA512,     100, 100 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_SHA512_224, 100, 28 },
+    { GCRY_KDF_PBKDF2, GCRY_MD_RMD160,     100, 20 },
+    { GCRY_KDF_ITERSALTED_S2K, GCRY_MD_SHA256, 1024, 32 }
+  };
+#define NPASS 11
+  unsigned char pass[NPASS][150];
+  unsigned char salt[NPASS][20];
+  unsigned char key[NPASS][100];
+  unsigned char ref[100];
+  const void *passp[NPASS];
+  const void *saltp[NPASS];
+  void *keyp[NPASS];
+  size_t passlen[NPASS];
+  size_t saltlen[NPASS];
+  gpg_error_t err;
+  int tvidx, i;
+
+  for (i = 0; i < NPASS; i++)
+    {
+      memset (pass[i], 'a' + i, sizeof pass[i]);
+      memset (salt[i], 'A' + i, sizeof salt[i]);
+      passp[i] = pass[i];
+      passlen[i] = 1 + i * 14;
+      saltp[i] = salt[i];
+      keyp[i] = key[i];
+    }
+
+  for (tvidx=0; tvidx < DIM(tv); tvidx++)
+    {
+      if (gcry_md_test_algo (tv[tvidx].subalgo))
+        continue;
+      if (verbose)
+        fprintf (stderr, "checking KDF batch %d algo %d/%d\n", tvidx,
+                 tv[tvidx].algo, tv[tvidx].subalgo);
+      for (i = 0; i < NPASS; i++)
+        saltlen[i] = (tv[tvidx].algo == GCRY_KDF_PBKDF2? 1 + i : 8);
+
+      err = gcry_kdf_derive_batch (NPASS, passp, passlen,
+                                   tv[tvidx].algo, tv[tvidx].subalgo,
+                                   saltp, saltlen, tv[tvidx].c,
+                                   tv[tvidx].dklen, keyp);
+      if (err)
+        {
+          fail ("kdf batch test %d failed: %s\n", tvidx, gpg_strerror (err));
+          continue;
+        }
+
+      for (i = 0; i < NPASS; i++)
+        {
+          err = gcry_kdf_derive (pass[i], passlen[i],
+                                 tv[tvidx].algo, tv[tvidx].subalgo,
+                                 salt[i], saltlen[i], tv[tvidx].c,
+                                 tv[tvidx].dklen, ref);
+          if (err)
+            fail ("kdf batch test %d.%d failed: %s\n",
+                  tvidx, i, gpg_strerror (err));
+          else if (memcmp (key[i], ref, tv[tvidx].dklen))
+            fail ("kdf batch test %d.%d failed: mismatch\n", tvidx, i);
+        }
     }
+
+  /* Missing salts are rejected for PBKDF2.  */
+  err = gcry_kdf_derive_batch (NPASS, passp, passlen,
+                               GCRY_KDF_PBKDF2, GCRY_MD_SHA256,
+                               NULL, NULL, 100, 32, keyp);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("kdf batch test without salts returned: %s\n", gpg_strerror (err));
+
+  /* An empty salt is handled as by gcry_kdf_derive: it is rejected
+     for PBKDF2 and allowed for scrypt.  */
+  for (i = 0; i < NPASS; i++)
+    saltlen[i] = i == 3? 0 : 8;
+  err = gcry_kdf_derive_batch (NPASS, passp, passlen,
+                               GCRY_KDF_PBKDF2, GCRY_MD_SHA256,
+                               saltp, saltlen, 100, 32, keyp);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("kdf batch test with an empty salt returned: %s\n",
+          gpg_strerror (err));
+  err = gcry_kdf_derive_batch (NPASS, passp, passlen, GCRY_KDF_SCRYPT, 16,
+                               saltp, saltlen, 1, 32, keyp);
+  if (err)
+    fail ("kdf batch test with an empty scrypt salt failed: %s\n",
+          gpg_strerror (err));
+  else
+    for (i = 0; i < NPASS; i++)
+      {
+        err = gcry_kdf_derive (pass[i], passlen[i], GCRY_KDF_SCRYPT, 16,
+                               salt[i], saltlen[i], 1, 32, ref);
+        if (err)
+          fail ("kdf batch scrypt test %d failed: %s\n",
+                i, gpg_strerror (err));
+        else if (memcmp (key[i], ref, 32))
+          fail ("kdf batch scrypt test %d failed: mismatch\n", i);
+      }
+#undef NPASS
+}
+
+
+#ifdef HAVE_PTHREAD
+/* Simple thread ops for the KDF: one thread per dispatched job.  */
+#define MAX_KDF_THREADS 16
+
+struct kdf_job
+{
+  gcry_kdf_job_fn_t fn;
+  void *priv;
+};
+
+struct kdf_jobs
+{
+  unsigned int num_jobs;
+  pthread_t thread[MAX_KDF_THREADS];
+  struct kdf_job job[MAX_KDF_THREADS];
+};
+
+static void *
+kdf_job_thread (void *arg)
+{
+  struct kdf_job *job = arg;
+
+  job->fn (job->priv);
+  return NULL;
+}
+
+static int
+kdf_dispatch_job (void *jobs_context, gcry_kdf_job_fn_t job_fn,
+                  void *job_priv)
+{
+  struct kdf_jobs *jobs = jobs_context;
+  unsigned int n = jobs->num_jobs;
+
+  if (n >= MAX_KDF_THREADS)
+    return -1;
+
+  jobs->job[n].fn = job_fn;
+  jobs->job[n].priv = job_priv;
+  if (pthread_create (&jobs->thread[n], NULL, kdf_job_thread, &jobs->job[n]))
+    return -1;
+  jobs->num_jobs++;
+  return 0;
+}
+
+static int
+kdf_wait_all_jobs (void *jobs_context)
+{
+  struct kdf_jobs *jobs = jobs_context;
+  unsigned int i;
+  int ret = 0;
+
+  for (i = 0; i < jobs->num_jobs; i++)
+    if (pthread_join (jobs->thread[i], NULL))
+      ret = -1;
+  jobs->num_jobs = 0;
+  return ret;
+}
+#endif /*HAVE_PTHREAD*/
+
+
+static gcry_error_t
+my_kdf_derive (int parallel, int algo, int subalgo,
+               const unsigned long *params, unsigned int paramslen,
+               const unsigned char *pass, size_t passlen,
+               const unsigned char *salt, size_t saltlen,
+               const unsigned char *key, size_t keylen,
+               const unsigned char *ad, size_t adlen,
+               size_t outlen, unsigned char *out)
+{
+  gcry_error_t err;
+  gcry_kdf_hd_t hd;
+#ifdef HAVE_PTHREAD
+  struct kdf_jobs jobs;
+  gcry_kdf_thread_ops_t ops;
+#endif
+
+  err = gcry_kdf_open (&hd, algo, subalgo, params, paramslen,
+                       pass, passlen, salt, saltlen, key, keylen,
+                       ad, adlen);
+  if (err)
+    return err;
+
+#ifdef HAVE_PTHREAD
+  if (parallel)
+    {
+      memset (&jobs, 0, sizeof jobs);
+      ops.jobs_context = &jobs;
+      ops.dispatch_job = kdf_dispatch_job;
+      ops.wait_all_jobs = kdf_wait_all_jobs;
+      err = gcry_kdf_compute (hd, &ops);
+    }
+  else
+#else
+  (void)parallel;
+#endif
+    err = gcry_kdf_compute (hd, NULL);
+
+  if (!err)
+    err = gcry_kdf_final (hd, outlen, out);
+
+  gcry_kdf_close (hd);
+  return err;
+}
+
+
+static void
+check_argon2 (void)
+{
+  /* Test vectors are from RFC 9106, section 5.  */
+  static const unsigned char pass[32] = {
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01
+  };
+  static const unsigned char salt[16] = {
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02
+  };
+  static const unsigned char key[8] = {
+    0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03
+  };
+  static const unsigned char ad[12] = {
+    0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04,
+    0x04, 0x04, 0x04, 0x04
+  };
+  static struct {
+    int subalgo;
+    const char *tag;
+  } tv[] = {
+    {
+      GCRY_KDF_ARGON2D,
+      "\x51\x2b\x39\x1b\x6f\x11\x62\x97\x53\x71\xd3\x09\x19\x73\x42\x94"
+      "\xf8\x68\xe3\xbe\x39\x84\xf3\xc1\xa1\x3a\x4d\xb9\xfa\xbe\x4a\xcb"
+    },
+    {
+      GCRY_KDF_ARGON2I,
+      "\xc8\x14\xd9\xd1\xdc\x7f\x37\xaa\x13\xf0\xd7\x7f\x24\x94\xbd\xa1"
+      "\xc8\xde\x6b\x01\x6d\xd3\x88\xd2\x99\x52\xa4\xc4\x67\x2b\x6c\xe8"
+    },
+    {
+      GCRY_KDF_ARGON2ID,
+      "\x0d\x64\x0d\xf5\x8d\x78\x76\x6c\x08\xc0\x37\xa3\x4a\x8b\x53\xc9"
+      "\xd0\x1e\xf0\x45\x2d\x75\xb6\x5e\xb5\x25\x20\xe9\x6b\x01\xe6\x59"
+    }
+  };
+  /* Tag length, passes, memory in KiB, parallelism.  */
+  static const unsigned long param[4] = { 32, 3, 32, 4 };
+  /* With 2 MiB of memory the blocks are mapped with huge pages.  The
+     tag was computed with the reference implementation.  */
+  static const unsigned long large_param[4] = { 32, 2, 2048, 4 };
+  static const char large_tag[] =
+    "\xcf\xf6\xb2\xeb\x42\x3b\x41\x46\x2c\x18\x25\x87\xed\x98\x06\x42"
+    "\x94\x17\x6a\x1f\xa1\xc2\x9e\xfa\xd4\xa0\x32\xac\x26\x61\x18\xa6";
+  gpg_error_t err;
+  unsigned char out[32];
+  int tvidx, parallel, i;
+
+  for (tvidx = 0; tvidx < DIM(tv); tvidx++)
+    for (parallel = 0; parallel < 2; parallel++)
+      {
+        if (verbose)
+          fprintf (stderr, "checking Argon2 test vector %d%s\n", tvidx,
+                   parallel ? " (threaded)" : "");
+        err = my_kdf_derive (parallel, GCRY_KDF_ARGON2, tv[tvidx].subalgo,
+                             param, 4, pass, sizeof pass, salt, sizeof salt,
+                             key, sizeof key, ad, sizeof ad,
+                             sizeof out, out);
+        if (err)
+          fail ("argon2 test %d failed: %s\n", tvidx, gpg_strerror (err));
+        else if (memcmp (out, tv[tvidx].tag, sizeof out))
+          {
+            fail ("argon2 test %d failed: mismatch\n", tvidx);
+            fputs ("got:", stderr);
+            for (i=0; i < sizeof out; i++)
+              fprintf (stderr, " %02x", out[i]);
+            putc ('\n', stderr);
+          }
+      }
+
+  for (parallel = 0; parallel < 2; parallel++)
+    {
+      if (verbose)
+        fprintf (stderr, "checking Argon2 with 2 MiB%s\n",
+                 parallel ? " (threaded)" : "");
+      err = my_kdf_derive (parallel, GCRY_KDF_ARGON2, GCRY_KDF_ARGON2ID,
+                           large_param, 4, pass, sizeof pass,
+                           salt, sizeof salt, NULL, 0, NULL, 0,
+                           sizeof out, out);
+      if (err)
+        fail ("argon2 test with 2 MiB failed: %s\n", gpg_strerror (err));
+      else if (memcmp (out, large_tag, sizeof out))
+        fail ("argon2 test with 2 MiB failed: mismatch\n");
+    }
+
+  /* Invalid parameters.  */
+  err = my_kdf_derive (0, GCRY_KDF_ARGON2, GCRY_KDF_ARGON2ID, param, 2,
+                       pass, sizeof pass, salt, sizeof salt,
+                       NULL, 0, NULL, 0, sizeof out, out);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("argon2 with too few parameters: %s\n", gpg_strerror (err));
+  err = my_kdf_derive (0, GCRY_KDF_ARGON2, 3, param, 4,
+                       pass, sizeof pass, salt, sizeof salt,
+                       NULL, 0, NULL, 0, sizeof out, out);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("argon2 with invalid variant: %s\n", gpg_strerror (err));
+  err = my_kdf_derive (0, GCRY_KDF_ARGON2, GCRY_KDF_ARGON2ID, param, 4,
+                       pass, sizeof pass, salt, sizeof salt,
+                       NULL, 0, NULL, 0, sizeof out - 1, out);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("argon2 with wrong output length: %s\n", gpg_strerror (err));
 }
 
 
@@ -1238,7 +1682,8 @@ main (int argc, char **argv)
                  "Options:\n"
                  " --verbose    print timinigs etc.\n"
                  " --debug      flyswatter\n"
-                 " --s2k        print the time needed for S2K\n",
+                 " --s2k        print the time needed for S2K\n"
+                 " --disable-hwf NAME  disable the hardware feature NAME\n",
                  stdout);
           exit (0);
         }
@@ -1258,6 +1703,18 @@ main (int argc, char **argv)
           s2kcount = 1;
           argc--; argv++;
         }
+      else if (!strcmp (*argv, "--disable-hwf"))
+        {
+          argc--; argv++;
+          if (argc)
+            {
+              if (gcry_control (GCRYCTL_DISABLE_HWF, *argv, NULL))
+                fprintf (stderr,
+                         PGM ": unknown hardware feature '%s'"
+                         " - option ignored\n", *argv);
+              argc--; argv++;
+            }
+        }
       else if (!strncmp (*argv, "--", 2))
         die ("unknown option '%s'\n", *argv);
     }
@@ -1285,7 +1742,16 @@ main (int argc, char **argv)
     {
       check_openpgp ();
       check_pbkdf2 ();
+      check_kdf_batch ();
       check_scrypt ();
+      /* Run the vectors again with the generic BlockMix.  */
+      if (!gcry_control (PRIV_CTL_SET_SCRYPT_SSE2, 1))
+        {
+          xgcry_control ((PRIV_CTL_SET_SCRYPT_SSE2, 0));
+          check_scrypt ();
+          xgcry_control ((PRIV_CTL_SET_SCRYPT_SSE2, 1));
+        }
+      check_argon2 ();
     }
 
   return error_count ? 1 : 0;
@@ -3282,6 +3282,320 @@ check_ec_mul (void)
 }
 
 
+/* Check that multiplying the base point gives the same result as
+   multiplying an equivalent point with a Z coordinate other than one.
+   The former uses the precomputed table of the curve.  */
+static void
+check_ec_mul_base (void)
+{
+  static const char *curves[] = {
+    "NIST P-192", "NIST P-256", "NIST P-521", "secp256k1",
+    "brainpoolP384r1", "Ed25519", "Ed448", NULL
+  };
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_t p, k, x, y, z, t, x1, y1, x2, y2;
+  gcry_mpi_point_t G, G2, Q1, Q2;
+  int idx, i, edwards, inf1, inf2;
+  unsigned int nbits;
+
+  for (idx = 0; curves[idx]; idx++)
+    {
+      err = gcry_mpi_ec_new (&ctx, NULL, curves[idx]);
+      if (err && gcry_fips_mode_active ())
+        continue;  /* Not all curves are supported in fips mode.  */
+      if (err)
+        {
+          fail ("'%s': can't create context: %s\n",
+                curves[idx], gpg_strerror (err));
+          continue;
+        }
+      edwards = !strncmp (curves[idx], "Ed", 2);
+
+      G = gcry_mpi_ec_get_point ("g", ctx, 1);
+      p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+      nbits = gcry_mpi_get_nbits (p);
+      x = gcry_mpi_new (0);
+      y = gcry_mpi_new (0);
+      t = gcry_mpi_new (0);
+      z = gcry_mpi_set_ui (NULL, 7);
+      gcry_mpi_point_get (x, y, NULL, G);
+      if (edwards)
+        {
+          gcry_mpi_mulm (x, x, z, p);
+          gcry_mpi_mulm (y, y, z, p);
+        }
+      else
+        {
+          gcry_mpi_mulm (t, z, z, p);
+          gcry_mpi_mulm (x, x, t, p);
+          gcry_mpi_mulm (t, t, z, p);
+          gcry_mpi_mulm (y, y, t, p);
+        }
+      G2 = gcry_mpi_point_snatch_set (NULL, x, y, z);
+
+      Q1 = gcry_mpi_point_new (0);
+      Q2 = gcry_mpi_point_new (0);
+      x1 = gcry_mpi_new (0);
+      y1 = gcry_mpi_new (0);
+      x2 = gcry_mpi_new (0);
+      y2 = gcry_mpi_new (0);
+
+      for (i = 0; i < 10; i++)
+        {
+          /* Odd rounds use a scalar in secure memory.  The last two
+             use a scalar of zero.  */
+          k = (i & 1)? gcry_mpi_snew (nbits) : gcry_mpi_new (nbits);
+          if (i < 2)
+            gcry_mpi_set_ui (k, i + 1);
+          else if (i < 8)
+            gcry_mpi_randomize (k, nbits - i, GCRY_WEAK_RANDOM);
+
+          gcry_mpi_ec_mul (Q1, k, G, ctx);
+          gcry_mpi_ec_mul (Q2, k, G2, ctx);
+          inf1 = gcry_mpi_ec_get_affine (x1, y1, Q1, ctx);
+          inf2 = gcry_mpi_ec_get_affine (x2, y2, Q2, ctx);
+          if (i >= 8 && !edwards)
+            {
+              if (!inf1 || !inf2)
+                fail ("'%s': base point multiply %d failed\n",
+                      curves[idx], i);
+            }
+          else if (inf1 || inf2
+                   || gcry_mpi_cmp (x1, x2) || gcry_mpi_cmp (y1, y2))
+            {
+              fail ("'%s': base point multiply %d failed\n", curves[idx], i);
+              print_mpi ("  k", k);
+              print_mpi (" x1", x1);
+              print_mpi (" x2", x2);
+            }
+          gcry_mpi_release (k);
+        }
+
+      gcry_mpi_release (x1);
+      gcry_mpi_release (y1);
+      gcry_mpi_release (x2);
+      gcry_mpi_release (y2);
+      gcry_mpi_release (t);
+      gcry_mpi_release (p);
+      gcry_mpi_point_release (Q1);
+      gcry_mpi_point_release (Q2);
+      gcry_mpi_point_release (G2);
+      gcry_mpi_point_release (G);
+      gcry_ctx_release (ctx);
+    }
+}
+
+
+/* Check that the multiplication with a public scalar, which uses the
+   wNAF method, gives the same result as the constant-time fixed-window
+   method used for a scalar in secure memory.  The latter handles even
+   scalars separately, so some of them are tested explicitly.  */
+static void
+check_ec_mul_public (void)
+{
+  static const char *curves[] = {
+    "NIST P-256", "NIST P-384", "NIST P-521", "secp256k1",
+    "brainpoolP256r1", "Ed25519", "Ed448", NULL
+  };
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_t p, n, k, ks, x1, y1, x2, y2;
+  gcry_mpi_point_t G, Q, R1, R2;
+  int idx, i, inf1, inf2;
+  unsigned int nbits;
+
+  for (idx = 0; curves[idx]; idx++)
+    {
+      err = gcry_mpi_ec_new (&ctx, NULL, curves[idx]);
+      if (err && gcry_fips_mode_active ())
+        continue;  /* Not all curves are supported in fips mode.  */
+      if (err)
+        {
+          fail ("'%s': can't create context: %s\n",
+                curves[idx], gpg_strerror (err));
+          continue;
+        }
+
+      G = gcry_mpi_ec_get_point ("g", ctx, 1);
+      p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+      n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+      nbits = gcry_mpi_get_nbits (p);
+
+      /* Use a point with a Z coordinate other than one.  */
+      Q = gcry_mpi_point_new (0);
+      k = gcry_mpi_set_ui (NULL, 5);
+      gcry_mpi_ec_mul (Q, k, G, ctx);
+      gcry_mpi_release (k);
+
+      R1 = gcry_mpi_point_new (0);
+      R2 = gcry_mpi_point_new (0);
+      x1 = gcry_mpi_new (0);
+      y1 = gcry_mpi_new (0);
+      x2 = gcry_mpi_new (0);
+      y2 = gcry_mpi_new (0);
+
+      for (i = 0; i < 10; i++)
+        {
+          k = gcry_mpi_new (nbits);
+          if (i == 0)
+            gcry_mpi_set_ui (k, 0);
+          else if (i == 1)
+            gcry_mpi_set_ui (k, 1);
+          else if (i == 2)
+            gcry_mpi_set (k, n);
+          else if (i == 3)
+            gcry_mpi_sub_ui (k, n, 1);
+          else if (i == 4)
+            gcry_mpi_set_ui (k, 2);
+          else if (i == 5)
+            gcry_mpi_set_ui (k, 32);
+          else
+            gcry_mpi_randomize (k, nbits - i, GCRY_WEAK_RANDOM);
+          /* Note that gcry_mpi_set also copies the flags.  */
+          ks = gcry_mpi_copy (k);
+          gcry_mpi_set_flag (ks, GCRYMPI_FLAG_SECURE);
+
+          gcry_mpi_ec_mul (R1, k, Q, ctx);
+          gcry_mpi_ec_mul (R2, ks, Q, ctx);
+          inf1 = gcry_mpi_ec_get_affine (x1, y1, R1, ctx);
+          inf2 = gcry_mpi_ec_get_affine (x2, y2, R2, ctx);
+          if (inf1 != inf2
+              || (!inf1 && (gcry_mpi_cmp (x1, x2) || gcry_mpi_cmp (y1, y2))))
+            {
+              fail ("'%s': public scalar multiply %d failed\n",
+                    curves[idx], i);
+              print_mpi ("  k", k);
+              print_mpi (" x1", x1);
+              print_mpi (" x2", x2);
+            }
+          gcry_mpi_release (ks);
+          gcry_mpi_release (k);
+        }
+
+      gcry_mpi_release (x1);
+      gcry_mpi_release (y1);
+      gcry_mpi_release (x2);
+      gcry_mpi_release (y2);
+      gcry_mpi_release (n);
+      gcry_mpi_release (p);
+      gcry_mpi_point_release (R1);
+      gcry_mpi_point_release (R2);
+      gcry_mpi_point_release (Q);
+      gcry_mpi_point_release (G);
+      gcry_ctx_release (ctx);
+    }
+}
+
+
+/* Check that point coordinates which are not reduced modulo p give
+   the same results as the reduced ones.  The fast field functions of
+   the NIST curves need to reduce such input themselves.  The points
+   need not be on the curve for this.  */
+static void
+check_ec_unreduced (void)
+{
+  static const char *curves[] = {
+    "NIST P-256", "NIST P-384", "NIST P-521", NULL
+  };
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_t p, u, ur, v, vr, k, one, x1, y1, x2, y2;
+  gcry_mpi_point_t U, UR, V, VR, R1, R2;
+  int idx, i, inf1, inf2;
+  unsigned int nbits;
+
+  wherestr = "check_ec_unreduced";
+  for (idx = 0; curves[idx]; idx++)
+    {
+      err = gcry_mpi_ec_new (&ctx, NULL, curves[idx]);
+      if (err)
+        {
+          fail ("'%s': can't create context: %s\n",
+                curves[idx], gpg_strerror (err));
+          continue;
+        }
+
+      p = gcry_mpi_ec_get_mpi ("p", ctx, 1);
+      nbits = gcry_mpi_get_nbits (p);
+
+      /* U = (2^NBITS - 1, 2^NBITS - 1, 1), V = (2^NBITS - 2,
+         2^NBITS - 1, 1) and UR and VR the same reduced.  Adding U and
+         V adds the unreduced coordinates.  */
+      one = gcry_mpi_set_ui (NULL, 1);
+      u = gcry_mpi_new (0);
+      gcry_mpi_mul_2exp (u, one, nbits);
+      gcry_mpi_sub_ui (u, u, 1);
+      ur = gcry_mpi_new (0);
+      gcry_mpi_mod (ur, u, p);
+      v = gcry_mpi_new (0);
+      gcry_mpi_sub_ui (v, u, 1);
+      vr = gcry_mpi_new (0);
+      gcry_mpi_mod (vr, v, p);
+      U = gcry_mpi_point_set (NULL, u, u, one);
+      UR = gcry_mpi_point_set (NULL, ur, ur, one);
+      V = gcry_mpi_point_set (NULL, v, u, one);
+      VR = gcry_mpi_point_set (NULL, vr, ur, one);
+
+      R1 = gcry_mpi_point_new (0);
+      R2 = gcry_mpi_point_new (0);
+      x1 = gcry_mpi_new (0);
+      y1 = gcry_mpi_new (0);
+      x2 = gcry_mpi_new (0);
+      y2 = gcry_mpi_new (0);
+      k = gcry_mpi_set_ui (NULL, 3);
+
+      for (i = 0; i < 3; i++)
+        {
+          if (i == 0)
+            {
+              gcry_mpi_ec_add (R1, U, V, ctx);
+              gcry_mpi_ec_add (R2, UR, VR, ctx);
+            }
+          else if (i == 1)
+            {
+              gcry_mpi_ec_dup (R1, U, ctx);
+              gcry_mpi_ec_dup (R2, UR, ctx);
+            }
+          else
+            {
+              gcry_mpi_ec_mul (R1, k, U, ctx);
+              gcry_mpi_ec_mul (R2, k, UR, ctx);
+            }
+          inf1 = gcry_mpi_ec_get_affine (x1, y1, R1, ctx);
+          inf2 = gcry_mpi_ec_get_affine (x2, y2, R2, ctx);
+          if (inf1 != inf2
+              || (!inf1 && (gcry_mpi_cmp (x1, x2) || gcry_mpi_cmp (y1, y2))))
+            {
+              fail ("'%s': operation %d on unreduced point failed\n",
+                    curves[idx], i);
+              print_mpi (" x1", x1);
+              print_mpi (" x2", x2);
+            }
+        }
+
+      gcry_mpi_release (k);
+      gcry_mpi_release (x1);
+      gcry_mpi_release (y1);
+      gcry_mpi_release (x2);
+      gcry_mpi_release (y2);
+      gcry_mpi_release (u);
+      gcry_mpi_release (ur);
+      gcry_mpi_release (v);
+      gcry_mpi_release (vr);
+      gcry_mpi_release (one);
+      gcry_mpi_release (p);
+      gcry_mpi_point_release (R1);
+      gcry_mpi_point_release (R2);
+      gcry_mpi_point_release (U);
+      gcry_mpi_point_release (UR);
+      gcry_mpi_point_release (V);
+      gcry_mpi_point_release (VR);
+      gcry_ctx_release (ctx);
+    }
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -3306,6 +3620,9 @@ main (int argc, char **argv)
   basic_ec_math ();
   point_on_curve ();
   check_ec_mul ();
+  check_ec_mul_base ();
+  check_ec_mul_public ();
+  check_ec_unreduced ();
 
   /* The tests are for P-192 and ed25519 which are not supported in
      FIPS mode.  */
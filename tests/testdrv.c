@@ -66,6 +66,7 @@ static struct {
    { "hmac"        },
    { "hashtest"    },
    { "t-kdf"       },
+   { "t-kdf-disable-all-hwf", "t-kdf", "--disable-hwf all" },
    { "keygrip"     },
    { "fips186-dsa" },
    { "aeswrap"     },